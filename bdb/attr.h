@@ -110,6 +110,9 @@ DEF_ATTR(LOWDISKTHRESHOLD, lowdiskthreshold, PERCENT, 95)
 DEF_ATTR(SQLBULKSZ, sqlbulksz, BYTES, 2 * 1024 * 1024)
 DEF_ATTR(ZLIBLEVEL, zlib_level, QUANTITY, 6)
 DEF_ATTR(ZTRACE, ztrace, QUANTITY, 0)
+DEF_ATTR(ZSTDLEVEL, zstd_level, QUANTITY, 3)
+DEF_ATTR(ZSTD_DICT_SIZE, zstd_dict_size, BYTES, 16384)
+DEF_ATTR(ZSTD_DICT_SAMPLES, zstd_dict_samples, QUANTITY, 10000)
 DEF_ATTR(PANICLOGSNAP, paniclogsnap, BOOLEAN, 1)
 DEF_ATTR(UPDATEGENIDS, updategenids, BOOLEAN, 0)
 DEF_ATTR(ROUND_ROBIN_STRIPES, round_robin_stripes, BOOLEAN, 0)
@@ -198,6 +201,8 @@ DEF_ATTR(TEMPTABLE_MEM_THRESHOLD, temptable_mem_threshold, QUANTITY, 512)
 
 DEF_ATTR(TEMPTABLE_CACHESZ, temptable_cachesz, BYTES, 262144)
 
+DEF_ATTR(TEMPTABLE_MEM_BUDGET, temptable_mem_budget, BYTES, 2097152)
+
 /* the number of bits allocated for the participant stripe id.  The remaining
  * bits are used for the update id */
 DEF_ATTR(PARTICIPANTID_BITS, participantid_bits, QUANTITY, 0)
@@ -279,7 +279,8 @@ enum COMPRESS {
     BDB_COMPRESS_ZLIB = 1,
     BDB_COMPRESS_RLE8 = 2,
     BDB_COMPRESS_CRLE = 3,
-    BDB_COMPRESS_LZ4 = 4
+    BDB_COMPRESS_LZ4 = 4,
+    BDB_COMPRESS_ZSTD = 5
 };
 
 int bdb_compr2algo(const char *a);
@@ -1051,6 +1052,11 @@ void bdb_set_odh_options(bdb_state_type *bdb_state, int odh, int compression,
 void bdb_get_compr_flags(bdb_state_type *bdb_state, int *odh, int *compr,
                          int *blob_compr);
 
+/* train a zstd dictionary on a sample of the table's records and make it the
+ * one new records are compressed with. */
+int bdb_train_compr_dict(bdb_state_type *bdb_state, int nsamples, int dictsz,
+                         unsigned *dictid);
+
 /* delete a table from disk.  must already be closed but NOT freed */
 int bdb_del(bdb_state_type *bdb_state, tran_type *tran, int *bdberr);
 int bdb_del_temp(bdb_state_type *bdb_state, tran_type *tran, int *bdberr);
@@ -1665,6 +1671,9 @@ int udppfault_thdpool_init(void);
 extern struct thdpool *gbl_pgcompact_thdpool;
 int pgcompact_thdpool_init(void);
 
+extern struct thdpool *gbl_dirscan_thdpool;
+int dirscan_thdpool_init(void);
+
 int get_dbnum_by_handle(bdb_state_type *bdb_state);
 int send_myseqnum_to_master(bdb_state_type *, int nodelay);
 
@@ -1778,6 +1787,15 @@ int bdb_get_table_csonparameters(const char *table, char **value, int *len);
 int bdb_set_table_csonparameters(void *parent_tran, const char *table,
                                  const char *value, int len);
 int bdb_del_table_csonparameters(void *parent_tran, const char *table);
+
+/* zstd dictionaries for a table, by dictionary id.  Id 0 isn't a dictionary,
+ * it holds the id of the one new records are compressed with. */
+int bdb_get_compr_dict(const char *table, unsigned id, void **dict, int *len);
+int bdb_set_compr_dict(void *parent_tran, const char *table, unsigned id,
+                       const void *dict, int len);
+int bdb_get_compr_dict_id(const char *table, unsigned *id);
+int bdb_set_compr_dict_id(void *parent_tran, const char *table, unsigned id);
+int bdb_del_compr_dicts(void *parent_tran, const char *table);
 int bdb_clear_table_parameter(void *parent_tran, const char *table,
                               const char *parameter);
 int bdb_get_table_parameter(const char *table, const char *parameter,
@@ -104,6 +104,9 @@ typedef struct bdb_cursor_ifn {
     int (*setnullblob)(struct bdb_cursor_ifn *cur, unsigned long long genid,
                        int dbnum, int blobno, int *bdberr);
 
+    /* Only the first len bytes of each row will be read (0 for all). */
+    void (*set_projection)(struct bdb_cursor_ifn *cur, int len);
+
     /* close */
     int (*close)(struct bdb_cursor_ifn *cur, int *bdberr);
 
@@ -194,4 +197,10 @@ int bdb_get_context_from_lsn(bdb_state_type *bdb_state, void *lsnp,
 
 int bdb_direct_count(bdb_cursor_ifn_t *, int ixnum, int64_t *count);
 
+/* Called for every record by bdb_direct_scan, from one thread per stripe. */
+typedef int (*bdb_direct_scan_fn)(void *arg, int stripe, void *dta, int dtalen,
+                                  uint8_t ver);
+int bdb_direct_scan(bdb_cursor_ifn_t *, int nstripes, bdb_direct_scan_fn fn,
+                    void *arg);
+
 #endif
@@ -627,6 +627,9 @@ struct bdb_cursor_impl_tag {
 
     struct pglogs_queue_cursor *queue_cursor;
 
+    /* if non-zero, callers only read this many leading bytes of a row */
+    int projlen;
+
     uint8_t ver;
     uint8_t trak;    /* debug this cursor: set to 1 for verbose */
     uint8_t used_rl; /* set to 1 if rl position was consumed */
@@ -942,6 +945,7 @@ struct bdb_state_tag {
     signed char ondisk_header; /* boolean: give each record an ondisk header? */
     signed char compress;      /* boolean: compress data? */
     signed char compress_blobs; /*boolean: compress blobs? */
+    struct zstd_dicts *zdicts;  /* zstd dictionaries, loaded on first use */
 
     signed char got_gblcontext;
     signed char need_to_upgrade;
@@ -1216,6 +1220,9 @@ void bdb_get_error(bdb_state_type *bdb_state, DB_TXN *tid, int rc,
 void bdb_c_get_error(bdb_state_type *bdb_state, DB_TXN *tid, DBC **dbcp, int rc,
                      int not_found_rc, int *bdberr, const char *context_str);
 
+int bdb_direct_scan_state(bdb_state_type *bdb_state, bdb_direct_scan_fn fn,
+                          void *fnarg);
+
 /* compression wrappers for I/O */
 void bdb_maybe_compress_data(bdb_state_type *bdb_state, DBT *data, DBT *data2);
 void bdb_maybe_uncompress_data(bdb_state_type *bdb_state, DBT *data,
@@ -1223,6 +1230,9 @@ void bdb_maybe_uncompress_data(bdb_state_type *bdb_state, DBT *data,
 
 int bdb_cget_unpack(bdb_state_type *bdb_state, DBC *dbcp, DBT *key, DBT *data,
                     uint8_t *ver, u_int32_t flags);
+int bdb_cget_unpack_prefix(bdb_state_type *bdb_state, DBC *dbcp, DBT *key,
+                           DBT *data, uint8_t *ver, u_int32_t flags,
+                           size_t prefixlen);
 int bdb_cget_unpack_blob(bdb_state_type *bdb_state, DBC *dbcp, DBT *key,
                          DBT *data, uint8_t *ver, u_int32_t flags);
 int bdb_get_unpack_blob(bdb_state_type *bdb_state, DB *db, DB_TXN *tid,
@@ -1256,6 +1266,9 @@ int bdb_pack(bdb_state_type *bdb_state, const struct odh *odh, void *to,
 
 int bdb_unpack(bdb_state_type *bdb_state, const void *from, size_t fromlen,
                void *to, size_t tolen, struct odh *odh, void **freeptr);
+int bdb_unpack_prefix(bdb_state_type *bdb_state, const void *from,
+                      size_t fromlen, void *to, size_t tolen, struct odh *odh,
+                      void **freeptr, size_t prefixlen);
 
 int ip_updates_enabled_sc(bdb_state_type *bdb_state);
 int ip_updates_enabled(bdb_state_type *bdb_state);
@@ -91,6 +91,7 @@ as long as there was a successful move in the past
 #include <list.h>
 #include <plhash.h>
 #include "logmsg.h"
+#include "thdpool.h"
 
 #include "genid.h"
 #define MERGE_DEBUG (0)
@@ -269,6 +270,7 @@ static void bdb_cursor_found_data(struct bdb_cursor_ifn *cur, int *rrn,
                                   void **data, uint8_t *ver);
 static void *bdb_cursor_collattr(bdb_cursor_ifn_t *cur);
 static int bdb_cursor_collattrlen(bdb_cursor_ifn_t *cur);
+static void bdb_cursor_set_projection(bdb_cursor_ifn_t *cur, int len);
 
 static int bdb_cursor_insert(bdb_cursor_ifn_t *cur, unsigned long long genid,
                              void *data, int datalen, void *datacopy,
@@ -723,6 +725,7 @@ bdb_cursor_ifn_t *bdb_cursor_open(
     pcur_ifn->getshadowtran = bdb_cursor_get_shadowtran;
 
     pcur_ifn->setnullblob = bdb_cursor_set_null_blob_in_shadows;
+    pcur_ifn->set_projection = bdb_cursor_set_projection;
     pcur_ifn->pause = bdb_cursor_pause;
     pcur_ifn->pauseall = pause_pagelock_cursors;
     pcur_ifn->pausearg = pausearg;
@@ -8059,6 +8062,13 @@ static int bdb_cursor_collattrlen(bdb_cursor_ifn_t *cur)
     return cur->impl->collattr_len;
 }
 
+static void bdb_cursor_set_projection(bdb_cursor_ifn_t *cur, int len)
+{
+    /* only data rows are decompressed by the berkdb layer */
+    if (cur->impl->type == BDBC_DT)
+        cur->impl->projlen = len;
+}
+
 struct count_arg {
     DB *db;
     int64_t count;
@@ -8153,3 +8163,194 @@ int bdb_direct_count(bdb_cursor_ifn_t *cur, int ixnum, int64_t *rcnt)
     *rcnt = count;
     return rc == DB_NOTFOUND ? 0 : -1;
 }
+
+struct scan_arg {
+    bdb_state_type *state;
+    DB *db;
+    int stripe;
+    bdb_direct_scan_fn fn;
+    void *fnarg;
+    int rc;
+};
+
+static void *db_scan(void *varg)
+{
+    int rc;
+    struct scan_arg *arg = varg;
+    bdb_state_type *state = arg->state;
+
+    DBT k = {0};
+    k.data = alloca(MAXKEYSZ);
+    k.ulen = MAXKEYSZ;
+    k.flags = DB_DBT_USERMEM;
+
+    DBT v = {0};
+    v.data = alloca(128 * 1024);
+    v.ulen = 128 * 1024;
+    v.flags = DB_DBT_USERMEM;
+
+    /* room for a decompressed record, plus the two bytes instant
+     * schema change may grow it by */
+    size_t unpacklen = state->lrl + 2;
+    void *unpackbuf = malloc(unpacklen);
+    if (unpackbuf == NULL) {
+        arg->rc = ENOMEM;
+        return NULL;
+    }
+
+    DB *db = arg->db;
+    DBC *dbc;
+    if ((rc = db->cursor(db, NULL, &dbc, 0)) != 0) {
+        free(unpackbuf);
+        arg->rc = rc;
+        return NULL;
+    }
+    while ((rc = dbc->c_get(dbc, &k, &v, DB_NEXT | DB_MULTIPLE_KEY)) == 0) {
+        uint8_t *kk, *vv;
+        uint32_t ks, vs;
+        void *bulk;
+        DB_MULTIPLE_INIT(bulk, &v);
+        DB_MULTIPLE_KEY_NEXT(bulk, &v, kk, ks, vv, vs);
+        while (bulk) {
+            struct odh odh;
+            rc = bdb_unpack(state, vv, vs, unpackbuf, unpacklen, &odh, NULL);
+            if (rc == 0)
+                rc = arg->fn(arg->fnarg, arg->stripe, odh.recptr, odh.length,
+                             odh.csc2vers);
+            if (rc)
+                goto done;
+            DB_MULTIPLE_KEY_NEXT(bulk, &v, kk, ks, vv, vs);
+        }
+    }
+done:
+    dbc->c_close(dbc);
+    free(unpackbuf);
+    arg->rc = rc;
+    return NULL;
+}
+
+/* Hand every record in the data stripes of cur's table to fn, one thread per
+ * stripe where the direct scan pool has one free.  fn sees the record without its ondisk header and is called with
+ * the stripe number, so fnarg usually points at per-stripe state sized for
+ * nstripes; -1 is returned if the table doesn't have that many.  Like
+ * bdb_direct_count this reads outside of any transaction.  A non-zero return
+ * from fn stops that stripe and is returned from here. */
+int bdb_direct_scan(bdb_cursor_ifn_t *cur, int nstripes, bdb_direct_scan_fn fn,
+                    void *fnarg)
+{
+    bdb_state_type *state = cur->impl->state;
+    int stripes = state->attr->dtastripe > 0 ? state->attr->dtastripe : 1;
+
+    if (nstripes != stripes)
+        return -1;
+    return bdb_direct_scan_state(state, fn, fnarg);
+}
+
+struct thdpool *gbl_dirscan_thdpool = NULL;
+
+int dirscan_thdpool_init(void)
+{
+    gbl_dirscan_thdpool = thdpool_create("DIRECT SCAN pool", 0);
+
+    thdpool_set_minthds(gbl_dirscan_thdpool, 0);
+    thdpool_set_maxthds(gbl_dirscan_thdpool, 16);
+    thdpool_set_linger(gbl_dirscan_thdpool, 30);
+    /* never queue: with every helper busy the caller scans the stripe
+     * itself rather than wait behind another query's scan */
+    thdpool_set_maxqueue(gbl_dirscan_thdpool, 0);
+
+    return 0;
+}
+
+struct scan_batch {
+    pthread_mutex_t lk;
+    pthread_cond_t cd;
+    int pending;
+};
+
+struct scan_work {
+    struct scan_batch *batch;
+    struct scan_arg *arg;
+    int queued;
+    int done;
+};
+
+static void db_scan_pp(struct thdpool *pool, void *work, void *thddata, int op)
+{
+    struct scan_work *w = work;
+    struct scan_batch *b = w->batch;
+
+    /* on THD_FREE the stripe is left for the caller to scan */
+    if (op == THD_RUN) {
+        db_scan(w->arg);
+        w->done = 1;
+    }
+
+    pthread_mutex_lock(&b->lk);
+    if (--b->pending == 0)
+        pthread_cond_signal(&b->cd);
+    pthread_mutex_unlock(&b->lk);
+}
+
+/* bdb_direct_scan for callers that have the table but no cursor.  Stripes
+ * go to the direct scan pool; whatever it can't take is scanned here. */
+int bdb_direct_scan_state(bdb_state_type *state, bdb_direct_scan_fn fn,
+                          void *fnarg)
+{
+    DB **db = state->dbp_data[0];
+    int stripes = state->attr->dtastripe > 0 ? state->attr->dtastripe : 1;
+    struct scan_arg args[stripes];
+    struct scan_work w[stripes];
+    struct scan_batch b;
+    int rc = 0;
+
+    pthread_mutex_init(&b.lk, NULL);
+    pthread_cond_init(&b.cd, NULL);
+    b.pending = 0;
+
+    for (int i = 0; i < stripes; ++i) {
+        args[i].state = state;
+        args[i].db = db[i];
+        args[i].stripe = i;
+        args[i].fn = fn;
+        args[i].fnarg = fnarg;
+        args[i].rc = 0;
+        w[i].batch = &b;
+        w[i].arg = &args[i];
+        w[i].queued = 0;
+        w[i].done = 0;
+        if (i == stripes - 1 || gbl_dirscan_thdpool == NULL)
+            continue;
+        pthread_mutex_lock(&b.lk);
+        b.pending++;
+        pthread_mutex_unlock(&b.lk);
+        if (thdpool_enqueue(gbl_dirscan_thdpool, db_scan_pp, &w[i], 0,
+                            NULL) == 0) {
+            w[i].queued = 1;
+        } else {
+            pthread_mutex_lock(&b.lk);
+            b.pending--;
+            pthread_mutex_unlock(&b.lk);
+        }
+    }
+    for (int i = stripes - 1; i >= 0; --i) {
+        if (!w[i].queued)
+            db_scan(&args[i]);
+    }
+
+    pthread_mutex_lock(&b.lk);
+    while (b.pending > 0)
+        pthread_cond_wait(&b.cd, &b.lk);
+    pthread_mutex_unlock(&b.lk);
+
+    for (int i = 0; i < stripes; ++i) {
+        if (w[i].queued && !w[i].done)
+            db_scan(&args[i]);
+        if (args[i].rc != DB_NOTFOUND && rc == 0)
+            rc = args[i].rc;
+    }
+
+    pthread_cond_destroy(&b.cd);
+    pthread_mutex_destroy(&b.lk);
+    return rc;
+}
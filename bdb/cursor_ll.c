@@ -710,8 +710,9 @@ static int process_bulk_odh(bdb_berkdb_t *pberkdb, int *bdberr)
     bdb_state_type *bdb_state = berkdb->cur->state;
     int rc;
 
-    rc = bdb_unpack(berkdb->cur->state, bt->lastdta, bt->lastdtasize,
-                    bt->odh_tmp, bt->odh.ulen, &odh, NULL);
+    rc = bdb_unpack_prefix(berkdb->cur->state, bt->lastdta, bt->lastdtasize,
+                           bt->odh_tmp, bt->odh.ulen, &odh, NULL,
+                           berkdb->cur->projlen);
     if (rc != 0) {
         *bdberr = BDBERR_UNPACK;
         return -1;
@@ -1425,8 +1426,8 @@ static int bdb_berkdb_cget(bdb_berkdb_impl_t *berkdb, int use_bulk, int how,
 
     bt->need_update_shadows = 1;
     if (bt->use_odh && !bt->use_bulk)
-        rc = bdb_cget_unpack(berkdb->cur->state, bt->dbc, &bt->key, &bt->data,
-                             &bt->ver, how);
+        rc = bdb_cget_unpack_prefix(berkdb->cur->state, bt->dbc, &bt->key,
+                                    &bt->data, &bt->ver, how, cur->projlen);
     else {
         if (!bt->dbc) {
             *bdberr = BDBERR_DEADLOCK;
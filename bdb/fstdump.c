@@ -55,6 +55,9 @@
 #include <sbuf2.h>
 #include <logmsg.h>
 
+/* Pages read by dumps are cached on probation, see __memp_fget */
+extern __thread int memp_scan_thread;
+
 struct error_extension {
     uint32_t length; /* length of this struct in bytes */
     int32_t bdberr;
@@ -1086,8 +1089,10 @@ int bdb_dtadump_next(bdb_state_type *bdb_state, struct dtadump *dump,
 
         /* do a multiple key extract if our buffer is empty */
         if (!dump->have_keys) {
+            ++memp_scan_thread;
             rc = dump->cur->c_get(dump->cur, &dump->dbt_key, &dump->dbt_dta,
                                   DB_MULTIPLE_KEY | DB_NEXT);
+            --memp_scan_thread;
             if (rc == DB_NOTFOUND) {
                 rc = dump->cur->c_close(dump->cur);
                 dump->cur = NULL;
@@ -1235,7 +1240,10 @@ static int get_retry(DBC *dbcp, fstdump_t *common, DBT *key, DBT *data,
     int retries = 0;
     int rc;
     while (retries < gbl_maxretries) {
-        if ((rc = dbcp->c_get(dbcp, key, data, flags)) == 0) {
+        ++memp_scan_thread;
+        rc = dbcp->c_get(dbcp, key, data, flags);
+        --memp_scan_thread;
+        if (rc == 0) {
             return 0;
         }
         if (rc == DB_NOTFOUND)
@@ -179,6 +179,17 @@ static void log_stats(FILE *out, bdb_state_type *bdb_state)
         prn_stat(st_inline_writes);
     }
 
+    if (stats->st_group_flushes || stats->st_group_waiters) {
+        prn_stat(st_group_commits);
+        prn_stat(st_group_flushes);
+        prn_stat(st_group_waiters);
+        prn_stat(st_commit_lat_p50);
+        prn_stat(st_commit_lat_p90);
+        prn_stat(st_commit_lat_p99);
+        prn_stat(st_commit_lat_p999);
+        prn_stat(st_commit_lat_max);
+    }
+
     free(stats);
 }
 
@@ -306,6 +317,15 @@ static void lock_stats(FILE *out, bdb_state_type *bdb_state)
     prn_stat(st_nnowaits);
 #endif
     prn_stat(st_ndeadlocks);
+    prn_stat(st_ndetects);
+    prn_lstat(st_detect_usecs);
+    prn_lstat(st_detect_cpu_usecs);
+    prn_stat(st_nwfg_detects);
+    prn_stat(st_nwfg_cycles);
+    prn_stat(st_nwfg_fallbacks);
+    prn_lstat(st_wfg_visits);
+    prn_lstat(st_wfg_usecs);
+    prn_lstat(st_wfg_cpu_usecs);
     prn_stat(st_locktimeout);
     prn_stat(st_nlocktimeouts);
     prn_stat(st_txntimeout);
@@ -329,7 +349,8 @@ static void rep_stats(FILE *out, bdb_state_type *bdb_state)
     char str[80];
     extern int64_t gbl_rep_trans_parallel, gbl_rep_trans_serial,
         gbl_rep_trans_deadlocked, gbl_rep_trans_inline,
-        gbl_rep_rowlocks_multifile;
+        gbl_rep_rowlocks_multifile, gbl_rep_trans_page_parallel,
+        gbl_rep_apply_barriers, gbl_rep_apply_records, gbl_rep_apply_usecs;
 
     bdb_state->dbenv->rep_stat(bdb_state->dbenv, &stats, 0);
 
@@ -382,6 +403,14 @@ static void rep_stats(FILE *out, bdb_state_type *bdb_state)
     logmsgf(LOGMSG_USER, out, "txn inline: %lld\n", gbl_rep_trans_inline);
     logmsgf(LOGMSG_USER, out, "txn multifile rowlocks: %lld\n", gbl_rep_rowlocks_multifile);
     logmsgf(LOGMSG_USER, out, "txn deadlocked: %lld\n", gbl_rep_trans_deadlocked);
+    logmsgf(LOGMSG_USER, out, "txn page parallel: %lld\n",
+            gbl_rep_trans_page_parallel);
+    logmsgf(LOGMSG_USER, out, "apply barriers: %lld\n", gbl_rep_apply_barriers);
+    logmsgf(LOGMSG_USER, out, "apply records: %lld in %lld us (%.0f recs/sec)\n",
+            gbl_rep_apply_records, gbl_rep_apply_usecs,
+            gbl_rep_apply_usecs
+                ? gbl_rep_apply_records * 1000000.0 / gbl_rep_apply_usecs
+                : 0.0);
     prn_lstat(lc_cache_hits);
     prn_lstat(lc_cache_misses);
     prn_stat(lc_cache_size);
@@ -506,6 +535,7 @@ static void cache_stats(FILE *out, bdb_state_type *bdb_state, int extra)
 {
     DB_MPOOL_STAT *stats;
     DB_MPOOL_FSTAT **fsp, **i;
+    u_int32_t hits, misses;
 
     bdb_state->dbenv->memp_stat(bdb_state->dbenv, &stats, extra ? &fsp : NULL,
                                 0);
@@ -544,6 +574,8 @@ static void cache_stats(FILE *out, bdb_state_type *bdb_state, int extra)
     prn_stat(st_hash_nowait);
     prn_stat(st_hash_wait);
     prn_stat(st_hash_max_wait);
+    prn_stat(st_hash_optimistic);
+    prn_stat(st_hash_optimistic_miss);
     prn_stat(st_region_wait);
     prn_stat(st_region_nowait);
     prn_stat(st_alloc);
@@ -553,6 +585,11 @@ static void cache_stats(FILE *out, bdb_state_type *bdb_state, int extra)
     prn_stat(st_alloc_max_pages);
     prn_stat(st_ckp_pages_sync);
     prn_stat(st_ckp_pages_skip);
+    prn_stat(st_scan_hit);
+    prn_stat(st_scan_miss);
+    prn_stat(st_scan_promote);
+    prn_stat(st_scan_evict);
+    prn_stat(st_scan_pages);
 
     if (extra) {
         bdb_state->dbenv->memp_dump_region(bdb_state->dbenv, "A", out);
@@ -577,6 +614,19 @@ static void cache_stats(FILE *out, bdb_state_type *bdb_state, int extra)
                     (unsigned)(*i)->st_page_create);
             logmsgf(LOGMSG_USER, out, "  st_page_in    : %u\n", (unsigned)(*i)->st_page_in);
             logmsgf(LOGMSG_USER, out, "  st_page_out   : %u\n", (unsigned)(*i)->st_page_out);
+            logmsgf(LOGMSG_USER, out, "  st_scan_hit   : %u\n",
+                    (unsigned)(*i)->st_scan_hit);
+            logmsgf(LOGMSG_USER, out, "  st_scan_miss  : %u\n",
+                    (unsigned)(*i)->st_scan_miss);
+            logmsgf(LOGMSG_USER, out, "  st_scan_promote: %u\n",
+                    (unsigned)(*i)->st_scan_promote);
+            logmsgf(LOGMSG_USER, out, "  st_scan_evict : %u\n",
+                    (unsigned)(*i)->st_scan_evict);
+            hits = (*i)->st_cache_hit - (*i)->st_scan_hit;
+            misses = (*i)->st_cache_miss - (*i)->st_scan_miss;
+            if (hits + misses)
+                logmsgf(LOGMSG_USER, out, "  non-scan hit %%: %.2f\n",
+                        100.0 * hits / (hits + misses));
         }
 
         free(fsp);
@@ -613,6 +663,8 @@ static void temp_cache_stats(FILE *out, bdb_state_type *bdb_state)
     prn_stat(st_hash_nowait);
     prn_stat(st_hash_wait);
     prn_stat(st_hash_max_wait);
+    prn_stat(st_hash_optimistic);
+    prn_stat(st_hash_optimistic_miss);
     prn_stat(st_region_wait);
     prn_stat(st_region_nowait);
     prn_stat(st_alloc);
@@ -156,7 +156,8 @@ typedef enum {
     LLMETA_VERSIONED_SP = 42,
     LLMETA_DEFAULT_VERSIONED_SP = 43,
     LLMETA_TABLE_USER_SCHEMA    = 44,
-    LLMETA_USER_PASSWORD_HASH   = 45
+    LLMETA_USER_PASSWORD_HASH   = 45,
+    LLMETA_COMPR_DICT = 46 /* key = 46 + TABLENAME[33] + DICTID */
 } llmetakey_t;
 
 struct llmeta_file_type_key {
@@ -7218,13 +7219,23 @@ retry:
     return 0;
 }
 
+static void llmeta_blob_key(char *llkey, llmetakey_t key, const char *table)
+{
+    memset(llkey, 0, LLMETA_IXLEN);
+    key = htonl(key);
+    memcpy(llkey, &key, sizeof(key));
+    if (table)
+        memcpy((llkey + sizeof(key)), table,
+               strnlen(table, LLMETA_IXLEN - sizeof(key)));
+}
+
 /* caller is responsible to free the memory
  * returns 0: key found
  *  1: not found
  * -1: error
+ * value comes back nul terminated, but may hold binary data
  */
-static int llmeta_get_blob(llmetakey_t key, const char *table, char **value,
-                           int *len)
+static int llmeta_get_blob_key(char *llkey, char **value, int *len)
 {
 #ifdef DEBUG
     fprintf(stderr, "%s\n", __func__);
@@ -7232,24 +7243,16 @@ static int llmeta_get_blob(llmetakey_t key, const char *table, char **value,
     if (llmeta_bdb_state == NULL)
         return -1;
     int rc, bdberr;
-    void *tran;
     char *tmpstr = NULL;
-    char llkey[LLMETA_IXLEN] = {0};
     int retry = 0;
 
-    key = htonl(key);
-    memcpy(llkey, &key, sizeof(key));
-    if (table)
-        memcpy((llkey + sizeof(key)), table,
-               strnlen(table, LLMETA_IXLEN - sizeof(key)));
-
 rep:
     if ((rc = bdb_lite_exact_var_fetch_tran(llmeta_bdb_state, NULL, llkey,
                                             (void **)&tmpstr, len, &bdberr)) ==
         0) {
         assert(tmpstr != NULL);
         *value = malloc(*len + 1);
-        strncpy(*value, tmpstr, *len);
+        memcpy(*value, tmpstr, *len);
         (*value)[*len] = '\0';
 #ifdef DEBUG
         fprintf(
@@ -7276,13 +7279,20 @@ rep:
     return rc;
 }
 
+static int llmeta_get_blob(llmetakey_t key, const char *table, char **value,
+                           int *len)
+{
+    char llkey[LLMETA_IXLEN];
+    llmeta_blob_key(llkey, key, table);
+    return llmeta_get_blob_key(llkey, value, len);
+}
+
 /* find & delete old -> add new
  * returns 0: success
  *  -1: error
  */
-static int llmeta_del_set_blob(void *parent_tran, llmetakey_t key,
-                               const char *table, const char *value, int len,
-                               int deleteonly)
+static int llmeta_del_set_blob_key(void *parent_tran, char *llkey,
+                                   const char *value, int len, int deleteonly)
 {
 #ifdef DEBUG
     fprintf(stderr, "%s\n", __func__);
@@ -7301,13 +7311,6 @@ rep:
                 bdberr, retry);
         goto err;
     }
-    char llkey[LLMETA_IXLEN] = {0};
-    key = htonl(key);
-    memcpy(llkey, &key, sizeof(key));
-    if (table)
-        memcpy((llkey + sizeof(key)), table,
-               strnlen(table, LLMETA_IXLEN - sizeof(key)));
-
     int fndlen;
     char *tmpstr = NULL;
     if ((rc = bdb_lite_exact_var_fetch_tran(llmeta_bdb_state, NULL, llkey,
@@ -7367,6 +7370,15 @@ out:
     return rc;
 }
 
+static int llmeta_del_set_blob(void *parent_tran, llmetakey_t key,
+                               const char *table, const char *value, int len,
+                               int deleteonly)
+{
+    char llkey[LLMETA_IXLEN];
+    llmeta_blob_key(llkey, key, table);
+    return llmeta_del_set_blob_key(parent_tran, llkey, value, len, deleteonly);
+}
+
 static inline int llmeta_del_blob(void *parent_tran, llmetakey_t key,
                                   const char *table)
 {
@@ -7399,6 +7411,55 @@ int bdb_del_table_csonparameters(void *parent_tran, const char *table)
     return llmeta_del_blob(parent_tran, LLMETA_TABLE_PARAMETERS, table);
 }
 
+static void llmeta_compr_dict_key(char *llkey, const char *table, unsigned id)
+{
+    llmeta_blob_key(llkey, LLMETA_COMPR_DICT, table);
+    id = htonl(id);
+    memcpy(llkey + sizeof(int) + LLMETA_TBLLEN + 1, &id, sizeof(id));
+}
+
+/* returns 0: found, 1: not found, -1: error
+ * NB: caller needs to free *dict */
+int bdb_get_compr_dict(const char *table, unsigned id, void **dict, int *len)
+{
+    char llkey[LLMETA_IXLEN];
+    llmeta_compr_dict_key(llkey, table, id);
+    return llmeta_get_blob_key(llkey, (char **)dict, len);
+}
+
+int bdb_set_compr_dict(void *parent_tran, const char *table, unsigned id,
+                       const void *dict, int len)
+{
+    char llkey[LLMETA_IXLEN];
+    llmeta_compr_dict_key(llkey, table, id);
+    return llmeta_del_set_blob_key(parent_tran, llkey, dict, len, 0);
+}
+
+/* returns 0: found, 1: no dictionary, -1: error */
+int bdb_get_compr_dict_id(const char *table, unsigned *id)
+{
+    void *val = NULL;
+    int len, rc;
+
+    rc = bdb_get_compr_dict(table, 0, &val, &len);
+    if (rc == 0) {
+        if (len == sizeof(*id)) {
+            memcpy(id, val, sizeof(*id));
+            *id = ntohl(*id);
+        } else {
+            rc = -1;
+        }
+        free(val);
+    }
+    return rc;
+}
+
+int bdb_set_compr_dict_id(void *parent_tran, const char *table, unsigned id)
+{
+    id = htonl(id);
+    return bdb_set_compr_dict(parent_tran, table, 0, &id, sizeof(id));
+}
+
 #include <cson_amalgamation_core.h>
 
 /* return parameter for tbl into value
@@ -8050,6 +8111,25 @@ static int kv_put(tran_type *tran, void *k, void *v, size_t vlen, int *bdberr)
     return rc;
 }
 
+/* Delete every dictionary trained for table along with the current id; they
+ * all share the LLMETA_COMPR_DICT + table prefix. */
+int bdb_del_compr_dicts(void *parent_tran, const char *table)
+{
+    char prefix[LLMETA_IXLEN];
+    void **keys = NULL;
+    int n = 0, i, rc, bdberr;
+
+    llmeta_blob_key(prefix, LLMETA_COMPR_DICT, table);
+    rc = kv_get_keys(prefix, sizeof(int) + LLMETA_TBLLEN + 1, &keys, &n,
+                     &bdberr);
+    for (i = 0; rc == 0 && i < n; ++i)
+        rc = llmeta_del_set_blob_key(parent_tran, keys[i], NULL, 0, 1);
+    for (i = 0; i < n; ++i)
+        free(keys[i]);
+    free(keys);
+    return rc;
+}
+
 /*
 **
 ** bdb_kv_funcs() - operate on key-value pairs where:
@@ -35,6 +35,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#include <time.h>
 #include <fsnap.h>
 
 #include "bdb_int.h"
@@ -45,7 +46,10 @@
 #include <comdb2rle.h>
 
 #include <lz4.h>
+#include <zstd.h>
+#include <zdict.h>
 #include <logmsg.h>
+#include <memory_sync.h>
 
 #if LZ4_VERSION_NUMBER < 10701
 #define LZ4_compress_default LZ4_compress_limitedOutput
@@ -150,6 +154,8 @@ const char *bdb_algo2compr(int alg)
         return "crle";
     case BDB_COMPRESS_LZ4:
         return "lz4 ";
+    case BDB_COMPRESS_ZSTD:
+        return "zstd";
     default:
         return "????";
     }
@@ -165,6 +171,8 @@ int bdb_compr2algo(const char *a)
         return BDB_COMPRESS_CRLE;
     if (strncasecmp(a, "lz4", 3) == 0)
         return BDB_COMPRESS_LZ4;
+    if (strcasecmp(a, "zstd") == 0)
+        return BDB_COMPRESS_ZSTD;
     return BDB_COMPRESS_NONE;
 }
 
@@ -257,6 +265,236 @@ static void read_odh(const void *buf, struct odh *odh)
 
 #ifndef ODH_TESTS
 
+/* zstd dictionaries are trained per table (see bdb_train_compr_dict) and kept
+ * in llmeta by the id zstd writes into every frame it compresses with one, so
+ * a record says which dictionary it needs without any help from the ODH.
+ * Once loaded a dictionary is never freed: handles come and go with schema
+ * changes but old records keep needing it.  The list for a table only grows
+ * at the head, so readers walk it without the lock. */
+struct zstd_dict {
+    unsigned id;
+    void *buf;
+    int len;
+    ZSTD_DDict *ddict;
+    ZSTD_CDict *cdict; /* only made for the dictionary we compress with */
+    struct zstd_dict *next;
+};
+
+struct zstd_dicts {
+    char *table;
+    struct zstd_dict *dicts;
+    struct zstd_dict *cur;
+    int cur_loaded;
+    struct zstd_dicts *next;
+};
+
+static pthread_mutex_t zstd_dicts_lk = PTHREAD_MUTEX_INITIALIZER;
+static struct zstd_dicts *zstd_tables;
+
+struct zstd_ctx {
+    ZSTD_CCtx *cctx;
+    ZSTD_DCtx *dctx;
+};
+
+static pthread_key_t zstd_ctx_key;
+static pthread_once_t zstd_ctx_once = PTHREAD_ONCE_INIT;
+
+static void zstd_ctx_free(void *p)
+{
+    struct zstd_ctx *z = p;
+    ZSTD_freeCCtx(z->cctx);
+    ZSTD_freeDCtx(z->dctx);
+    free(z);
+}
+
+static void zstd_ctx_key_init(void)
+{
+    pthread_key_create(&zstd_ctx_key, zstd_ctx_free);
+}
+
+/* zstd contexts are expensive to set up, so each thread keeps its own */
+static struct zstd_ctx *zstd_get_ctx(void)
+{
+    struct zstd_ctx *z;
+
+    pthread_once(&zstd_ctx_once, zstd_ctx_key_init);
+    if ((z = pthread_getspecific(zstd_ctx_key)) != NULL)
+        return z;
+    if ((z = malloc(sizeof(*z))) == NULL)
+        return NULL;
+    z->cctx = ZSTD_createCCtx();
+    z->dctx = ZSTD_createDCtx();
+    if (z->cctx == NULL || z->dctx == NULL) {
+        zstd_ctx_free(z);
+        return NULL;
+    }
+    pthread_setspecific(zstd_ctx_key, z);
+    return z;
+}
+
+static const char *zstd_table(bdb_state_type *bdb_state)
+{
+    return bdb_state->origname ? bdb_state->origname : bdb_state->name;
+}
+
+static struct zstd_dicts *zstd_get_dicts(bdb_state_type *bdb_state)
+{
+    struct zstd_dicts *zd = bdb_state->zdicts;
+    const char *table = zstd_table(bdb_state);
+
+    if (table == NULL)
+        return NULL;
+    if (zd && strcmp(zd->table, table) == 0)
+        return zd;
+
+    pthread_mutex_lock(&zstd_dicts_lk);
+    for (zd = zstd_tables; zd; zd = zd->next) {
+        if (strcmp(zd->table, table) == 0)
+            break;
+    }
+    if (zd == NULL && (zd = calloc(1, sizeof(*zd))) != NULL) {
+        if ((zd->table = strdup(table)) == NULL) {
+            free(zd);
+            zd = NULL;
+        } else {
+            zd->next = zstd_tables;
+            zstd_tables = zd;
+        }
+    }
+    pthread_mutex_unlock(&zstd_dicts_lk);
+    bdb_state->zdicts = zd;
+    return zd;
+}
+
+/* call with zstd_dicts_lk held */
+static struct zstd_dict *zstd_load_dict(struct zstd_dicts *zd, unsigned id)
+{
+    struct zstd_dict *d;
+
+    for (d = zd->dicts; d; d = d->next) {
+        if (d->id == id)
+            return d;
+    }
+    if ((d = calloc(1, sizeof(*d))) == NULL)
+        return NULL;
+    d->id = id;
+    if (bdb_get_compr_dict(zd->table, id, &d->buf, &d->len) != 0) {
+        logmsg(LOGMSG_ERROR, "%s: can't find dictionary %u for %s\n",
+               __func__, id, zd->table);
+        free(d);
+        return NULL;
+    }
+    if ((d->ddict = ZSTD_createDDict(d->buf, d->len)) == NULL) {
+        free(d->buf);
+        free(d);
+        return NULL;
+    }
+    d->next = zd->dicts;
+    MEMORY_SYNC;
+    zd->dicts = d;
+    return d;
+}
+
+static struct zstd_dict *zstd_find_dict(struct zstd_dicts *zd, unsigned id)
+{
+    struct zstd_dict *d;
+
+    for (d = zd->dicts; d; d = d->next) {
+        if (d->id == id)
+            return d;
+    }
+    pthread_mutex_lock(&zstd_dicts_lk);
+    d = zstd_load_dict(zd, id);
+    pthread_mutex_unlock(&zstd_dicts_lk);
+    return d;
+}
+
+/* The dictionary new records are compressed with, or NULL if the table
+ * doesn't have one yet.  Looked up again after bdb_set_odh_options. */
+static struct zstd_dict *zstd_cur_dict(bdb_state_type *bdb_state,
+                                       struct zstd_dicts *zd)
+{
+    struct zstd_dict *d;
+    unsigned id;
+    int rc;
+
+    if (zd->cur_loaded) {
+        MEMORY_SYNC;
+        return zd->cur;
+    }
+
+    pthread_mutex_lock(&zstd_dicts_lk);
+    if (!zd->cur_loaded) {
+        zd->cur = NULL;
+        rc = bdb_get_compr_dict_id(zd->table, &id);
+        if (rc == 0 && (d = zstd_load_dict(zd, id)) != NULL) {
+            if (d->cdict == NULL)
+                d->cdict = ZSTD_createCDict(d->buf, d->len,
+                                            bdb_state->attr->zstd_level);
+            if (d->cdict)
+                zd->cur = d;
+        } else if (rc < 0) {
+            logmsg(LOGMSG_ERROR, "%s: can't read dictionary id for %s\n",
+                   __func__, zd->table);
+        }
+        MEMORY_SYNC;
+        zd->cur_loaded = 1;
+    }
+    d = zd->cur;
+    pthread_mutex_unlock(&zstd_dicts_lk);
+    return d;
+}
+
+static size_t zstd_compress(bdb_state_type *bdb_state, const void *in,
+                            size_t inlen, void *out, size_t outlen)
+{
+    struct zstd_ctx *z = zstd_get_ctx();
+    struct zstd_dicts *zd;
+    struct zstd_dict *d = NULL;
+
+    if (z == NULL)
+        return 0;
+    if ((zd = zstd_get_dicts(bdb_state)) != NULL)
+        d = zstd_cur_dict(bdb_state, zd);
+    if (d)
+        return ZSTD_compress_usingCDict(z->cctx, out, outlen, in, inlen,
+                                        d->cdict);
+    return ZSTD_compressCCtx(z->cctx, out, outlen, in, inlen,
+                             bdb_state->attr->zstd_level);
+}
+
+static int zstd_decompress(bdb_state_type *bdb_state, const void *in,
+                           size_t inlen, void *out, size_t outlen)
+{
+    struct zstd_ctx *z = zstd_get_ctx();
+    struct zstd_dicts *zd;
+    struct zstd_dict *d;
+    unsigned id;
+    size_t n;
+
+    if (z == NULL)
+        return -1;
+    if ((id = ZSTD_getDictID_fromFrame(in, inlen)) != 0) {
+        if ((zd = zstd_get_dicts(bdb_state)) == NULL ||
+            (d = zstd_find_dict(zd, id)) == NULL)
+            return -1;
+        n = ZSTD_decompress_usingDDict(z->dctx, out, outlen, in, inlen,
+                                       d->ddict);
+    } else {
+        n = ZSTD_decompressDCtx(z->dctx, out, outlen, in, inlen);
+    }
+    if (ZSTD_isError(n)) {
+        logmsg(LOGMSG_ERROR, "%s: %s\n", __func__, ZSTD_getErrorName(n));
+        return -1;
+    }
+    if (n != outlen) {
+        logmsg(LOGMSG_ERROR, "%s:ERROR decompressed to %zu bytes should be %zu\n",
+               __func__, n, outlen);
+        return -1;
+    }
+    return 0;
+}
+
 void init_odh(bdb_state_type *bdb_state, struct odh *odh, void *rec,
               size_t reclen, int dtanum)
 {
@@ -420,6 +658,24 @@ int bdb_pack(bdb_state_type *bdb_state, const struct odh *odh, void *to,
                 *recsize = rc + ODH_SIZE;
             }
             break;
+
+        case BDB_COMPRESS_ZSTD: {
+            size_t n = 0;
+            if (odh->length > 1)
+                n = zstd_compress(bdb_state, odh->recptr, odh->length,
+                                  (char *)to + ODH_SIZE, odh->length - 1);
+            if (n == 0 || ZSTD_isError(n)) {
+                alg = BDB_COMPRESS_NONE;
+            } else {
+                if (bdb_state->attr->ztrace) {
+                    logmsg(LOGMSG_USER, "%s zstd compressed %u bytes -> %u\n",
+                           bdb_state->name, (unsigned)odh->length,
+                           (unsigned)n);
+                }
+                *recsize = n + ODH_SIZE;
+            }
+            break;
+        }
         }
 
         if (alg == BDB_COMPRESS_NONE) {
@@ -458,6 +714,11 @@ int bdb_pack(bdb_state_type *bdb_state, const struct odh *odh, void *to,
  *    tolen       - Size of buffer pointer to by to.
  *    updateid    - the updateid we're expecting to see from the on-disk
  *                  header.  It will be ignored if it is set to less than 0
+ *    prefixlen   - If non-zero, the caller only looks at the first prefixlen
+ *                  bytes of the record.  Decompression may stop there and
+ *                  zero the rest.  Records written under another schema
+ *                  version are always decompressed in full since converting
+ *                  them touches every field.
  *
  * Output:
  *    odh         - the ODH read from the record (we set this even if
@@ -480,11 +741,12 @@ int bdb_pack(bdb_state_type *bdb_state, const struct odh *odh, void *to,
 static int bdb_unpack_updateid(bdb_state_type *bdb_state, const void *from,
                                size_t fromlen, void *to, size_t tolen,
                                struct odh *odh, int updateid, void **freeptr,
-                               int verify_updateid)
+                               int verify_updateid, size_t prefixlen)
 {
     void *mallocmem = NULL;
     const int ver_bytes = 2;
     int do_uncompress = 1;
+    size_t need;
 
     if (freeptr) {
         *freeptr = NULL;
@@ -553,8 +815,31 @@ static int bdb_unpack_updateid(bdb_state_type *bdb_state, const void *from,
             }
 
             destLen = odh->length;
+            need = odh->length;
+            if (prefixlen && prefixlen < need &&
+                (odh->csc2vers ? odh->csc2vers : 1) == bdb_state->version)
+                need = prefixlen;
+
             if (do_uncompress == 0) {
                 /* Do nothing */
+            } else if (alg == BDB_COMPRESS_ZLIB && need < odh->length) {
+                z_stream zs = {0};
+
+                zs.next_in = ((Bytef *)from) + ODH_SIZE;
+                zs.avail_in = fromlen - ODH_SIZE;
+                zs.next_out = to;
+                zs.avail_out = need;
+                if ((rc = inflateInit(&zs)) == Z_OK) {
+                    rc = inflate(&zs, Z_SYNC_FLUSH);
+                    inflateEnd(&zs);
+                }
+                if ((rc != Z_OK && rc != Z_STREAM_END) || zs.avail_out) {
+                    logmsg(LOGMSG_ERROR, "%s:inflate gave %d %s %u->%u\n",
+                           __func__, rc, zError(rc),
+                           (unsigned)fromlen - ODH_SIZE, (unsigned)need);
+                    goto err;
+                }
+                memset((char *)to + need, 0, odh->length - need);
             } else if (alg == BDB_COMPRESS_ZLIB) {
                 rc = uncompress(to, &destLen, ((Bytef *)from) + ODH_SIZE,
                                 fromlen - ODH_SIZE);
@@ -582,6 +867,19 @@ static int bdb_unpack_updateid(bdb_state_type *bdb_state, const void *from,
                             __func__, rc, (unsigned)odh->length);
                     goto err;
                 }
+            } else if (alg == BDB_COMPRESS_CRLE && need < odh->length) {
+                Comdb2RLE rle = {.in = (uint8_t *)from + ODH_SIZE,
+                                 .insz = fromlen - ODH_SIZE,
+                                 .out = to,
+                                 .outsz = odh->length};
+                rc = decompressComdb2RLEPrefix(&rle, need);
+                if (rc || rle.outsz < need) {
+                    logmsg(LOGMSG_ERROR, "%s:ERROR decompressComdb2RLEPrefix "
+                                         "rc: %d outsz: %lu expected: %u\n",
+                           __func__, rc, rle.outsz, (unsigned)need);
+                    goto err;
+                }
+                memset((char *)to + rle.outsz, 0, odh->length - rle.outsz);
             } else if (alg == BDB_COMPRESS_CRLE) {
                 Comdb2RLE rle = {.in = (uint8_t *)from + ODH_SIZE,
                                  .insz = fromlen - ODH_SIZE,
@@ -594,12 +892,25 @@ static int bdb_unpack_updateid(bdb_state_type *bdb_state, const void *from,
                             __func__, rc, rle.outsz, odh->length);
                     goto err;
                 }
+            } else if (alg == BDB_COMPRESS_LZ4 && need < odh->length) {
+                rc = LZ4_decompress_safe_partial(
+                    (char *)from + ODH_SIZE, to, fromlen - ODH_SIZE, need,
+                    odh->length);
+                if (rc < 0 || (size_t)rc < need) {
+                    goto err;
+                }
+                memset((char *)to + rc, 0, odh->length - rc);
             } else if (alg == BDB_COMPRESS_LZ4) {
                 rc = LZ4_decompress_fast((uint8_t *)from + ODH_SIZE, to,
                                          odh->length);
                 if (rc != fromlen - ODH_SIZE) {
                     goto err;
                 }
+            } else if (alg == BDB_COMPRESS_ZSTD) {
+                /* no partial decode for zstd, a prefix costs the same */
+                if (zstd_decompress(bdb_state, (char *)from + ODH_SIZE,
+                                    fromlen - ODH_SIZE, to, odh->length))
+                    goto err;
             }
 
             /* Successfully decompressed */
@@ -643,7 +954,15 @@ int bdb_unpack(bdb_state_type *bdb_state, const void *from, size_t fromlen,
                void *to, size_t tolen, struct odh *odh, void **freeptr)
 {
     return bdb_unpack_updateid(bdb_state, from, fromlen, to, tolen, odh, -1,
-                               freeptr, 1);
+                               freeptr, 1, 0);
+}
+
+int bdb_unpack_prefix(bdb_state_type *bdb_state, const void *from,
+                      size_t fromlen, void *to, size_t tolen, struct odh *odh,
+                      void **freeptr, size_t prefixlen)
+{
+    return bdb_unpack_updateid(bdb_state, from, fromlen, to, tolen, odh, -1,
+                               freeptr, 1, prefixlen);
 }
 
 static int bdb_write_updateid(bdb_state_type *bdb_state, void *buf,
@@ -716,7 +1035,8 @@ static int bdb_retrieve_updateid(bdb_state_type *bdb_state, const void *from,
 
 static int bdb_unpack_dbt_verify_updateid(bdb_state_type *bdb_state, DBT *data,
                                           int *updateid, uint8_t *ver,
-                                          int flags, int verify_updateid)
+                                          int flags, int verify_updateid,
+                                          size_t prefixlen)
 {
     int rc;
     struct odh odh;
@@ -755,7 +1075,7 @@ static int bdb_unpack_dbt_verify_updateid(bdb_state_type *bdb_state, DBT *data,
     fsnapf(stdout, data->data, data->size);
     */
     rc = bdb_unpack_updateid(bdb_state, data->data, data->size, NULL, 0, &odh,
-                             *updateid, &buf, verify_updateid);
+                             *updateid, &buf, verify_updateid, prefixlen);
 
     if (rc == 0) {
         /*
@@ -980,7 +1300,7 @@ int bdb_cget(bdb_state_type *bdb_state, DBC *dbcp, DBT *key, DBT *data,
 
 static int bdb_cget_unpack_int(bdb_state_type *bdb_state, DBC *dbcp, DBT *key,
                                DBT *data, uint8_t *ver, u_int32_t flags,
-                               int verify_updateid)
+                               int verify_updateid, size_t prefixlen)
 {
     int rc, updateid = -1, ipu = ip_updates_enabled(bdb_state);
     unsigned long long *genptr = NULL;
@@ -1001,7 +1321,7 @@ static int bdb_cget_unpack_int(bdb_state_type *bdb_state, DBC *dbcp, DBT *key,
          * return
          * the ondisk-header updateid on success */
         rc = bdb_unpack_dbt_verify_updateid(bdb_state, data, &updateid, ver,
-                                            flags, verify_updateid);
+                                            flags, verify_updateid, prefixlen);
 
         /* bad rcode: free any memory the c_get allocated */
         if (rc != 0 && data->flags & DB_DBT_MALLOC) {
@@ -1030,14 +1350,24 @@ static int bdb_cget_unpack_int(bdb_state_type *bdb_state, DBC *dbcp, DBT *key,
 int bdb_cget_unpack(bdb_state_type *bdb_state, DBC *dbcp, DBT *key, DBT *data,
                     uint8_t *ver, u_int32_t flags)
 {
-    return bdb_cget_unpack_int(bdb_state, dbcp, key, data, ver, flags, 1);
+    return bdb_cget_unpack_int(bdb_state, dbcp, key, data, ver, flags, 1, 0);
+}
+
+/* As bdb_cget_unpack, but the caller only needs the first prefixlen bytes of
+ * the record.  See bdb_unpack_updateid. */
+int bdb_cget_unpack_prefix(bdb_state_type *bdb_state, DBC *dbcp, DBT *key,
+                           DBT *data, uint8_t *ver, u_int32_t flags,
+                           size_t prefixlen)
+{
+    return bdb_cget_unpack_int(bdb_state, dbcp, key, data, ver, flags, 1,
+                               prefixlen);
 }
 
 /* The updateid-agnostic version of this code. */
 int bdb_cget_unpack_blob(bdb_state_type *bdb_state, DBC *dbcp, DBT *key,
                          DBT *data, uint8_t *ver, u_int32_t flags)
 {
-    return bdb_cget_unpack_int(bdb_state, dbcp, key, data, ver, flags, 0);
+    return bdb_cget_unpack_int(bdb_state, dbcp, key, data, ver, flags, 0, 0);
 }
 
 /* as above, but for DB->get instead of DBC->c_get. */
@@ -1060,7 +1390,7 @@ static int bdb_get_unpack_int(bdb_state_type *bdb_state, DB *db, DB_TXN *tid,
         /* This will fail for mismatched updateids if updateid >= 0.
          * It will always return the correct updateid on success */
         rc = bdb_unpack_dbt_verify_updateid(bdb_state, data, &updateid, ver,
-                                            flags, verify_updateid);
+                                            flags, verify_updateid, 0);
 
         /* bad rcode: free any memory the c_get allocated */
         if (rc != 0 && data->flags & DB_DBT_MALLOC) {
@@ -1304,6 +1634,139 @@ void bdb_set_odh_options(bdb_state_type *bdb_state, int odh, int compression,
     bdb_state->ondisk_header = odh;
     bdb_state->compress = compression;
     bdb_state->compress_blobs = blob_compression;
+
+    /* this is how a new dictionary reaches replicants (scdone setcompr) */
+    if (compression == BDB_COMPRESS_ZSTD ||
+        blob_compression == BDB_COMPRESS_ZSTD) {
+        struct zstd_dicts *zd = zstd_get_dicts(bdb_state);
+        if (zd)
+            zd->cur_loaded = 0;
+    }
+}
+
+struct dict_sample {
+    int cap; /* samples wanted from this stripe */
+    int n;
+    long long seen;
+    unsigned seed;
+    void **recs;
+    size_t *lens;
+};
+
+/* reservoir sample each stripe, so every record has the same chance */
+static int dict_sample_rec(void *arg, int stripe, void *dta, int dtalen,
+                           uint8_t ver)
+{
+    struct dict_sample *s = (struct dict_sample *)arg + stripe;
+    unsigned long long i = s->seen++;
+    void *copy;
+
+    if (dtalen <= 0)
+        return 0;
+    if (i >= (unsigned)s->cap) {
+        i = (((unsigned long long)rand_r(&s->seed) << 31) ^
+             rand_r(&s->seed)) % (i + 1);
+        if (i >= (unsigned)s->cap)
+            return 0;
+    }
+    if ((copy = malloc(dtalen)) == NULL)
+        return ENOMEM;
+    memcpy(copy, dta, dtalen);
+    if (i < (unsigned)s->n)
+        free(s->recs[i]);
+    else
+        s->n++;
+    s->recs[i] = copy;
+    s->lens[i] = dtalen;
+    return 0;
+}
+
+int bdb_train_compr_dict(bdb_state_type *bdb_state, int nsamples, int dictsz,
+                         unsigned *dictid)
+{
+    int stripes = bdb_state->attr->dtastripe > 0 ? bdb_state->attr->dtastripe
+                                                 : 1;
+    struct dict_sample s[stripes];
+    const char *table = zstd_table(bdb_state);
+    char *samples = NULL, *p;
+    size_t *sizes = NULL, total = 0, n;
+    void *dict = NULL;
+    int i, j, nrecs = 0, rc = -1;
+
+    if (nsamples <= 0 || dictsz <= 0)
+        return -1;
+
+    memset(s, 0, sizeof(s));
+    for (i = 0; i < stripes; i++) {
+        s[i].cap = (nsamples + stripes - 1) / stripes;
+        s[i].seed = time(NULL) + i;
+        s[i].recs = calloc(s[i].cap, sizeof(void *));
+        s[i].lens = calloc(s[i].cap, sizeof(size_t));
+        if (s[i].recs == NULL || s[i].lens == NULL)
+            goto done;
+    }
+
+    if ((rc = bdb_direct_scan_state(bdb_state, dict_sample_rec, s)) != 0) {
+        logmsg(LOGMSG_ERROR, "%s: scan of %s failed rc %d\n", __func__, table,
+               rc);
+        rc = -1;
+        goto done;
+    }
+    rc = -1;
+
+    for (i = 0; i < stripes; i++) {
+        nrecs += s[i].n;
+        for (j = 0; j < s[i].n; j++)
+            total += s[i].lens[j];
+    }
+    samples = malloc(total ? total : 1);
+    sizes = malloc(nrecs ? nrecs * sizeof(size_t) : 1);
+    dict = malloc(dictsz);
+    if (samples == NULL || sizes == NULL || dict == NULL)
+        goto done;
+    p = samples;
+    for (i = 0, nrecs = 0; i < stripes; i++) {
+        for (j = 0; j < s[i].n; j++) {
+            memcpy(p, s[i].recs[j], s[i].lens[j]);
+            p += s[i].lens[j];
+            sizes[nrecs++] = s[i].lens[j];
+        }
+    }
+
+    n = ZDICT_trainFromBuffer(dict, dictsz, samples, sizes, nrecs);
+    if (ZDICT_isError(n)) {
+        logmsg(LOGMSG_ERROR, "%s: %s from %d records of %s\n", __func__,
+               ZDICT_getErrorName(n), nrecs, table);
+        goto done;
+    }
+    if ((*dictid = ZDICT_getDictID(dict, n)) == 0)
+        goto done;
+
+    if (bdb_set_compr_dict(NULL, table, *dictid, dict, n) != 0 ||
+        bdb_set_compr_dict_id(NULL, table, *dictid) != 0) {
+        logmsg(LOGMSG_ERROR, "%s: can't save dictionary for %s\n", __func__,
+               table);
+        goto done;
+    }
+    logmsg(LOGMSG_USER, "%s: %s dictionary %u is %zu bytes from %d records\n",
+           __func__, table, *dictid, n, nrecs);
+
+    struct zstd_dicts *zd = zstd_get_dicts(bdb_state);
+    if (zd)
+        zd->cur_loaded = 0;
+    rc = 0;
+
+done:
+    for (i = 0; i < stripes; i++) {
+        for (j = 0; j < s[i].n; j++)
+            free(s[i].recs[j]);
+        free(s[i].recs);
+        free(s[i].lens);
+    }
+    free(samples);
+    free(sizes);
+    free(dict);
+    return rc;
 }
 
 int bdb_get_csc2_version(bdb_state_type *bdb_state)
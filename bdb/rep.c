@@ -693,7 +693,8 @@ int berkdb_send_rtn(DB_ENV *dbenv, const DBT *control, const DBT *rec,
                     const DB_LSN *lsnp, char *host, int flags, void *usr_ptr)
 {
     bdb_state_type *bdb_state;
-    char *buf;
+    net_iov_buf *buf;
+    net_iov iov[2];
     int bufsz;
     int rc;
     int outrc;
@@ -707,11 +708,10 @@ int berkdb_send_rtn(DB_ENV *dbenv, const DBT *control, const DBT *rec,
     char *recbuf;
     char *controlbuf;
     int i;
-    int *seqnum;
+    uint8_t seqnum[sizeof(int)];
     const char *hostlist[REPMAX];
     int count = 0;
     int nodelay;
-    int useheap = 0;
     unsigned long long gblcontext;
     int dontsend;
 
@@ -776,8 +776,10 @@ int berkdb_send_rtn(DB_ENV *dbenv, const DBT *control, const DBT *rec,
     if (bdb_state->parent)
         bdb_state = bdb_state->parent;
 
-    bufsz = sizeof(int) +   /* seqnum */
-            sizeof(int) +   /* recsz */
+    /* The seqnum differs per host, so it isn't part of buf.  Everything
+     * else is packed once into a refcounted buffer which net queues by
+     * reference for each host we send to. */
+    bufsz = sizeof(int) +   /* recsz */
             sizeof(int) +   /* reccrc */
             rec->size +     /* recbuf */
             sizeof(int) +   /* controlsz */
@@ -785,25 +787,24 @@ int berkdb_send_rtn(DB_ENV *dbenv, const DBT *control, const DBT *rec,
             control->size + /* controlbuf */
             16;             /* some fluff */
 
-    /*fprintf(stderr, "malloc(%d)\n", bufsz);*/
-    /* use the heap if we are allocating a lot of memory.  in general we only
-     * need ~pagesize bytes - but queues might have large page sizes, so we
-     * better make sure we can allocate enough memory for them. */
-    if (bufsz > 1024 * 65)
-        useheap = 1;
-    if (useheap)
-        buf = malloc(bufsz);
-    else
-        buf = alloca(bufsz);
+    buf = net_iov_buf_alloc(bufsz);
+    if (buf == NULL) {
+        logmsg(LOGMSG_ERROR, "%s: failed to allocate %d bytes\n", __func__,
+               bufsz);
+        return 1;
+    }
 
-    bytecount += bufsz;
+    bytecount += sizeof(int) + bufsz;
 
-    p_buf = (uint8_t *)buf;
-    p_buf_end = ((uint8_t *)buf + bufsz);
+    p_buf = (uint8_t *)net_iov_buf_data(buf);
+    p_buf_end = p_buf + bufsz;
 
-    /* not included in the buf headers as it's set multiple times */
-    seqnum = (int *)p_buf;
-    p_buf += sizeof(int);
+    iov[0].base = seqnum;
+    iov[0].len = sizeof(seqnum);
+    iov[0].ref = NULL;
+    iov[1].base = p_buf;
+    iov[1].len = bufsz;
+    iov[1].ref = buf;
 
     /*
        ptr = buf;
@@ -875,6 +876,9 @@ int berkdb_send_rtn(DB_ENV *dbenv, const DBT *control, const DBT *rec,
     /* pack control buffer payload */
     p_buf = buf_no_net_put(control->data, control->size, p_buf, p_buf_end);
 
+    /* the fluff goes on the wire too; don't leak heap contents */
+    memset(p_buf, 0, p_buf_end - p_buf);
+
     nodelay = 0;
 
     tran = pthread_getspecific(bdb_state->seqnum_info->key);
@@ -985,19 +989,14 @@ int berkdb_send_rtn(DB_ENV *dbenv, const DBT *control, const DBT *rec,
 
             if (!dontsend) {
                 if (!is_logput) {
-                    rc = net_send_nodrop(bdb_state->repinfo->netinfo,
-                                         hostlist[i], USER_TYPE_BERKDB_REP, buf,
-                                         bufsz, nodelay);
-                } else {
-                    if (bdb_state->attr->net_inorder_logputs) {
-                        rc = net_send_inorder(bdb_state->repinfo->netinfo,
+                    rc = net_send_message_iov(bdb_state->repinfo->netinfo,
                                               hostlist[i], USER_TYPE_BERKDB_REP,
-                                              buf, bufsz, nodelay);
-                    } else {
-                        rc =
-                            net_send(bdb_state->repinfo->netinfo, hostlist[i],
-                                     USER_TYPE_BERKDB_REP, buf, bufsz, nodelay);
-                    }
+                                              iov, 2, nodelay, 1, 0);
+                } else {
+                    rc = net_send_message_iov(
+                        bdb_state->repinfo->netinfo, hostlist[i],
+                        USER_TYPE_BERKDB_REP, iov, 2, nodelay, 0,
+                        bdb_state->attr->net_inorder_logputs);
                 }
                 if (rc != 0)
                     rc = 1; /* haha, keep ignoring it */
@@ -1055,16 +1054,16 @@ int berkdb_send_rtn(DB_ENV *dbenv, const DBT *control, const DBT *rec,
             }
 
         if (!outrc) {
-            rc = net_send(bdb_state->repinfo->netinfo, host,
-                          USER_TYPE_BERKDB_REP, buf, bufsz, nodelay);
+            rc = net_send_message_iov(bdb_state->repinfo->netinfo, host,
+                                      USER_TYPE_BERKDB_REP, iov, 2, nodelay, 0,
+                                      0);
 
             if (rc != 0)
                 outrc = 1;
         }
     }
 
-    if (useheap)
-        free(buf);
+    net_iov_buf_release(buf);
 
     /*Pthread_mutex_unlock(&(bdb_state->repinfo->send_lock));*/
 
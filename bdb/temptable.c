@@ -32,6 +32,7 @@
 #include "bdb_int.h"
 #include <list.h>
 #include <plhash.h>
+#include <arena.h>
 
 #ifdef _LINUX_SOURCE
 #include <execinfo.h>
@@ -80,6 +81,26 @@ struct temp_list_node {
     void *data;
 };
 
+/* In-memory ordered temp tables are skiplists whose nodes, keys and data are
+ * carved out of a per-table arena.  Deleted nodes stay in the arena until the
+ * table is truncated, so a cursor parked on one can still find its way back
+ * into the list by key. */
+#define TEMP_SKIPLIST_MAXLEVEL 16
+
+struct temp_skipnode {
+    struct temp_skipnode *prev; /* level 0 only */
+    void *data;
+    int keylen;
+    int datalen;
+    int dtacap;
+    int deleted;
+    int height;
+    struct temp_skipnode *next[/*height*/];
+    /* key follows next[height] */
+};
+
+#define SKIPNODE_KEY(n) ((void *)&(n)->next[(n)->height])
+
 /* code for SQL temp table support */
 struct temp_cursor {
     DBC *cur;
@@ -94,10 +115,16 @@ struct temp_cursor {
     struct temp_list_node *list_cur;
     void *hash_cur;
     unsigned int hash_cur_buk;
+    struct temp_skipnode *skip_cur;
     LINKC_T(struct temp_cursor) lnk;
 };
 
-enum { TEMP_TABLE_TYPE_BTREE, TEMP_TABLE_TYPE_HASH, TEMP_TABLE_TYPE_LIST };
+enum {
+    TEMP_TABLE_TYPE_BTREE,
+    TEMP_TABLE_TYPE_HASH,
+    TEMP_TABLE_TYPE_LIST,
+    TEMP_TABLE_TYPE_SKIPLIST
+};
 
 struct temp_table {
     DB_ENV *dbenv_temp;
@@ -107,6 +134,14 @@ struct temp_table {
     LISTC_T(struct temp_list_node) temp_tbl_list;
     hash_t *temp_hash_tbl;
 
+    arena_t *skip_arena;
+    struct temp_skipnode *skip_head; /* sentinel, TEMP_SKIPLIST_MAXLEVEL high */
+    struct temp_skipnode *skip_tail;
+    int skip_level;
+    unsigned int skip_seed;
+    size_t mem_used; /* bytes taken from skip_arena */
+    size_t mem_budget;
+
     tmptbl_cmp cmpfunc;
     void *usermem;
     char filename[512];
@@ -137,8 +172,11 @@ static int temp_table_compare(DB *db, const DBT *dbt1, const DBT *dbt2);
 
 /* refactored both insert and put code paths here */
 static int bdb_temp_table_insert_put(bdb_state_type *, struct temp_table *,
-                                     void *key, int keylen, void *data,
-                                     int dtalen, int *bdberr);
+                                     struct temp_cursor *, void *key,
+                                     int keylen, void *data, int dtalen,
+                                     void *unpacked, int *bdberr);
+static int bdb_temp_table_open_temp_db(bdb_state_type *bdb_state,
+                                       struct temp_table *tbl, int *bdberr);
 
 void *bdb_temp_table_get_cur(struct temp_cursor *skippy) { return skippy->cur; }
 
@@ -165,6 +203,12 @@ static int bdb_hash_table_copy_to_temp_db(bdb_state_type *bdb_state,
     void *hash_cur;
     unsigned int hash_cur_buk;
     char *data;
+    unsigned long long rowid = tbl->rowid;
+
+    rc = bdb_temp_table_open_temp_db(bdb_state, tbl, bdberr);
+    if (rc)
+        return rc;
+    tbl->rowid = rowid;
 
     /* copy the hash to a btree */
     data = hash_first(tbl->temp_hash_tbl, &hash_cur, &hash_cur_buk);
@@ -193,6 +237,7 @@ static int bdb_hash_table_copy_to_temp_db(bdb_state_type *bdb_state,
         }
         data = hash_next(tbl->temp_hash_tbl, &hash_cur, &hash_cur_buk);
     }
+    tbl->num_mem_entries = num_recs;
 
     /* get rid of the hash */
     data = hash_first(tbl->temp_hash_tbl, &hash_cur, &hash_cur_buk);
@@ -301,11 +346,15 @@ static int bdb_temp_table_env_close(bdb_state_type *bdb_state,
         }
         tbl->tmpdb = NULL;
     }
-    rc = tbl->dbenv_temp->close(tbl->dbenv_temp, 0);
-    if (rc) {
-        logmsg(LOGMSG_ERROR, "%s: failed to close dbenv_temp rc=%d\n", __func__, rc);
-        *bdberr = rc;
-        return -1;
+    if (tbl->dbenv_temp) {
+        rc = tbl->dbenv_temp->close(tbl->dbenv_temp, 0);
+        if (rc) {
+            logmsg(LOGMSG_ERROR, "%s: failed to close dbenv_temp rc=%d\n",
+                   __func__, rc);
+            *bdberr = rc;
+            return -1;
+        }
+        tbl->dbenv_temp = NULL;
     }
     *bdberr = 0;
     return 0;
@@ -314,13 +363,11 @@ static int bdb_temp_table_env_close(bdb_state_type *bdb_state,
 pthread_key_t current_sql_query_key;
 int gbl_debug_temptables = 0;
 
-static struct temp_table *bdb_temp_table_create_main(bdb_state_type *bdb_state,
-                                                     int *bdberr)
+static int bdb_temp_table_env_open(bdb_state_type *bdb_state,
+                                   struct temp_table *tbl, int *bdberr)
 {
     int rc;
-    struct temp_table *tbl;
     bdb_state_type *parent;
-    int id;
     DB_ENV *dbenv_temp;
     unsigned int gb = 0, bytes = 0;
 
@@ -329,17 +376,11 @@ static struct temp_table *bdb_temp_table_create_main(bdb_state_type *bdb_state,
     else
         parent = bdb_state;
 
-    tbl = malloc(sizeof(struct temp_table));
-    tbl->next = NULL;
-    tbl->tmpdb = NULL;
-    tbl->cmpfunc = key_memcmp;
-
     rc = db_env_create(&dbenv_temp, 0);
     if (rc != 0) {
         logmsg(LOGMSG_ERROR, "couldnt create temp table env\n");
-        free(tbl);
-        tbl = NULL;
-        goto done;
+        *bdberr = rc;
+        return -1;
     }
 
     if (gbl_crypto) {
@@ -350,9 +391,7 @@ static struct temp_table *bdb_temp_table_create_main(bdb_state_type *bdb_state,
         if ((rc = dbenv_temp->set_encrypt(dbenv_temp, passwd,
                                           DB_ENCRYPT_AES)) != 0) {
             fprintf(stderr, "%s set_encrypt rc:%d\n", __func__, rc);
-            free(tbl);
-            tbl = NULL;
-            goto done;
+            goto err;
         }
         memset(passwd, 0xff, sizeof(passwd));
     }
@@ -360,9 +399,7 @@ static struct temp_table *bdb_temp_table_create_main(bdb_state_type *bdb_state,
     rc = dbenv_temp->set_is_tmp_tbl(dbenv_temp, 1);
     if (rc != 0) {
         logmsg(LOGMSG_ERROR, "couldnt set property is_tmp_tbl\n");
-        free(tbl);
-        tbl = NULL;
-        goto done;
+        goto err;
     }
 
     bytes = bdb_state->attr->temptable_cachesz;
@@ -371,19 +408,10 @@ static struct temp_table *bdb_temp_table_create_main(bdb_state_type *bdb_state,
     if (bytes < 524288)
         bytes = 524288;
 
-    rc = dbenv_temp->set_tmp_dir(dbenv_temp, parent->tmpdir);
-    if (rc) {
-        logmsg(LOGMSG_ERROR, "can't set temp table environment's temp directory");
-        /* continue anyway */
-    }
-
     rc = dbenv_temp->set_cachesize(dbenv_temp, gb, bytes, 1);
     if (rc != 0) {
         logmsg(LOGMSG_ERROR, "invalid set_cache_size call: gb %d bytes %d\n", gb, bytes);
-        free(tbl);
-        *bdberr = rc;
-        tbl = NULL;
-        goto done;
+        goto err;
     }
 
     rc = dbenv_temp->set_tmp_dir(dbenv_temp, parent->tmpdir);
@@ -396,12 +424,396 @@ static struct temp_table *bdb_temp_table_create_main(bdb_state_type *bdb_state,
                           DB_INIT_MPOOL | DB_CREATE | DB_PRIVATE, 0666);
     if (rc != 0) {
         logmsg(LOGMSG_ERROR, "couldnt open temp table env\n");
+        goto err;
+    }
+
+    tbl->dbenv_temp = dbenv_temp;
+    return 0;
+
+err:
+    dbenv_temp->close(dbenv_temp, 0);
+    *bdberr = rc;
+    return -1;
+}
+
+/* The berkeley environment behind a temp table is only created the first time
+ * the table needs a real btree: either it was asked for one, or it started
+ * out in memory and outgrew that. */
+static int bdb_temp_table_open_temp_db(bdb_state_type *bdb_state,
+                                       struct temp_table *tbl, int *bdberr)
+{
+    int rc;
+
+    if (tbl->tmpdb)
+        return 0;
+
+    if (tbl->dbenv_temp == NULL) {
+        rc = bdb_temp_table_env_open(bdb_state, tbl, bdberr);
+        if (rc)
+            return rc;
+    }
+
+    return bdb_temp_table_init_temp_db(bdb_state, tbl, bdberr);
+}
+
+static void skiplist_reset(struct temp_table *tbl)
+{
+    struct temp_cursor *cur;
+
+    if (tbl->skip_arena)
+        arena_free_all(tbl->skip_arena);
+    memset(tbl->skip_head->next, 0,
+           TEMP_SKIPLIST_MAXLEVEL * sizeof(struct temp_skipnode *));
+    tbl->skip_tail = NULL;
+    tbl->skip_level = 1;
+    tbl->mem_used = 0;
+
+    LISTC_FOR_EACH(&tbl->cursors, cur, lnk)
+    {
+        cur->skip_cur = NULL;
+        if (tbl->temp_table_type == TEMP_TABLE_TYPE_SKIPLIST)
+            cur->valid = 0;
+    }
+}
+
+/* same sense as temp_table_compare(): search key against a node's key */
+static inline int skiplist_cmp(struct temp_table *tbl, int keylen,
+                               const void *key, void *unpacked,
+                               struct temp_skipnode *n)
+{
+    if (unpacked)
+        return -tbl->cmpfunc(NULL, n->keylen, SKIPNODE_KEY(n), -1, unpacked);
+    return tbl->cmpfunc(tbl->usermem, keylen, key, n->keylen, SKIPNODE_KEY(n));
+}
+
+/* Return the first node >= key, filling in the last node < key on every
+ * level if update is given. */
+static struct temp_skipnode *skiplist_seek(struct temp_table *tbl, int keylen,
+                                           const void *key, void *unpacked,
+                                           struct temp_skipnode **update)
+{
+    struct temp_skipnode *x = tbl->skip_head;
+    int i;
+
+    for (i = tbl->skip_level - 1; i >= 0; i--) {
+        while (x->next[i] &&
+               skiplist_cmp(tbl, keylen, key, unpacked, x->next[i]) > 0)
+            x = x->next[i];
+        if (update)
+            update[i] = x;
+    }
+    return x->next[0];
+}
+
+static int skiplist_set_data(struct temp_table *tbl, struct temp_skipnode *n,
+                             const void *data, int dtalen)
+{
+    if (dtalen > n->dtacap) {
+        void *p = arena_alloc(tbl->skip_arena, dtalen);
+        if (p == NULL)
+            return ENOMEM;
+        tbl->mem_used += dtalen;
+        n->data = p;
+        n->dtacap = dtalen;
+    }
+    if (dtalen)
+        memcpy(n->data, data, dtalen);
+    n->datalen = dtalen;
+    return 0;
+}
+
+/* insert or overwrite, like a DB_KEYFIRST put into a btree without dups */
+static struct temp_skipnode *skiplist_insert(struct temp_table *tbl,
+                                             const void *key, int keylen,
+                                             const void *data, int dtalen,
+                                             void *unpacked, int *bdberr)
+{
+    struct temp_skipnode *update[TEMP_SKIPLIST_MAXLEVEL];
+    struct temp_skipnode *n;
+    size_t sz;
+    int height, i, rc;
+
+    n = skiplist_seek(tbl, keylen, key, unpacked, update);
+    if (n && skiplist_cmp(tbl, keylen, key, unpacked, n) == 0) {
+        if ((rc = skiplist_set_data(tbl, n, data, dtalen)) != 0) {
+            *bdberr = rc;
+            return NULL;
+        }
+        return n;
+    }
+
+    /* p = 1/4 */
+    height = 1;
+    while (height < TEMP_SKIPLIST_MAXLEVEL && (rand_r(&tbl->skip_seed) & 3) == 0)
+        height++;
+
+    sz = offsetof(struct temp_skipnode, next) +
+         height * sizeof(struct temp_skipnode *) + keylen;
+    n = arena_alloc(tbl->skip_arena, sz);
+    if (n == NULL) {
+        *bdberr = ENOMEM;
+        return NULL;
+    }
+    tbl->mem_used += sz;
+    n->height = height;
+    n->keylen = keylen;
+    n->deleted = 0;
+    n->data = NULL;
+    n->dtacap = 0;
+    memcpy(SKIPNODE_KEY(n), key, keylen);
+    if ((rc = skiplist_set_data(tbl, n, data, dtalen)) != 0) {
+        *bdberr = rc;
+        return NULL;
+    }
+
+    for (i = tbl->skip_level; i < height; i++)
+        update[i] = tbl->skip_head;
+    if (height > tbl->skip_level)
+        tbl->skip_level = height;
+
+    for (i = 0; i < height; i++) {
+        n->next[i] = update[i]->next[i];
+        update[i]->next[i] = n;
+    }
+    n->prev = (update[0] == tbl->skip_head) ? NULL : update[0];
+    if (n->next[0])
+        n->next[0]->prev = n;
+    else
+        tbl->skip_tail = n;
+
+    tbl->num_mem_entries++;
+    return n;
+}
+
+static void skiplist_unlink(struct temp_table *tbl, struct temp_skipnode *n)
+{
+    struct temp_skipnode *update[TEMP_SKIPLIST_MAXLEVEL];
+    int i;
+
+    skiplist_seek(tbl, n->keylen, SKIPNODE_KEY(n), NULL, update);
+    for (i = 0; i < n->height; i++) {
+        if (update[i]->next[i] == n)
+            update[i]->next[i] = n->next[i];
+    }
+    if (n->next[0])
+        n->next[0]->prev = n->prev;
+    else
+        tbl->skip_tail = n->prev;
+
+    while (tbl->skip_level > 1 &&
+           tbl->skip_head->next[tbl->skip_level - 1] == NULL)
+        tbl->skip_level--;
+
+    n->deleted = 1;
+    tbl->num_mem_entries--;
+}
+
+/* Hand the cursor its own copies of the row, the same way the btree code
+ * does with DB_DBT_MALLOC; callers are allowed to keep them. */
+static int skiplist_cursor_set(struct temp_cursor *cur,
+                               struct temp_skipnode *n, int *bdberr)
+{
+    free(cur->key);
+    free(cur->data);
+    cur->key = malloc(n->keylen);
+    cur->data = malloc(n->datalen);
+    if ((n->keylen && cur->key == NULL) || (n->datalen && cur->data == NULL)) {
+        free(cur->key);
+        free(cur->data);
+        cur->key = cur->data = NULL;
+        cur->keylen = cur->datalen = 0;
+        cur->skip_cur = NULL;
+        cur->valid = 0;
+        *bdberr = ENOMEM;
+        return -1;
+    }
+    memcpy(cur->key, SKIPNODE_KEY(n), n->keylen);
+    cur->keylen = n->keylen;
+    memcpy(cur->data, n->data, n->datalen);
+    cur->datalen = n->datalen;
+    cur->skip_cur = n;
+    cur->valid = 1;
+    return 0;
+}
+
+/* Leave every cursor parked on deleted node n where a btree cursor would be
+ * after a c_del: on a deleted item between its neighbours.  If the key has
+ * been put again since, step back so the next row is the new one. */
+static int skiplist_park_deleted(struct temp_table *tbl,
+                                 struct temp_skipnode *n, int *bdberr)
+{
+    struct temp_cursor *cur, *last = NULL;
+    DBT dbt_key, dbt_data;
+    int exists, rc;
+
+    bzero(&dbt_key, sizeof(DBT));
+    bzero(&dbt_data, sizeof(DBT));
+    dbt_key.flags = DB_DBT_USERMEM;
+    dbt_key.ulen = dbt_key.size = n->keylen;
+    dbt_key.data = SKIPNODE_KEY(n);
+    dbt_data.flags = DB_DBT_USERMEM | DB_DBT_PARTIAL;
+
+    rc = tbl->tmpdb->get(tbl->tmpdb, NULL, &dbt_key, &dbt_data, 0);
+    if (rc && rc != DB_NOTFOUND)
+        goto err;
+    exists = (rc == 0);
+    if (!exists) {
+        DBT dbt_row = {0};
+        dbt_row.ulen = dbt_row.size = n->datalen;
+        dbt_row.data = n->data;
+        rc = tbl->tmpdb->put(tbl->tmpdb, NULL, &dbt_key, &dbt_row, 0);
+        if (rc)
+            goto err;
+    }
+
+    LISTC_FOR_EACH(&tbl->cursors, cur, lnk)
+    {
+        if (cur->skip_cur != n)
+            continue;
+        cur->skip_cur = NULL;
+        rc = cur->cur->c_get(cur->cur, &dbt_key, &dbt_data, DB_SET);
+        if (rc)
+            goto err;
+        if (exists) {
+            DBT dbt_prev = {0};
+            dbt_prev.flags = DB_DBT_MALLOC;
+            rc = cur->cur->c_get(cur->cur, &dbt_prev, &dbt_data, DB_PREV);
+            free(dbt_prev.data);
+            if (rc == DB_NOTFOUND) {
+                /* nothing before it: an unset cursor's next is the first */
+                cur->cur->c_close(cur->cur);
+                rc = tbl->tmpdb->cursor(tbl->tmpdb, NULL, &cur->cur, 0);
+            }
+            if (rc)
+                goto err;
+        }
+        last = cur;
+    }
+
+    /* deleting through one cursor moves all of them onto the deleted item */
+    if (!exists && last && (rc = last->cur->c_del(last->cur, 0)) != 0)
+        goto err;
+    return 0;
+
+err:
+    logmsg(LOGMSG_ERROR, "%s:%d rc %d\n", __func__, __LINE__, rc);
+    *bdberr = rc;
+    return -1;
+}
+
+/* Copy an in-memory table that went over its budget into a btree, keeping
+ * every cursor where it was. */
+static int bdb_skiplist_copy_to_temp_db(bdb_state_type *bdb_state,
+                                        struct temp_table *tbl, int *bdberr)
+{
+    int rc = 0;
+    int num_recs = 0;
+    DBT dbt_key, dbt_data;
+    struct temp_cursor *cur;
+    struct temp_skipnode *n;
+    unsigned long long rowid = tbl->rowid;
+
+    rc = bdb_temp_table_open_temp_db(bdb_state, tbl, bdberr);
+    if (rc)
+        return rc;
+    tbl->rowid = rowid;
+
+    bzero(&dbt_key, sizeof(DBT));
+    bzero(&dbt_data, sizeof(DBT));
+    for (n = tbl->skip_head->next[0]; n; n = n->next[0]) {
+        dbt_key.ulen = dbt_key.size = n->keylen;
+        dbt_key.data = SKIPNODE_KEY(n);
+        dbt_data.ulen = dbt_data.size = n->datalen;
+        dbt_data.data = n->data;
+
+        rc = tbl->tmpdb->put(tbl->tmpdb, NULL, &dbt_key, &dbt_data, 0);
+        if (rc) {
+            logmsg(LOGMSG_ERROR, "%s:%d put rc %d\n", __FILE__, __LINE__, rc);
+            *bdberr = rc;
+            return -1;
+        }
+        num_recs++;
+    }
+    tbl->num_mem_entries = num_recs;
+    tbl->temp_table_type = TEMP_TABLE_TYPE_BTREE;
+
+    LISTC_FOR_EACH(&tbl->cursors, cur, lnk)
+    {
+        rc = tbl->tmpdb->cursor(tbl->tmpdb, NULL, &cur->cur, 0);
+        if (rc) {
+            cur->cur = NULL;
+            logmsg(LOGMSG_ERROR, "%s:%d cursor rc %d\n", __FILE__, __LINE__, rc);
+            *bdberr = rc;
+            return -1;
+        }
+        if (cur->skip_cur == NULL || cur->skip_cur->deleted)
+            continue;
+
+        /* key and data already hold the row; just move the berkeley cursor */
+        dbt_key.flags = DB_DBT_USERMEM;
+        dbt_key.ulen = dbt_key.size = cur->skip_cur->keylen;
+        dbt_key.data = SKIPNODE_KEY(cur->skip_cur);
+        dbt_data.flags = DB_DBT_USERMEM | DB_DBT_PARTIAL;
+        dbt_data.data = NULL;
+        dbt_data.ulen = dbt_data.size = 0;
+        dbt_data.dlen = dbt_data.doff = 0;
+        rc = cur->cur->c_get(cur->cur, &dbt_key, &dbt_data, DB_SET);
+        if (rc) {
+            logmsg(LOGMSG_ERROR, "%s:%d c_get rc %d\n", __FILE__, __LINE__, rc);
+            *bdberr = rc;
+            return -1;
+        }
+    }
+
+    LISTC_FOR_EACH(&tbl->cursors, cur, lnk)
+    {
+        if (cur->skip_cur && cur->skip_cur->deleted &&
+            skiplist_park_deleted(tbl, cur->skip_cur, bdberr))
+            return -1;
+    }
+
+    skiplist_reset(tbl);
+    return 0;
+}
+
+static int skiplist_over_budget(struct temp_table *tbl)
+{
+    return tbl->mem_used > tbl->mem_budget;
+}
+
+static struct temp_table *bdb_temp_table_create_main(bdb_state_type *bdb_state,
+                                                     int *bdberr)
+{
+    struct temp_table *tbl;
+    bdb_state_type *parent;
+    int id;
+
+    if (bdb_state->parent)
+        parent = bdb_state->parent;
+    else
+        parent = bdb_state;
+
+    tbl = calloc(1, sizeof(struct temp_table));
+    if (tbl == NULL) {
+        *bdberr = ENOMEM;
+        goto done;
+    }
+    tbl->next = NULL;
+    tbl->tmpdb = NULL;
+    tbl->dbenv_temp = NULL;
+    tbl->cmpfunc = key_memcmp;
+
+    tbl->skip_head =
+        calloc(1, offsetof(struct temp_skipnode, next) +
+                      TEMP_SKIPLIST_MAXLEVEL * sizeof(struct temp_skipnode *));
+    if (tbl->skip_head == NULL) {
         free(tbl);
         tbl = NULL;
+        *bdberr = ENOMEM;
         goto done;
     }
-
-    tbl->dbenv_temp = dbenv_temp;
+    tbl->skip_head->height = TEMP_SKIPLIST_MAXLEVEL;
+    tbl->skip_level = 1;
 
     if (gbl_temptable_pool_capacity == 0) {
         Pthread_mutex_lock(&parent->temp_list_lock);
@@ -415,17 +827,15 @@ static struct temp_table *bdb_temp_table_create_main(bdb_state_type *bdb_state,
     snprintf(tbl->filename, sizeof(tbl->filename), "%s/_temp_%d.db",
              parent->tmpdir, id);
     tbl->tblid = id;
+    tbl->skip_seed = id;
 
     listc_init(&tbl->cursors, offsetof(struct temp_cursor, lnk));
 
     tbl->max_mem_entries = bdb_state->attr->temptable_mem_threshold;
 
-    rc = bdb_temp_table_init_temp_db(bdb_state, tbl, bdberr);
-    if (rc) {
-        free(tbl);
-        tbl = NULL;
-        goto done;
-    }
+    /* Start with rowid 2 */
+    tbl->rowid = 2;
+    tbl->num_mem_entries = 0;
 
     listc_init(&tbl->temp_tbl_list, offsetof(struct temp_list_node, lnk));
 
@@ -545,6 +955,31 @@ static struct temp_table *bdb_temp_table_create_type(bdb_state_type *bdb_state,
     table->cmpfunc = key_memcmp;
     table->temp_table_type = temp_table_type;
 
+    switch (temp_table_type) {
+    case TEMP_TABLE_TYPE_BTREE:
+        rc = bdb_temp_table_open_temp_db(bdb_state, table, bdberr);
+        break;
+
+    case TEMP_TABLE_TYPE_SKIPLIST:
+        table->mem_budget = bdb_state->attr->temptable_mem_budget;
+        if (table->skip_arena == NULL) {
+            table->skip_arena = arena_new(malloc, free, 65536, 65536);
+            if (table->skip_arena == NULL)
+                *bdberr = ENOMEM;
+        }
+        rc = (table->skip_arena == NULL);
+        break;
+
+    default:
+        rc = 0;
+        break;
+    }
+    if (rc) {
+        int bdberr2;
+        bdb_temp_table_close(bdb_state, table, &bdberr2);
+        return NULL;
+    }
+
     return table;
 }
 
@@ -553,14 +988,18 @@ struct temp_table *bdb_temp_table_create_flags(bdb_state_type *bdb_state,
 {
     int temptype;
 
-    temptype = TEMP_TABLE_TYPE_BTREE;
+    if ((flags & BDB_TEMP_TABLE_DONT_USE_INMEM) ||
+        bdb_state->attr->temptable_mem_budget <= 0)
+        temptype = TEMP_TABLE_TYPE_BTREE;
+    else
+        temptype = TEMP_TABLE_TYPE_SKIPLIST;
 
     return bdb_temp_table_create_type(bdb_state, temptype, bdberr);
 }
 
 struct temp_table *bdb_temp_table_create(bdb_state_type *bdb_state, int *bdberr)
 {
-    return bdb_temp_table_create_type(bdb_state, TEMP_TABLE_TYPE_BTREE, bdberr);
+    return bdb_temp_table_create_flags(bdb_state, 0, bdberr);
 }
 
 struct temp_table *bdb_temp_list_create(bdb_state_type *bdb_state, int *bdberr)
@@ -604,6 +1043,11 @@ struct temp_cursor *bdb_temp_table_cursor(bdb_state_type *bdb_state,
     case TEMP_TABLE_TYPE_BTREE:
         rc = tbl->tmpdb->cursor(tbl->tmpdb, NULL, &cur->cur, 0);
         break;
+
+    case TEMP_TABLE_TYPE_SKIPLIST:
+        cur->skip_cur = NULL;
+        rc = 0;
+        break;
     }
 
     if (rc) {
@@ -636,8 +1080,8 @@ int bdb_temp_table_insert(bdb_state_type *bdb_state, struct temp_cursor *cur,
     DBT dkey, ddata;
     struct temp_table *tbl = cur->tbl;
 
-    int rc = bdb_temp_table_insert_put(bdb_state, tbl, key, keylen, data,
-                                       dtalen, bdberr);
+    int rc = bdb_temp_table_insert_put(bdb_state, tbl, cur, key, keylen, data,
+                                       dtalen, NULL, bdberr);
     if (rc <= 0)
         goto done;
 
@@ -673,6 +1117,18 @@ int bdb_temp_table_update(bdb_state_type *bdb_state, struct temp_cursor *cur,
     DBT dkey, ddata;
     int rc = 0;
 
+    if (cur->tbl->temp_table_type == TEMP_TABLE_TYPE_SKIPLIST) {
+        if (!cur->valid || cur->skip_cur == NULL || cur->skip_cur->deleted) {
+            *bdberr = DB_NOTFOUND;
+            rc = -1;
+        } else if ((rc = skiplist_set_data(cur->tbl, cur->skip_cur, data,
+                                           dtalen)) != 0) {
+            *bdberr = rc;
+            rc = -1;
+        }
+        goto done;
+    }
+
     if (cur->tbl->temp_table_type != TEMP_TABLE_TYPE_BTREE) {
         logmsg(LOGMSG_ERROR, "bdb_temp_table_update operation "
                         "only supported for btree.\n");
@@ -700,6 +1156,7 @@ int bdb_temp_table_update(bdb_state_type *bdb_state, struct temp_cursor *cur,
         rc = -1;
     }
 
+done:
     dbghexdump(3, key, keylen);
     dbgtrace(3, "temp_table_update(cursor %d) = %d\n", cur->curid, rc);
     return rc;
@@ -716,8 +1173,8 @@ int bdb_temp_table_put(bdb_state_type *bdb_state, struct temp_table *tbl,
 {
     DBT dkey, ddata;
 
-    int rc = bdb_temp_table_insert_put(bdb_state, tbl, key, keylen, data,
-                                       dtalen, bdberr);
+    int rc = bdb_temp_table_insert_put(bdb_state, tbl, NULL, key, keylen,
+                                       data, dtalen, unpacked, bdberr);
     if (rc <= 0)
         goto done;
 
@@ -790,6 +1247,18 @@ static int bdb_temp_table_first_last(bdb_state_type *bdb_state,
         return 0;
     }
 
+    if (cur->tbl->temp_table_type == TEMP_TABLE_TYPE_SKIPLIST) {
+        struct temp_skipnode *n;
+        cur->valid = 0;
+        n = (how == DB_FIRST) ? cur->tbl->skip_head->next[0]
+                              : cur->tbl->skip_tail;
+        if (n == NULL)
+            return IX_EMPTY;
+        if (skiplist_cursor_set(cur, n, bdberr))
+            return -1;
+        return 0;
+    }
+
     /* if cursor was deleted, need to reopen */
     if (cur->cur == NULL) {
         int rc = cur->tbl->tmpdb->cursor(cur->tbl->tmpdb, NULL, &cur->cur, 0);
@@ -882,6 +1351,28 @@ static int bdb_temp_table_next_prev_norewind(bdb_state_type *bdb_state,
         return 0;
     }
 
+    if (cur->tbl->temp_table_type == TEMP_TABLE_TYPE_SKIPLIST) {
+        struct temp_skipnode *n = cur->skip_cur;
+        if (n == NULL)
+            return IX_PASTEOF;
+        if (n->deleted) {
+            /* row is gone; its successor is the first key past it */
+            struct temp_skipnode *succ = skiplist_seek(
+                cur->tbl, n->keylen, SKIPNODE_KEY(n), NULL, NULL);
+            if (how == DB_NEXT)
+                n = succ;
+            else
+                n = succ ? succ->prev : cur->tbl->skip_tail;
+        } else {
+            n = (how == DB_NEXT) ? n->next[0] : n->prev;
+        }
+        if (n == NULL)
+            return IX_PASTEOF;
+        if (skiplist_cursor_set(cur, n, bdberr))
+            return -1;
+        return IX_FND;
+    }
+
     /* if cursor was deleted, need to reopen */
     if (cur->cur == NULL) {
         int rc = cur->tbl->tmpdb->cursor(cur->tbl->tmpdb, NULL, &cur->cur, 0);
@@ -1165,6 +1656,11 @@ int bdb_temp_table_truncate(bdb_state_type *bdb_state, struct temp_table *tbl,
             goto done;
         }
         break;
+
+    case TEMP_TABLE_TYPE_SKIPLIST:
+        skiplist_reset(tbl);
+        tbl->num_mem_entries = 0;
+        break;
     }
 
 done:
@@ -1203,8 +1699,9 @@ int bdb_temp_table_close(bdb_state_type *bdb_state, struct temp_table *tbl,
 
     Pthread_mutex_lock(&(bdb_state->temp_list_lock));
 
-    if ((tbl->dbenv_temp->memp_stat(tbl->dbenv_temp, &tmp, NULL,
-                                    DB_STAT_CLEAR)) == 0) {
+    if (tbl->dbenv_temp && (tbl->dbenv_temp->memp_stat(tbl->dbenv_temp, &tmp,
+                                                       NULL,
+                                                       DB_STAT_CLEAR)) == 0) {
         bdb_state->temp_stats->st_gbytes += tmp->st_gbytes;
         bdb_state->temp_stats->st_bytes += tmp->st_bytes;
         bdb_state->temp_stats->st_ncache += tmp->st_ncache;
@@ -1302,8 +1799,9 @@ int bdb_temp_table_destroy_lru(struct temp_table *tbl,
     bdb_state->temp_list = tbl->next;
     *last = 0;
 
-    if ((tbl->dbenv_temp->memp_stat(tbl->dbenv_temp, &tmp, NULL,
-                                    DB_STAT_CLEAR)) == 0) {
+    if (tbl->dbenv_temp && (tbl->dbenv_temp->memp_stat(tbl->dbenv_temp, &tmp,
+                                                       NULL,
+                                                       DB_STAT_CLEAR)) == 0) {
         bdb_state->temp_stats->st_gbytes += tmp->st_gbytes;
         bdb_state->temp_stats->st_bytes += tmp->st_bytes;
         bdb_state->temp_stats->st_ncache += tmp->st_ncache;
@@ -1378,12 +1876,17 @@ int bdb_temp_table_destroy_lru(struct temp_table *tbl,
     } break;
 
     case TEMP_TABLE_TYPE_BTREE:
+    case TEMP_TABLE_TYPE_SKIPLIST:
         break;
     }
 
     hash_free(tbl->temp_hash_tbl);
     tbl->temp_hash_tbl = NULL;
 
+    if (tbl->skip_arena)
+        arena_destroy(tbl->skip_arena);
+    free(tbl->skip_head);
+
     /* close the environments*/
     rc = bdb_temp_table_env_close(bdb_state, tbl, bdberr);
 
@@ -1422,6 +1925,17 @@ int bdb_temp_table_delete(bdb_state_type *bdb_state, struct temp_cursor *cur,
         goto done;
     }
 
+    if (cur->tbl->temp_table_type == TEMP_TABLE_TYPE_SKIPLIST) {
+        if (cur->skip_cur == NULL || cur->skip_cur->deleted) {
+            logmsg(LOGMSG_ERROR, "c_del rc %d\n", DB_KEYEMPTY);
+            *bdberr = DB_KEYEMPTY;
+            return -1;
+        }
+        skiplist_unlink(cur->tbl, cur->skip_cur);
+        rc = 0;
+        goto done;
+    }
+
     assert(cur->cur != NULL);
     rc = cur->cur->c_del(cur->cur, 0);
     if (rc) {
@@ -1518,6 +2032,19 @@ int bdb_temp_table_find(bdb_state_type *bdb_state, struct temp_cursor *cur,
         return 0;
     }
 
+    if (cur->tbl->temp_table_type == TEMP_TABLE_TYPE_SKIPLIST) {
+        struct temp_skipnode *n;
+        cur->valid = 0;
+        n = skiplist_seek(cur->tbl, keylen, key, unpacked, NULL);
+        if (n == NULL) {
+            /* find anything at all if possible */
+            rc = bdb_temp_table_last(bdb_state, cur, bdberr);
+            goto done;
+        }
+        rc = skiplist_cursor_set(cur, n, bdberr);
+        goto done;
+    }
+
     assert(cur->cur != NULL);
 
     /*pthread_setspecific(cur->tbl->curkey, cur);*/
@@ -1620,6 +2147,28 @@ int bdb_temp_table_find_exact(bdb_state_type *bdb_state,
         return 0;
     }
 
+    if (cur->tbl->temp_table_type == TEMP_TABLE_TYPE_SKIPLIST) {
+        struct temp_skipnode *n;
+        rc = 0;
+        cur->valid = 0;
+        n = skiplist_seek(cur->tbl, keylen, key, NULL, NULL);
+        if (n == NULL || skiplist_cmp(cur->tbl, keylen, key, NULL, n) != 0)
+            goto done;
+        exists = 1;
+        /* like DB_SET, the cursor keeps the caller's key rather than a copy */
+        if (cur->key != key)
+            free(cur->key);
+        cur->key = key;
+        cur->keylen = keylen;
+        free(cur->data);
+        cur->data = malloc(n->datalen);
+        memcpy(cur->data, n->data, n->datalen);
+        cur->datalen = n->datalen;
+        cur->skip_cur = n;
+        cur->valid = 1;
+        goto done;
+    }
+
     /*pthread_setspecific(cur->tbl->curkey, cur);*/
 
     memset(&dkey, 0, sizeof(DBT));
@@ -1699,7 +2248,8 @@ int bdb_temp_table_close_cursor(bdb_state_type *bdb_state,
     struct temp_table *tbl;
     tbl = cur->tbl;
 
-    if (cur->tbl->temp_table_type == TEMP_TABLE_TYPE_BTREE) {
+    if (cur->tbl->temp_table_type == TEMP_TABLE_TYPE_BTREE ||
+        cur->tbl->temp_table_type == TEMP_TABLE_TYPE_SKIPLIST) {
         if (cur->key) {
 #if 0
           printf( "%p Freeing %p\n", cur, cur->key);
@@ -1818,12 +2368,33 @@ int bdb_is_hashtable(struct temp_table *tt)
 }
 
 static int bdb_temp_table_insert_put(bdb_state_type *bdb_state,
-                                     struct temp_table *tbl, void *key,
+                                     struct temp_table *tbl,
+                                     struct temp_cursor *cur, void *key,
                                      int keylen, void *data, int dtalen,
-                                     int *bdberr)
+                                     void *unpacked, int *bdberr)
 {
     int rc;
 
+    if (tbl->temp_table_type == TEMP_TABLE_TYPE_SKIPLIST) {
+        struct temp_skipnode *n;
+
+        n = skiplist_insert(tbl, key, keylen, data, dtalen, unpacked, bdberr);
+        if (unlikely(n == NULL))
+            return -1;
+        /* c_put leaves a berkeley cursor on the new row */
+        if (cur)
+            cur->skip_cur = n;
+
+        if (skiplist_over_budget(tbl)) {
+            rc = bdb_skiplist_copy_to_temp_db(bdb_state, tbl, bdberr);
+            if (unlikely(rc)) {
+                return -1;
+            }
+        }
+
+        return 0;
+    }
+
     if (tbl->temp_table_type == TEMP_TABLE_TYPE_LIST) {
         struct temp_list_node *c_node = malloc(sizeof(struct temp_list_node));
         void *list_data = malloc(dtalen);
@@ -1880,7 +2451,8 @@ const char *bdb_temp_table_filename(struct temp_table *tbl)
 void bdb_temp_table_flush(struct temp_table *tbl)
 {
     DB *db = tbl->tmpdb;
-    db->sync(db, 0);
+    if (db)
+        db->sync(db, 0);
 }
 
 int bdb_temp_table_stat(bdb_state_type *bdb_state, DB_MPOOL_STAT **gspp)
@@ -510,6 +510,15 @@ struct __db_lock_stat {
 	u_int32_t st_nnowaits;		/* Number of requests that would have
 					   waited, but NOWAIT was set. */
 	u_int32_t st_ndeadlocks;	/* Number of lock deadlocks. */
+	u_int32_t st_ndetects;		/* Full deadlock detector passes. */
+	u_int64_t st_detect_usecs;	/* Time spent in them. */
+	u_int64_t st_detect_cpu_usecs;	/* CPU time spent in them. */
+	u_int32_t st_nwfg_detects;	/* Incremental deadlock searches. */
+	u_int32_t st_nwfg_cycles;	/* Searches that found a cycle. */
+	u_int32_t st_nwfg_fallbacks;	/* Searches given up for a full pass. */
+	u_int64_t st_wfg_visits;	/* Lockers visited by searches. */
+	u_int64_t st_wfg_usecs;		/* Time spent searching. */
+	u_int64_t st_wfg_cpu_usecs;	/* CPU time spent searching. */
 	db_timeout_t st_locktimeout;	/* Lock timeout. */
 	u_int32_t st_nlocktimeouts;	/* Number of lock timeouts. */
 	db_timeout_t st_txntimeout;	/* Transaction timeout. */
@@ -691,6 +700,14 @@ struct __db_log_stat {
 	u_int32_t st_ondisk_get;	/* On-disk log_get. */
 	u_int32_t st_inmem_trav;	/* Mem-log steps for partial reads. */
 	u_int32_t st_wrap_copy;		/* Count of wrapped copies. */
+	u_int32_t st_group_commits;	/* Commits synced by the flusher. */
+	u_int32_t st_group_flushes;	/* Flusher write+sync passes. */
+	u_int32_t st_group_waiters;	/* Committers waiting right now. */
+	u_int32_t st_commit_lat_p50;	/* Commit wait percentiles (usecs). */
+	u_int32_t st_commit_lat_p90;
+	u_int32_t st_commit_lat_p99;
+	u_int32_t st_commit_lat_p999;
+	u_int32_t st_commit_lat_max;
 };
 
 /*******************************************************
@@ -867,6 +884,8 @@ struct __db_mpool_stat {
 	u_int32_t st_hash_nowait;	/* Hash lock granted with nowait. */
 	u_int32_t st_hash_wait;		/* Hash lock granted after wait. */
 	u_int32_t st_hash_max_wait;	/* Max hash lock granted after wait. */
+	u_int32_t st_hash_optimistic;	/* Gets/puts done without hash lock. */
+	u_int32_t st_hash_optimistic_miss;/* Lock-free attempts that fell back. */
 	u_int32_t st_region_nowait;	/* Region lock granted with nowait. */
 	u_int32_t st_region_wait;	/* Region lock granted after wait. */
 	u_int32_t st_alloc;		/* Number of page allocations. */
@@ -876,6 +895,11 @@ struct __db_mpool_stat {
 	u_int32_t st_alloc_max_pages;	/* Max checked during allocation. */
 	u_int32_t st_ckp_pages_sync;	/* Number of pages sync'd using perfect ckp. */
 	u_int32_t st_ckp_pages_skip;	/* Number of pages skipped using perfect ckp. */
+	u_int32_t st_scan_hit;		/* Scan gets found in the cache. */
+	u_int32_t st_scan_miss;		/* Scan gets not found in the cache. */
+	u_int32_t st_scan_promote;	/* Scan pages re-referenced by others. */
+	u_int32_t st_scan_evict;	/* Scan pages forced from the cache. */
+	u_int32_t st_scan_pages;	/* Scan pages in the cache. */
 };
 
 /* Mpool file statistics structure. */
@@ -894,6 +918,10 @@ struct __db_mpool_fstat {
 	u_int32_t st_page_out;		/* Pages written out. */
 	u_int32_t st_ro_merges;		/* Read merges performed. */
 	u_int32_t st_rw_merges;		/* Write merges performed. */
+	u_int32_t st_scan_hit;		/* Scan gets found in the cache. */
+	u_int32_t st_scan_miss;		/* Scan gets not found in the cache. */
+	u_int32_t st_scan_promote;	/* Scan pages re-referenced by others. */
+	u_int32_t st_scan_evict;	/* Scan pages forced from the cache. */
 };
 
 /*******************************************************
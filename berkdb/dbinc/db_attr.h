@@ -2,6 +2,7 @@
 
 BERK_DEF_ATTR(iomap_enabled, "Map file that tells comdb2ar to pause while we fsync", BERK_ATTR_TYPE_BOOLEAN, 1)
 BERK_DEF_ATTR(flush_scan_dbs_first, "Don't hold bufpool mutex while opening files for flush", BERK_ATTR_TYPE_BOOLEAN, 0)
+BERK_DEF_ATTR(aio_batch, "Submit multi-page reads and writes together through io_uring or kernel aio", BERK_ATTR_TYPE_BOOLEAN, 0)
 BERK_DEF_ATTR(skip_sync_if_direct, "Don't fsync files if directio enabled", BERK_ATTR_TYPE_BOOLEAN, 1)
 BERK_DEF_ATTR(warn_on_replicant_log_write, "Warn if replicant is writing to logs", BERK_ATTR_TYPE_BOOLEAN, 1)
 BERK_DEF_ATTR(abort_on_replicant_log_write , "Abort if replicant is writing to logs", BERK_ATTR_TYPE_BOOLEAN, 0)
@@ -59,8 +60,19 @@ BERK_DEF_ATTR(latch_max_wait, "Block at most this many microseconds before retur
 BERK_DEF_ATTR(latch_poll_us, "Poll latch this many microseconds before retrying", BERK_ATTR_TYPE_INTEGER, 1000)
 BERK_DEF_ATTR(latch_max_poll, "Poll latch this many times before returning deadlock", BERK_ATTR_TYPE_INTEGER, 5)
 BERK_DEF_ATTR(latch_timed_mutex, "Use a timed mutex", BERK_ATTR_TYPE_BOOLEAN, 1)
+BERK_DEF_ATTR(lock_fastpath, "Grant uncontended rowlocks with a CAS on a slot word instead of through the lock table (slots are allocated at startup)", BERK_ATTR_TYPE_BOOLEAN, 0)
+BERK_DEF_ATTR(max_fastlock, "Size of fast path rowlock slot array", BERK_ATTR_TYPE_INTEGER, 1048576)
+BERK_DEF_ATTR(max_fastlock_lockerid, "Size of fast path lockerid array", BERK_ATTR_TYPE_INTEGER, 10000)
+BERK_DEF_ATTR(deadlock_incremental, "Search for deadlocks only from a locker that is about to wait, running the full detector when a cycle is found", BERK_ATTR_TYPE_BOOLEAN, 0)
+BERK_DEF_ATTR(deadlock_incremental_max, "Hand an incremental deadlock search to the full detector after visiting this many lockers", BERK_ATTR_TYPE_INTEGER, 1024)
+BERK_DEF_ATTR(mpool_optimistic_get, "Get and put pages that are already pinned without the hash bucket lock", BERK_ATTR_TYPE_BOOLEAN, 0)
+BERK_DEF_ATTR(page_compress, "Store btree pages compressed on disk: 0 off, 1 lz4, 2 zstd", BERK_ATTR_TYPE_INTEGER, 0)
+BERK_DEF_ATTR(page_compress_zstd_level, "zstd compression level for page_compress", BERK_ATTR_TYPE_INTEGER, 1)
+BERK_DEF_ATTR(mpool_scan_pct, "Percent of the cache that pages read by scans may hold (0 to cache them like any other page)", BERK_ATTR_TYPE_PERCENT, 25)
+BERK_DEF_ATTR(log_group_commit, "Sync commits from a dedicated log flusher thread", BERK_ATTR_TYPE_BOOLEAN, 0)
 BERK_DEF_ATTR(log_cursor_cache, "Cache log cursors", BERK_ATTR_TYPE_BOOLEAN, 0)
 BERK_DEF_ATTR(recovery_processor_poll_interval_us, "Recovery processor wakes this often to check workers", BERK_ATTR_TYPE_INTEGER, 1000)
+BERK_DEF_ATTR(rep_apply_page_partitions, "Spread single-page records of a file over this many recovery workers by page (0 = one worker per file)", BERK_ATTR_TYPE_INTEGER, 0)
 BERK_DEF_ATTR(lsnerr_logflush, "Flush log on lsn error", BERK_ATTR_TYPE_BOOLEAN, 1)
 BERK_DEF_ATTR(tracked_locklist_init, "Initial allocation count for tracked locks", BERK_ATTR_TYPE_INTEGER, 10)
 /* This is a placeholder for now */
@@ -34,6 +34,8 @@ extern size_t gbl_lkr_hash;
 #define	LOCK_INVALID		INVALID_ROFF
 #define LATCH_OFFSET		-1
 #define LOCK_ISLATCH(lock)	((lock).off == LATCH_OFFSET)
+#define FASTLOCK_OFFSET		-2
+#define LOCK_ISFAST(lock)	((lock).off == FASTLOCK_OFFSET)
 #define	LOCK_ISSET(lock)	((lock).off != LOCK_INVALID)
 #define	LOCK_INIT(lock)		((lock).off = LOCK_INVALID)
 
@@ -120,6 +122,8 @@ struct __db_latch;
 struct __db_lock_lsn;
 struct __db_lockerid_latch_node;
 struct __db_lockerid_latch_list;
+struct __db_fastlock_node;
+struct __db_fastlock_list;
 
 /*
  * DB_LOCKREGION --
@@ -176,6 +180,14 @@ typedef struct __db_lockregion {
 	struct __db_lockerid_latch_node	*lockerid_node_head;
 	pthread_mutex_t 	db_lock_lsn_lk;
 	SH_LIST_HEAD(_regionlsns, __db_lock_lsn) db_lock_lsn_head;
+
+	/* Uncontended rowlock fast path */
+	u_int32_t		max_fastlock;
+	u_int32_t		max_fastlock_lockerid;
+	u_int64_t		*fastlocks;	/* slot state words */
+	struct __db_fastlock_list	*fastlock_lockers;
+	pthread_mutex_t		fastlock_node_lk;
+	struct __db_fastlock_node	*fastlock_node_head;
 } DB_LOCKREGION;
 
 typedef struct __sh_dbt {
@@ -248,6 +260,56 @@ typedef struct __db_lockerid_latch_list {
 	DB_LOCKERID_LATCH_NODE *head;
 } DB_LOCKERID_LATCH_LIST;
 
+/*
+ * Fast path rowlocks.  Each rowlock hashes to a slot in region->fastlocks
+ * whose state word is one of
+ *
+ *	0				nothing in the slot is locked
+ *	FASTLOCK_EXCL | n << 32 | id	locker id holds n fast locks in the slot,
+ *					and nobody else holds or wants any
+ *	FASTLOCK_SLOW | n		the lock table has the slot; n counts its
+ *					lock objects and the requests in flight
+ *
+ * Fast locks are kept on their locker's DB_FASTLOCK_NODE instead of in the
+ * lock table.  Handles for them have off == FASTLOCK_OFFSET.
+ */
+#define	FASTLOCK_SLOW		0x8000000000000000ULL
+#define	FASTLOCK_INFLATING	0x4000000000000000ULL
+#define	FASTLOCK_EXCL		0x2000000000000000ULL
+#define	FASTLOCK_FLAGS		(FASTLOCK_SLOW|FASTLOCK_INFLATING|FASTLOCK_EXCL)
+#define	FASTLOCK_ONE		0x0000000100000000ULL
+#define	FASTLOCK_NLOCKS(w)	(((w) & ~FASTLOCK_FLAGS) >> 32)
+#define	FASTLOCK_MAXLOCKS	4096	/* Per locker; more go to the table. */
+
+typedef struct __db_fastlock {
+	u_int8_t obj[32];		/* Rowlock or endlock. */
+	u_int32_t size;
+	u_int32_t slot;
+	u_int32_t gen;			/* Handle gen; unique in the node. */
+	u_int32_t refcount;
+	db_lockmode_t mode;
+	roff_t off;			/* Table lock once inflated, or */
+	u_int32_t offgen;		/* LOCK_INVALID. */
+	u_int32_t ndx;
+	u_int32_t partition;
+} DB_FASTLOCK;
+
+typedef struct __db_fastlock_node {
+	pthread_mutex_t lock;
+	u_int32_t lockerid;
+	u_int32_t gen;
+	u_int32_t nlocks;
+	u_int32_t maxlocks;
+	DB_FASTLOCK *locks;
+	struct __db_fastlock_node *next;
+	struct __db_fastlock_node *prev;
+} DB_FASTLOCK_NODE;
+
+typedef struct __db_fastlock_list {
+	pthread_mutex_t lock;
+	DB_FASTLOCK_NODE *head;
+} DB_FASTLOCK_LIST;
+
 /*
  * Locker structures; these live in the locker hash table.
  */
@@ -293,6 +355,16 @@ typedef struct __db_locker {
 	u_int32_t flags;
 	u_int8_t has_pglk_lsn;
 	u_int8_t wstatus;  /* master locker waiting, for deadlock detection */
+	/*
+	 * Lock a master locker is waiting on and its generation, for the
+	 * incremental deadlock detector.  Set and cleared atomically by the
+	 * waiting thread; readers check the generation and status under the
+	 * lock's partition before trusting it.  dd_unpublished counts the
+	 * master's children waiting while the edge was taken by another.
+	 */
+	struct __db_lock *dd_waitlock;
+	u_int32_t dd_waitgen;
+	u_int32_t dd_unpublished;
 } DB_LOCKER;
 
 /*
@@ -377,6 +449,13 @@ struct __db_lock {
 #define	DB_LOCK_UNLINK		0x080000
 #define	DB_LOCK_NOWAITERS	0x100000
 
+/*
+ * Flag value for __lock_get_internal:
+ * DB_LOCK_FASTINFLATE: Granting a fast lock into the table on behalf of its
+ *		      owner, which may be waiting on something else.
+ */
+#define	DB_LOCK_FASTINFLATE	0x200000
+
 /*
  * Macros to get/release different types of mutexes.
  */
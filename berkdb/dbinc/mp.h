@@ -162,6 +162,13 @@ struct __mpool {
 	u_int32_t last_checked;	/* Last bucket checked for free. */
 	u_int32_t lru_count;	/* Counter for buffer LRU */
 
+	/*
+	 * Buffers brought in by scans carry BH_NOINCR until somebody else
+	 * references them; scan_pages counts them so allocation can keep
+	 * scans recycling their own buffers.  Updated atomically.
+	 */
+	u_int32_t scan_pages;	/* BH_NOINCR buffers in this cache. */
+
 	/*
 	 * The stat fields are generally not thread protected, and cannot be
 	 * trusted.  Note that st_pages is an exception, and is always updated
@@ -191,8 +198,48 @@ struct __db_mpool_hash {
 	HashTab 	hash_bucket;	/* Head of bucket. */
 	db_atomic_t	hash_page_dirty;/* Count of dirty pages. */
 	u_int32_t	hash_priority;	/* Minimum priority of bucket buffer. */
+	u_int32_t	hash_writers;	/* Threads changing the chain. */
+	u_int32_t	hash_readers;	/* Threads walking it lock-free. */
 };
 
+/*
+ * Optimistic (lock-free) bucket lookups --
+ *
+ * __memp_fget and __memp_fput can pin and unpin an already referenced,
+ * resident buffer without the bucket mutex.  A lock-free reader registers
+ * in hash_readers and gives up if hash_writers is non-zero; a thread that
+ * unlinks, relinks or frees a buffer, or that locks one for I/O, holds the
+ * bucket mutex, registers in hash_writers and then waits for the readers
+ * to drain.  Readers never block, so the wait is short, and no reader can
+ * be looking at a buffer header while it's being moved or freed.  Writer
+ * sections nest.
+ *
+ * A lock-free reader only pins a buffer whose reference count is already
+ * non-zero, so a buffer found unreferenced under the bucket mutex stays
+ * unreferenced.  Because of that, every reference count change goes
+ * through the atomic macros below.
+ */
+#define	BH_REF_INC(bhp)							\
+	__atomic_add_fetch(&(bhp)->ref, 1, __ATOMIC_SEQ_CST)
+#define	BH_REF_DEC(bhp)							\
+	__atomic_sub_fetch(&(bhp)->ref, 1, __ATOMIC_SEQ_CST)
+
+#define	MEMP_HASH_WRITE_BEGIN(hp) do {					\
+	__atomic_add_fetch(&(hp)->hash_writers, 1, __ATOMIC_SEQ_CST);	\
+	while (__atomic_load_n(&(hp)->hash_readers, __ATOMIC_SEQ_CST))	\
+		;							\
+} while (0)
+#define	MEMP_HASH_WRITE_END(hp)						\
+	__atomic_sub_fetch(&(hp)->hash_writers, 1, __ATOMIC_SEQ_CST)
+
+/* Returns non-zero if the caller may walk the bucket lock-free. */
+#define	MEMP_HASH_READ_BEGIN(hp)					\
+	(__atomic_add_fetch(&(hp)->hash_readers, 1, __ATOMIC_SEQ_CST),	\
+	__atomic_load_n(&(hp)->hash_writers, __ATOMIC_SEQ_CST) == 0 ?	\
+	1 : (MEMP_HASH_READ_END(hp), 0))
+#define	MEMP_HASH_READ_END(hp)						\
+	__atomic_sub_fetch(&(hp)->hash_readers, 1, __ATOMIC_SEQ_CST)
+
 /*
  * The base mpool priority is 1/4th of the name space, or just under 2^30.
  * When the LRU counter wraps, we shift everybody down to a base-relative
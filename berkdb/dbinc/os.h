@@ -79,6 +79,15 @@ struct __fh_t {
 	u_int8_t flags;
 };
 
+/* One page read or write in a batch handed to __os_aio_rw. */
+typedef struct __db_aio_req {
+	DB_FH	*fhp;
+	u_int8_t *buf;
+	size_t	 len;
+	off_t	 off;
+	ssize_t	 res;			/* Bytes transferred or -errno. */
+} DB_AIO_REQ;
+
 #if defined(__cplusplus)
 }
 #endif
@@ -89,6 +89,17 @@ static int __lock_sort_cmp __P((const void *, const void *));
 static int __locklsn_sort_cmp __P((const void *, const void *));
 static int __rowlock_sort_cmp __P((const void *, const void *));
 static int __lock_fix_list __P((DB_ENV *, DBT *, u_int32_t, u_int8_t));
+static int __lock_get_internal_int __P((DB_LOCKTAB *, u_int32_t, DB_LOCKER **,
+	u_int32_t, const DBT *, db_lockmode_t, db_timeout_t, DB_LOCK *));
+static u_int32_t __fastlock_hold __P((DB_LOCKTAB *, const DBT *));
+static void __fastlock_release __P((DB_LOCKTAB *, u_int32_t));
+static int __fastlock_put __P((DB_LOCKTAB *, DB_LOCK *, int *));
+static int __fastlock_resolve __P((DB_LOCKTAB *, DB_LOCK *));
+static void __fastlock_inflate_locker __P((DB_LOCKTAB *, u_int32_t));
+static void __fastlock_put_all __P((DB_LOCKTAB *, u_int32_t));
+static u_int32_t __fastlock_free_locker __P((DB_LOCKTAB *, u_int32_t));
+static u_int32_t __fastlock_count __P((DB_LOCKTAB *, u_int32_t));
+static int __fastlock_to_dbt __P((DB_LOCKTAB *, DB_LOCK *, DBT *));
 
 static const char __db_lock_err[] = "Lock table is out of available %s";
 static const char __db_lock_invalid[] = "%s: Lock is no longer valid";
@@ -677,7 +688,7 @@ __lock_id_free(dbenv, id)
 	DB_LOCKER *sh_locker;
 	DB_LOCKTAB *lt;
 	DB_LOCKREGION *region;
-	u_int32_t locker_ndx, partition;
+	u_int32_t locker_ndx, partition, nfast;
 	int ret;
 
 	PANIC_CHECK(dbenv);
@@ -688,6 +699,9 @@ __lock_id_free(dbenv, id)
 	region = lt->reginfo.primary;
 
 	__free_latch_lockerid(dbenv, id);
+	if ((nfast = __fastlock_free_locker(lt, id)) != 0)
+		logmsg(LOGMSG_ERROR, "locker %x, freed with %u fast locks\n",
+		    (int)id, nfast);
 
 	LOCKREGION(dbenv, lt);
 	lock_lockers(region);
@@ -1336,7 +1350,7 @@ __lock_vec(dbenv, locker, flags, list, nlist, elistp)
 	struct __db_lockobj_lsn *lklsnp;
 	u_int32_t lndx, ndx;
 	u_int32_t nwrites = 0, nwritelatches = 0, countwl = 0, counttot = 0;
-	u_int32_t partition;
+	u_int32_t partition, fslot;
 	u_int32_t run_dd;
 	int did_abort, i, ret, rc, upgrade, writes, has_pglk_lsn = 0;
 
@@ -1364,6 +1378,7 @@ __lock_vec(dbenv, locker, flags, list, nlist, elistp)
 			    list[i].mode, list[i].timeout, &list[i].lock);
 			break;
 		case DB_LOCK_INHERIT:
+			__fastlock_inflate_locker(lt, locker);
 			ret = __lock_inherit_locks(lt, locker, flags);
 			break;
 		case DB_LOCK_PUT:
@@ -1394,6 +1409,16 @@ __lock_vec(dbenv, locker, flags, list, nlist, elistp)
 				objlist->data = NULL;
 			}
 
+			/*
+			 * Fast locks that were never inflated can simply be
+			 * dropped; anything more selective needs them in
+			 * the table.
+			 */
+			if (list[i].op == DB_LOCK_PUT_ALL)
+				__fastlock_put_all(lt, locker);
+			else
+				__fastlock_inflate_locker(lt, locker);
+
 			LOCKER_INDX(lt, region, locker, ndx);
 			if ((rc = __lock_getlocker(lt,
 				    locker, ndx, 0, GETLOCKER_KEEP_PART,
@@ -1723,6 +1748,7 @@ up_done:
 			break;
 		case DB_LOCK_PUT_OBJ:
 			/* Remove all the locks associated with an object. */
+			fslot = __fastlock_hold(lt, list[i].obj);
 			OBJECT_INDX(lt, region, list[i].obj, ndx, partition);
 			lock_obj_partition(region, partition);
 			if ((ret = __lock_getobj(lt, list[i].obj,
@@ -1731,6 +1757,7 @@ up_done:
 				if (ret == 0)
 					ret = EINVAL;
 				unlock_obj_partition(region, partition);
+				__fastlock_release(lt, fslot);
 				break;
 			}
 
@@ -1798,6 +1825,7 @@ again2:		for (lp = SH_TAILQ_FIRST(&sh_obj->holders, __db_lock);
 				unlock_locker_partition(region, tl->partition);
 			}
 			unlock_obj_partition(region, partition);
+			__fastlock_release(lt, fslot);
 			break;
 
 		case DB_LOCK_TIMEOUT:
@@ -1857,7 +1885,8 @@ again2:		for (lp = SH_TAILQ_FIRST(&sh_obj->holders, __db_lock);
 	UNLOCKREGION(dbenv, (DB_LOCKTAB *)dbenv->lk_handle);
 
 	/* FIXME TODO XXX should I be checking for need_dd here?? */
-	if (run_dd || region->need_dd)
+	/* Releases only remove waits-for edges, so not when incremental. */
+	if ((run_dd || region->need_dd) && !dbenv->attr.deadlock_incremental)
 		(void)__lock_detect(dbenv, region->detect, &did_abort);
 
 	if (ret != 0 && elistp != NULL)
@@ -2045,15 +2074,15 @@ __lock_get_internal_int(lt, locker, in_locker, flags, obj, lock_mode, timeout,
 	}
 	u_int32_t partition = gbl_lk_parts, lpartition = gbl_lkr_parts;
 	int x1, x2;
-	struct __db_lock *newl, *lp, *firstlp, *wwrite;
+	struct __db_lock *newl, *lp, *firstlp, *wwrite, *waitlp;
 	DB_ENV *dbenv;
-	DB_LOCKER *sh_locker;
+	DB_LOCKER *sh_locker, *wlocker;
 	DB_LOCKOBJ *sh_obj;
 	DB_LOCKREGION *region;
 	u_int32_t holder, obj_ndx, ihold, *holdarr, holdix, holdsz;
 	extern int gbl_lock_get_verbose_waiter;
 	int verbose_waiter = gbl_lock_get_verbose_waiter;;
-	int did_abort, grant_dirty, no_dd, ret, t_ret;
+	int did_abort, dd_unpublished, grant_dirty, no_dd, ret, t_ret;
 	extern int gbl_locks_check_waiters;
 
 	/* Set a locker's status */
@@ -2509,8 +2538,19 @@ __lock_get_internal_int(lt, locker, in_locker, flags, obj, lock_mode, timeout,
 		    SH_LIST_FIRST(&sh_locker->child_locker, __db_locker) == NULL
 		    && SH_LIST_FIRST(&sh_locker->heldby, __db_lock) == NULL;
 
-		SH_LIST_INSERT_HEAD(&sh_locker->heldby, newl, locker_links,
-		    __db_lock);
+		/*
+		 * The deadlock detector expects a waiting locker's first
+		 * lock to be the one it's waiting on, so a fast lock moved
+		 * into the table for a waiting locker goes after it.
+		 */
+		if (LF_ISSET(DB_LOCK_FASTINFLATE) &&
+		    (waitlp = SH_LIST_FIRST(&sh_locker->heldby,
+		    __db_lock)) != NULL && waitlp->status == DB_LSTAT_WAITING)
+			SH_LIST_INSERT_AFTER(waitlp, newl, locker_links,
+			    __db_lock);
+		else
+			SH_LIST_INSERT_HEAD(&sh_locker->heldby, newl,
+			    locker_links, __db_lock);
 
 #ifndef TESTSUITE
 		if (gbl_berkdb_track_locks) {
@@ -2677,10 +2717,28 @@ upgrade:
 
 		/* set waiting status for master_locker */
 		if (sh_locker->master_locker == INVALID_ROFF)
-			sh_locker->wstatus = 1;
+			wlocker = sh_locker;
+		else
+			wlocker = (DB_LOCKER *)R_ADDR(&lt->reginfo,
+			    sh_locker->master_locker);
+		wlocker->wstatus = 1;
+
+		/*
+		 * Publish the waits-for edge for the incremental detector.
+		 * A master has room for one edge; if another of its children
+		 * is already waiting, count ours as unpublished instead, and
+		 * searches through the master go to the full detector.
+		 */
+		waitlp = NULL;
+		dd_unpublished = !__atomic_compare_exchange_n(
+		    &wlocker->dd_waitlock, &waitlp, newl, 0, __ATOMIC_SEQ_CST,
+		    __ATOMIC_SEQ_CST);
+		if (dd_unpublished)
+			__atomic_add_fetch(&wlocker->dd_unpublished, 1,
+			    __ATOMIC_SEQ_CST);
 		else
-			((DB_LOCKER *)R_ADDR(&lt->reginfo,
-				sh_locker->master_locker))->wstatus = 1;
+			__atomic_store_n(&wlocker->dd_waitgen, newl->gen,
+			    __ATOMIC_SEQ_CST);
 
 		unlock_locker_partition(region, lpartition);
 
@@ -2700,6 +2758,14 @@ upgrade:
 		if (LF_ISSET(DB_LOCK_SWITCH) &&
 		    (ret = __lock_put_nolock(dbenv,
 			    lock, &ihold, DB_LOCK_NOWAITERS)) != 0) {
+			waitlp = newl;
+			if (dd_unpublished)
+				__atomic_sub_fetch(&wlocker->dd_unpublished, 1,
+				    __ATOMIC_SEQ_CST);
+			else
+				__atomic_compare_exchange_n(
+				    &wlocker->dd_waitlock, &waitlp, NULL, 0,
+				    __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
 			lock_locker_partition(region, lpartition);
 			lock_obj_partition(region, partition);
 			__lock_remove_waiter(lt, sh_obj, newl, DB_LSTAT_FREE);
@@ -2737,8 +2803,14 @@ upgrade:
 		 * We are about to wait; before waiting, see if the deadlock
 		 * detector should be run.
 		 */
-		if (region->detect != DB_LOCK_NORUN && !no_dd)
-			(void)__lock_detect(dbenv, region->detect, &did_abort);
+		if (region->detect != DB_LOCK_NORUN && !no_dd) {
+			if (dbenv->attr.deadlock_incremental)
+				(void)__lock_detect_incremental(dbenv,
+				    region->detect, wlocker, &did_abort);
+			else
+				(void)__lock_detect(dbenv,
+				    region->detect, &did_abort);
+		}
 
 		if (gbl_bb_berkdb_enable_lock_timing) {
 			x1 = bb_berkdb_fasttime();
@@ -2770,6 +2842,16 @@ upgrade:
 			}
 		}
 
+		/* Not waiting on this object any more, whatever happened. */
+		waitlp = newl;
+		if (dd_unpublished)
+			__atomic_sub_fetch(&wlocker->dd_unpublished, 1,
+			    __ATOMIC_SEQ_CST);
+		else
+			__atomic_compare_exchange_n(&wlocker->dd_waitlock,
+			    &waitlp, NULL, 0, __ATOMIC_SEQ_CST,
+			    __ATOMIC_SEQ_CST);
+
 		LOCKREGION(dbenv, (DB_LOCKTAB *)dbenv->lk_handle);
 		lock_locker_partition(region, lpartition);
 		lock_obj_partition(region, partition);
@@ -2840,7 +2922,9 @@ expired:			obj_ndx = sh_obj->index;
 
 
 	/* clear waiting status for master_locker */
-	if (sh_locker->master_locker == INVALID_ROFF)
+	if (LF_ISSET(DB_LOCK_FASTINFLATE))
+		;	/* the locker may be waiting elsewhere */
+	else if (sh_locker->master_locker == INVALID_ROFF)
 		sh_locker->wstatus = 0;
 	else
 		((DB_LOCKER *)R_ADDR(&lt->reginfo,
@@ -2897,6 +2981,549 @@ err:
 	return (ret);
 }
 
+/*
+ * Uncontended rowlock fast path.
+ *
+ * With lock_fastpath set, a READ or WRITE rowlock requested on the master is
+ * granted by a CAS on its slot word (see DB_FASTLOCK in lock.h) when the slot
+ * is free or already owned by the same locker.  The lock is remembered on the
+ * locker's DB_FASTLOCK_NODE, which only that locker's thread and inflaters
+ * touch, so no partition mutex is taken and nothing goes into the lock table.
+ *
+ * Every other rowlock request "holds" its slot for the table while it runs.
+ * Finding the slot owned by a fast locker, it first inflates that locker's
+ * locks in the slot into ordinary table locks; the slot is FASTLOCK_INFLATING
+ * meanwhile so that no one else gets in first.  From then on the table does
+ * what it always has: conflicts wait, deadlocks are detected, and the slot
+ * goes back to 0 when its last lock object is freed.
+ *
+ * Anything that needs a table lock behind a fast handle (upgrades, trades,
+ * downgrades, PUT_READ, inheritance) inflates it first.  Fast locks that are
+ * never inflated don't show up in lock dumps or deadlock detector counts.
+ */
+static __thread DB_FASTLOCK_NODE *fastlock_last;
+
+static inline u_int32_t
+fastlock_slot(DB_LOCKREGION *region, const DBT *obj)
+{
+	return (__lock_ohash(obj) % region->max_fastlock);
+}
+
+int
+init_fastlocks(dbenv, lt)
+	DB_ENV *dbenv;
+	DB_LOCKTAB *lt;
+{
+	DB_LOCKREGION *region = lt->reginfo.primary;
+	u_int32_t i;
+
+	region->fastlocks = NULL;
+	if (!dbenv->attr.lock_fastpath || dbenv->attr.max_fastlock <= 0 ||
+	    dbenv->attr.max_fastlock_lockerid <= 0)
+		return 0;
+
+	region->max_fastlock = dbenv->attr.max_fastlock;
+	region->max_fastlock_lockerid = dbenv->attr.max_fastlock_lockerid;
+
+	if (__os_calloc(dbenv, region->max_fastlock_lockerid,
+		sizeof(DB_FASTLOCK_LIST), &region->fastlock_lockers) != 0)
+		abort();
+	for (i = 0; i < region->max_fastlock_lockerid; i++)
+		pthread_mutex_init(&region->fastlock_lockers[i].lock, NULL);
+	pthread_mutex_init(&region->fastlock_node_lk, NULL);
+	region->fastlock_node_head = NULL;
+
+	if (__os_calloc(dbenv, region->max_fastlock, sizeof(u_int64_t),
+		&region->fastlocks) != 0)
+		abort();
+	return 0;
+}
+
+/*
+ * Find a locker's fast lock node, creating it if asked, and return it
+ * locked.  Nodes are recycled but never freed, so a node remembered by this
+ * thread can be locked and checked without the list lock.
+ */
+static DB_FASTLOCK_NODE *
+__fastlock_node(DB_LOCKTAB *lt, u_int32_t locker, int create)
+{
+	DB_LOCKREGION *region = lt->reginfo.primary;
+	DB_FASTLOCK_LIST *l;
+	DB_FASTLOCK_NODE *n;
+
+	if ((n = fastlock_last) != NULL) {
+		pthread_mutex_lock(&n->lock);
+		if (n->lockerid == locker)
+			return n;
+		pthread_mutex_unlock(&n->lock);
+	}
+
+	l = &region->fastlock_lockers[locker % region->max_fastlock_lockerid];
+	pthread_mutex_lock(&l->lock);
+	for (n = l->head; n != NULL && n->lockerid != locker; n = n->next)
+		;
+	if (n == NULL && create) {
+		pthread_mutex_lock(&region->fastlock_node_lk);
+		if ((n = region->fastlock_node_head) != NULL)
+			region->fastlock_node_head = n->next;
+		pthread_mutex_unlock(&region->fastlock_node_lk);
+		if (n == NULL) {
+			if (__os_calloc(lt->dbenv, 1, sizeof(*n), &n) != 0) {
+				pthread_mutex_unlock(&l->lock);
+				return NULL;
+			}
+			pthread_mutex_init(&n->lock, NULL);
+		}
+		n->lockerid = locker;
+		n->nlocks = 0;
+		n->prev = NULL;
+		n->next = l->head;
+		if (l->head)
+			l->head->prev = n;
+		l->head = n;
+	}
+	if (n != NULL)
+		pthread_mutex_lock(&n->lock);
+	pthread_mutex_unlock(&l->lock);
+	if (n != NULL && create)
+		fastlock_last = n;
+	return n;
+}
+
+static inline DB_FASTLOCK *
+__fastlock_find(DB_FASTLOCK_NODE *n, u_int32_t gen)
+{
+	u_int32_t i;
+
+	for (i = n->nlocks; i > 0; i--)
+		if (n->locks[i - 1].gen == gen)
+			return &n->locks[i - 1];
+	return NULL;
+}
+
+/* Give back one of an owner's fast locks in a slot.  Node is locked. */
+static inline void
+__fastlock_unslot(DB_LOCKREGION *region, u_int32_t slot)
+{
+	u_int64_t *w = &region->fastlocks[slot], cur;
+
+	/* Only the owner changes an EXCL word, under its node lock. */
+	cur = __atomic_load_n(w, __ATOMIC_SEQ_CST);
+	DB_ASSERT((cur & FASTLOCK_FLAGS) == FASTLOCK_EXCL);
+	__atomic_store_n(w, FASTLOCK_NLOCKS(cur) == 1 ? 0 : cur - FASTLOCK_ONE,
+	    __ATOMIC_SEQ_CST);
+}
+
+static void
+__fastlock_release(DB_LOCKTAB *lt, u_int32_t slot)
+{
+	DB_LOCKREGION *region = lt->reginfo.primary;
+	u_int64_t *w, cur;
+
+	if (slot >= region->max_fastlock)
+		return;
+	w = &region->fastlocks[slot];
+	cur = __atomic_sub_fetch(w, 1, __ATOMIC_SEQ_CST);
+	if (cur == FASTLOCK_SLOW)
+		__atomic_compare_exchange_n(w, &cur, 0, 0, __ATOMIC_SEQ_CST,
+		    __ATOMIC_SEQ_CST);
+}
+
+/*
+ * Move an owner's fast locks in a slot into the lock table and leave the
+ * slot to the table.  Node is locked.
+ */
+static void
+__fastlock_inflate_slot(DB_LOCKTAB *lt, DB_FASTLOCK_NODE *n, u_int32_t slot)
+{
+	DB_LOCKREGION *region = lt->reginfo.primary;
+	DB_LOCKER *sh_locker;
+	DB_FASTLOCK *e;
+	DB_LOCK lock;
+	struct __db_lock *lp;
+	u_int64_t *w = &region->fastlocks[slot], cur;
+	u_int32_t i;
+	DBT obj;
+	int ret;
+
+	cur = __atomic_load_n(w, __ATOMIC_SEQ_CST);
+	if ((cur & FASTLOCK_FLAGS) != FASTLOCK_EXCL ||
+	    (u_int32_t)cur != n->lockerid)
+		return;
+	__atomic_store_n(w, FASTLOCK_SLOW | FASTLOCK_INFLATING | 1,
+	    __ATOMIC_SEQ_CST);
+
+	memset(&obj, 0, sizeof(obj));
+	for (i = 0; i < n->nlocks; i++) {
+		e = &n->locks[i];
+		if (e->slot != slot || e->off != LOCK_INVALID)
+			continue;
+		obj.data = e->obj;
+		obj.size = e->size;
+		sh_locker = NULL;
+		/* Nothing else is in the table for this slot yet. */
+		if ((ret = __lock_get_internal_int(lt, n->lockerid, &sh_locker,
+		    DB_LOCK_NOWAIT | DB_LOCK_FASTINFLATE, &obj, e->mode, 0,
+		    &lock)) != 0) {
+			logmsg(LOGMSG_FATAL,
+			    "%s: can't move fast lock for locker %u to the "
+			    "lock table, rc %d\n", __func__, n->lockerid, ret);
+			abort();
+		}
+		if (e->refcount > 1) {
+			lp = (struct __db_lock *)R_ADDR(&lt->reginfo, lock.off);
+			lock_obj_partition(region, lock.partition);
+			lp->refcount += e->refcount - 1;
+			unlock_obj_partition(region, lock.partition);
+		}
+		e->off = lock.off;
+		e->offgen = lock.gen;
+		e->ndx = lock.ndx;
+		e->partition = lock.partition;
+	}
+
+	__atomic_and_fetch(w, ~FASTLOCK_INFLATING, __ATOMIC_SEQ_CST);
+	__fastlock_release(lt, slot);
+}
+
+/*
+ * Hold an object's slot for the lock table, inflating whoever owns it.
+ * Returns the slot to release afterwards, or max_fastlock if there's none.
+ */
+static u_int32_t
+__fastlock_hold(DB_LOCKTAB *lt, const DBT *obj)
+{
+	DB_LOCKREGION *region = lt->reginfo.primary;
+	DB_FASTLOCK_NODE *n;
+	u_int64_t *w, cur;
+	u_int32_t slot;
+
+	if (region->fastlocks == NULL || obj == NULL ||
+	    !is_comdb2_rowlock(obj->size))
+		return region->max_fastlock;
+
+	slot = fastlock_slot(region, obj);
+	w = &region->fastlocks[slot];
+	cur = __atomic_load_n(w, __ATOMIC_SEQ_CST);
+	for (;;) {
+		if (cur & FASTLOCK_INFLATING) {
+			__os_yield(lt->dbenv, 1);
+			cur = __atomic_load_n(w, __ATOMIC_SEQ_CST);
+		} else if (cur == 0 || (cur & FASTLOCK_SLOW)) {
+			if (__atomic_compare_exchange_n(w, &cur,
+			    cur == 0 ? FASTLOCK_SLOW | 1 : cur + 1, 0,
+			    __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+				return slot;
+		} else {
+			if ((n = __fastlock_node(lt, (u_int32_t)cur, 0)) !=
+			    NULL) {
+				__fastlock_inflate_slot(lt, n, slot);
+				pthread_mutex_unlock(&n->lock);
+			}
+			cur = __atomic_load_n(w, __ATOMIC_SEQ_CST);
+		}
+	}
+}
+
+/*
+ * Try to grant a rowlock on the fast path.  Returns 0 if granted, and
+ * DB_LOCK_NOTGRANTED if the request has to go through the lock table.
+ */
+static int
+__fastlock_get(DB_LOCKTAB *lt, u_int32_t locker, const DBT *obj,
+    db_lockmode_t lock_mode, DB_LOCK *lock)
+{
+	DB_LOCKREGION *region = lt->reginfo.primary;
+	DB_FASTLOCK_NODE *n;
+	DB_FASTLOCK *e;
+	u_int64_t *w, cur, nw;
+	u_int32_t i, slot;
+
+	slot = fastlock_slot(region, obj);
+	w = &region->fastlocks[slot];
+
+	/* Don't bother with the node if the slot is obviously taken. */
+	cur = __atomic_load_n(w, __ATOMIC_SEQ_CST);
+	if (cur != 0 && ((cur & FASTLOCK_FLAGS) != FASTLOCK_EXCL ||
+	    (u_int32_t)cur != locker))
+		return DB_LOCK_NOTGRANTED;
+
+	if ((n = __fastlock_node(lt, locker, 1)) == NULL)
+		return DB_LOCK_NOTGRANTED;
+
+	/* Rows are usually locked again soon after, if at all. */
+	for (i = n->nlocks; i > 0 && i + 8 > n->nlocks; i--) {
+		e = &n->locks[i - 1];
+		if (e->slot == slot && e->mode == lock_mode &&
+		    e->off == LOCK_INVALID && e->size == obj->size &&
+		    memcmp(e->obj, obj->data, obj->size) == 0) {
+			e->refcount++;
+			goto granted;
+		}
+	}
+
+	if (n->nlocks == n->maxlocks) {
+		u_int32_t max = n->maxlocks ? n->maxlocks * 2 : 64;
+		if (max > FASTLOCK_MAXLOCKS || __os_realloc(lt->dbenv,
+		    max * sizeof(DB_FASTLOCK), &n->locks) != 0) {
+			pthread_mutex_unlock(&n->lock);
+			return DB_LOCK_NOTGRANTED;
+		}
+		n->maxlocks = max;
+	}
+
+	cur = __atomic_load_n(w, __ATOMIC_SEQ_CST);
+	do {
+		if (cur == 0)
+			nw = FASTLOCK_EXCL | FASTLOCK_ONE | locker;
+		else if ((cur & FASTLOCK_FLAGS) == FASTLOCK_EXCL &&
+		    (u_int32_t)cur == locker)
+			nw = cur + FASTLOCK_ONE;
+		else {
+			pthread_mutex_unlock(&n->lock);
+			return DB_LOCK_NOTGRANTED;
+		}
+	} while (!__atomic_compare_exchange_n(w, &cur, nw, 0,
+	    __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+
+	e = &n->locks[n->nlocks++];
+	memcpy(e->obj, obj->data, obj->size);
+	e->size = obj->size;
+	e->slot = slot;
+	e->gen = ++n->gen;
+	e->refcount = 1;
+	e->mode = lock_mode;
+	e->off = LOCK_INVALID;
+
+granted:
+	lock->off = FASTLOCK_OFFSET;
+	lock->ilock_latch = NULL;
+	lock->ndx = slot;
+	lock->gen = e->gen;
+	lock->mode = lock_mode;
+	lock->owner = locker;
+	lock->partition = 0;
+	pthread_mutex_unlock(&n->lock);
+	return 0;
+}
+
+/*
+ * Release a fast lock.  If it was inflated, *lock is turned into the table
+ * lock, which the caller puts instead.
+ */
+static int
+__fastlock_put(DB_LOCKTAB *lt, DB_LOCK *lock, int *inflated)
+{
+	DB_LOCKREGION *region = lt->reginfo.primary;
+	DB_FASTLOCK_NODE *n;
+	DB_FASTLOCK *e;
+
+	*inflated = 0;
+	if (region->fastlocks == NULL ||
+	    (n = __fastlock_node(lt, lock->owner, 0)) == NULL) {
+		__db_err(lt->dbenv, __db_lock_invalid, "DB_LOCK->lock_put");
+		return (EINVAL);
+	}
+	if ((e = __fastlock_find(n, lock->gen)) == NULL) {
+		pthread_mutex_unlock(&n->lock);
+		__db_err(lt->dbenv, __db_lock_invalid, "DB_LOCK->lock_put");
+		return (EINVAL);
+	}
+
+	/*
+	 * An inflated entry only maps its handles to the table lock, which
+	 * holds their references; it goes away with its last handle too.
+	 */
+	if (e->off != LOCK_INVALID) {
+		lock->off = e->off;
+		lock->gen = e->offgen;
+		lock->ndx = e->ndx;
+		lock->partition = e->partition;
+		*inflated = 1;
+	} else
+		LOCK_INIT(*lock);
+	if (--e->refcount == 0) {
+		if (e->off == LOCK_INVALID)
+			__fastlock_unslot(region, e->slot);
+		*e = n->locks[--n->nlocks];
+	}
+	pthread_mutex_unlock(&n->lock);
+	return (0);
+}
+
+/*
+ * Turn a fast lock handle into the table lock behind it.  The handle no
+ * longer refers to its entry, which is dropped with its last handle.
+ */
+static int
+__fastlock_resolve(DB_LOCKTAB *lt, DB_LOCK *lock)
+{
+	DB_LOCKREGION *region = lt->reginfo.primary;
+	DB_FASTLOCK_NODE *n;
+	DB_FASTLOCK *e;
+
+	if (region->fastlocks == NULL ||
+	    (n = __fastlock_node(lt, lock->owner, 0)) == NULL) {
+		__db_err(lt->dbenv, __db_lock_invalid, "fast lock");
+		return (EINVAL);
+	}
+	if ((e = __fastlock_find(n, lock->gen)) == NULL) {
+		pthread_mutex_unlock(&n->lock);
+		__db_err(lt->dbenv, __db_lock_invalid, "fast lock");
+		return (EINVAL);
+	}
+	if (e->off == LOCK_INVALID)
+		__fastlock_inflate_slot(lt, n, e->slot);
+	lock->off = e->off;
+	lock->gen = e->offgen;
+	lock->ndx = e->ndx;
+	lock->partition = e->partition;
+	if (--e->refcount == 0)
+		*e = n->locks[--n->nlocks];
+	pthread_mutex_unlock(&n->lock);
+	return (0);
+}
+
+/* Move all of a locker's fast locks into the lock table. */
+static void
+__fastlock_inflate_locker(DB_LOCKTAB *lt, u_int32_t locker)
+{
+	DB_LOCKREGION *region = lt->reginfo.primary;
+	DB_FASTLOCK_NODE *n;
+	u_int32_t i;
+
+	if (region->fastlocks == NULL ||
+	    (n = __fastlock_node(lt, locker, 0)) == NULL)
+		return;
+	for (i = 0; i < n->nlocks; i++)
+		if (n->locks[i].off == LOCK_INVALID)
+			__fastlock_inflate_slot(lt, n, n->locks[i].slot);
+	pthread_mutex_unlock(&n->lock);
+}
+
+/*
+ * Release all of a locker's fast locks.  The inflated ones are in the lock
+ * table and are released with the rest of the locker's table locks.
+ */
+static void
+__fastlock_put_all(DB_LOCKTAB *lt, u_int32_t locker)
+{
+	DB_LOCKREGION *region = lt->reginfo.primary;
+	DB_FASTLOCK_NODE *n;
+	u_int32_t i;
+
+	if (region->fastlocks == NULL ||
+	    (n = __fastlock_node(lt, locker, 0)) == NULL)
+		return;
+	for (i = 0; i < n->nlocks; i++)
+		if (n->locks[i].off == LOCK_INVALID)
+			__fastlock_unslot(region, n->locks[i].slot);
+	n->nlocks = 0;
+	pthread_mutex_unlock(&n->lock);
+}
+
+/*
+ * Drop a locker's fast lock node when the locker is freed.  Returns the
+ * number of fast locks it still held, which are released.
+ */
+static u_int32_t
+__fastlock_free_locker(DB_LOCKTAB *lt, u_int32_t locker)
+{
+	DB_LOCKREGION *region = lt->reginfo.primary;
+	DB_FASTLOCK_LIST *l;
+	DB_FASTLOCK_NODE *n;
+	u_int32_t i, held;
+
+	if (region->fastlocks == NULL)
+		return 0;
+
+	held = 0;
+	l = &region->fastlock_lockers[locker % region->max_fastlock_lockerid];
+	pthread_mutex_lock(&l->lock);
+	for (n = l->head; n != NULL && n->lockerid != locker; n = n->next)
+		;
+	if (n == NULL) {
+		pthread_mutex_unlock(&l->lock);
+		return 0;
+	}
+	pthread_mutex_lock(&n->lock);
+	for (i = 0; i < n->nlocks; i++) {
+		if (n->locks[i].off == LOCK_INVALID) {
+			__fastlock_unslot(region, n->locks[i].slot);
+			held++;
+		}
+	}
+	n->nlocks = 0;
+	n->lockerid = DB_LOCK_INVALIDID;
+	if (n->next)
+		n->next->prev = n->prev;
+	if (n->prev)
+		n->prev->next = n->next;
+	if (n == l->head)
+		l->head = n->next;
+	pthread_mutex_unlock(&n->lock);
+	pthread_mutex_unlock(&l->lock);
+
+	pthread_mutex_lock(&region->fastlock_node_lk);
+	n->prev = NULL;
+	n->next = region->fastlock_node_head;
+	region->fastlock_node_head = n;
+	pthread_mutex_unlock(&region->fastlock_node_lk);
+	return held;
+}
+
+/* Number of a locker's fast locks that aren't also in the lock table. */
+static u_int32_t
+__fastlock_count(DB_LOCKTAB *lt, u_int32_t locker)
+{
+	DB_LOCKREGION *region = lt->reginfo.primary;
+	DB_FASTLOCK_NODE *n;
+	u_int32_t i, count;
+
+	if (region->fastlocks == NULL ||
+	    (n = __fastlock_node(lt, locker, 0)) == NULL)
+		return 0;
+	for (i = count = 0; i < n->nlocks; i++)
+		if (n->locks[i].off == LOCK_INVALID)
+			count++;
+	pthread_mutex_unlock(&n->lock);
+	return count;
+}
+
+/* Copy a fast lock's object into a dbt, as __lock_to_dbt does. */
+static int
+__fastlock_to_dbt(DB_LOCKTAB *lt, DB_LOCK *lock, DBT *dbt)
+{
+	DB_LOCKREGION *region = lt->reginfo.primary;
+	DB_FASTLOCK_NODE *n;
+	DB_FASTLOCK *e;
+	int rc = 0;
+
+	if (region->fastlocks == NULL ||
+	    (n = __fastlock_node(lt, lock->owner, 0)) == NULL) {
+		__db_err(lt->dbenv, __db_lock_invalid, "DB_LOCK->lock_put");
+		return (EINVAL);
+	}
+	if ((e = __fastlock_find(n, lock->gen)) == NULL) {
+		__db_err(lt->dbenv, __db_lock_invalid, "DB_LOCK->lock_put");
+		rc = EINVAL;
+		goto done;
+	}
+	dbt->size = e->size;
+	if (dbt->flags & DB_DBT_MALLOC) {
+		if ((rc = __os_malloc(lt->dbenv, e->size, &dbt->data)) != 0)
+			goto done;
+		memcpy(dbt->data, e->obj, e->size);
+	} else if (dbt->ulen >= e->size) {
+		memcpy(dbt->data, e->obj, e->size);
+	} else {
+		rc = ENOMEM;
+	}
+done:
+	pthread_mutex_unlock(&n->lock);
+	return rc;
+}
+
 static inline int
 __lock_get_internal(lt, locker, sh_locker, flags, obj, lock_mode, timeout, lock)
 	DB_LOCKTAB *lt;
@@ -2908,8 +3535,14 @@ __lock_get_internal(lt, locker, sh_locker, flags, obj, lock_mode, timeout, lock)
 	db_timeout_t timeout;
 	DB_LOCK *lock;
 {
+	DB_LOCKREGION *region = lt->reginfo.primary;
+	u_int32_t slot;
 	int rc, use_latch = 0;
 
+	if ((obj == NULL || LF_ISSET(DB_LOCK_UPGRADE | DB_LOCK_SWITCH)) &&
+	    LOCK_ISFAST(*lock) && (rc = __fastlock_resolve(lt, lock)) != 0)
+		return rc;
+
 	if (use_page_latches(lt->dbenv)) {
 		if (obj) {
 			if (obj->size == sizeof(DB_LOCK_ILOCK)) {
@@ -2926,9 +3559,19 @@ __lock_get_internal(lt, locker, sh_locker, flags, obj, lock_mode, timeout, lock)
 
 	if (use_latch) {
 		rc = __get_page_latch(lt, locker, flags, obj, lock_mode, lock);
+	} else if (region->fastlocks != NULL && lt->dbenv->attr.lock_fastpath &&
+	    obj != NULL && is_comdb2_rowlock(obj->size) &&
+	    (lock_mode == DB_LOCK_READ || lock_mode == DB_LOCK_WRITE) &&
+	    (flags & ~DB_LOCK_NOWAIT) == 0 && sh_locker == NULL &&
+	    !gbl_ddlk && !IS_REP_CLIENT(lt->dbenv) &&
+	    !F_ISSET(lt->dbenv, DB_ENV_NOLOCKING) &&
+	    __fastlock_get(lt, locker, obj, lock_mode, lock) == 0) {
+		return 0;
 	} else {
+		slot = __fastlock_hold(lt, obj);
 		rc = __lock_get_internal_int(lt, locker, &sh_locker, flags, obj,
 		    lock_mode, timeout, lock);
+		__fastlock_release(lt, slot);
 	}
 
 	if (sh_locker && F_ISSET(sh_locker, DB_LOCKER_TRACK)) {
@@ -3003,7 +3646,7 @@ __lock_put(dbenv, lock)
 	 * a call to lock_detect here will 0 the need_dd bit, but will not
 	 * actually abort anything.
 	 */
-	if (ret == 0 && run_dd)
+	if (ret == 0 && run_dd && !dbenv->attr.deadlock_incremental)
 		(void)__lock_detect(dbenv,
 		    ((DB_LOCKREGION *)lt->reginfo.primary)->detect, NULL);
 
@@ -3037,6 +3680,13 @@ __lock_put_nolock(dbenv, lock, runp, flags)
 	lt = dbenv->lk_handle;
 	region = lt->reginfo.primary;
 
+	if (LOCK_ISFAST(*lock)) {
+		int inflated;
+		if ((ret = __fastlock_put(lt, lock, &inflated)) != 0 ||
+		    !inflated)
+			return ret;
+	}
+
 	lockp = (struct __db_lock *)R_ADDR(&lt->reginfo, lock->off);
 	sh_locker = lockp->holderp;
 
@@ -3104,6 +3754,9 @@ __lock_downgrade(dbenv, lock, new_mode, flags)
 
 	lt = dbenv->lk_handle;
 	region = lt->reginfo.primary;
+
+	if (LOCK_ISFAST(*lock) && (ret = __fastlock_resolve(lt, lock)) != 0)
+		return (ret);
 	partition = lock->partition;
 
 	LOCKREGION(dbenv, lt);
@@ -3264,6 +3917,13 @@ __lock_put_internal(lt, lockp, lock, obj_ndx, need_dd, flags)
 	    SH_TAILQ_FIRST(&sh_obj->waiters, __db_lock) == NULL) {
 		HASHREMOVE_EL(region->obj_tab[partition],
 		    obj_ndx, __db_lockobj, links, sh_obj);
+		if (region->fastlocks != NULL &&
+		    is_comdb2_rowlock(sh_obj->lockobj.size)) {
+			DBT objdbt = { 0 };
+			objdbt.data = sh_obj->lockobj.data;
+			objdbt.size = sh_obj->lockobj.size;
+			__fastlock_release(lt, fastlock_slot(region, &objdbt));
+		}
 		if (sh_obj->lockobj.size > sizeof(sh_obj->objdata)) {
 			__os_free(dbenv, sh_obj->lockobj.data);
 		}
@@ -3592,13 +4252,16 @@ __lock_freefamilylocker(lt, locker)
 	DB_ENV *dbenv;
 	DB_LOCKER *sh_locker;
 	DB_LOCKREGION *region;
-	u_int32_t indx, partition;
+	u_int32_t indx, partition, nfast;
 	int ret;
 
 	dbenv = lt->dbenv;
 	region = lt->reginfo.primary;
 
 	__free_latch_lockerid(lt->dbenv, locker);
+	if ((nfast = __fastlock_free_locker(lt, locker)) != 0)
+		logmsg(LOGMSG_ERROR, "locker %x, freed with %u fast locks\n",
+		    (int)locker, nfast);
 
 	lock_lockers(region);
 	LOCKREGION(dbenv, lt);
@@ -3883,6 +4546,8 @@ __lock_getlocker_int(lt, locker, indx, partition, create, retries, retp,
 		    sh_locker, links, __db_locker);
 		sh_locker->id = locker;
 		sh_locker->dd_id = 0;
+		sh_locker->dd_waitlock = NULL;
+		sh_locker->dd_unpublished = 0;
 		sh_locker->master_locker = INVALID_ROFF;
 		sh_locker->parent_locker = INVALID_ROFF;
 		SH_LIST_INIT(&sh_locker->child_locker);
@@ -4092,6 +4757,11 @@ __lock_getobj(lt, obj, ndx, partition, create, retp)
 
 		HASHINSERT(region->obj_tab[partition], ndx, __db_lockobj, links,
 		    sh_obj);
+
+		/* Counts against its fast path slot, which the caller holds. */
+		if (region->fastlocks != NULL && is_comdb2_rowlock(obj->size))
+			__atomic_add_fetch(&region->fastlocks[
+			    fastlock_slot(region, obj)], 1, __ATOMIC_SEQ_CST);
 	}
 
 	*retp = sh_obj;
@@ -4580,6 +5250,9 @@ __lock_trade(dbenv, lock, new_locker, create)
 		return __latch_trade(dbenv, lnode->latch, new_locker);
 	}
 
+	if (LOCK_ISFAST(*lock) && (ret = __fastlock_resolve(lt, lock)) != 0)
+		return (ret);
+
 
 	/* Make sure that we can get new locker and add this lock to it. */
 	LOCKER_INDX(lt, region, new_locker, locker_ndx);
@@ -6017,6 +6690,8 @@ __lock_to_dbt(dbenv, lock, dbt)
 {
 	int rc;
 	DB_LOCKTAB *lt = dbenv->lk_handle;
+	if (LOCK_ISFAST(*lock))
+		return __fastlock_to_dbt(lt, lock, dbt);
 	LOCKREGION(dbenv, lt);
 	rc = __lock_to_dbt_unlocked(dbenv, lock, dbt);
 	UNLOCKREGION(dbenv, lt);
@@ -6162,7 +6837,7 @@ __nlocks_for_locker(DB_ENV *dbenv, u_int32_t id)
 	LOCKER_INDX(lt, region, id, locker_ndx);
 	if ((ret = __lock_getlocker(lt, id, locker_ndx, 0, 0, &sh_locker)) != 0)
 		goto err;
-	nlocks = sh_locker->nlocks;
+	nlocks = (sh_locker ? sh_locker->nlocks : 0) + __fastlock_count(lt, id);
 	UNLOCKREGION(dbenv, lt);
 	return nlocks;
 err:
@@ -19,6 +19,7 @@ static const char revid[] = "$Id: lock_deadlock.c,v 11.66 2003/11/19 19:59:02 ub
 #include <pthread.h>
 
 #include <string.h>
+#include <time.h>
 #include <assert.h>
 #endif
 
@@ -92,6 +93,7 @@ static int __dd_build __P((DB_ENV *,
 static int __dd_find __P((DB_ENV *, u_int32_t *, sparse_map_t *, locker_info *,
 	u_int32_t, u_int32_t, u_int32_t ***, u_int32_t **, int *));
 static int __dd_isolder __P((u_int32_t, u_int32_t, u_int32_t, u_int32_t));
+static u_int64_t __dd_usecs __P((clockid_t));
 static int __dd_verify __P((locker_info *, u_int32_t *, u_int32_t *,
 	u_int32_t *, sparse_map_t *, u_int32_t, u_int32_t, u_int32_t));
 
@@ -463,6 +465,7 @@ uint64_t detect_run = 0;
 #if LOCK_DETECT_Q
 static int __lock_detect_int(DB_ENV *, u_int32_t atype, int *abortp,
     int *retry);
+static int __lock_detect_run(DB_ENV *, u_int32_t atype, int *abortp);
 static pthread_mutex_t dlock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t qlock = PTHREAD_MUTEX_INITIALIZER;
 static int q = 0;
@@ -481,7 +484,6 @@ __lock_detect(dbenv, atype, abortp)
 	int *abortp;
 {
 #if LOCK_DETECT_Q
-	int ret;
 	int skip;
 
 	/* Run detector if one is not waiting to be run already */
@@ -496,15 +498,40 @@ __lock_detect(dbenv, atype, abortp)
 	pthread_mutex_unlock(&qlock);
 	if (skip) return 0;
 
+	return (__lock_detect_run(dbenv, atype, abortp));
+}
+
+/*
+ * __lock_detect_run --
+ *	Run the detector, waiting for any run in progress to finish first.
+ */
+static int
+__lock_detect_run(dbenv, atype, abortp)
+	DB_ENV *dbenv;
+	u_int32_t atype;
+	int *abortp;
+{
+	DB_LOCKREGION *region;
+	u_int64_t start, cpu;
+	int ret;
+
+	region = ((DB_LOCKTAB *)dbenv->lk_handle)->reginfo.primary;
 	pthread_mutex_lock(&dlock);
 	{
 		pthread_mutex_lock(&qlock);
 		q = 0;
 		pthread_mutex_unlock(&qlock);
+		start = __dd_usecs(CLOCK_MONOTONIC);
+		cpu = __dd_usecs(CLOCK_THREAD_CPUTIME_ID);
 		int retry = 0;
 		ret = __lock_detect_int(dbenv, atype, abortp, &retry);
 		if (retry)
 			ret = __lock_detect_int(dbenv, atype, abortp, NULL);
+		region->stat.st_ndetects++;
+		region->stat.st_detect_usecs +=
+		    __dd_usecs(CLOCK_MONOTONIC) - start;
+		region->stat.st_detect_cpu_usecs +=
+		    __dd_usecs(CLOCK_THREAD_CPUTIME_ID) - cpu;
 	}
 	pthread_mutex_unlock(&dlock);
 	return ret;
@@ -2447,3 +2474,289 @@ berkdb_register_deadlock_callback(void (*callback) (struct berkdb_deadlock_info
 {
 	berkdb_deadlock_callback = callback;
 }
+
+/*
+ * __dd_usecs --
+ *	Microseconds on the given clock.
+ */
+static u_int64_t
+__dd_usecs(clk)
+	clockid_t clk;
+{
+	struct timespec ts;
+
+	clock_gettime(clk, &ts);
+	return ((u_int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+/*
+ * Lockers found by an incremental search: a queue in the order they were
+ * found, and an open-addressed set of the same pointers.  Both start out
+ * on the stack and move to the heap if a search gets that far.
+ */
+#define	DD_WFG_INLINE	32
+
+typedef struct {
+	DB_LOCKER **queue;
+	DB_LOCKER **slots;
+	u_int32_t n;
+	u_int32_t nslots;
+	DB_LOCKER *inl_queue[DD_WFG_INLINE];
+	DB_LOCKER *inl_slots[2 * DD_WFG_INLINE];
+} dd_wfg_set;
+
+#define	DD_WFG_HASH(p, n)						\
+	((u_int32_t)(((uintptr_t)(p) >> 4) * 2654435761U) & ((n) - 1))
+
+static void
+__dd_wfg_insert(set, lockerp)
+	dd_wfg_set *set;
+	DB_LOCKER *lockerp;
+{
+	u_int32_t h;
+
+	for (h = DD_WFG_HASH(lockerp, set->nslots); set->slots[h] != NULL;
+	    h = (h + 1) & (set->nslots - 1))
+		;
+	set->slots[h] = lockerp;
+}
+
+/*
+ * __dd_wfg_add --
+ *	Add a locker to the set unless it's already there; *addedp says which.
+ */
+static int
+__dd_wfg_add(dbenv, set, lockerp, addedp)
+	DB_ENV *dbenv;
+	dd_wfg_set *set;
+	DB_LOCKER *lockerp;
+	int *addedp;
+{
+	DB_LOCKER **queue, **slots;
+	u_int32_t h, i, nslots;
+	int ret;
+
+	*addedp = 0;
+	for (h = DD_WFG_HASH(lockerp, set->nslots); set->slots[h] != NULL;
+	    h = (h + 1) & (set->nslots - 1))
+		if (set->slots[h] == lockerp)
+			return (0);
+
+	/* Keep the set at most half full. */
+	if (set->n == set->nslots / 2) {
+		nslots = set->nslots * 2;
+		if ((ret = __os_malloc(dbenv,
+		    sizeof(DB_LOCKER *) * nslots / 2, &queue)) != 0)
+			return (ret);
+		if ((ret = __os_calloc(dbenv,
+		    nslots, sizeof(DB_LOCKER *), &slots)) != 0) {
+			__os_free(dbenv, queue);
+			return (ret);
+		}
+		memcpy(queue, set->queue, sizeof(DB_LOCKER *) * set->n);
+		if (set->queue != set->inl_queue) {
+			__os_free(dbenv, set->queue);
+			__os_free(dbenv, set->slots);
+		}
+		set->queue = queue;
+		set->slots = slots;
+		set->nslots = nslots;
+		for (i = 0; i < set->n; i++)
+			__dd_wfg_insert(set, set->queue[i]);
+	}
+	__dd_wfg_insert(set, lockerp);
+	set->queue[set->n++] = lockerp;
+	*addedp = 1;
+	return (0);
+}
+
+/*
+ * __dd_wfg_search --
+ *	Follow the waits-for edges out of a waiting master locker, looking
+ * for a path back to it.  Sets *cyclep if there is one, and *fallbackp if
+ * there might be but the search got too big or reached a master with
+ * waiting children it can't follow.
+ */
+static int
+__dd_wfg_search(dbenv, master, cyclep, fallbackp, visitsp)
+	DB_ENV *dbenv;
+	DB_LOCKER *master;
+	int *cyclep, *fallbackp;
+	u_int32_t *visitsp;
+{
+	DB_LOCKER *first, *holder, *lockerp;
+	DB_LOCKOBJ *obj;
+	DB_LOCKREGION *region;
+	DB_LOCKTAB *lt;
+	dd_wfg_set set;
+	struct __db_lock *lp, *waitlp;
+	u_int32_t gen, i, partition;
+	int added, ret;
+
+	lt = dbenv->lk_handle;
+	region = lt->reginfo.primary;
+	*cyclep = *fallbackp = 0;
+
+	memset(set.inl_slots, 0, sizeof(set.inl_slots));
+	set.queue = set.inl_queue;
+	set.slots = set.inl_slots;
+	set.nslots = 2 * DD_WFG_INLINE;
+	set.n = 0;
+
+	i = 0;
+	if ((ret = __dd_wfg_add(dbenv, &set, master, &added)) != 0)
+		goto err;
+
+	for (; i < set.n && !*cyclep && !*fallbackp; i++) {
+		lockerp = set.queue[i];
+		/* Some of its edges aren't published; only a full run sees them. */
+		if (__atomic_load_n(&lockerp->dd_unpublished,
+		    __ATOMIC_SEQ_CST) != 0) {
+			*fallbackp = 1;
+			break;
+		}
+		if ((waitlp = __atomic_load_n(&lockerp->dd_waitlock,
+		    __ATOMIC_SEQ_CST)) == NULL)
+			continue;
+		gen = __atomic_load_n(&lockerp->dd_waitgen, __ATOMIC_SEQ_CST);
+
+		/*
+		 * Lock structures stay in their partition, so this is the
+		 * partition of whatever object the lock is on now.  The
+		 * locker may have stopped waiting since we read it.
+		 */
+		partition = waitlp->lpartition;
+		lock_obj_partition(region, partition);
+		if (waitlp->gen != gen || waitlp->status != DB_LSTAT_WAITING ||
+		    __atomic_load_n(&lockerp->dd_waitlock,
+		    __ATOMIC_SEQ_CST) != waitlp) {
+			unlock_obj_partition(region, partition);
+			continue;
+		}
+		obj = waitlp->lockobj;
+
+		/*
+		 * A locker waiting on something it already holds is only
+		 * stuck if it's queued behind someone else, as in __dd_build.
+		 */
+		lp = SH_TAILQ_FIRST(&obj->waiters, __db_lock);
+		first = lp == NULL ? NULL : lp->holderp;
+		if (first != NULL && first->master_locker != INVALID_ROFF)
+			first = (DB_LOCKER *)R_ADDR(&lt->reginfo,
+			    first->master_locker);
+
+		for (lp = SH_TAILQ_FIRST(&obj->holders, __db_lock);
+		    lp != NULL; lp = SH_TAILQ_NEXT(lp, links, __db_lock)) {
+			/* Aborted and promoted holders aren't in the way. */
+			if (lp->status != DB_LSTAT_HELD)
+				continue;
+			holder = lp->holderp;
+			if (holder->master_locker != INVALID_ROFF)
+				holder = (DB_LOCKER *)R_ADDR(&lt->reginfo,
+				    holder->master_locker);
+			if (holder == lockerp) {
+				if (first == lockerp)
+					continue;
+				*cyclep = 1;
+				break;
+			}
+			if (holder == master) {
+				*cyclep = 1;
+				break;
+			}
+			if ((ret = __dd_wfg_add(dbenv,
+			    &set, holder, &added)) != 0) {
+				unlock_obj_partition(region, partition);
+				goto err;
+			}
+			if (added && set.n >
+			    (u_int32_t)dbenv->attr.deadlock_incremental_max) {
+				*fallbackp = 1;
+				break;
+			}
+		}
+		unlock_obj_partition(region, partition);
+	}
+
+err:	if (set.queue != set.inl_queue) {
+		__os_free(dbenv, set.queue);
+		__os_free(dbenv, set.slots);
+	}
+	*visitsp = i;
+	return (ret);
+}
+
+/*
+ * __lock_detect_incremental --
+ *	Look for a deadlock involving a master locker that is about to wait,
+ * following only the waits-for edges reachable from it instead of building
+ * the whole matrix.  The edges are kept by the lock table as it goes: a
+ * waiting master's dd_waitlock is its lock on the waiters list, and the
+ * holders of that lock's object are the lockers it waits for.  Releasing a
+ * lock only removes edges, so every cycle is closed by some locker starting
+ * to wait, and searching from each one as it does finds them all.
+ *
+ *	When a cycle turns up the full detector is run to break it, so the
+ * victim is still chosen by policy; it may pick one from another cycle, so
+ * we search again until ours is gone.  A search that visits more than
+ * deadlock_incremental_max lockers hands over to the full detector too, as
+ * does one reaching a master whose children wait on more than one object:
+ * a master publishes only one edge.
+ *
+ * PUBLIC: int __lock_detect_incremental
+ * PUBLIC:     __P((DB_ENV *, u_int32_t, DB_LOCKER *, int *));
+ */
+int
+__lock_detect_incremental(dbenv, atype, master, abortp)
+	DB_ENV *dbenv;
+	u_int32_t atype;
+	DB_LOCKER *master;
+	int *abortp;
+{
+	DB_LOCKREGION *region;
+	u_int64_t start, cpu, full, fullcpu;
+	u_int32_t visits;
+	int cycle, fallback, naborted, ret;
+
+	region = ((DB_LOCKTAB *)dbenv->lk_handle)->reginfo.primary;
+	if (abortp != NULL)
+		*abortp = 0;
+
+	start = __dd_usecs(CLOCK_MONOTONIC);
+	cpu = __dd_usecs(CLOCK_THREAD_CPUTIME_ID);
+	full = fullcpu = 0;
+
+	__atomic_add_fetch(&region->stat.st_nwfg_detects, 1, __ATOMIC_RELAXED);
+	for (;;) {
+		ret = __dd_wfg_search(dbenv, master, &cycle, &fallback, &visits);
+		__atomic_add_fetch(&region->stat.st_wfg_visits, visits,
+		    __ATOMIC_RELAXED);
+		if (ret == 0 && !cycle && !fallback)
+			break;
+		if (cycle)
+			__atomic_add_fetch(&region->stat.st_nwfg_cycles, 1,
+			    __ATOMIC_RELAXED);
+		else
+			__atomic_add_fetch(&region->stat.st_nwfg_fallbacks, 1,
+			    __ATOMIC_RELAXED);
+
+		/* The full detector's time is counted as its own. */
+		full -= __dd_usecs(CLOCK_MONOTONIC);
+		fullcpu -= __dd_usecs(CLOCK_THREAD_CPUTIME_ID);
+		naborted = 0;
+		ret = __lock_detect_run(dbenv, atype, &naborted);
+		full += __dd_usecs(CLOCK_MONOTONIC);
+		fullcpu += __dd_usecs(CLOCK_THREAD_CPUTIME_ID);
+		if (abortp != NULL)
+			*abortp += naborted;
+		if (ret != 0 || !cycle || naborted == 0)
+			break;
+	}
+
+	__atomic_add_fetch(&region->stat.st_wfg_usecs,
+	    __dd_usecs(CLOCK_MONOTONIC) - start - full, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&region->stat.st_wfg_cpu_usecs,
+	    __dd_usecs(CLOCK_THREAD_CPUTIME_ID) - cpu - fullcpu,
+	    __ATOMIC_RELAXED);
+	return (ret);
+}
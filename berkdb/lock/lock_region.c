@@ -182,6 +182,7 @@ add_to_lock_partition(DB_ENV *dbenv, DB_LOCKTAB *lt,
 }
 
 int init_latches(DB_ENV *, DB_LOCKTAB *);
+int init_fastlocks(DB_ENV *, DB_LOCKTAB *);
 
 /*
  * __lock_init --
@@ -414,6 +415,7 @@ mem_err:		__db_err(dbenv,
 	region->db_lock_lsn_step = dbenv->attr.db_lock_lsn_step;
 
 	init_latches(dbenv, lt);
+	init_fastlocks(dbenv, lt);
 
 	return (0);
 }
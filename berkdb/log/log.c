@@ -953,6 +953,8 @@ __log_stat(dbenv, statp, flags)
 
 	R_UNLOCK(dbenv, &dblp->reginfo);
 
+	__log_group_commit_stat(stats, LF_ISSET(DB_STAT_CLEAR) ? 1 : 0);
+
 	*statp = stats;
 	return (0);
 }
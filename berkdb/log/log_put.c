@@ -44,6 +44,7 @@ static const char revid[] = "$Id: log_put.c,v 11.145 2003/09/13 19:20:39 bostic
 #include <netinet/in.h>
 
 #include "logmsg.h"
+#include <bbhrtime.h>
 
 extern unsigned long long get_commit_context(const void *, uint32_t generation);
 extern int bdb_update_startlwm_berk(void *statearg, unsigned long long ltranid,
@@ -56,6 +57,8 @@ static int __log_fill __P((DB_LOG *, DB_LSN *, void *, u_int32_t));
 static int __log_fill_segments __P((DB_LOG *, DB_LSN *, DB_LSN *, void *,
 	u_int32_t));
 static int __log_flush_commit __P((DB_ENV *, const DB_LSN *, u_int32_t));
+static int __log_group_commit_start __P((DB_LOG *));
+static int __log_group_commit_wait __P((DB_LOG *, const DB_LSN *));
 static int __log_newfh __P((DB_LOG *));
 static int __log_put_next __P((DB_ENV *,
 	DB_LSN *, u_int64_t *, DBT *, const DBT *, HDR *, DB_LSN *, int,
@@ -71,6 +74,29 @@ static pthread_t log_write_td = 0;
 static int log_write_td_should_stop = 0;
 static DB_LOG *log_write_dblp = NULL;
 
+/*
+ * Group commit.  With the log_group_commit attribute set, committers post
+ * their commit LSN and sleep; a single flusher thread writes and syncs
+ * everything in the log buffer and wakes every committer covered by the
+ * sync.  log_flush_done is the last record known to be on disk.
+ */
+#define	LOG_COMMIT_LAT_BUCKETS	32
+static pthread_mutex_t log_flush_lk = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t log_flush_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t log_flush_done_cond = PTHREAD_COND_INITIALIZER;
+static pthread_once_t log_flush_once = PTHREAD_ONCE_INIT;
+static pthread_t log_flush_td;
+static int log_flush_td_running = 0;
+static DB_LOG *log_flush_dblp = NULL;
+static DB_LSN log_flush_want;
+static DB_LSN log_flush_done;
+static int log_flush_err = 0;
+static u_int32_t log_flush_waiters = 0;
+static u_int32_t log_group_commits = 0;
+static u_int32_t log_group_flushes = 0;
+static u_int32_t log_commit_lat_max = 0;
+static u_int32_t log_commit_lat[LOG_COMMIT_LAT_BUCKETS];
+
 int __db_debug_log(DB_ENV *, DB_TXN *, DB_LSN *, u_int32_t, const DBT *,
     int32_t, const DBT *, const DBT *, u_int32_t);
 
@@ -886,9 +912,13 @@ __log_flush_commit(dbenv, lsnp, flags)
 	 * DB_LOG_WRNOSYNC:
 	 *	If there's anything in the current log buffer, write it out.
 	 */
-	if (LF_ISSET(DB_FLUSH))
-		ret = __log_flush_int(dblp, &flush_lsn, 1);
-	else if (!__inmemory_buf_empty(lp)) {
+	if (LF_ISSET(DB_FLUSH)) {
+		if (dbenv->attr.log_group_commit &&
+		    __log_group_commit_start(dblp) == 0)
+			ret = __log_group_commit_wait(dblp, &flush_lsn);
+		else
+			ret = __log_flush_int(dblp, &flush_lsn, 1);
+	} else if (!__inmemory_buf_empty(lp)) {
 		if ((ret = __write_inmemory_buffer(dblp, 1)) == 0)
 			lp->b_off = 0;
 	}
@@ -922,6 +952,209 @@ __log_flush_commit(dbenv, lsnp, flags)
 	return (ret);
 }
 
+/* Wake up and sync the log for every committer waiting on the flusher. */
+static void *
+__log_flush_td(arg)
+	void *arg;
+{
+	DB_ENV *dbenv;
+	DB_LOG *dblp;
+	DB_LSN flush_lsn;
+	LOG *lp;
+	int ret;
+
+	dblp = (DB_LOG *)arg;
+	dbenv = dblp->dbenv;
+	lp = dblp->reginfo.primary;
+	ret = 0;
+
+	pthread_mutex_lock(&log_flush_lk);
+	for (;;) {
+		/* Block until some committer is past the synced point. */
+		while (log_compare(&log_flush_want, &log_flush_done) <= 0)
+			pthread_cond_wait(&log_flush_cond, &log_flush_lk);
+		pthread_mutex_unlock(&log_flush_lk);
+
+		/*
+		 * Everything in the buffer goes out in one write and one
+		 * sync, including commits that arrived after we were woken.
+		 * Committers arriving while we sync wait for the next pass
+		 * and are batched together there.
+		 */
+		R_LOCK(dbenv, &dblp->reginfo);
+		flush_lsn.file = lp->lsn.file;
+		flush_lsn.offset = lp->lsn.offset - lp->len;
+		ret = __log_flush_int(dblp, &flush_lsn, 1);
+		R_UNLOCK(dbenv, &dblp->reginfo);
+
+		pthread_mutex_lock(&log_flush_lk);
+		if (ret == 0) {
+			if (log_compare(&flush_lsn, &log_flush_done) > 0)
+				log_flush_done = flush_lsn;
+		} else
+			log_flush_err = ret;
+		++log_group_flushes;
+		pthread_cond_broadcast(&log_flush_done_cond);
+		if (ret != 0) {
+			/*
+			 * Committers see the error and fall back to flushing
+			 * for themselves; stop so we don't spin on it.
+			 */
+			log_flush_td_running = 0;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&log_flush_lk);
+
+	__db_err(dbenv, "log flusher thread exiting: %s", db_strerror(ret));
+	return (NULL);
+}
+
+static void
+__log_flush_td_init(void)
+{
+	int ret;
+
+	ZERO_LSN(log_flush_want);
+	ZERO_LSN(log_flush_done);
+	if ((ret = pthread_create(&log_flush_td, NULL, __log_flush_td,
+	    log_flush_dblp)) != 0) {
+		__db_err(log_flush_dblp->dbenv,
+		    "DB_ENV->log_flush: error creating flusher thread %d", ret);
+		return;
+	}
+	pthread_detach(log_flush_td);
+	log_flush_td_running = 1;
+}
+
+/*
+ * __log_group_commit_start --
+ *	Start the flusher thread on first use.  Returns non-zero if it isn't
+ * available, in which case the committer flushes for itself.
+ */
+static int
+__log_group_commit_start(dblp)
+	DB_LOG *dblp;
+{
+	log_flush_dblp = dblp;
+	pthread_once(&log_flush_once, __log_flush_td_init);
+	return (log_flush_td_running ? 0 : 1);
+}
+
+/*
+ * __log_group_commit_wait --
+ *	Hand a commit LSN to the flusher thread and sleep until it is on
+ * disk.  Called, and returns, with the region locked.
+ */
+static int
+__log_group_commit_wait(dblp, lsnp)
+	DB_LOG *dblp;
+	const DB_LSN *lsnp;
+{
+	DB_ENV *dbenv;
+	LOG *lp;
+	bbhrtime_t start, end;
+	u_int32_t us;
+	int bucket, ret;
+
+	dbenv = dblp->dbenv;
+	lp = dblp->reginfo.primary;
+
+	/* Already synced by someone else. */
+	if (log_compare(&lp->s_lsn, lsnp) > 0)
+		return (0);
+
+	R_UNLOCK(dbenv, &dblp->reginfo);
+	getbbhrtime(&start);
+
+	ret = 0;
+	pthread_mutex_lock(&log_flush_lk);
+	if (log_compare(&log_flush_want, lsnp) < 0)
+		log_flush_want = *lsnp;
+	++log_flush_waiters;
+	pthread_cond_signal(&log_flush_cond);
+	while (log_compare(&log_flush_done, lsnp) < 0) {
+		if (!log_flush_td_running) {
+			ret = log_flush_err;
+			break;
+		}
+		pthread_cond_wait(&log_flush_done_cond, &log_flush_lk);
+	}
+	--log_flush_waiters;
+
+	getbbhrtime(&end);
+	us = (u_int32_t)((bbhrtimens(&end) - bbhrtimens(&start)) / 1000);
+	for (bucket = 0; bucket < LOG_COMMIT_LAT_BUCKETS - 1 &&
+	    (us >> bucket) > 1; ++bucket)
+		;
+	++log_commit_lat[bucket];
+	if (us > log_commit_lat_max)
+		log_commit_lat_max = us;
+	++log_group_commits;
+	pthread_mutex_unlock(&log_flush_lk);
+
+	R_LOCK(dbenv, &dblp->reginfo);
+
+	/* The flusher died under us: sync this commit ourselves. */
+	if (ret != 0 && log_compare(&lp->s_lsn, lsnp) <= 0)
+		ret = __log_flush_int(dblp, lsnp, 1);
+	return (ret);
+}
+
+/* Upper bound, in usecs, of the latency bucket holding percentile pct. */
+static u_int32_t
+__log_commit_lat_pct(total, pct)
+	u_int64_t total;
+	u_int32_t pct;
+{
+	u_int64_t seen, want;
+	int i;
+
+	if (total == 0)
+		return (0);
+	want = (total * pct + 999) / 1000;
+	for (seen = 0, i = 0; i < LOG_COMMIT_LAT_BUCKETS; ++i) {
+		seen += log_commit_lat[i];
+		if (seen >= want)
+			return (i == LOG_COMMIT_LAT_BUCKETS - 1 ?
+			    log_commit_lat_max : (u_int32_t)2 << i);
+	}
+	return (log_commit_lat_max);
+}
+
+/*
+ * __log_group_commit_stat --
+ *	Fill in the group-commit counters and commit latency percentiles.
+ *
+ * PUBLIC: void __log_group_commit_stat __P((DB_LOG_STAT *, int));
+ */
+void
+__log_group_commit_stat(sp, clear)
+	DB_LOG_STAT *sp;
+	int clear;
+{
+	u_int64_t total;
+	int i;
+
+	pthread_mutex_lock(&log_flush_lk);
+	for (total = 0, i = 0; i < LOG_COMMIT_LAT_BUCKETS; ++i)
+		total += log_commit_lat[i];
+	sp->st_group_commits = log_group_commits;
+	sp->st_group_flushes = log_group_flushes;
+	sp->st_group_waiters = log_flush_waiters;
+	sp->st_commit_lat_p50 = __log_commit_lat_pct(total, 500);
+	sp->st_commit_lat_p90 = __log_commit_lat_pct(total, 900);
+	sp->st_commit_lat_p99 = __log_commit_lat_pct(total, 990);
+	sp->st_commit_lat_p999 = __log_commit_lat_pct(total, 999);
+	sp->st_commit_lat_max = log_commit_lat_max;
+	if (clear) {
+		memset(log_commit_lat, 0, sizeof(log_commit_lat));
+		log_commit_lat_max = 0;
+		log_group_commits = log_group_flushes = 0;
+	}
+	pthread_mutex_unlock(&log_flush_lk);
+}
+
 extern int wait_for_running_transactions(DB_ENV *);
 
 /*
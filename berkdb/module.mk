@@ -53,9 +53,9 @@ berkdb/log/log_compare.c berkdb/log/log_get.c berkdb/log/log_method.c	\
 berkdb/log/log_put.c
 MP_SOURCES:=berkdb/mp/mp_alloc.c berkdb/mp/mp_bh.c		\
 berkdb/mp/mp_fget.c berkdb/mp/mp_fopen.c berkdb/mp/mp_fput.c	\
-berkdb/mp/mp_fset.c berkdb/mp/mp_method.c berkdb/mp/mp_region.c	\
-berkdb/mp/mp_register.c berkdb/mp/mp_stat.c berkdb/mp/mp_sync.c	\
-berkdb/mp/mp_trickle.c
+berkdb/mp/mp_fset.c berkdb/mp/mp_method.c berkdb/mp/mp_pgcompress.c	\
+berkdb/mp/mp_region.c berkdb/mp/mp_register.c berkdb/mp/mp_stat.c	\
+berkdb/mp/mp_sync.c berkdb/mp/mp_trickle.c
 MUTEX_SOURCES:=berkdb/mutex/mut_pthread.c berkdb/mutex/mutex.c
 OS_SOURCES:=berkdb/os/os_abs.c berkdb/os/os_alloc.c			\
 berkdb/os/os_clock.c berkdb/os/os_config.c berkdb/os/os_dir.c		\
@@ -65,7 +65,8 @@ berkdb/os/os_method.c berkdb/os/os_oflags.c berkdb/os/os_open.c		\
 berkdb/os/os_region.c berkdb/os/os_rename.c berkdb/os/os_root.c		\
 berkdb/os/os_rpath.c berkdb/os/os_rw.c berkdb/os/os_seek.c		\
 berkdb/os/os_sleep.c berkdb/os/os_spin.c berkdb/os/os_stat.c		\
-berkdb/os/os_tmpdir.c berkdb/os/os_unlink.c berkdb/os/os_falloc.c
+berkdb/os/os_tmpdir.c berkdb/os/os_unlink.c berkdb/os/os_falloc.c	\
+berkdb/os/os_aio.c
 QAM_SOURCES:=berkdb/qam/qam.c berkdb/qam/qam_conv.c			\
 berkdb/qam/qam_files.c berkdb/qam/qam_method.c berkdb/qam/qam_open.c	\
 berkdb/qam/qam_rec.c berkdb/qam/qam_stat.c berkdb/qam/qam_upgrade.c	\
@@ -192,6 +192,8 @@ static void dump_page_stats(DB_ENV *dbenv) {
 	logmsgf(LOGMSG_USER, out, "st_hash_nowait: %d\n", mpool_stats->st_hash_nowait);
 	logmsgf(LOGMSG_USER, out, "st_hash_wait: %d\n", mpool_stats->st_hash_wait);
 	logmsgf(LOGMSG_USER, out, "st_hash_max_wait: %d\n", mpool_stats->st_hash_max_wait);
+	logmsgf(LOGMSG_USER, out, "st_hash_optimistic: %d\n", mpool_stats->st_hash_optimistic);
+	logmsgf(LOGMSG_USER, out, "st_hash_optimistic_miss: %d\n", mpool_stats->st_hash_optimistic_miss);
 	logmsgf(LOGMSG_USER, out, "st_hash_region_wait: %d\n", mpool_stats->st_region_wait);
 	logmsgf(LOGMSG_USER, out, "st_hash_region_nowait: %d\n",
 		mpool_stats->st_region_nowait);
@@ -202,6 +204,11 @@ static void dump_page_stats(DB_ENV *dbenv) {
 	logmsgf(LOGMSG_USER, out, "st_alloc_pages: %d\n", mpool_stats->st_alloc_pages);
 	logmsgf(LOGMSG_USER, out, "st_alloc_max_pages: %d\n",
 		mpool_stats->st_alloc_max_pages);
+	logmsgf(LOGMSG_USER, out, "st_scan_hit: %d\n", mpool_stats->st_scan_hit);
+	logmsgf(LOGMSG_USER, out, "st_scan_miss: %d\n", mpool_stats->st_scan_miss);
+	logmsgf(LOGMSG_USER, out, "st_scan_promote: %d\n", mpool_stats->st_scan_promote);
+	logmsgf(LOGMSG_USER, out, "st_scan_evict: %d\n", mpool_stats->st_scan_evict);
+	logmsgf(LOGMSG_USER, out, "st_scan_pages: %d\n", mpool_stats->st_scan_pages);
 
 	for(; fsp != NULL && *fsp != NULL; ++fsp)
 	{
@@ -215,6 +222,10 @@ static void dump_page_stats(DB_ENV *dbenv) {
 		logmsgf(LOGMSG_USER, out, "  st_page_out   : %u\n", (unsigned)(*fsp)->st_page_out);
 		logmsgf(LOGMSG_USER, out, "  st_ro_merges  : %u\n", (unsigned)(*fsp)->st_ro_merges);
 		logmsgf(LOGMSG_USER, out, "  st_rw_merges  : %u\n", (unsigned)(*fsp)->st_rw_merges);
+		logmsgf(LOGMSG_USER, out, "  st_scan_hit   : %u\n", (unsigned)(*fsp)->st_scan_hit);
+		logmsgf(LOGMSG_USER, out, "  st_scan_miss  : %u\n", (unsigned)(*fsp)->st_scan_miss);
+		logmsgf(LOGMSG_USER, out, "  st_scan_promote: %u\n", (unsigned)(*fsp)->st_scan_promote);
+		logmsgf(LOGMSG_USER, out, "  st_scan_evict : %u\n", (unsigned)(*fsp)->st_scan_evict);
 	}
 
 	free(mpool_stats);
@@ -300,6 +311,15 @@ __memp_alloc_flags(dbmp, memreg, mfp, len, offsetp, flags, retp)
 	if (LF_ISSET(DB_MPOOL_LOWPRI)) {
 		high_priority =
 		    c_mp->lru_count - (c_mp->stat.st_pages * 99) / 100;
+
+		/*
+		 * Once scans hold their share of the cache, they only get
+		 * to recycle buffers other scans are done with (those have
+		 * priority 0).
+		 */
+		if (dbenv->attr.mpool_scan_pct && c_mp->scan_pages >
+		    c_mp->stat.st_pages / 100 * dbenv->attr.mpool_scan_pct)
+			high_priority = 0;
 	}
 
 
@@ -504,6 +524,8 @@ found:		if (offsetp != NULL)
 		if (F_ISSET(bhp, BH_PREFAULT)) {
 			++c_mp->stat.st_pf_evict;
 		}
+		if (F_ISSET(bhp, BH_NOINCR))
+			++bh_mfp->stat.st_scan_evict;
 
 		/* 
 		 * If the page is dirty, pin it and write it. Regardless
@@ -516,9 +538,16 @@ found:		if (offsetp != NULL)
 				goto next_hb;
 			}
 
-			++bhp->ref;
+			/*
+			 * Keep lock-free lookups off the bucket while we hold
+			 * our pin, they'd otherwise be able to share the
+			 * buffer before the write locks it.
+			 */
+			MEMP_HASH_WRITE_BEGIN(hp);
+			BH_REF_INC(bhp);
 			ret = __memp_bhwrite(dbmp, hp, bh_mfp, bhp, 0);
-			--bhp->ref;
+			BH_REF_DEC(bhp);
+			MEMP_HASH_WRITE_END(hp);
 			if (ret == 0) {
 				++c_mp->stat.st_rw_evict;
 				if(ISLEAF(bhp->buf)) ++c_mp->stat.st_rw_levict;
@@ -617,6 +646,8 @@ __memp_bad_buffer(hp)
 	BH *bhp;
 	u_int32_t priority;
 
+	MEMP_HASH_WRITE_BEGIN(hp);
+
 	/* Remove the first buffer from the bucket. */
 	bhp = SH_TAILQ_FIRST(&hp->hash_bucket, __bh);
 	SH_TAILQ_REMOVE(&hp->hash_bucket, bhp, hq, __bh);
@@ -635,6 +666,7 @@ __memp_bad_buffer(hp)
 	 */
 	bhp->priority = priority;
 	SH_TAILQ_INSERT_TAIL(&hp->hash_bucket, bhp, hq);
+	MEMP_HASH_WRITE_END(hp);
 
 	/* Reset the hash bucket's priority. */
 	hp->hash_priority = SH_TAILQ_FIRST(&hp->hash_bucket, __bh)->priority;
@@ -262,6 +262,10 @@ __dir_pgread_multi(dbmfp, pgno, numpages, pages)
 
 		++mfp->stat.st_page_in;
 
+		if (__memp_pguncompress(dbenv,
+			dbmfp, pgno, &pages[idx]) != 0)
+			return (EIO);
+
 		if ((ret = mfp->ftype == 0 ? 0 :
 			__dir_pg(dbmfp, pgno, &pages[idx], 1)) != 0)
 			return (ret);
@@ -505,9 +509,15 @@ __memp_pgread(dbmfp, hp, bhp, can_create, is_recovery_page)
 			memset(bhp->buf + len, CLEAR_BYTE, pagesize - len);
 #endif
 		++mfp->stat.st_page_create;
-	} else
+	} else {
 		++mfp->stat.st_page_in;
 
+		/* A damaged compressed page is a checksum error. */
+		if (__memp_pguncompress(dbenv,
+		    dbmfp, bhp->pgno, bhp->buf) != 0)
+			goto recover_page;
+	}
+
 	if (0) {
 recover_page:
 		if (ret = __memp_recover_page(dbmfp, hp, bhp, bhp->pgno)) {
@@ -779,7 +789,8 @@ __memp_pgwrite_multi(dbenv, dbmfp, hps, bhps, numpages, wrrec)
 	BH *bhp;
 	u_int8_t **bparray;
 	size_t nw;
-	int *callpgin, *reclk;
+	DB_AIO_REQ *recreqs;
+	int *callpgin, *reclk, nrec;
 	DB_MPOOL *dbmp;
 	MPOOL *c_mp;
 	u_int32_t n_cache;
@@ -788,6 +799,8 @@ __memp_pgwrite_multi(dbenv, dbmfp, hps, bhps, numpages, wrrec)
 	mfp = dbmfp == NULL ? NULL : dbmfp->mfp;
 	ret = 0;
 	idx = -1;
+	recreqs = NULL;
+	nrec = 0;
 
 	/* We should at least have one one buffer to write out. */
 	DB_ASSERT(numpages >= 1 && bhps[0] != NULL && hps[0] != NULL);
@@ -836,7 +849,9 @@ __memp_pgwrite_multi(dbenv, dbmfp, hps, bhps, numpages, wrrec)
 		 * for the buffer lock, do so now.
 		 */
 		if (!F_ISSET(bhp, BH_LOCKED)) {
+			MEMP_HASH_WRITE_BEGIN(hp);
 			F_SET(bhp, BH_LOCKED);
+			MEMP_HASH_WRITE_END(hp);
 			MUTEX_LOCK(dbenv, &bhp->mutex);
 			MUTEX_UNLOCK(dbenv, &hp->hash_mutex);
 		}
@@ -964,7 +979,15 @@ __memp_pgwrite_multi(dbenv, dbmfp, hps, bhps, numpages, wrrec)
 		}
 	}
 
-	/* Recovery-page logging.  */
+	/*
+	 * Recovery-page logging.  With aio_batch the recovery pages of a
+	 * multi-page write all go out together once their slots are locked.
+	 */
+	if (wrrec && dbenv->mp_recovery_pages > 0 && numpages > 1 &&
+	    dbenv->attr.aio_batch && (ret = __os_malloc(dbenv,
+	    numpages * sizeof(DB_AIO_REQ), &recreqs)) != 0)
+		goto err;
+
 	for (i = 0; i < numpages; i++) {
 		bhp = bhps[i];
 
@@ -987,6 +1010,16 @@ __memp_pgwrite_multi(dbenv, dbmfp, hps, bhps, numpages, wrrec)
 			/* Hack in case we're writing out the meta page. */
 			reclk[i] = idx + 1;
 
+			if (recreqs != NULL) {
+				recreqs[nrec].fhp = dbmfp->recp;
+				recreqs[nrec].buf = bhp->buf;
+				recreqs[nrec].len = mfp->stat.st_pagesize;
+				recreqs[nrec].off =
+				    (off_t)idx * mfp->stat.st_pagesize;
+				++nrec;
+				continue;
+			}
+
 			ret = __os_io(dbenv, DB_IO_WRITE, dbmfp->recp,
 			    idx, mfp->stat.st_pagesize, bhp->buf, &nw);
 			if (ret != 0) {
@@ -1000,6 +1033,23 @@ __memp_pgwrite_multi(dbenv, dbmfp, hps, bhps, numpages, wrrec)
 		}
 	}
 
+	if (nrec > 0 &&
+	    __os_aio_rw(dbenv, DB_IO_WRITE, recreqs, nrec) != 0) {
+		/* Redo the batch synchronously. */
+		for (i = 0; i < nrec; i++) {
+			ret = __os_io(dbenv, DB_IO_WRITE, recreqs[i].fhp,
+			    (db_pgno_t)(recreqs[i].off / recreqs[i].len),
+			    recreqs[i].len, recreqs[i].buf, &nw);
+			if (ret != 0) {
+				__db_err(dbenv,
+				    "%s: write failed for recovery page %lu",
+				    __memp_fn(dbmfp),
+				    (u_long)(recreqs[i].off / recreqs[i].len));
+				goto err;
+			}
+		}
+	}
+
 	/* If bad-write testing is enabled, do a short-write then abort. */
 	if (!IS_RECOVERING(dbenv) && gbl_test_badwrite_intvl > 0 &&
 	    !(rand() % gbl_test_badwrite_intvl)) {
@@ -1031,8 +1081,18 @@ __memp_pgwrite_multi(dbenv, dbmfp, hps, bhps, numpages, wrrec)
 		bparray[i] = bhp->buf;
 	}
 
-	/* Write the page. */
-	if ((ret = __os_iov(dbenv, DB_IO_WRITE, dbmfp->fhp,
+	/* Write the pages.  Compressed pages go out one at a time. */
+	if (__memp_pgcompress_file(dbmfp)) {
+		for (i = 0; i < numpages; i++) {
+			bhp = bhps[i];
+			if ((ret = __memp_pgwrite_compressed(dbenv,
+			    dbmfp, bhp->pgno, bhp->buf)) != 0) {
+				__db_err(dbenv, "%s: write failed for page %lu",
+				    __memp_fn(dbmfp), (u_long) bhp->pgno);
+				goto err;
+			}
+		}
+	} else if ((ret = __os_iov(dbenv, DB_IO_WRITE, dbmfp->fhp,
 		    bhps[0]->pgno, mfp->stat.st_pagesize,
 		    bparray, numpages, &nw)) != 0) {
 		__db_err(dbenv, "%s: writev failed for page %lu",
@@ -1051,6 +1111,9 @@ __memp_pgwrite_multi(dbenv, dbmfp, hps, bhps, numpages, wrrec)
 
 err:
 file_dead:
+	if (recreqs != NULL)
+		__os_free(dbenv, recreqs);
+
 	/* Unlock the recovery-lock. */
 	for (i = 0; reclk[i] && i < numpages; i++)
 		pthread_mutex_unlock(&dbmfp->recp_lk_array[reclk[i] - 1]);
@@ -1257,12 +1320,19 @@ __memp_bhfree(dbmp, hp, bhp, free_mem)
 	dbenv = dbmp->dbenv;
 	mp = dbmp->reginfo[0].primary;
 	n_cache = NCACHE(mp, bhp->mf_offset, bhp->pgno);
+	c_mp = dbmp->reginfo[n_cache].primary;
+
+	if (F_ISSET(bhp, BH_NOINCR))
+		(void)__atomic_sub_fetch(&c_mp->scan_pages, 1, __ATOMIC_SEQ_CST);
 
 	/*
 	 * Delete the buffer header from the hash bucket queue and reset
-	 * the hash bucket's priority, if necessary.
+	 * the hash bucket's priority, if necessary.  Lock-free readers are
+	 * drained first, none of them may be holding a pointer to it.
 	 */
+	MEMP_HASH_WRITE_BEGIN(hp);
 	SH_TAILQ_REMOVE(&hp->hash_bucket, bhp, hq, __bh);
+	MEMP_HASH_WRITE_END(hp);
 	if (bhp->priority == hp->hash_priority)
 		hp->hash_priority =
 		    SH_TAILQ_FIRST(&hp->hash_bucket, __bh) == NULL ?
@@ -1300,7 +1370,6 @@ __memp_bhfree(dbmp, hp, bhp, free_mem)
 	 */
 	if (free_mem) {
 		__db_shalloc_free(dbmp->reginfo[n_cache].addr, bhp);
-		c_mp = dbmp->reginfo[n_cache].primary;
 		c_mp->stat.st_pages--;
 	}
 	R_UNLOCK(dbenv, &dbmp->reginfo[n_cache]);
@@ -110,6 +110,15 @@ __memp_fget_pp(dbmfp, pgnoaddr, flags, addrp)
 }
 
 void (*memp_fget_callback) (void) = 0;
+
+/*
+ * Non-zero while this thread is scanning (table scans, dumps, schema change
+ * conversions).  Plain gets and puts it makes are treated as
+ * DB_MPOOL_NOCACHE, so the pages it reads are cached on probation rather
+ * than pushing out the working set.  Callers increment and decrement it, so
+ * scans can nest.
+ */
+__thread int memp_scan_thread = 0;
 void
 __berkdb_register_memp_callback(void (*callback) (void))
 {
@@ -198,6 +207,62 @@ __memp_falloc_len(mfp, offset, len)
 }
 
 
+/*
+ * __memp_fget_optimistic --
+ *	Look for a resident, already referenced page without taking the
+ *	hash bucket lock, and pin it if found.  Returns NULL if the caller
+ *	has to take the locked path.
+ */
+static BH *
+__memp_fget_optimistic(c_mp, hp, mf_offset, pgno)
+	MPOOL *c_mp;
+	DB_MPOOL_HASH *hp;
+	roff_t mf_offset;
+	db_pgno_t pgno;
+{
+	BH *bhp;
+	u_int16_t ref;
+
+	if (!MEMP_HASH_READ_BEGIN(hp)) {
+		++c_mp->stat.st_hash_optimistic_miss;
+		return (NULL);
+	}
+
+	for (bhp = SH_TAILQ_FIRST(&hp->hash_bucket, __bh);
+	    bhp != NULL; bhp = SH_TAILQ_NEXT(bhp, hq, __bh))
+		if (bhp->pgno == pgno && bhp->mf_offset == mf_offset)
+			break;
+
+	/*
+	 * Only share a buffer somebody else already has pinned, and only if
+	 * it's usable as it stands.  None of these flags can be set while
+	 * we're registered as a reader, so checking before the pin is enough.
+	 * An unreferenced buffer may be about to be evicted, and is left to
+	 * the locked path, which also maintains its priority.  So is a scan
+	 * buffer, which the locked path may have to promote.
+	 */
+	if (bhp != NULL &&
+	    !F_ISSET(bhp, BH_LOCKED | BH_TRASH | BH_CALLPGIN | BH_NOINCR)) {
+		ref = __atomic_load_n(&bhp->ref, __ATOMIC_SEQ_CST);
+		do {
+			if (ref == 0 || ref == UINT16_T_MAX) {
+				bhp = NULL;
+				break;
+			}
+		} while (!__atomic_compare_exchange_n(&bhp->ref, &ref,
+		    ref + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+	} else
+		bhp = NULL;
+
+	MEMP_HASH_READ_END(hp);
+
+	if (bhp == NULL)
+		++c_mp->stat.st_hash_optimistic_miss;
+	else
+		++c_mp->stat.st_hash_optimistic;
+	return (bhp);
+}
+
 /*
  * __memp_fget_internal --
  *	Get a page from the file.
@@ -228,6 +293,9 @@ __memp_fget_internal(dbmfp, pgnoaddr, flags, addrp, did_io)
 	if (memp_fget_callback)
 		memp_fget_callback();
 
+	if (flags == 0 && memp_scan_thread && dbmfp->dbenv->attr.mpool_scan_pct)
+		flags = DB_MPOOL_NOCACHE;
+
 	if (gbl_bb_berkdb_enable_memp_timing) {
 		start_time_ms = bb_berkdb_fasttime();
 	}
@@ -301,6 +369,33 @@ __memp_fget_internal(dbmfp, pgnoaddr, flags, addrp, did_io)
 		return (0);
 	}
 
+#ifndef DIAGNOSTIC
+	/*
+	 * Plain gets of pages other threads are already using don't need the
+	 * bucket lock.
+	 */
+	if (flags == 0 && dbenv->attr.mpool_optimistic_get) {
+		n_cache = NCACHE(mp, mf_offset, *pgnoaddr);
+		c_mp = dbmp->reginfo[n_cache].primary;
+		hp = R_ADDR(&dbmp->reginfo[n_cache], c_mp->htab);
+		hp = &hp[NBUCKET(c_mp, mf_offset, *pgnoaddr)];
+		if ((bhp = __memp_fget_optimistic(c_mp,
+		    hp, mf_offset, *pgnoaddr)) != NULL) {
+			/* Layer violation */
+			if (ISINTERNAL(bhp->buf))
+				++mfp->stat.st_cache_ihit;
+			else if (ISLEAF(bhp->buf))
+				++mfp->stat.st_cache_lhit;
+			++mfp->stat.st_cache_hit;
+
+			*(void **)addrp = bhp->buf;
+			if (gbl_bb_berkdb_enable_memp_timing)
+				bb_memp_hit(start_time_ms);
+			return (0);
+		}
+	}
+#endif
+
 hb_search:
 	/*
 	 * Determine the cache and hash bucket where this page lives and get
@@ -335,7 +430,7 @@ retry:	st_hsearch = 0;
 			MUTEX_UNLOCK(dbenv, &hp->hash_mutex);
 			goto err;
 		}
-		++bhp->ref;
+		BH_REF_INC(bhp);
 		b_incr = 1;
 
 		/*
@@ -353,7 +448,7 @@ retry:	st_hsearch = 0;
 			 * and try again.
 			 */
 			if (!first && bhp->ref_sync != 0) {
-				--bhp->ref;
+				BH_REF_DEC(bhp);
 				b_incr = 0;
 				MUTEX_UNLOCK(dbenv, &hp->hash_mutex);
 				__os_yield(dbenv, 1);
@@ -387,6 +482,19 @@ retry:	st_hsearch = 0;
         if (LF_ISSET(DB_MPOOL_PFGET))
             ++c_mp->stat.st_page_pf_in_late;
 
+		/*
+		 * A page a scan brought in has been asked for again by a
+		 * regular reader: it's worth keeping, move it to the LRU.
+		 */
+		if (flags == DB_MPOOL_NOCACHE)
+			++mfp->stat.st_scan_hit;
+		else if (F_ISSET(bhp, BH_NOINCR)) {
+			F_CLR(bhp, BH_NOINCR);
+			(void)__atomic_sub_fetch(&c_mp->scan_pages, 1,
+			    __ATOMIC_SEQ_CST);
+			++mfp->stat.st_scan_promote;
+		}
+
 		break;
 	}
 
@@ -613,7 +721,7 @@ alloc:		/*
 		 * another one.
 		 */
 		if (flags == DB_MPOOL_NEW) {
-			--bhp->ref;
+			BH_REF_DEC(bhp);
 			b_incr = 0;
 			goto alloc;
 		}
@@ -644,6 +752,12 @@ alloc:		/*
 		bhp->priority = UINT32_T_MAX;
 		bhp->pgno = *pgnoaddr;
 		bhp->mf_offset = mf_offset;
+
+		/*
+		 * Lock-free readers mustn't see the buffer until its flags
+		 * say whether it can be used.
+		 */
+		MEMP_HASH_WRITE_BEGIN(hp);
 		SH_TAILQ_INSERT_TAIL(&hp->hash_bucket, bhp, hq);
 
 		hp->hash_priority =
@@ -665,6 +779,9 @@ alloc:		/*
 		 */
 		if (flags == DB_MPOOL_NOCACHE) {
 			F_SET(bhp, BH_NOINCR);
+			(void)__atomic_add_fetch(&c_mp->scan_pages, 1,
+			    __ATOMIC_SEQ_CST);
+			++mfp->stat.st_scan_miss;
 		}
 
 		/*
@@ -716,6 +833,7 @@ alloc:		/*
 			if (did_io != NULL)
 				*did_io = 1;
 		}
+		MEMP_HASH_WRITE_END(hp);
 
 		/* Increment buffer count referenced by MPOOLFILE. */
 		MUTEX_LOCK(dbenv, &mfp->mutex);
@@ -747,8 +865,10 @@ alloc:		/*
 		bhp->priority = UINT32_T_MAX;
 		if (SH_TAILQ_FIRST(&hp->hash_bucket, __bh) !=
 		    SH_TAILQ_LAST(&hp->hash_bucket, HashTab)) {
+			MEMP_HASH_WRITE_BEGIN(hp);
 			SH_TAILQ_REMOVE(&hp->hash_bucket, bhp, hq, __bh);
 			SH_TAILQ_INSERT_TAIL(&hp->hash_bucket, bhp, hq);
+			MEMP_HASH_WRITE_END(hp);
 		}
 		hp->hash_priority =
 		    SH_TAILQ_FIRST(&hp->hash_bucket, __bh)->priority;
@@ -832,12 +952,18 @@ err:	/*
 	 * also still holding the hash bucket mutex.
 	 */
 	if (b_incr) {
+		/*
+		 * Decide with lock-free readers drained, one of them may be
+		 * sharing the buffer.
+		 */
+		MEMP_HASH_WRITE_BEGIN(hp);
 		if (bhp->ref == 1)
 			(void)__memp_bhfree(dbmp, hp, bhp, 1);
 		else {
-			--bhp->ref;
+			BH_REF_DEC(bhp);
 			MUTEX_UNLOCK(dbenv, &hp->hash_mutex);
 		}
+		MEMP_HASH_WRITE_END(hp);
 	}
 
 	/* If alloc_bhp is set, free the memory. */
@@ -1449,6 +1449,10 @@ __memp_mf_discard(dbmp, mfp)
 	sp->st_page_out += mfp->stat.st_page_out;
 	sp->st_ro_merges += mfp->stat.st_ro_merges;
 	sp->st_rw_merges += mfp->stat.st_rw_merges;
+	sp->st_scan_hit += mfp->stat.st_scan_hit;
+	sp->st_scan_miss += mfp->stat.st_scan_miss;
+	sp->st_scan_promote += mfp->stat.st_scan_promote;
+	sp->st_scan_evict += mfp->stat.st_scan_evict;
 
 	/* Clear the mutex this MPOOLFILE recorded. */
 	__db_shlocks_clear(&mfp->mutex, dbmp->reginfo,
@@ -23,8 +23,10 @@ static const char revid[] = "$Id: mp_fput.c,v 11.48 2003/09/30 17:12:00 sue Exp
 #include <string.h>
 
 extern int gbl_enable_cache_internal_nodes;
+extern __thread int memp_scan_thread;
 
 static void __memp_reset_lru __P((DB_ENV *, REGINFO *));
+static int __memp_fput_optimistic __P((MPOOL *, DB_MPOOL_HASH *, BH *));
 
 /*
  * __memp_fput_pp --
@@ -69,6 +71,7 @@ __memp_fput_internal(dbmfp, pgaddr, flags, pgorder)
 	DB_MPOOL_HASH *hp;
 	MPOOL *c_mp;
 	u_int32_t n_cache;
+	u_int16_t ref;
 	int adjust, ret, incr_count = 1;
 
 	dbenv = dbmfp->dbenv;
@@ -151,6 +154,18 @@ __memp_fput_internal(dbmfp, pgaddr, flags, pgorder)
 	hp = R_ADDR(&dbmp->reginfo[n_cache], c_mp->htab);
 	hp = &hp[NBUCKET(c_mp, bhp->mf_offset, bhp->pgno)];
 
+	/* Scans return their pages the way they got them, see __memp_fget. */
+	if (flags == 0 && memp_scan_thread && dbenv->attr.mpool_scan_pct)
+		flags = DB_MPOOL_NOCACHE;
+
+#ifndef DIAGNOSTIC
+	if (flags == 0 && dbenv->attr.mpool_optimistic_get &&
+	    __memp_fput_optimistic(c_mp, hp, bhp)) {
+		++c_mp->put_counter;
+		return (0);
+	}
+#endif
+
 	MUTEX_LOCK(dbenv, &hp->hash_mutex);
 
 	/* Set/clear the page bits. */
@@ -192,7 +207,8 @@ __memp_fput_internal(dbmfp, pgaddr, flags, pgorder)
 	 * thread waiting to flush the buffer to disk, we're done.  Ignore the
 	 * discard flags (for now) and leave the buffer's priority alone.
 	 */
-	if (--bhp->ref > 1 || (bhp->ref == 1 && !F_ISSET(bhp, BH_LOCKED))) {
+	if ((ref = BH_REF_DEC(bhp)) > 1 ||
+	    (ref == 1 && !F_ISSET(bhp, BH_LOCKED))) {
 #ifdef REF_SYNC_TEST
 		if (F_ISSET(bhp, BH_LOCKED) && bhp->ref_sync) {
 			fprintf(stderr,
@@ -276,6 +292,7 @@ __memp_fput_internal(dbmfp, pgaddr, flags, pgorder)
 
 	if (fbhp == bhp)
 		fbhp = SH_TAILQ_NEXT(fbhp, hq, __bh);
+	MEMP_HASH_WRITE_BEGIN(hp);
 	SH_TAILQ_REMOVE(&hp->hash_bucket, bhp, hq, __bh);
 
 	for (prev = NULL; fbhp != NULL;
@@ -286,6 +303,7 @@ __memp_fput_internal(dbmfp, pgaddr, flags, pgorder)
 		SH_TAILQ_INSERT_HEAD(&hp->hash_bucket, bhp, hq, __bh);
 	else
 		SH_TAILQ_INSERT_AFTER(&hp->hash_bucket, prev, bhp, hq, __bh);
+	MEMP_HASH_WRITE_END(hp);
 
 done:
 	/* Reset the hash bucket's priority. */
@@ -321,6 +339,51 @@ done:
 	return (0);
 }
 
+/*
+ * __memp_fput_optimistic --
+ *	Drop a reference without taking the hash bucket lock, if it isn't
+ *	the last reference other than a sync waiting on the buffer.  Returns
+ *	0 if the caller has to take the locked path.
+ */
+static int
+__memp_fput_optimistic(c_mp, hp, bhp)
+	MPOOL *c_mp;
+	DB_MPOOL_HASH *hp;
+	BH *bhp;
+{
+	u_int16_t ref;
+	int done;
+
+	/* Don't bother registering if ours is the last reference. */
+	if (__atomic_load_n(&bhp->ref, __ATOMIC_RELAXED) < 2 ||
+	    !MEMP_HASH_READ_BEGIN(hp)) {
+		++c_mp->stat.st_hash_optimistic_miss;
+		return (0);
+	}
+
+	/*
+	 * The same test as the locked path: nothing but the count changes
+	 * unless we'd leave the buffer unreferenced or leave only a sync.
+	 * BH_LOCKED can't be set while we're registered as a reader.
+	 */
+	done = 0;
+	ref = __atomic_load_n(&bhp->ref, __ATOMIC_SEQ_CST);
+	while (ref > 2 || (ref == 2 && !F_ISSET(bhp, BH_LOCKED)))
+		if (__atomic_compare_exchange_n(&bhp->ref, &ref, ref - 1,
+		    0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+			done = 1;
+			break;
+		}
+
+	MEMP_HASH_READ_END(hp);
+
+	if (done)
+		++c_mp->stat.st_hash_optimistic;
+	else
+		++c_mp->stat.st_hash_optimistic_miss;
+	return (done);
+}
+
 int
 __memp_fput(dbmfp, pgaddr, flags)
 	DB_MPOOLFILE *dbmfp;
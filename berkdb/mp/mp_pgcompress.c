@@ -0,0 +1,235 @@
+/*-
+ * See the file LICENSE for redistribution information.
+ *
+ * Copyright (c) 1996-2003
+ *	Sleepycat Software.  All rights reserved.
+ */
+
+#include "db_config.h"
+
+#ifndef lint
+static const char revid[] = "$Id: mp_pgcompress.c,v 1.1 2017/06/01 12:00:00 $";
+#endif /* not lint */
+
+#ifndef NO_SYSTEM_INCLUDES
+#include <sys/types.h>
+#include <arpa/inet.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#endif /* NO_SYSTEM_INCLUDES */
+
+#include <lz4.h>
+#include <zstd.h>
+#include <crc32c.h>
+
+#include "db_int.h"
+#include "dbinc/db_shash.h"
+#include "dbinc/mp.h"
+#include "logmsg.h"
+
+#if LZ4_VERSION_NUMBER < 10701
+#define	LZ4_compress_default LZ4_compress_limitedOutput
+#endif
+
+/*
+ * Compressed pages on disk.  With the page_compress attribute set, btree
+ * pages are compressed on their way out of the cache and uncompressed on
+ * their way back in, so everything above the __os_io layer still sees
+ * ordinary pages.  Compression runs after pgout, so checksums have already
+ * been computed over the uncompressed page and are verified as usual by
+ * pgin once it has been inflated.
+ *
+ * A compressed page keeps its fixed slot in the file.  It is written as a
+ * header and the compressed bytes, rounded up to PGZ_BLOCK, and the rest
+ * of the slot is punched out so the filesystem can give the blocks back.
+ * The header starts where the page LSN would, with a file number no real
+ * LSN can have:
+ *
+ *	0xffffffff | "PGZ" alg | compressed length | crc32c of compressed bytes
+ *
+ * all big-endian.  Reads always look for the header, so pages written with
+ * compression on stay readable after it's turned off.  Page 0 (the meta
+ * page, which is read directly by file operations and comdb2ar), files
+ * with pages too small to save a block, and encrypted environments are
+ * never compressed.  Neither are recovery pages.
+ */
+#define	PGZ_HDRSZ	16
+#define	PGZ_BLOCK	4096
+#define	PGZ_NOLSN	0xffffffffU
+#define	PGZ_MAGIC	0x50475a00U	/* "PGZ\0" */
+#define	PGZ_MAGIC_MASK	0xffffff00U
+
+#define	PGZ_LZ4		1
+#define	PGZ_ZSTD	2
+
+#define	PGZ_ALIGN(n)	(((n) + PGZ_BLOCK - 1) & ~(size_t)(PGZ_BLOCK - 1))
+
+/*
+ * __memp_pgcompress_file --
+ *	Return whether pages written to this file should be compressed.
+ *
+ * PUBLIC: int __memp_pgcompress_file __P((DB_MPOOLFILE *));
+ */
+int
+__memp_pgcompress_file(dbmfp)
+	DB_MPOOLFILE *dbmfp;
+{
+	DB_ENV *dbenv;
+	DB_MPOOL *dbmp;
+	DB_PGINFO *pginfo;
+	MPOOLFILE *mfp;
+
+	dbenv = dbmfp->dbenv;
+	dbmp = dbenv->mp_handle;
+	mfp = dbmfp->mfp;
+
+	if (dbenv->attr.page_compress != PGZ_LZ4 &&
+	    dbenv->attr.page_compress != PGZ_ZSTD)
+		return (0);
+	if (CRYPTO_ON(dbenv) || mfp->ftype == 0 || mfp->pgcookie_len == 0)
+		return (0);
+	if (mfp->stat.st_pagesize <= PGZ_BLOCK)
+		return (0);
+
+	pginfo = (DB_PGINFO *)R_ADDR(dbmp->reginfo, mfp->pgcookie_off);
+	return (pginfo->type == DB_BTREE);
+}
+
+/*
+ * __memp_pgwrite_compressed --
+ *	Write a page to its slot, compressed if that saves at least a block.
+ *	The caller has already run pgout on it.
+ *
+ * PUBLIC: int __memp_pgwrite_compressed
+ * PUBLIC:     __P((DB_ENV *, DB_MPOOLFILE *, db_pgno_t, u_int8_t *));
+ */
+int
+__memp_pgwrite_compressed(dbenv, dbmfp, pgno, buf)
+	DB_ENV *dbenv;
+	DB_MPOOLFILE *dbmfp;
+	db_pgno_t pgno;
+	u_int8_t *buf;
+{
+	u_int8_t *out;
+	u_int32_t hdr[4];
+	size_t pagesize, clen, slot, nw;
+	int alg, n, ret;
+
+	pagesize = dbmfp->mfp->stat.st_pagesize;
+	alg = dbenv->attr.page_compress;
+	out = NULL;
+	clen = 0;
+
+	if (pgno == 0 || __os_malloc(dbenv, pagesize, &out) != 0)
+		goto raw;
+
+	/* Anything that doesn't leave a whole block free isn't worth it. */
+	switch (alg) {
+	case PGZ_LZ4:
+		n = LZ4_compress_default((const char *)buf,
+		    (char *)out + PGZ_HDRSZ, (int)pagesize,
+		    (int)(pagesize - PGZ_BLOCK - PGZ_HDRSZ));
+		clen = n > 0 ? (size_t)n : 0;
+		break;
+	case PGZ_ZSTD:
+		clen = ZSTD_compress(out + PGZ_HDRSZ,
+		    pagesize - PGZ_BLOCK - PGZ_HDRSZ, buf, pagesize,
+		    dbenv->attr.page_compress_zstd_level);
+		if (ZSTD_isError(clen))
+			clen = 0;
+		break;
+	}
+	if (clen == 0)
+		goto raw;
+
+	hdr[0] = htonl(PGZ_NOLSN);
+	hdr[1] = htonl(PGZ_MAGIC | alg);
+	hdr[2] = htonl((u_int32_t)clen);
+	hdr[3] = htonl(crc32c(out + PGZ_HDRSZ, (u_int32_t)clen));
+	memcpy(out, hdr, PGZ_HDRSZ);
+
+	slot = PGZ_ALIGN(PGZ_HDRSZ + clen);
+	memset(out + PGZ_HDRSZ + clen, 0, slot - PGZ_HDRSZ - clen);
+
+	if ((ret = __os_io_partial(dbenv, DB_IO_WRITE,
+	    dbmfp->fhp, pgno, pagesize, slot, out, &nw)) != 0)
+		goto done;
+
+	/*
+	 * If the tail of the slot can't be made part of the file (because
+	 * this page extends it and we can't preallocate), readers would see
+	 * a short page: write the whole thing instead.
+	 */
+	if (__os_punch_hole(dbenv, dbmfp->fhp,
+	    (off_t)pgno * pagesize + slot, (off_t)(pagesize - slot)) == 0)
+		goto done;
+
+raw:	ret = __os_io(dbenv, DB_IO_WRITE,
+	    dbmfp->fhp, pgno, pagesize, buf, &nw);
+
+done:	if (out != NULL)
+		__os_free(dbenv, out);
+	return (ret);
+}
+
+/*
+ * __memp_pguncompress --
+ *	If the page just read is a compressed slot, inflate it in place.
+ *	Returns 0 for an ordinary or successfully inflated page, and
+ *	DB_SEARCH_PGCACHE if the slot is damaged.
+ *
+ * PUBLIC: int __memp_pguncompress
+ * PUBLIC:     __P((DB_ENV *, DB_MPOOLFILE *, db_pgno_t, u_int8_t *));
+ */
+int
+__memp_pguncompress(dbenv, dbmfp, pgno, buf)
+	DB_ENV *dbenv;
+	DB_MPOOLFILE *dbmfp;
+	db_pgno_t pgno;
+	u_int8_t *buf;
+{
+	u_int8_t *out;
+	u_int32_t hdr[4], alg, clen;
+	size_t pagesize, n;
+	int ret;
+
+	memcpy(hdr, buf, PGZ_HDRSZ);
+	if (ntohl(hdr[0]) != PGZ_NOLSN ||
+	    (ntohl(hdr[1]) & PGZ_MAGIC_MASK) != PGZ_MAGIC)
+		return (0);
+
+	pagesize = dbmfp->mfp->stat.st_pagesize;
+	alg = ntohl(hdr[1]) & ~PGZ_MAGIC_MASK;
+	clen = ntohl(hdr[2]);
+	if (clen > pagesize - PGZ_HDRSZ ||
+	    crc32c(buf + PGZ_HDRSZ, clen) != ntohl(hdr[3]))
+		goto bad;
+
+	if ((ret = __os_malloc(dbenv, pagesize, &out)) != 0)
+		return (ret);
+
+	n = 0;
+	switch (alg) {
+	case PGZ_LZ4:
+		if ((ret = LZ4_decompress_safe((const char *)buf + PGZ_HDRSZ,
+		    (char *)out, (int)clen, (int)pagesize)) > 0)
+			n = (size_t)ret;
+		break;
+	case PGZ_ZSTD:
+		n = ZSTD_decompress(out, pagesize, buf + PGZ_HDRSZ, clen);
+		if (ZSTD_isError(n))
+			n = 0;
+		break;
+	}
+	if (n == pagesize)
+		memcpy(buf, out, pagesize);
+	__os_free(dbenv, out);
+	if (n == pagesize)
+		return (0);
+
+bad:	__db_err(dbenv, "%s: bad compressed page %lu",
+	    __memp_fn(dbmfp), (u_long)pgno);
+	return (DB_SEARCH_PGCACHE);
+}
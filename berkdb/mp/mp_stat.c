@@ -126,6 +126,10 @@ __memp_stat(dbenv, gspp, fspp, flags)
 			sp->st_page_out += c_mp->stat.st_page_out;
 			sp->st_ro_merges += c_mp->stat.st_ro_merges;
 			sp->st_rw_merges += c_mp->stat.st_rw_merges;
+			sp->st_scan_hit += c_mp->stat.st_scan_hit;
+			sp->st_scan_miss += c_mp->stat.st_scan_miss;
+			sp->st_scan_promote += c_mp->stat.st_scan_promote;
+			sp->st_scan_evict += c_mp->stat.st_scan_evict;
 			if (LF_ISSET(DB_STAT_MINIMAL))
 				continue;
 			sp->st_ro_evict += c_mp->stat.st_ro_evict;
@@ -136,6 +140,7 @@ __memp_stat(dbenv, gspp, fspp, flags)
 			sp->st_rw_evict_skip += c_mp->stat.st_rw_evict_skip;
 			sp->st_page_trickle += c_mp->stat.st_page_trickle;
 			sp->st_pages += c_mp->stat.st_pages;
+			sp->st_scan_pages += c_mp->scan_pages;
 			/*
 			 * st_page_dirty	calculated by __memp_stat_hash
 			 * st_page_clean	calculated here
@@ -148,6 +153,9 @@ __memp_stat(dbenv, gspp, fspp, flags)
 			sp->st_hash_searches += c_mp->stat.st_hash_searches;
 			sp->st_hash_longest += c_mp->stat.st_hash_longest;
 			sp->st_hash_examined += c_mp->stat.st_hash_examined;
+			sp->st_hash_optimistic += c_mp->stat.st_hash_optimistic;
+			sp->st_hash_optimistic_miss +=
+			    c_mp->stat.st_hash_optimistic_miss;
 			/*
 			 * st_hash_nowait	calculated by __memp_stat_wait
 			 * st_hash_wait
@@ -207,6 +215,10 @@ __memp_stat(dbenv, gspp, fspp, flags)
 			sp->st_page_out += mfp->stat.st_page_out;
 			sp->st_ro_merges += mfp->stat.st_ro_merges;
 			sp->st_rw_merges += mfp->stat.st_rw_merges;
+			sp->st_scan_hit += mfp->stat.st_scan_hit;
+			sp->st_scan_miss += mfp->stat.st_scan_miss;
+			sp->st_scan_promote += mfp->stat.st_scan_promote;
+			sp->st_scan_evict += mfp->stat.st_scan_evict;
 			if (fspp == NULL && LF_ISSET(DB_STAT_CLEAR)) {
 				pagesize = mfp->stat.st_pagesize;
 				memset(&mfp->stat, 0, sizeof(mfp->stat));
@@ -623,7 +623,7 @@ trickle_do_work(struct thdpool *thdpool, void *work, void *thddata, int thd_op)
 				bhparray[j]->ref_sync = 0;
 
 				/* Discard our reference and unlock the bucket*/
-				--bhparray[j]->ref;
+				BH_REF_DEC(bhparray[j]);
 				MUTEX_UNLOCK(dbenv, &hparray[j]->hash_mutex);
 			}
 
@@ -693,11 +693,13 @@ trickle_do_work(struct thdpool *thdpool, void *work, void *thddata, int thd_op)
 		 * Set the sync wait-for count, used to count down outstanding
 		 * references to this buffer as they are returned to the cache.
 		 */
+		MEMP_HASH_WRITE_BEGIN(hp);
 		bhp->ref_sync = bhp->ref;
 
 		/* Pin the buffer into memory and lock it. */
-		++bhp->ref;
+		BH_REF_INC(bhp);
 		F_SET(bhp, BH_LOCKED);
+		MEMP_HASH_WRITE_END(hp);
 		MUTEX_LOCK(dbenv, &bhp->mutex);
 
 		/*
@@ -881,7 +883,7 @@ trickle_do_work(struct thdpool *thdpool, void *work, void *thddata, int thd_op)
 
 				/* Discard our reference and unlock
 				 * the bucket. */
-				--bhparray[j]->ref;
+				BH_REF_DEC(bhparray[j]);
 				MUTEX_UNLOCK(dbenv, &hparray[j]->hash_mutex);
 			}
 
@@ -951,7 +953,7 @@ trickle_do_work(struct thdpool *thdpool, void *work, void *thddata, int thd_op)
 			bhp->ref_sync = 0;
 
 			/* Discard our reference and unlock the bucket. */
-			--bhp->ref;
+			BH_REF_DEC(bhp);
 			MUTEX_UNLOCK(dbenv, mutexp);
 		}
 
@@ -997,7 +999,7 @@ trickle_do_work(struct thdpool *thdpool, void *work, void *thddata, int thd_op)
 		bhparray[j]->ref_sync = 0;
 
 		/* Discard our reference and unlock the bucket. */
-		--bhparray[j]->ref;
+		BH_REF_DEC(bhparray[j]);
 		MUTEX_UNLOCK(dbenv, &hparray[j]->hash_mutex);
 	}
 
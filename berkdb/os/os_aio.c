@@ -0,0 +1,485 @@
+/*-
+ * See the file LICENSE for redistribution information.
+ *
+ * Copyright (c) 1997-2003
+ *	Sleepycat Software.  All rights reserved.
+ */
+
+#include "db_config.h"
+
+#ifndef lint
+static const char revid[] = "$Id: os_aio.c,v 1.1 2017/06/01 12:00:00 $";
+#endif /* not lint */
+
+#ifndef NO_SYSTEM_INCLUDES
+#include <pthread.h>
+#include <sys/types.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef _LINUX_SOURCE
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/aio_abi.h>
+#include <linux/io_uring.h>
+#endif
+#endif /* NO_SYSTEM_INCLUDES */
+
+#include "db_int.h"
+#include "mem_restore.h"
+#include "logmsg.h"
+
+/*
+ * Batched page I/O.  A checkpoint or trickle thread hands us a run of page
+ * writes (or reads) and we put all of them in flight at once, then wait for
+ * the lot.  Each thread owns a small io_uring; if the kernel doesn't have
+ * io_uring we use kernel AIO (io_submit) instead, and if neither is usable
+ * we return ENOSYS so the caller does the I/O synchronously.
+ *
+ * Requests against O_DIRECT handles that aren't sector aligned are bounced
+ * through a per-thread aligned buffer, like __berkdb_direct_pwrite does.
+ */
+#define	AIO_QDEPTH	64
+#define	AIO_ALIGN	512
+
+#define	AIO_NONE	0
+#define	AIO_URING	1
+#define	AIO_KAIO	2
+
+#ifdef _LINUX_SOURCE
+struct aio_ctx {
+	int backend;
+
+	/* io_uring */
+	int ring_fd;
+	void *sq_ptr;
+	void *cq_ptr;
+	size_t sq_sz;
+	size_t cq_sz;
+	struct io_uring_sqe *sqes;
+	size_t sqes_sz;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+	unsigned sq_entries;
+
+	/* kernel aio */
+	aio_context_t kaio;
+
+	/* A batch failed part way; don't trust the ring again. */
+	int broken;
+
+	/* Bounce buffer for unaligned direct requests. */
+	void *bounce;
+	size_t bounce_sz;
+};
+
+static pthread_key_t aio_key;
+static pthread_once_t aio_once = PTHREAD_ONCE_INIT;
+static int aio_unavailable = 0;
+
+static void
+__os_aio_ctx_free(p)
+	void *p;
+{
+	struct aio_ctx *c = p;
+
+	if (c->backend == AIO_URING) {
+		munmap(c->sqes, c->sqes_sz);
+		if (c->cq_ptr != c->sq_ptr)
+			munmap(c->cq_ptr, c->cq_sz);
+		munmap(c->sq_ptr, c->sq_sz);
+		close(c->ring_fd);
+	} else if (c->backend == AIO_KAIO)
+		syscall(__NR_io_destroy, c->kaio);
+	free(c->bounce);
+	free(c);
+}
+
+static void
+__os_aio_key_init(void)
+{
+	int rc;
+
+	if ((rc = pthread_key_create(&aio_key, __os_aio_ctx_free)) != 0) {
+		logmsg(LOGMSG_ERROR, "can't create aio key %d\n", rc);
+		aio_unavailable = 1;
+	}
+}
+
+static int
+__os_uring_setup(c)
+	struct aio_ctx *c;
+{
+	struct io_uring_params p;
+	int fd;
+
+	memset(&p, 0, sizeof(p));
+	if ((fd = syscall(__NR_io_uring_setup, AIO_QDEPTH, &p)) < 0)
+		return (errno);
+
+	c->ring_fd = fd;
+	c->sq_entries = p.sq_entries;
+	c->sq_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	c->cq_sz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (c->cq_sz > c->sq_sz)
+			c->sq_sz = c->cq_sz;
+		c->cq_sz = c->sq_sz;
+	}
+
+	c->sq_ptr = mmap(NULL, c->sq_sz, PROT_READ | PROT_WRITE,
+	    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if (c->sq_ptr == MAP_FAILED)
+		goto err;
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+		c->cq_ptr = c->sq_ptr;
+	else {
+		c->cq_ptr = mmap(NULL, c->cq_sz, PROT_READ | PROT_WRITE,
+		    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+		if (c->cq_ptr == MAP_FAILED) {
+			munmap(c->sq_ptr, c->sq_sz);
+			goto err;
+		}
+	}
+	c->sqes_sz = p.sq_entries * sizeof(struct io_uring_sqe);
+	c->sqes = mmap(NULL, c->sqes_sz, PROT_READ | PROT_WRITE,
+	    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if (c->sqes == MAP_FAILED) {
+		if (c->cq_ptr != c->sq_ptr)
+			munmap(c->cq_ptr, c->cq_sz);
+		munmap(c->sq_ptr, c->sq_sz);
+		goto err;
+	}
+
+	c->sq_tail = (unsigned *)((char *)c->sq_ptr + p.sq_off.tail);
+	c->sq_mask = (unsigned *)((char *)c->sq_ptr + p.sq_off.ring_mask);
+	c->sq_array = (unsigned *)((char *)c->sq_ptr + p.sq_off.array);
+	c->cq_head = (unsigned *)((char *)c->cq_ptr + p.cq_off.head);
+	c->cq_tail = (unsigned *)((char *)c->cq_ptr + p.cq_off.tail);
+	c->cq_mask = (unsigned *)((char *)c->cq_ptr + p.cq_off.ring_mask);
+	c->cqes = (struct io_uring_cqe *)((char *)c->cq_ptr + p.cq_off.cqes);
+	c->backend = AIO_URING;
+	return (0);
+
+err:	close(fd);
+	return (errno);
+}
+
+static struct aio_ctx *
+__os_aio_ctx(void)
+{
+	struct aio_ctx *c;
+
+	if (aio_unavailable)
+		return (NULL);
+	pthread_once(&aio_once, __os_aio_key_init);
+	if (aio_unavailable)
+		return (NULL);
+	if ((c = pthread_getspecific(aio_key)) != NULL)
+		return (c->broken ? NULL : c);
+
+	if ((c = calloc(1, sizeof(struct aio_ctx))) == NULL)
+		return (NULL);
+	if (__os_uring_setup(c) != 0 &&
+	    syscall(__NR_io_setup, AIO_QDEPTH, &c->kaio) == 0)
+		c->backend = AIO_KAIO;
+	if (c->backend == AIO_NONE) {
+		logmsg(LOGMSG_WARN,
+		    "neither io_uring nor kernel aio is available, "
+		    "batched page I/O disabled\n");
+		aio_unavailable = 1;
+		free(c);
+		return (NULL);
+	}
+	pthread_setspecific(aio_key, c);
+	return (c);
+}
+
+/*
+ * A batch failed after the kernel accepted some of its requests.  They still
+ * point at the caller's pages (or our bounce buffer), which will be reused or
+ * rewritten as soon as we return, so wait for every one of them to complete
+ * first.  The context is poisoned; if waiting itself fails, keep retrying:
+ * returning early would let a late completion land in a reused buffer.
+ */
+static void
+__os_uring_drain(c, reqs, submitted, done)
+	struct aio_ctx *c;
+	DB_AIO_REQ *reqs;
+	int submitted, done;
+{
+	struct io_uring_cqe *cqe;
+	unsigned head;
+	int rc, warned;
+
+	c->broken = 1;
+	for (warned = 0; done < submitted;) {
+		head = *c->cq_head;
+		if (head != __atomic_load_n(c->cq_tail, __ATOMIC_ACQUIRE)) {
+			cqe = &c->cqes[head & *c->cq_mask];
+			reqs[cqe->user_data].res = cqe->res;
+			__atomic_store_n(c->cq_head, head + 1, __ATOMIC_RELEASE);
+			++done;
+			continue;
+		}
+		rc = syscall(__NR_io_uring_enter, c->ring_fd,
+		    0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+		if (rc < 0 && errno != EINTR) {
+			if (!warned++)
+				logmsg(LOGMSG_ERROR, "waiting for %d batched "
+				    "page requests: %s\n",
+				    submitted - done, strerror(errno));
+			usleep(10000);
+		}
+	}
+}
+
+/* Same as __os_uring_drain, for kernel aio. */
+static void
+__os_kaio_drain(c, reqs, submitted, done)
+	struct aio_ctx *c;
+	DB_AIO_REQ *reqs;
+	int submitted, done;
+{
+	struct io_event evs[AIO_QDEPTH];
+	int i, rc, warned;
+
+	c->broken = 1;
+	for (warned = 0; done < submitted;) {
+		if ((rc = syscall(__NR_io_getevents, c->kaio,
+		    1, submitted - done, evs, NULL)) < 0) {
+			if (errno != EINTR) {
+				if (!warned++)
+					logmsg(LOGMSG_ERROR, "waiting for %d "
+					    "batched page requests: %s\n",
+					    submitted - done, strerror(errno));
+				usleep(10000);
+			}
+			continue;
+		}
+		for (i = 0; i < rc; ++i)
+			reqs[evs[i].data].res = evs[i].res;
+		done += rc;
+	}
+}
+
+/* Submit reqs[0..n) (n <= AIO_QDEPTH) on the ring and reap them all. */
+static int
+__os_uring_batch(c, op, reqs, iovs, n)
+	struct aio_ctx *c;
+	int op;
+	DB_AIO_REQ *reqs;
+	struct iovec *iovs;
+	int n;
+{
+	struct io_uring_sqe *sqe;
+	struct io_uring_cqe *cqe;
+	unsigned head, idx, tail;
+	int done, i, rc, ret, submitted;
+
+	tail = *c->sq_tail;
+	for (i = 0; i < n; ++i) {
+		idx = tail & *c->sq_mask;
+		sqe = &c->sqes[idx];
+		memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode =
+		    op == DB_IO_READ ? IORING_OP_READV : IORING_OP_WRITEV;
+		sqe->fd = reqs[i].fhp->fd;
+		sqe->addr = (u_int64_t)(uintptr_t)&iovs[i];
+		sqe->len = 1;
+		sqe->off = reqs[i].off;
+		sqe->user_data = i;
+		c->sq_array[idx] = idx;
+		++tail;
+	}
+	__atomic_store_n(c->sq_tail, tail, __ATOMIC_RELEASE);
+
+	for (submitted = 0, done = 0; done < n;) {
+		head = *c->cq_head;
+		if (head == __atomic_load_n(c->cq_tail, __ATOMIC_ACQUIRE)) {
+			rc = syscall(__NR_io_uring_enter, c->ring_fd,
+			    n - submitted, n - done, IORING_ENTER_GETEVENTS,
+			    NULL, 0);
+			if (rc < 0) {
+				if (errno == EINTR)
+					continue;
+				ret = errno;
+				__os_uring_drain(c, reqs, submitted, done);
+				return (ret);
+			}
+			submitted += rc;
+			continue;
+		}
+		cqe = &c->cqes[head & *c->cq_mask];
+		reqs[cqe->user_data].res = cqe->res;
+		__atomic_store_n(c->cq_head, head + 1, __ATOMIC_RELEASE);
+		++done;
+	}
+	return (0);
+}
+
+/* Same as __os_uring_batch, through io_submit/io_getevents. */
+static int
+__os_kaio_batch(c, op, reqs, iovs, n)
+	struct aio_ctx *c;
+	int op;
+	DB_AIO_REQ *reqs;
+	struct iovec *iovs;
+	int n;
+{
+	struct iocb cbs[AIO_QDEPTH], *cbps[AIO_QDEPTH];
+	struct io_event evs[AIO_QDEPTH];
+	int done, i, rc, ret, submitted;
+
+	for (i = 0; i < n; ++i) {
+		memset(&cbs[i], 0, sizeof(cbs[i]));
+		cbs[i].aio_fildes = reqs[i].fhp->fd;
+		cbs[i].aio_lio_opcode =
+		    op == DB_IO_READ ? IOCB_CMD_PREAD : IOCB_CMD_PWRITE;
+		cbs[i].aio_buf = (u_int64_t)(uintptr_t)iovs[i].iov_base;
+		cbs[i].aio_nbytes = iovs[i].iov_len;
+		cbs[i].aio_offset = reqs[i].off;
+		cbs[i].aio_data = i;
+		cbps[i] = &cbs[i];
+	}
+
+	for (submitted = 0; submitted < n; submitted += rc)
+		if ((rc = syscall(__NR_io_submit,
+		    c->kaio, n - submitted, cbps + submitted)) <= 0) {
+			if (rc < 0 && errno == EINTR) {
+				rc = 0;
+				continue;
+			}
+			ret = rc < 0 ? errno : EIO;
+
+			/* Reap whatever is already in flight before failing. */
+			__os_kaio_drain(c, reqs, submitted, 0);
+			return (ret);
+		}
+
+	for (done = 0; done < n; done += rc) {
+		if ((rc = syscall(__NR_io_getevents,
+		    c->kaio, n - done, n - done, evs, NULL)) < 0) {
+			if (errno != EINTR) {
+				ret = errno;
+				__os_kaio_drain(c, reqs, n, done);
+				return (ret);
+			}
+			rc = 0;
+		}
+		for (i = 0; i < rc; ++i)
+			reqs[evs[i].data].res = evs[i].res;
+	}
+	return (0);
+}
+
+#define	AIO_ALIGNED(x)	(((uintptr_t)(x) & (AIO_ALIGN - 1)) == 0)
+#endif /* _LINUX_SOURCE */
+
+/*
+ * __os_aio_rw --
+ *	Put a batch of reads or writes in flight together and wait for all of
+ *	them.  Each request's res gets its byte count or -errno.  Returns 0 if
+ *	every request transferred its full length, ENOSYS if no asynchronous
+ *	backend is available, or another error; on any non-zero return the
+ *	caller should redo the batch synchronously.  Nothing is left in
+ *	flight when this returns, whatever the outcome.
+ *
+ * PUBLIC: int __os_aio_rw __P((DB_ENV *, int, DB_AIO_REQ *, int));
+ */
+int
+__os_aio_rw(dbenv, op, reqs, nreqs)
+	DB_ENV *dbenv;
+	int op;
+	DB_AIO_REQ *reqs;
+	int nreqs;
+{
+#ifdef _LINUX_SOURCE
+	struct aio_ctx *c;
+	struct iovec iovs[AIO_QDEPTH];
+	u_int8_t *bp;
+	size_t need;
+	int i, j, n, ret;
+
+	COMPQUIET(dbenv, NULL);
+
+	if ((c = __os_aio_ctx()) == NULL)
+		return (ENOSYS);
+
+	for (i = 0; i < nreqs; i += n) {
+		n = nreqs - i;
+		if (n > AIO_QDEPTH)
+			n = AIO_QDEPTH;
+		if (c->backend == AIO_URING && n > (int)c->sq_entries)
+			n = c->sq_entries;
+
+		/* Size the bounce buffer for unaligned direct requests. */
+		for (need = 0, j = i; j < i + n; ++j) {
+			reqs[j].res = -1;
+			if (F_ISSET(reqs[j].fhp, DB_FH_DIRECT) &&
+			    (!AIO_ALIGNED(reqs[j].buf) ||
+			    !AIO_ALIGNED(reqs[j].len)))
+				need += ALIGN(reqs[j].len, AIO_ALIGN);
+		}
+		if (need > c->bounce_sz) {
+			free(c->bounce);
+			c->bounce_sz = 0;
+			if (posix_memalign(&c->bounce, AIO_ALIGN, need) != 0) {
+				c->bounce = NULL;
+				return (ENOMEM);
+			}
+			c->bounce_sz = need;
+		}
+
+		for (bp = c->bounce, j = i; j < i + n; ++j) {
+			iovs[j - i].iov_base = reqs[j].buf;
+			iovs[j - i].iov_len = reqs[j].len;
+			if (F_ISSET(reqs[j].fhp, DB_FH_DIRECT) &&
+			    (!AIO_ALIGNED(reqs[j].buf) ||
+			    !AIO_ALIGNED(reqs[j].len))) {
+				if (op == DB_IO_WRITE)
+					memcpy(bp, reqs[j].buf, reqs[j].len);
+				iovs[j - i].iov_base = bp;
+				bp += ALIGN(reqs[j].len, AIO_ALIGN);
+			}
+		}
+
+		ret = c->backend == AIO_URING ?
+		    __os_uring_batch(c, op, reqs + i, iovs, n) :
+		    __os_kaio_batch(c, op, reqs + i, iovs, n);
+		if (ret != 0) {
+			logmsg(LOGMSG_ERROR, "batched page %s failed: %s\n",
+			    op == DB_IO_READ ? "read" : "write", strerror(ret));
+			c->broken = 1;
+			return (ret);
+		}
+
+		for (j = i; j < i + n; ++j) {
+			if (reqs[j].res != (ssize_t)reqs[j].len)
+				ret = reqs[j].res < 0 ? -reqs[j].res : EIO;
+			else if (op == DB_IO_READ &&
+			    iovs[j - i].iov_base != reqs[j].buf)
+				memcpy(reqs[j].buf,
+				    iovs[j - i].iov_base, reqs[j].len);
+		}
+		if (ret != 0)
+			return (ret);
+	}
+	return (0);
+#else
+	COMPQUIET(dbenv, NULL);
+	COMPQUIET(op, 0);
+	COMPQUIET(reqs, NULL);
+	COMPQUIET(nreqs, 0);
+	return (ENOSYS);
+#endif
+}
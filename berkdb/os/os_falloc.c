@@ -14,7 +14,9 @@ static const char revid[] = "$Id: os_falloc.c,v 11.32 2014/09/32 12:27:03 bostic
 
 #ifndef NO_SYSTEM_INCLUDES
 #include <sys/types.h>
+#include <sys/stat.h>
 
+#include <errno.h>
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
@@ -59,3 +61,48 @@ __os_fallocate(dbenv, offset, len, fhp)
 
 	return (ret);
 }
+
+/*
+ * __os_punch_hole --
+ *	Give the blocks under [offset, offset + len) of a file back to the
+ *	filesystem; the range reads back as zeros.  If the file ends before
+ *	the range does it is extended first.  Returns 0 if the file covers
+ *	the range afterwards, whether or not a hole could be punched.
+ *
+ * PUBLIC: int __os_punch_hole __P((DB_ENV *, DB_FH *, off_t, off_t));
+ */
+int
+__os_punch_hole(dbenv, fhp, offset, len)
+	DB_ENV *dbenv;
+	DB_FH *fhp;
+	off_t offset, len;
+{
+#ifdef _LINUX_SOURCE
+	struct stat sb;
+
+	COMPQUIET(dbenv, NULL);
+
+	if (len <= 0)
+		return (0);
+
+	/*
+	 * Never ftruncate: another thread may extend the file past us
+	 * between the fstat and the truncate.  fallocate only ever grows it.
+	 */
+	if (fstat(fhp->fd, &sb) == -1)
+		return (__os_get_errno());
+	if (sb.st_size < offset + len &&
+	    syscall(SYS_fallocate, fhp->fd, 0, offset, len) == -1)
+		return (__os_get_errno());
+
+	(void)syscall(SYS_fallocate, fhp->fd,
+	    FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, len);
+	return (0);
+#else
+	COMPQUIET(dbenv, NULL);
+	COMPQUIET(fhp, NULL);
+	COMPQUIET(offset, 0);
+	COMPQUIET(len, 0);
+	return (EOPNOTSUPP);
+#endif
+}
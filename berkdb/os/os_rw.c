@@ -61,6 +61,8 @@ static const char revid[] = "$Id: os_rw.c,v 11.30 2003/05/23 21:19:05 bostic Exp
 static int __os_zerofill __P((DB_ENV *, DB_FH *));
 #endif
 static int __os_physwrite __P((DB_ENV *, DB_FH *, void *, size_t, size_t *));
+static int __os_iov_aio __P((DB_ENV *,
+    int, DB_FH *, db_pgno_t, size_t, u_int8_t **, size_t, size_t *));
 
 /* NOTE: __berkdb_direct_pread/__berkdb_direct_pwrite assume that read/writes
    are always multiples of 512, which is true for all cases in berkeley */
@@ -368,6 +370,10 @@ __berkdb_direct_pread(int fd, void *buf, size_t bufsz, off_t offset)
 
 	pthread_once(&once, init_iobuf);
 
+	/* Read straight into the caller's buffer if O_DIRECT allows it. */
+	if (((uintptr_t)buf & 511) == 0)
+		return pread(fd, buf, bufsz, offset);
+
 	abuf = get_aligned_buffer(buf, bufsz, 0);
 	rc = pread(fd, abuf, bufsz, offset);
 	if (rc > 0 && buf != abuf)
@@ -449,7 +455,8 @@ again:
 
 /*
  * __os_io_partial --
- *	Do a partial page io.  This is used to test recovery page logging.
+ *	Do a partial page io.  This is used to write compressed pages and to
+ *	test recovery page logging.
  *
  * PUBLIC: int __os_io_partial __P((DB_ENV *,
  * PUBLIC:     int, DB_FH *, db_pgno_t, size_t, size_t, u_int8_t *, size_t *));
@@ -1043,6 +1050,115 @@ __berkdb_direct_pwritev(DB_ENV *dbenv,
 }
 #endif
 
+/*
+ * __os_iov_aio --
+ *	Put every page of an __os_iov call in flight at once.
+ */
+static int
+__os_iov_aio(dbenv, op, fhp, pgno, pagesize, bufs, nobufs, niop)
+	DB_ENV *dbenv;
+	int op;
+	DB_FH *fhp;
+	db_pgno_t pgno;
+	size_t pagesize, nobufs, *niop;
+	u_int8_t **bufs;
+{
+	DB_AIO_REQ *reqs;
+	int i, ret, x1, x2;
+
+	*niop = 0;
+	x1 = 0;
+	if ((ret = __os_malloc(dbenv, nobufs * sizeof(DB_AIO_REQ), &reqs)) != 0)
+		return (ret);
+	for (i = 0; i < nobufs; i++) {
+		reqs[i].fhp = fhp;
+		reqs[i].buf = bufs[i];
+		reqs[i].len = pagesize;
+		reqs[i].off = (off_t)(pgno + i) * pagesize;
+	}
+	if (op == DB_IO_READ ? __berkdb_read_alarm_ms : __berkdb_write_alarm_ms)
+		x1 = bb_berkdb_fasttime();
+	ret = __os_aio_rw(dbenv, op, reqs, (int)nobufs);
+	if (ret == ENOSYS)
+		goto done;
+
+	/*
+	 * The pages went out (or were read) even if some failed and the
+	 * caller redoes them synchronously, so count them either way.
+	 */
+	if (op == DB_IO_READ) {
+		if (__berkdb_num_read_ios)
+			(*__berkdb_num_read_ios) += nobufs;
+		if (__berkdb_read_alarm_ms) {
+			x2 = bb_berkdb_fasttime();
+			if (gbl_bb_berkdb_enable_thread_stats) {
+				struct bb_berkdb_thread_stats *p, *t;
+
+				t = bb_berkdb_get_thread_stats();
+				p = bb_berkdb_get_process_stats();
+				p->n_preads++;
+				p->pread_bytes += nobufs * pagesize;
+				p->pread_time_ms += (x2 - x1);
+				t->n_preads++;
+				t->pread_bytes += nobufs * pagesize;
+				t->pread_time_ms += (x2 - x1);
+			}
+			if ((x2 - x1) > __berkdb_read_alarm_ms &&
+			    __berkdb_trace_func) {
+				char s[80];
+
+				snprintf(s, sizeof(s),
+				    "LONG AIO PREAD (%d) %d ms fd %d%s\n",
+				    (int)(nobufs * pagesize), x2 - x1, fhp->fd,
+				    ret ? " failed" : "");
+				__berkdb_trace_func(s);
+			}
+		}
+	} else {
+		if (__berkdb_num_write_ios)
+			(*__berkdb_num_write_ios) += nobufs;
+		if (__berkdb_write_alarm_ms) {
+			x2 = bb_berkdb_fasttime();
+			if (gbl_bb_berkdb_enable_thread_stats) {
+				struct bb_berkdb_thread_stats *p, *t;
+
+				t = bb_berkdb_get_thread_stats();
+				p = bb_berkdb_get_process_stats();
+				p->n_pwrites++;
+				p->pwrite_bytes += nobufs * pagesize;
+				p->pwrite_time_ms += (x2 - x1);
+				t->n_pwrites++;
+				t->pwrite_bytes += nobufs * pagesize;
+				t->pwrite_time_ms += (x2 - x1);
+			}
+			if ((x2 - x1) > __berkdb_write_alarm_ms &&
+			    __berkdb_trace_func) {
+				char s[80];
+
+				snprintf(s, sizeof(s),
+				    "LONG AIO PWRITE (%d) %d ms fd %d%s\n",
+				    (int)(nobufs * pagesize), x2 - x1, fhp->fd,
+				    ret ? " failed" : "");
+				__berkdb_trace_func(s);
+			}
+		}
+	}
+
+	if (ret == 0) {
+		*niop = nobufs * pagesize;
+		if (op == DB_IO_READ) {
+			if (read_callback)
+				read_callback(*niop);
+		} else {
+			if (write_callback)
+				write_callback(*niop);
+		}
+	}
+done:
+	__os_free(dbenv, reqs);
+	return (ret);
+}
+
 /*
  * __os_iov --
  *      Write a vector of data. Useful for skipping mpool buffer headers.
@@ -1085,10 +1201,10 @@ __os_iov(dbenv, op, fhp, pgno, pagesize, bufs, nobufs, niop)
 		}
 	}
 
-	if (!F_ISSET(fhp, DB_FH_DIRECT))
-		goto slow;
 	if (nobufs == 1)
 		goto slow;
+	if (!F_ISSET(fhp, DB_FH_DIRECT) && !dbenv->attr.aio_batch)
+		goto slow;
 
 	if (op == DB_IO_WRITE && dbenv->attr.check_zero_lsn_writes
 	    && (dbenv->open_flags & DB_INIT_TXN)) {
@@ -1122,6 +1238,16 @@ __os_iov(dbenv, op, fhp, pgno, pagesize, bufs, nobufs, niop)
 	DB_ASSERT(F_ISSET(fhp, DB_FH_OPENED) &&
 	    fhp->fd != -1 && DB_GLOBAL(j_read) != NULL);
 
+	if (dbenv->attr.aio_batch) {
+		if (op == DB_IO_WRITE)
+			__checkpoint_verify(dbenv);
+		if (__os_iov_aio(dbenv, op, fhp, pgno, pagesize,
+		    bufs, nobufs, niop) == 0)
+			return (0);
+		if (!F_ISSET(fhp, DB_FH_DIRECT))
+			goto slow;
+	}
+
 	int x1, x2;
 
 	max_bufs = nobufs;
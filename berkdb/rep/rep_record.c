@@ -102,6 +102,12 @@ int64_t gbl_rep_trans_parallel = 0, gbl_rep_trans_serial =
     0, gbl_rep_trans_deadlocked = 0, gbl_rep_trans_inline =
     0, gbl_rep_rowlocks_multifile = 0;
 
+/* Intra-transaction apply: transactions split by page, rounds ended by a
+ * page/file conflict, and records applied (with the time spent) by the
+ * recovery processors. */
+int64_t gbl_rep_trans_page_parallel = 0, gbl_rep_apply_barriers = 0,
+    gbl_rep_apply_records = 0, gbl_rep_apply_usecs = 0;
+
 static inline int wait_for_running_transactions(DB_ENV *dbenv);
 
 #define	IS_SIMPLE(R)	((R) != DB___txn_regop && (R) != DB___txn_xa_regop && \
@@ -2804,6 +2810,43 @@ logical_record_file_affinity(int rectype)
 	}
 }
 
+/* Per-file queueing mode within one round of processor_thd */
+enum { APPLY_FILE = 1, APPLY_PAGE = 2 };
+
+/*
+ * Return the page modified by a record that modifies exactly one page, or
+ * PGNO_INVALID for anything else.  All of these have the page number right
+ * after the fileid; see file_id_for_recovery_record for the layouts.
+ */
+static inline db_pgno_t
+single_page_record_pgno(u_int32_t rectype, DBT *dbt)
+{
+	int off;
+	db_pgno_t pgno;
+
+	switch (rectype) {
+	case DB___bam_adj:
+	case DB___bam_cadjust:
+	case DB___bam_cdel:
+	case DB___bam_repl:
+		off = sizeof(u_int32_t) + sizeof(u_int32_t) + sizeof(DB_LSN) +
+		    sizeof(int32_t);
+		break;
+	case DB___db_addrem:
+		/* opcode comes first */
+		off = sizeof(u_int32_t) + sizeof(u_int32_t) + sizeof(DB_LSN) +
+		    sizeof(u_int32_t) + sizeof(int32_t);
+		break;
+	default:
+		return PGNO_INVALID;
+	}
+
+	if (dbt->size < off + sizeof(db_pgno_t))
+		return PGNO_INVALID;
+	LOGCOPY_32(&pgno, (u_int8_t *)dbt->data + off);
+	return pgno;
+}
+
 #include <stdlib.h>
 
 static void
@@ -2819,7 +2862,10 @@ processor_thd(struct thdpool *pool, void *work, void *thddata, int op)
 	DB_LOGC *logc = NULL;
 	DB_LOCKREQ req, *lvp;
 	DB_ENV *dbenv;
-	int ret, t_ret, last_fileid = -1;
+	int ret, t_ret, last_fileid = -1, last_qidx = 0;
+	int nparts, nmodes = 0, used_pages = 0;
+	u_int8_t *modes = NULL;
+	bbhrtime_t apply_start, apply_end;
 	DB_LSN *lsnp;
 	int j;
 	LISTC_T(struct __recovery_queue) queues;
@@ -2886,152 +2932,210 @@ processor_thd(struct thdpool *pool, void *work, void *thddata, int op)
 	if ((ret = __log_cursor(dbenv, &logc)) != 0)
 		goto err;
 
-	/* First, bucket records per queue. */
+	/*
+	 * Bucket records per queue.  A queue normally holds every record for
+	 * one file.  With rep_apply_page_partitions set, records that modify
+	 * a single page are instead spread over that many queues per file by
+	 * page number; records for the same page land in the same queue, so
+	 * they still apply in LSN order.  A record that may touch several
+	 * pages (a split, an allocation, ...) needs its file queued whole.
+	 * Within a round a file is queued one way or the other; a record that
+	 * wants the other way ends the round: we dispatch what we have, wait
+	 * for it, and start bucketing again from that record.
+	 */
 	data_dbt.flags = DB_DBT_REALLOC;
 
-	for (i = 0; i < rp->lc.nlsns; i++) {
-		int fileid;
-		u_int32_t rectype;
+	nparts = dbenv->attr.rep_apply_page_partitions;
+	if (nparts <= 1)
+		nparts = 0;
+	getbbhrtime(&apply_start);
 
-		lsnp = &rp->lc.array[i].lsn;
+	i = 0;
+	while (i < rp->lc.nlsns) {
+		for (; i < rp->lc.nlsns; i++) {
+			int fileid, qidx, mode;
+			u_int32_t rectype;
+			db_pgno_t pgno = PGNO_INVALID;
+			DBT *dbt;
 
-		if (rp->lc.array[i].rec.data == NULL) {
-			assert(!rp->lc.filled_from_cache);
-			if ((ret =
-				__log_c_get(logc, lsnp, &data_dbt,
-				    DB_SET)) != 0) {
-				__db_err(dbenv,
-				    "failed to read the log at [%lu][%lu]",
-				    (u_long)lsnp->file, (u_long)lsnp->offset);
-				goto err;
+			lsnp = &rp->lc.array[i].lsn;
+
+			if (rp->lc.array[i].rec.data == NULL) {
+				assert(!rp->lc.filled_from_cache);
+				if ((ret =
+					__log_c_get(logc, lsnp, &data_dbt,
+					    DB_SET)) != 0) {
+					__db_err(dbenv,
+					    "failed to read the log at [%lu][%lu]",
+					    (u_long)lsnp->file, (u_long)lsnp->offset);
+					goto err;
+				}
+				dbt = &data_dbt;
+			} else {
+				dbt = &rp->lc.array[i].rec;
 			}
-			LOGCOPY_32(&rectype, data_dbt.data);
+			LOGCOPY_32(&rectype, dbt->data);
 			fileid =
-			    (int)file_id_for_recovery_record(dbenv, NULL,
-			    rectype, &data_dbt);
-		} else {
-			LOGCOPY_32(&rectype, rp->lc.array[i].rec.data);
-			fileid =
-			    (int)file_id_for_recovery_record(dbenv, NULL,
-			    rectype, &rp->lc.array[i].rec);
-		}
+			    (int)file_id_for_recovery_record(dbenv, NULL, rectype,
+			    dbt);
 
-		if (fileid >= 0) {
-			last_fileid = fileid;
-		}
-		/* Logical follows physical: they should have the same fileid */
-		if (fileid == -1 && logical_record_file_affinity(rectype)) {
-			fileid = last_fileid;
-		}
+			if (fileid >= 0) {
+				last_fileid = fileid;
+				if (nparts)
+					pgno = single_page_record_pgno(rectype, dbt);
+			}
+			/* Logical follows physical: they should have the same fileid */
+			if (fileid == -1 && logical_record_file_affinity(rectype)) {
+				fileid = last_fileid;
+			}
 
-		/* If there is no fileid, or if this is a start or commit put in fileid 0  */
-		if (-1 == fileid || logical_start_commit(rectype)) {
-			fileid = 0;
-		}
+			/* If there is no fileid, or if this is a start or commit put in fileid 0  */
+			if (-1 == fileid || logical_start_commit(rectype)) {
+				fileid = 0;
+			}
 
-		if (fileid >= rp->num_fileids) {
-			rp->recovery_queues =
-			    realloc(rp->recovery_queues,
-			    (fileid + 1) * sizeof(struct __recovery_queue *));
-			for (j = rp->num_fileids; j <= fileid; j++) {
-				rp->recovery_queues[j] = NULL;
+			if (!nparts) {
+				qidx = fileid;
+			} else if (fileid == last_fileid && fileid != 0 &&
+			    pgno == PGNO_INVALID &&
+			    logical_record_file_affinity(rectype)) {
+				/* ... and the same queue */
+				qidx = last_qidx;
+			} else {
+				if (fileid >= nmodes) {
+					modes = realloc(modes, (fileid + 1));
+					memset(modes + nmodes, 0, fileid + 1 - nmodes);
+					nmodes = fileid + 1;
+				}
+				mode = (pgno == PGNO_INVALID || fileid == 0) ?
+				    APPLY_FILE : APPLY_PAGE;
+				if (modes[fileid] != 0 && modes[fileid] != mode)
+					break;
+				modes[fileid] = mode;
+				qidx = fileid * (nparts + 1);
+				if (mode == APPLY_PAGE) {
+					qidx += 1 + (pgno % nparts);
+					used_pages = 1;
+				}
+			}
+			last_qidx = qidx;
+
+			if (qidx >= rp->num_fileids) {
+				rp->recovery_queues =
+				    realloc(rp->recovery_queues,
+				    (qidx + 1) * sizeof(struct __recovery_queue *));
+				for (j = rp->num_fileids; j <= qidx; j++) {
+					rp->recovery_queues[j] = NULL;
+				}
+				rp->num_fileids = qidx + 1;
+			}
+			if (rp->recovery_queues[qidx] == NULL) {
+				rp->recovery_queues[qidx] =
+				    malloc(sizeof(struct __recovery_queue));
+				rp->recovery_queues[qidx]->fileid = qidx;
+				rp->recovery_queues[qidx]->processor = rp;
+				rp->recovery_queues[qidx]->used = 0;
+				listc_init(&rp->recovery_queues[qidx]->records,
+				    offsetof(struct __recovery_record, lnk));
+			}
+			if (!rp->recovery_queues[qidx]->used) {
+				rp->recovery_queues[qidx]->used = 1;
+				rp->num_busy_workers++;
+				listc_abl(&queues, rp->recovery_queues[qidx]);
 			}
-			rp->num_fileids = fileid + 1;
-		}
-		if (rp->recovery_queues[fileid] == NULL) {
-			rp->recovery_queues[fileid] =
-			    malloc(sizeof(struct __recovery_queue));
-			rp->recovery_queues[fileid]->fileid = fileid;
-			rp->recovery_queues[fileid]->processor = rp;
-			rp->recovery_queues[fileid]->used = 0;
-			listc_init(&rp->recovery_queues[fileid]->records,
-			    offsetof(struct __recovery_record, lnk));
-		}
-		if (!rp->recovery_queues[fileid]->used) {
-			rp->recovery_queues[fileid]->used = 1;
-			rp->num_busy_workers++;
-			listc_abl(&queues, rp->recovery_queues[fileid]);
-		}
-
-		rr = pool_getablk(rp->recpool);
-		if (rp->lc.array[i].rec.data)
-			rr->logdbt = rp->lc.array[i].rec;
-		else
-			rr->logdbt.data = NULL;
-		rr->lsn = *lsnp;
-		rr->fileid = fileid;
 
-		listc_abl(&rp->recovery_queues[fileid]->records, rr);
-	}
+			rr = pool_getablk(rp->recpool);
+			if (rp->lc.array[i].rec.data)
+				rr->logdbt = rp->lc.array[i].rec;
+			else
+				rr->logdbt.data = NULL;
+			rr->lsn = *lsnp;
+			rr->fileid = fileid;
 
-	if ((dbenv->flags & DB_ENV_ROWLOCKS) && listc_size(&queues) > 1) {
-		gbl_rep_rowlocks_multifile++;
-	}
+			listc_abl(&rp->recovery_queues[qidx]->records, rr);
+		}
 
-	/* Handle inline. */
-	if (listc_size(&queues) <= 1) {
-		inline_worker = 1;
-		rq = listc_rtl(&queues);
+		if ((dbenv->flags & DB_ENV_ROWLOCKS) && listc_size(&queues) > 1) {
+			gbl_rep_rowlocks_multifile++;
+		}
 
-		while (rq) {
-			rq->used = 0;
-			gbl_rep_trans_inline++;
-			worker_thd(NULL, rq, NULL, -1);
+		/* Handle inline. */
+		if (listc_size(&queues) <= 1) {
+			inline_worker = 1;
 			rq = listc_rtl(&queues);
-		}
-	}
-	/* Assign to workers */
-	else {
-		inline_worker = 0;
-		rq = listc_rtl(&queues);
 
-		while (rq) {
-			if (rp->recovery_queues[rq->fileid] == NULL) {
-				logmsg(LOGMSG_FATAL, "NO QUEUE at fileid %d???\n",
-				    rq->fileid);
-				abort();
+			while (rq) {
+				rq->used = 0;
+				gbl_rep_trans_inline++;
+				worker_thd(NULL, rq, NULL, -1);
+				rq = listc_rtl(&queues);
 			}
-			rq->used = 0;
-			thdpool_enqueue(dbenv->recovery_workers, worker_thd, rq,
-			    0, NULL);
+		}
+		/* Assign to workers */
+		else {
+			inline_worker = 0;
 			rq = listc_rtl(&queues);
+
+			while (rq) {
+				if (rp->recovery_queues[rq->fileid] == NULL) {
+					logmsg(LOGMSG_FATAL, "NO QUEUE at fileid %d???\n",
+					    rq->fileid);
+					abort();
+				}
+				rq->used = 0;
+				thdpool_enqueue(dbenv->recovery_workers, worker_thd, rq,
+				    0, NULL);
+				rq = listc_rtl(&queues);
+			}
 		}
-	}
 
-	/* Wait for worker threads to finish */
-	if (!inline_worker) {
-		pthread_mutex_lock(&rp->lk);
-		int lastpr = 0, pollus =
-		    dbenv->attr.recovery_processor_poll_interval_us;
-		if (pollus <= 0)
-			pollus = 1000;
+		/* Wait for worker threads to finish */
+		if (!inline_worker) {
+			pthread_mutex_lock(&rp->lk);
+			int lastpr = 0, pollus =
+			    dbenv->attr.recovery_processor_poll_interval_us;
+			if (pollus <= 0)
+				pollus = 1000;
 
-		while (rp->num_busy_workers) {
-			int rc;
-			struct timespec ts;
+			while (rp->num_busy_workers) {
+				int rc;
+				struct timespec ts;
 
-			clock_gettime(CLOCK_REALTIME, &ts);
-			if (!lastpr)
-				lastpr = ts.tv_sec + 1;
+				clock_gettime(CLOCK_REALTIME, &ts);
+				if (!lastpr)
+					lastpr = ts.tv_sec + 1;
 
-			/* This should stay small:  All workers could finish before the cond_timedwait. */
-			ts.tv_nsec += (1000 * pollus);
-			if (ts.tv_nsec > 1000000000) {
-				ts.tv_nsec %= 1000000000;
-				ts.tv_sec++;
-			}
+				/* This should stay small:  All workers could finish before the cond_timedwait. */
+				ts.tv_nsec += (1000 * pollus);
+				if (ts.tv_nsec > 1000000000) {
+					ts.tv_nsec %= 1000000000;
+					ts.tv_sec++;
+				}
 
-			rc = pthread_cond_timedwait(&rp->wait, &rp->lk, &ts);
-			if (rp->num_busy_workers && rc == ETIMEDOUT &&
-			    ts.tv_sec > lastpr) {
-				logmsg(LOGMSG_WARN, "waiting for %d workers\n",
-				    rp->num_busy_workers);
-				lastpr = ts.tv_sec;
+				rc = pthread_cond_timedwait(&rp->wait, &rp->lk, &ts);
+				if (rp->num_busy_workers && rc == ETIMEDOUT &&
+				    ts.tv_sec > lastpr) {
+					logmsg(LOGMSG_WARN, "waiting for %d workers\n",
+					    rp->num_busy_workers);
+					lastpr = ts.tv_sec;
+				}
 			}
+			pthread_mutex_unlock(&rp->lk);
+		}
+
+		/* Stopped on a conflict: everything before it is applied. */
+		if (i < rp->lc.nlsns) {
+			memset(modes, 0, nmodes);
+			gbl_rep_apply_barriers++;
 		}
-		pthread_mutex_unlock(&rp->lk);
 	}
 
+	if (used_pages)
+		gbl_rep_trans_page_parallel++;
+	gbl_rep_apply_records += rp->lc.nlsns;
+	getbbhrtime(&apply_end);
+	gbl_rep_apply_usecs +=
+	    (bbhrtimens(&apply_end) - bbhrtimens(&apply_start)) / 1000;
 
 #if 0
 	{
@@ -3122,6 +3226,9 @@ err:
 	if (data_dbt.data)
 		free(data_dbt.data);
 
+	if (modes)
+		free(modes);
+
 	if (logc != NULL && (t_ret = __log_c_close(logc)) != 0 && ret == 0)
 		ret = t_ret;
 
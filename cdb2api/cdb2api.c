@@ -57,6 +57,7 @@ static int MIN_RETRIES = 3;
 static int CDB2_CONNECT_TIMEOUT = 100;
 static int COMDB2DB_TIMEOUT = 500;
 static int cdb2_tcpbufsz = 0;
+static int CDB2_MAX_ASYNC = 64; /* Statements in flight per handle. */
 
 #ifndef WITH_SSL
 #  define WITH_SSL 1
@@ -555,10 +556,33 @@ typedef struct cdb2_query_list_item {
     void *buf;
     int len;
     int is_read;
+    int has_bindrows; /* needs a server that runs bindrows */
     char *sql;
     struct cdb2_query_list_item *next;
 } cdb2_query_list;
 
+/* A statement sent by cdb2_run_statement_async and not yet picked up by
+ * cdb2_poll.  The packed query is kept so that it can be resent if the
+ * connection drops before its result arrives. */
+typedef struct cdb2_async_item {
+    void *buf;
+    int len;
+    int seq;
+    int is_read;
+    int sent;
+    int lost; /* connection dropped after sending a write, may have run */
+    struct cdb2_async_item *next;
+} cdb2_async_item;
+
+/* A column of values bound with cdb2_bind_array.  It is expanded into one
+ * bindvalue per row when the query is packed. */
+typedef struct cdb2_bind_array_item {
+    const char *varname;
+    int type;
+    const void *varaddr;
+    int typelen;
+} cdb2_bind_array_item;
+
 #if WITH_SSL
 typedef struct cdb2_ssl_sess {
     char host[64];
@@ -617,6 +641,10 @@ struct cdb2_hndl {
     int client_side_error;
     int n_bindvars;
     CDB2SQLQUERY__Bindvalue **bindvars;
+    int n_bindarrays;
+    cdb2_bind_array_item *bindarrays;
+    int bindrows; /* length of every bound array */
+    int server_bindrows; /* the connected server runs bindrows */
     cdb2_query_list *query_list;
     int snapshot_file;
     int snapshot_offset;
@@ -635,6 +663,10 @@ struct cdb2_hndl {
     int debug_trace;
     int max_retries;
     int min_retries;
+    cdb2_async_item *async_head; /* oldest statement without a result */
+    cdb2_async_item *async_tail;
+    int num_async;
+    int async_seq;
 #if WITH_SSL
     ssl_mode c_sslmode; /* client SSL mode */
     peer_ssl_mode s_sslmode; /* server SSL mode */
@@ -833,6 +865,10 @@ static void read_comdb2db_cfg(cdb2_hndl_tp *hndl, FILE *fp, char *comdb2db_name,
                 tok = strtok_r(NULL, " :,", &last);
                 if (tok)
                     cdb2_tcpbufsz = atoi(tok);
+            } else if (strcasecmp("max_async", tok) == 0) {
+                tok = strtok_r(NULL, " :,", &last);
+                if (tok && atoi(tok) > 0)
+                    CDB2_MAX_ASYNC = atoi(tok);
             } else if (strcasecmp("dnssufix", tok) == 0) {
                 tok = strtok_r(NULL, " :,", &last);
                 if (tok)
@@ -1486,6 +1522,7 @@ retry_newsql_connect:
     sbuf2settimeout(sb, 5000, 5000);
     hndl->sb = sb;
     hndl->num_set_commands_sent = 0;
+    hndl->server_bindrows = 0; /* learned from its first response */
     return 0;
 }
 
@@ -1501,7 +1538,9 @@ static int newsql_disconnect(cdb2_hndl_tp *hndl, SBUF2 *sb, int line)
     int fd = sbuf2fileno(sb);
 
     int timeoutms = 10 * 1000;
-    if ((hndl->firstresponse &&
+    /* Don't hand a socket with unread results to the next user. */
+    if (hndl->async_head ||
+        (hndl->firstresponse &&
          (!hndl->lastresponse ||
           (hndl->lastresponse->response_type != RESPONSE_TYPE__LAST_ROW))) ||
         (!hndl->firstresponse)) {
@@ -1909,18 +1948,79 @@ static int cdb2_hostid()
     return MACHINE_ID;
 }
 
-static int cdb2_send_query(cdb2_hndl_tp *hndl, SBUF2 *sb, char *dbname,
-                           char *sql, int n_set_commands,
-                           int n_set_commands_sent, char **set_commands,
-                           int n_bindvars, CDB2SQLQUERY__Bindvalue **bindvars,
-                           int ntypes, int *types, int is_begin, int skip_nrows,
-                           int retries_done, int do_append, int fromline)
+/* Lay out the bound arrays, and any scalar bindings, as bindrows rows of
+ * parameters back to back.  The pointers and the bindvalues they point to
+ * come from a single allocation. */
+static CDB2SQLQUERY__Bindvalue **cdb2_bind_rows(cdb2_hndl_tp *hndl,
+                                                size_t *nvars)
+{
+    int ncols = hndl->n_bindvars + hndl->n_bindarrays;
+    int nrows = hndl->bindrows;
+    CDB2SQLQUERY__Bindvalue **vars;
+    CDB2SQLQUERY__Bindvalue *vals;
+    int row, col;
+
+    vars = malloc((sizeof(*vars) + sizeof(*vals)) * nrows * hndl->n_bindarrays +
+                  sizeof(*vars) * nrows * hndl->n_bindvars);
+    vals = (CDB2SQLQUERY__Bindvalue *)(vars + nrows * ncols);
+
+    for (row = 0; row < nrows; row++) {
+        for (col = 0; col < hndl->n_bindvars; col++)
+            vars[row * ncols + col] = hndl->bindvars[col];
+        for (col = 0; col < hndl->n_bindarrays; col++) {
+            cdb2_bind_array_item *arr = &hndl->bindarrays[col];
+            CDB2SQLQUERY__Bindvalue *val = vals++;
+            const void *data;
+            int len;
+
+            cdb2__sqlquery__bindvalue__init(val);
+            val->type = arr->type;
+            val->varname = (char *)arr->varname;
+            if (arr->type == CDB2_CSTRING || arr->type == CDB2_BLOB) {
+                data = ((const void **)arr->varaddr)[row];
+                len = (data && arr->type == CDB2_CSTRING) ? strlen(data)
+                                                          : arr->typelen;
+            } else {
+                data = (const char *)arr->varaddr + row * arr->typelen;
+                len = arr->typelen;
+            }
+
+            if (data == NULL) {
+                val->has_isnull = 1;
+                val->isnull = 1;
+            } else if (arr->type == CDB2_CSTRING && len == 0) {
+                val->value.data = (unsigned char *)"";
+                val->value.len = 1;
+            } else if (arr->type == CDB2_BLOB && len == 0) {
+                val->value.data = (unsigned char *)"";
+                val->has_isnull = 1;
+                val->isnull = 0;
+            } else {
+                val->value.data = (void *)data;
+                val->value.len = len;
+            }
+            vars[row * ncols + hndl->n_bindvars + col] = val;
+        }
+    }
+
+    *nvars = nrows * ncols;
+    return vars;
+}
+
+static unsigned char *
+cdb2_pack_query(cdb2_hndl_tp *hndl, char *dbname, char *sql,
+                int n_set_commands, int n_set_commands_sent,
+                char **set_commands, int n_bindvars,
+                CDB2SQLQUERY__Bindvalue **bindvars, int ntypes, int *types,
+                int is_begin, int skip_nrows, int retries_done, int do_append,
+                int pipeline, int fromline, int *lenp)
 {
     int n_features = 0;
     int features[10]; // Max 10 client features??
     CDB2QUERY query = CDB2__QUERY__INIT;
     CDB2SQLQUERY sqlquery = CDB2__SQLQUERY__INIT;
     CDB2SQLQUERY__Cinfo cinfo = CDB2__SQLQUERY__CINFO__INIT;
+    CDB2SQLQUERY__Bindvalue **rowvars = NULL;
 
     cinfo.pid = getpid();
     cinfo.th_id = pthread_self();
@@ -1938,6 +2038,13 @@ static int cdb2_send_query(cdb2_hndl_tp *hndl, SBUF2 *sb, char *dbname,
 
     sqlquery.n_bindvars = n_bindvars;
     sqlquery.bindvars = bindvars;
+    if (hndl && hndl->n_bindarrays && bindvars == hndl->bindvars &&
+        !is_begin) {
+        rowvars = cdb2_bind_rows(hndl, &sqlquery.n_bindvars);
+        sqlquery.bindvars = rowvars;
+        sqlquery.has_bindrows = 1;
+        sqlquery.bindrows = hndl->bindrows;
+    }
     sqlquery.n_types = ntypes;
     sqlquery.types = types;
 
@@ -1997,6 +2104,12 @@ static int cdb2_send_query(cdb2_hndl_tp *hndl, SBUF2 *sb, char *dbname,
             features[n_features] = CDB2_CLIENT_FEATURES__ALLOW_MASTER_EXEC;
             n_features++;
         }
+        if (pipeline) {
+            features[n_features] = CDB2_CLIENT_FEATURES__PIPELINE;
+            n_features++;
+        }
+        features[n_features] = CDB2_CLIENT_FEATURES__BINDROWS;
+        n_features++;
     }
 
     if (hndl &&
@@ -2028,7 +2141,14 @@ static int cdb2_send_query(cdb2_hndl_tp *hndl, SBUF2 *sb, char *dbname,
     unsigned char *buf = malloc(len + 1);
 
     cdb2__query__pack(&query, buf);
+    free(rowvars);
 
+    *lenp = len;
+    return buf;
+}
+
+static void cdb2_write_query(SBUF2 *sb, const unsigned char *buf, int len)
+{
     struct newsqlheader hdr;
 
     hdr.type = ntohl(CDB2_REQUEST_TYPE__CDB2QUERY);
@@ -2037,6 +2157,26 @@ static int cdb2_send_query(cdb2_hndl_tp *hndl, SBUF2 *sb, char *dbname,
 
     sbuf2write((char *)&hdr, sizeof(hdr), sb);
     sbuf2write((char *)buf, len, sb);
+}
+
+static int cdb2_send_query(cdb2_hndl_tp *hndl, SBUF2 *sb, char *dbname,
+                           char *sql, int n_set_commands,
+                           int n_set_commands_sent, char **set_commands,
+                           int n_bindvars, CDB2SQLQUERY__Bindvalue **bindvars,
+                           int ntypes, int *types, int is_begin, int skip_nrows,
+                           int retries_done, int do_append, int fromline)
+{
+    int len;
+    unsigned char *buf;
+
+    while (isspace(*sql))
+        sql++;
+
+    buf = cdb2_pack_query(hndl, dbname, sql, n_set_commands,
+                          n_set_commands_sent, set_commands, n_bindvars,
+                          bindvars, ntypes, types, is_begin, skip_nrows,
+                          retries_done, do_append, 0, fromline, &len);
+    cdb2_write_query(sb, buf, len);
 
     int rc = sbuf2flush(sb);
 
@@ -2049,6 +2189,8 @@ static int cdb2_send_query(cdb2_hndl_tp *hndl, SBUF2 *sb, char *dbname,
         item->buf = buf;
         item->len = len;
         item->is_read = hndl->is_read;
+        item->has_bindrows =
+            hndl->n_bindarrays && bindvars == hndl->bindvars && !is_begin;
         item->next = NULL;
         item->sql = strdup(sql);
         cdb2_query_list *last = hndl->query_list;
@@ -2084,6 +2226,7 @@ static int is_retryable(cdb2_hndl_tp *hndl, int err_val)
 
 static int retry_queries_and_skip(cdb2_hndl_tp *hndl, int num_retry,
                                   int skip_nrows);
+static void cdb2_free_async(cdb2_hndl_tp *hndl);
 
 #define PRINT_RETURN(rcode)                                                    \
     {                                                                          \
@@ -2223,9 +2366,12 @@ retry_next_record:
             hndl->num_set_commands_sent = hndl->num_set_commands;
         }
         for (ii = 0; ii < hndl->lastresponse->n_features; ii++) {
-            if (hndl->in_trans && CDB2_SERVER_FEATURES__SKIP_ROWS &&
-                hndl->lastresponse->features[ii])
+            if (hndl->in_trans && CDB2_SERVER_FEATURES__SKIP_ROWS ==
+                                      hndl->lastresponse->features[ii])
                 hndl->skip_feature = 1;
+            else if (CDB2_SERVER_FEATURES__BINDROWS ==
+                     hndl->lastresponse->features[ii])
+                hndl->server_bindrows = 1;
         }
 
         PRINT_RETURN_OK(CDB2_OK_DONE);
@@ -2346,6 +2492,8 @@ int cdb2_close(cdb2_hndl_tp *hndl)
     if (hndl->sb)
         newsql_disconnect(hndl, hndl->sb, __LINE__);
 
+    cdb2_free_async(hndl);
+
     if (hndl->firstresponse) {
         cdb2__sqlresponse__free_unpacked(hndl->firstresponse, NULL);
         free((void *)hndl->first_buf);
@@ -2662,6 +2810,15 @@ static int retry_queries(cdb2_hndl_tp *hndl, int num_retry, int run_last)
             if (run_last == 0 && item->next == NULL)
                 break;
 
+            /* the begin above told us whether this server runs bindrows;
+               one that doesn't would lose all but the first row */
+            if (item->has_bindrows && !hndl->server_bindrows) {
+                sprintf(hndl->errstr, "%s: the server doesn't support "
+                                      "cdb2_bind_array",
+                        __func__);
+                return CDB2ERR_TRAN_IO_ERROR;
+            }
+
             struct newsqlheader hdr;
             hdr.type = ntohl(CDB2_REQUEST_TYPE__CDB2QUERY);
             hdr.compression = ntohl(0);
@@ -2762,6 +2919,10 @@ static int retry_queries_and_skip(cdb2_hndl_tp *hndl, int num_retry,
     }
     hndl->is_retry = num_retry;
 
+    /* nothing has told us yet whether the new node runs bindrows */
+    if (hndl->n_bindarrays && !hndl->server_bindrows)
+        return -1;
+
     rc = cdb2_send_query(hndl, hndl->sb, hndl->dbname, hndl->sql,
                          hndl->num_set_commands, hndl->num_set_commands_sent,
                          hndl->commands, hndl->n_bindvars, hndl->bindvars,
@@ -2859,6 +3020,34 @@ static void clear_snapshot_info(cdb2_hndl_tp *hndl, int line)
     hndl->snapshot_offset = 0;
 }
 
+/* The master rejected the query and sent info about nodes that might be
+ * coherent: disconnect and use those from now on. */
+static void cdb2_redirect_from_master(cdb2_hndl_tp *hndl, int len)
+{
+    newsql_disconnect(hndl, hndl->sb, __LINE__);
+    CDB2DBINFORESPONSE *dbinfo_response = NULL;
+    dbinfo_response = cdb2__dbinforesponse__unpack(NULL, len, hndl->first_buf);
+    parse_dbresponse(dbinfo_response, hndl->hosts, hndl->ports, &hndl->master,
+                     &hndl->num_hosts, &hndl->num_hosts_sameroom
+#if WITH_SSL
+                     , &hndl->s_sslmode
+#endif
+                     );
+    cdb2__dbinforesponse__free_unpacked(dbinfo_response, NULL);
+    hndl->connected_host = -1;
+
+#if WITH_SSL
+    /* Clear cached SSL sessions - Hosts may have changed. */
+    if (hndl->sess_list != NULL) {
+        cdb2_ssl_sess_list *sl = hndl->sess_list;
+        for (int i = 0; i != sl->n; ++i)
+            SSL_SESSION_free(sl->list[i].sess);
+        free(sl->list);
+        sl->list = NULL;
+    }
+#endif
+}
+
 static int cdb2_run_statement_typed_int(cdb2_hndl_tp *hndl, const char *sql,
                                         int ntypes, int *types, int line)
 {
@@ -3142,6 +3331,15 @@ retry_queries:
         }
     }
 
+    /* A server that doesn't know bindrows would run the statement once, with
+       the first row's values, and report success */
+    if (hndl->n_bindarrays && !is_begin && !is_commit && !is_rollback &&
+        !hndl->server_bindrows) {
+        sprintf(hndl->errstr,
+                "%s: the server doesn't support cdb2_bind_array", __func__);
+        PRINT_RETURN(CDB2ERR_NOTSUPPORTED);
+    }
+
     hndl->sql = (char *)sql;
     hndl->ntypes = ntypes;
     hndl->types = types;
@@ -3252,37 +3450,12 @@ read_record:
 
     /* Dbinfo .. go to new node */
     if (type == RESPONSE_HEADER__DBINFO_RESPONSE) {
-        /* The master sent info about nodes that might be coherent. */
-        newsql_disconnect(hndl, hndl->sb, __LINE__);
-        CDB2DBINFORESPONSE *dbinfo_response = NULL;
-        dbinfo_response =
-            cdb2__dbinforesponse__unpack(NULL, len, hndl->first_buf);
-        parse_dbresponse(dbinfo_response, hndl->hosts, hndl->ports,
-                         &hndl->master, &hndl->num_hosts,
-                         &hndl->num_hosts_sameroom
-#if WITH_SSL
-                         , &hndl->s_sslmode
-#endif
-                         );
-        cdb2__dbinforesponse__free_unpacked(dbinfo_response, NULL);
+        cdb2_redirect_from_master(hndl, len);
         hndl->retry_all = 1;
-        hndl->connected_host = -1;
         if (hndl->debug_trace) {
             fprintf(stderr, "td %u %s line %d goto retry_queries\n", (uint32_t)
                     pthread_self(), __func__, __LINE__);
         }
-
-#if WITH_SSL
-        /* Clear cached SSL sessions - Hosts may have changed. */
-        if (hndl->sess_list != NULL) {
-            cdb2_ssl_sess_list *sl = hndl->sess_list;
-            for (int i = 0; i != sl->n; ++i)
-                SSL_SESSION_free(sl->list[i].sess);
-            free(sl->list);
-            sl->list = NULL;
-        }
-#endif
-
         goto retry_queries;
     }
 
@@ -3628,6 +3801,33 @@ static char *cdb2_type_str(int type)
     }
 }
 
+/* Find out whether the server on this connection can run a statement once
+ * per row of bound arrays, if nothing has told us yet.  Every response from
+ * one that can says so, so this is only needed on a fresh connection. */
+static int cdb2_probe_bindrows(cdb2_hndl_tp *hndl)
+{
+    int n_bindvars = hndl->n_bindvars;
+    int n_bindarrays = hndl->n_bindarrays;
+    int rc;
+
+    hndl->n_bindvars = 0;
+    hndl->n_bindarrays = 0;
+    rc = cdb2_run_statement_typed_int(hndl, "select 1", 0, NULL, __LINE__);
+    while (rc == CDB2_OK)
+        rc = cdb2_next_record_int(hndl, 0);
+    hndl->n_bindvars = n_bindvars;
+    hndl->n_bindarrays = n_bindarrays;
+    if (rc != CDB2_OK_DONE)
+        return rc;
+
+    if (!hndl->server_bindrows) {
+        sprintf(hndl->errstr,
+                "%s: the server doesn't support cdb2_bind_array", __func__);
+        return CDB2ERR_NOTSUPPORTED;
+    }
+    return 0;
+}
+
 int cdb2_run_statement_typed(cdb2_hndl_tp *hndl, const char *sql, int ntypes,
                              int *types)
 {
@@ -3635,6 +3835,12 @@ int cdb2_run_statement_typed(cdb2_hndl_tp *hndl, const char *sql, int ntypes,
 
     pthread_once(&init_once, do_init_once);
 
+    if (hndl->async_head) {
+        sprintf(hndl->errstr, "%s: Poll for the results of pipelined "
+                              "statements first.", __func__);
+        return CDB2ERR_BADSTATE;
+    }
+
     if (hndl->temp_trans && hndl->in_trans) {
         cdb2_run_statement_typed_int(hndl, "rollback", 0, NULL, __LINE__);
     }
@@ -3652,6 +3858,18 @@ int cdb2_run_statement_typed(cdb2_hndl_tp *hndl, const char *sql, int ntypes,
         hndl->temp_trans = 1;
     }
 
+    if (hndl->n_bindarrays && !hndl->server_bindrows) {
+        rc = cdb2_probe_bindrows(hndl);
+        if (rc != 0) {
+            if (hndl->temp_trans) {
+                cdb2_run_statement_typed_int(hndl, "rollback", 0, NULL,
+                                             __LINE__);
+                hndl->temp_trans = 0;
+            }
+            return rc;
+        }
+    }
+
     rc = cdb2_run_statement_typed_int(hndl, sql, ntypes, types, __LINE__);
 
     // XXX This code does not work correctly for WITH statements
@@ -3683,6 +3901,290 @@ int cdb2_run_statement_typed(cdb2_hndl_tp *hndl, const char *sql, int ntypes,
     return rc;
 }
 
+static void cdb2_free_async(cdb2_hndl_tp *hndl)
+{
+    cdb2_async_item *item = hndl->async_head;
+    while (item != NULL) {
+        cdb2_async_item *ditem = item;
+        item = item->next;
+        free(ditem->buf);
+        free(ditem);
+    }
+    hndl->async_head = NULL;
+    hndl->async_tail = NULL;
+    hndl->num_async = 0;
+}
+
+static void cdb2_pop_async(cdb2_hndl_tp *hndl, int *seq)
+{
+    cdb2_async_item *item = hndl->async_head;
+    if (seq)
+        *seq = item->seq;
+    hndl->async_head = item->next;
+    if (hndl->async_head == NULL)
+        hndl->async_tail = NULL;
+    hndl->num_async--;
+    free(item->buf);
+    free(item);
+}
+
+/* Reconnect and send the statements that are still waiting for a result.
+ * The server runs pipelined statements whether or not we read their
+ * results, so any write that went out on the old connection, including the
+ * one we were waiting for, may have run: those are not resent but reported
+ * lost, the same way a dropped commit can't be retried. */
+static int cdb2_resend_async(cdb2_hndl_tp *hndl)
+{
+    cdb2_async_item *item;
+    int first = 1;
+
+    cdb2_connect_sqlhost(hndl);
+    if (hndl->sb == NULL)
+        return -1;
+
+    for (item = hndl->async_head; item != NULL; item = item->next) {
+        if (item->lost)
+            continue;
+        if (item->sent && !item->is_read) {
+            item->lost = 1;
+            continue;
+        }
+
+        /* A new connection needs the set commands again, once. */
+        CDB2QUERY *query = cdb2__query__unpack(NULL, item->len, item->buf);
+        if (query == NULL)
+            return -1;
+        CDB2SQLQUERY *sqlquery = query->sqlquery;
+        size_t n_set_flags = sqlquery->n_set_flags;
+        char **set_flags = sqlquery->set_flags;
+        sqlquery->n_set_flags = first ? hndl->num_set_commands : 0;
+        sqlquery->set_flags = hndl->commands;
+        int len = cdb2__query__get_packed_size(query);
+        unsigned char *buf = malloc(len + 1);
+        cdb2__query__pack(query, buf);
+        sqlquery->n_set_flags = n_set_flags;
+        sqlquery->set_flags = set_flags;
+        cdb2__query__free_unpacked(query, NULL);
+
+        free(item->buf);
+        item->buf = buf;
+        item->len = len;
+        cdb2_write_query(hndl->sb, buf, len);
+        item->sent = 1;
+        first = 0;
+    }
+    hndl->num_set_commands_sent = hndl->num_set_commands;
+    return 0;
+}
+
+int cdb2_run_statement_async(cdb2_hndl_tp *hndl, const char *sql, int *seq)
+{
+    cdb2_async_item *item;
+    int rc = 0;
+
+    pthread_once(&init_once, do_init_once);
+
+    while (sql && isspace(*sql))
+        sql++;
+
+    if (sql == NULL) {
+        rc = CDB2ERR_NOSTATEMENT;
+        goto done;
+    }
+
+    if (hndl->in_trans || hndl->is_hasql) {
+        sprintf(hndl->errstr, "%s: Can't pipeline statements in a "
+                              "transaction or with hasql on.", __func__);
+        rc = CDB2ERR_BADSTATE;
+        goto done;
+    }
+
+    if (strncasecmp(sql, "set", 3) == 0 || strncasecmp(sql, "begin", 5) == 0 ||
+        strncasecmp(sql, "commit", 6) == 0 ||
+        strncasecmp(sql, "rollback", 8) == 0) {
+        sprintf(hndl->errstr, "%s: Run set and transaction statements with "
+                              "cdb2_run_statement.", __func__);
+        rc = CDB2ERR_NOTSUPPORTED;
+        goto done;
+    }
+
+    /* cdb2_run_statement checks that the server supports them first */
+    if (hndl->n_bindarrays) {
+        sprintf(hndl->errstr, "%s: Run statements with bound arrays with "
+                              "cdb2_run_statement.", __func__);
+        rc = CDB2ERR_NOTSUPPORTED;
+        goto done;
+    }
+
+    if (hndl->num_async >= CDB2_MAX_ASYNC) {
+        sprintf(hndl->errstr, "%s: %d statements already in flight.",
+                __func__, hndl->num_async);
+        rc = CDB2ERR_BADSTATE;
+        goto done;
+    }
+
+    clear_snapshot_info(hndl, __LINE__);
+    hndl->is_retry = 0;
+    make_random_str(hndl->cnonce, &hndl->cnonce_len);
+
+    item = calloc(1, sizeof(cdb2_async_item));
+    item->buf = cdb2_pack_query(
+        hndl, hndl->dbname, (char *)sql, hndl->num_set_commands,
+        hndl->num_set_commands_sent, hndl->commands, hndl->n_bindvars,
+        hndl->bindvars, 0, NULL, 0, 0, 0, 0, 1, __LINE__, &item->len);
+    item->is_read = is_sql_read(sql);
+    item->seq = hndl->async_seq++;
+    if (hndl->async_tail)
+        hndl->async_tail->next = item;
+    else
+        hndl->async_head = item;
+    hndl->async_tail = item;
+    hndl->num_async++;
+    if (seq)
+        *seq = item->seq;
+
+    /* With other statements waiting for a lost connection, this one goes
+     * out with them from cdb2_poll. */
+    if (hndl->sb == NULL && hndl->async_head == item)
+        cdb2_connect_sqlhost(hndl);
+    if (hndl->sb == NULL)
+        goto done;
+
+    /* Not flushed: cdb2_poll sends everything queued in one write. */
+    cdb2_write_query(hndl->sb, item->buf, item->len);
+    item->sent = 1;
+    hndl->num_set_commands_sent = hndl->num_set_commands;
+
+done:
+    if (log_calls)
+        fprintf(stderr, "%p> cdb2_run_statement_async(%p, \"%s\") = %d\n",
+                (void *)pthread_self(), hndl, sql, rc);
+    return rc;
+}
+
+int cdb2_poll(cdb2_hndl_tp *hndl, int *seq)
+{
+    int rc, len, type;
+    int retries_done = 0;
+
+    pthread_once(&init_once, do_init_once);
+
+    if (seq)
+        *seq = -1;
+
+    /* Whatever is left of the previous result set comes first. */
+    while (cdb2_next_record_int(hndl, 0) == CDB2_OK)
+        ;
+    clear_responses(hndl);
+    hndl->rows_read = 0;
+
+    if (hndl->async_head == NULL) {
+        rc = CDB2_OK_DONE;
+        goto done;
+    }
+
+    if (hndl->async_head->lost) {
+        sprintf(hndl->errstr, "%s: Connection dropped, the statement may or "
+                              "may not have run.", __func__);
+        cdb2_pop_async(hndl, seq);
+        rc = CDB2ERR_IO_ERROR;
+        goto done;
+    }
+
+retry:
+    if (hndl->sb == NULL) {
+        retries_done++;
+        if (retries_done > hndl->max_retries) {
+            sprintf(hndl->errstr, "%s: Maximum number of retries done.",
+                    __func__);
+            cdb2_pop_async(hndl, seq);
+            rc = CDB2ERR_TRAN_IO_ERROR;
+            goto done;
+        }
+        if (retries_done > hndl->num_hosts) {
+            if (retries_done > hndl->min_retries) {
+                sprintf(hndl->errstr, "%s: Cannot connect to db", __func__);
+                cdb2_pop_async(hndl, seq);
+                rc = CDB2ERR_CONNECT_ERROR;
+                goto done;
+            }
+            int tmsec = (retries_done - hndl->num_hosts) * 100;
+            poll(NULL, 0, tmsec > 1000 ? 1000 : tmsec);
+        }
+        if (cdb2_resend_async(hndl) != 0) {
+            newsql_disconnect(hndl, hndl->sb, __LINE__);
+            goto retry;
+        }
+        if (hndl->async_head->lost) {
+            /* The statement we were waiting on was a write. */
+            sprintf(hndl->errstr, "%s: Connection dropped, the statement may "
+                                  "or may not have run.", __func__);
+            cdb2_pop_async(hndl, seq);
+            rc = CDB2ERR_IO_ERROR;
+            goto done;
+        }
+    }
+
+    if (hndl->ack)
+        ack(hndl);
+    if (sbuf2flush(hndl->sb) < 0) {
+        newsql_disconnect(hndl, hndl->sb, __LINE__);
+        goto retry;
+    }
+
+    hndl->first_record_read = 0;
+    rc = cdb2_read_record(hndl, (char **)(&hndl->first_buf), &len, &type);
+    if (rc == 0 && type == RESPONSE_HEADER__DBINFO_RESPONSE) {
+        cdb2_redirect_from_master(hndl, len);
+        goto retry;
+    }
+    if (rc || hndl->first_buf == NULL) {
+        newsql_disconnect(hndl, hndl->sb, __LINE__);
+        goto retry;
+    }
+
+    hndl->firstresponse = cdb2__sqlresponse__unpack(NULL, len, hndl->first_buf);
+    if (hndl->firstresponse == NULL) {
+        newsql_disconnect(hndl, hndl->sb, __LINE__);
+        goto retry;
+    }
+
+    if (hndl->firstresponse->error_code == CDB2__ERROR_CODE__MASTER_TIMEOUT ||
+        hndl->firstresponse->error_code == CDB2ERR_CHANGENODE ||
+        (hndl->firstresponse->response_type == RESPONSE_TYPE__COLUMN_NAMES &&
+         is_retryable(hndl, hndl->firstresponse->error_code))) {
+        newsql_disconnect(hndl, hndl->sb, __LINE__);
+        clear_responses(hndl);
+        goto retry;
+    }
+
+    hndl->node_seq = 0;
+    bzero(hndl->hosts_connected, sizeof(hndl->hosts_connected));
+
+    cdb2_pop_async(hndl, seq);
+
+    if (hndl->firstresponse->response_type != RESPONSE_TYPE__COLUMN_NAMES) {
+        sprintf(hndl->errstr, "%s: Unknown response type %d", __func__,
+                hndl->firstresponse->response_type);
+        rc = -1;
+    } else if (hndl->firstresponse->error_code) {
+        rc = cdb2_convert_error_code(hndl->firstresponse->error_code);
+    } else {
+        /* Same as cdb2_run_statement: have the first row ready. */
+        rc = cdb2_next_record_int(hndl, 0);
+        if (rc == CDB2_OK || rc == CDB2_OK_DONE)
+            rc = 0;
+        else
+            rc = cdb2_convert_error_code(rc);
+    }
+
+done:
+    if (log_calls)
+        fprintf(stderr, "%p> cdb2_poll(%p) = %d seq %d\n",
+                (void *)pthread_self(), hndl, rc, seq ? *seq : -1);
+    return rc;
+}
+
 int cdb2_numcolumns(cdb2_hndl_tp *hndl)
 {
     int rc;
@@ -3903,9 +4405,49 @@ done:
     return rc;
 }
 
+int cdb2_bind_array(cdb2_hndl_tp *hndl, const char *varname, int type,
+                    const void *varaddr, int count, int typelen)
+{
+    int rc = 0;
+    pthread_once(&init_once, do_init_once);
+    if (count <= 0 || varaddr == NULL) {
+        sprintf(hndl->errstr, "%s: array needs at least one value", __func__);
+        rc = -1;
+        goto done;
+    }
+    if (hndl->n_bindarrays && count != hndl->bindrows) {
+        sprintf(hndl->errstr, "%s: array of %d values, others have %d",
+                __func__, count, hndl->bindrows);
+        rc = -1;
+        goto done;
+    }
+    hndl->n_bindarrays++;
+    hndl->bindarrays =
+        realloc(hndl->bindarrays,
+                sizeof(cdb2_bind_array_item) * hndl->n_bindarrays);
+    cdb2_bind_array_item *arr = &hndl->bindarrays[hndl->n_bindarrays - 1];
+    arr->varname = varname;
+    arr->type = type;
+    arr->varaddr = varaddr;
+    arr->typelen = typelen;
+    hndl->bindrows = count;
+
+done:
+    if (log_calls)
+        fprintf(stderr,
+                "%p> cdb2_bind_array(%p, \"%s\", %s, %p, %d, %d) = %d\n",
+                (void *)pthread_self(), hndl, varname, cdb2_type_str(type),
+                varaddr, count, typelen, rc);
+    return rc;
+}
+
 int cdb2_clearbindings(cdb2_hndl_tp *hndl)
 {
     pthread_once(&init_once, do_init_once);
+    free(hndl->bindarrays);
+    hndl->bindarrays = NULL;
+    hndl->n_bindarrays = 0;
+    hndl->bindrows = 0;
     if (hndl->bindvars == NULL)
         goto done;
     int i = 0;
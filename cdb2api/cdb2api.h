@@ -203,6 +203,9 @@ int cdb2_run_statement(cdb2_hndl_tp *hndl, const char *sql);
 int cdb2_run_statement_typed(cdb2_hndl_tp *hndl, const char *sql, int ntypes,
                              int *types);
 
+int cdb2_run_statement_async(cdb2_hndl_tp *hndl, const char *sql, int *seq);
+int cdb2_poll(cdb2_hndl_tp *hndl, int *seq);
+
 int cdb2_numcolumns(cdb2_hndl_tp *hndl);
 const char *cdb2_column_name(cdb2_hndl_tp *hndl, int col);
 int cdb2_column_type(cdb2_hndl_tp *hndl, int col);
@@ -226,6 +229,8 @@ int cdb2_bind_param(cdb2_hndl_tp *hndl, const char *name, int type,
                     const void *varaddr, int length);
 int cdb2_bind_index(cdb2_hndl_tp *hndl, int index, int type,
                     const void *varaddr, int length);
+int cdb2_bind_array(cdb2_hndl_tp *hndl, const char *name, int type,
+                    const void *varaddr, int count, int typelen);
 int cdb2_clearbindings(cdb2_hndl_tp *hndl);
 
 const char *cdb2_dbname(cdb2_hndl_tp *hndl);
@@ -276,6 +276,117 @@ static uint32_t space_reqd(uint32_t r, uint32_t s)
            (s > 1 ? (varint_need(s) + s) : s);
 }
 
+/*
+** Vector kernels for the two inner loops: finding how far a pattern
+** repeats, and writing out a repeated pattern when decompressing.
+** comdb2rle_init() picks AVX2 or SSE4.2 versions if the cpu has them;
+** until then (and on other platforms) the scalar code below is used.
+*/
+
+/* Index of first byte where a and b differ, or n if they don't */
+typedef size_t (*crle_mismatch_t)(const uint8_t *a, const uint8_t *b, size_t n);
+/* Write len bytes of pattern p (size s <= CRLE_EXPAND_MAXPAT) to out */
+typedef void (*crle_expand_t)(uint8_t *out, const uint8_t *p, uint32_t s,
+                              size_t len);
+
+static crle_mismatch_t crle_mismatch;
+static crle_expand_t crle_expand;
+
+#define CRLE_EXPAND_MAXPAT 16
+#define CRLE_EXPAND_MINLEN 64
+
+#if defined(__x86_64__) && !defined(_SUN_SOURCE)
+#include <immintrin.h>
+
+__attribute__((target("sse4.2"))) static size_t
+mismatch_sse(const uint8_t *a, const uint8_t *b, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+        unsigned m = _mm_movemask_epi8(_mm_cmpeq_epi8(x, y));
+        if (m != 0xffff)
+            return i + __builtin_ctz(~m);
+    }
+    while (i < n && a[i] == b[i])
+        ++i;
+    return i;
+}
+
+__attribute__((target("avx2"))) static size_t
+mismatch_avx2(const uint8_t *a, const uint8_t *b, size_t n)
+{
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+        unsigned m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+        if (m != 0xffffffff)
+            return i + __builtin_ctz(~m);
+    }
+    return i + mismatch_sse(a + i, b + i, n - i);
+}
+
+/* Fill blk with copies of p, starting in phase with the output.  Returns the
+** step: the largest multiple of s that fits in a vector keeps it in phase. */
+static inline size_t expand_block(uint8_t *blk, uint32_t vsz,
+                                  const uint8_t *p, uint32_t s)
+{
+    uint32_t j;
+    for (j = 0; j < vsz; j += s)
+        memcpy(blk + j, p, s);
+    return vsz - vsz % s;
+}
+
+__attribute__((target("sse4.2"))) static void
+expand_sse(uint8_t *out, const uint8_t *p, uint32_t s, size_t len)
+{
+    uint8_t blk[16 + CRLE_EXPAND_MAXPAT];
+    size_t i, step;
+    step = expand_block(blk, 16, p, s);
+    __m128i v = _mm_loadu_si128((const __m128i *)blk);
+    for (i = 0; i + 16 <= len; i += step)
+        _mm_storeu_si128((__m128i *)(out + i), v);
+    memcpy(out + i, blk, len - i);
+}
+
+__attribute__((target("avx2"))) static void
+expand_avx2(uint8_t *out, const uint8_t *p, uint32_t s, size_t len)
+{
+    uint8_t blk[32 + CRLE_EXPAND_MAXPAT];
+    size_t i, step;
+    step = expand_block(blk, 32, p, s);
+    __m256i v = _mm256_loadu_si256((const __m256i *)blk);
+    for (i = 0; i + 32 <= len; i += step)
+        _mm256_storeu_si256((__m256i *)(out + i), v);
+    memcpy(out + i, blk, len - i);
+}
+
+void comdb2rle_init(int v)
+{
+    const char *name = "scalar";
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        crle_mismatch = mismatch_avx2;
+        crle_expand = expand_avx2;
+        name = "avx2";
+    } else if (__builtin_cpu_supports("sse4.2")) {
+        crle_mismatch = mismatch_sse;
+        crle_expand = expand_sse;
+        name = "sse4.2";
+    }
+    if (v)
+        fprintf(stderr, "comdb2rle = %s\n", name);
+}
+#else
+void comdb2rle_init(int v)
+{
+    if (v)
+        fprintf(stderr, "comdb2rle = scalar\n");
+}
+#endif
+
 /* Check if 'sz' bytes repeat */
 static uint32_t repeats(Data in, uint32_t sz, uint32_t *r_)
 {
@@ -283,6 +394,14 @@ static uint32_t repeats(Data in, uint32_t sz, uint32_t *r_)
     r = *r_ = 0;
     if (in.sz < (sz * 2))
         return 0;
+    if (crle_mismatch) {
+        /* Every chunk matches the first as long as each byte matches the
+         * one sz bytes ahead of it */
+        size_t n = in.sz - in.sz % sz - sz;
+        r = crle_mismatch(in.dt, in.dt + sz, n) / sz;
+        *r_ = r;
+        return r;
+    }
     uint8_t *bp, *bx, bt;
     uint16_t *wp, word;
     switch (sz) {
@@ -343,7 +462,7 @@ static int well_known(uint8_t *d, uint32_t s, uint32_t *w)
     *w = MAXPAT;
     int i;
     for (i = 0; i < MAXPAT; ++i) {
-        if (s == psizes[i])
+        if (s == psizes[i] && *d == *patterns[i])
             if (memcmp(d, patterns[i], psizes[i]) == 0) {
                 *w = i;
                 return 1;
@@ -565,14 +684,15 @@ next:
     return 0;
 }
 
-int decompressComdb2RLE(Comdb2RLE *d)
+/* Stops once at least prefix bytes have been produced */
+static int decompress_int(Comdb2RLE *d, size_t prefix)
 {
     Data input, output;
     input.dt = d->in;
     input.sz = d->insz;
     output.dt = d->out;
     output.sz = d->outsz;
-    while (input.sz) {
+    while (input.sz && (size_t)(output.dt - d->out) < prefix) {
         int i;
         uint8_t *p;
         uint32_t reqd, s, r;
@@ -583,6 +703,11 @@ int decompressComdb2RLE(Comdb2RLE *d)
             memset(output.dt, *p, r);
             output.dt += r;
             output.sz -= r;
+        } else if (crle_expand && s <= CRLE_EXPAND_MAXPAT &&
+                   reqd >= CRLE_EXPAND_MINLEN) {
+            crle_expand(output.dt, p, s, reqd);
+            output.dt += reqd;
+            output.sz -= reqd;
         } else
             for (i = 0; i <= r; ++i) {
                 switch (s) {
@@ -613,3 +738,13 @@ int decompressComdb2RLE(Comdb2RLE *d)
     return 0;
 }
 
+int decompressComdb2RLE(Comdb2RLE *d)
+{
+    return decompress_int(d, d->outsz);
+}
+
+int decompressComdb2RLEPrefix(Comdb2RLE *d, size_t prefix)
+{
+    return decompress_int(d, prefix);
+}
+
@@ -31,5 +31,11 @@ typedef struct {
 **        1: Failure */
 int compressComdb2RLE(Comdb2RLE *);
 int decompressComdb2RLE(Comdb2RLE *);
+/* Decompress at least the first prefix bytes; outsz is set to how many were
+** written, which may be more than prefix */
+int decompressComdb2RLEPrefix(Comdb2RLE *, size_t prefix);
+
+/* Use the fastest vector kernels this cpu supports; v: say which */
+void comdb2rle_init(int v);
 
 #endif
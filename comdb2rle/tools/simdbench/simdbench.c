@@ -0,0 +1,173 @@
+/*
+ * Compresses and decompresses the same rows with the scalar Comdb2RLE
+ * loops and with the vector kernels comdb2rle_init() picks, checks that
+ * both give the same bytes and reports MB/s for each.
+ */
+#include <comdb2rle.c>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#define ROWSZ 512
+
+static double now(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/* Something like an ondisk row: mostly zero and null ints, short strings
+ * padded with zeros, and a few longer runs of multi-byte patterns. */
+static void mkrow(uint8_t *row, unsigned *seed)
+{
+	static const uint8_t zero[] = {0x08, 0x80, 0, 0, 0, 0, 0, 0, 0};
+	static const uint8_t null[] = {0x02, 0, 0, 0, 0, 0, 0, 0, 0};
+	uint8_t *p = row, *e = row + ROWSZ;
+	while (p < e) {
+		int n, i, k = rand_r(seed) % 8;
+		switch (k) {
+		case 0: case 1: case 2:
+			n = sizeof(zero);
+			if (p + n > e) n = e - p;
+			memcpy(p, k == 2 ? null : zero, n);
+			if (k == 1 && n == sizeof(zero))
+				p[8] = rand_r(seed);
+			break;
+		case 3: /* cstring */
+			n = 40;
+			if (p + n > e) n = e - p;
+			memset(p, 0, n);
+			p[0] = 0x08;
+			for (i = 1; i < n && i < 1 + rand_r(seed) % 12; ++i)
+				p[i] = 'a' + rand_r(seed) % 26;
+			break;
+		case 4: /* run of a 3 or 5 byte pattern */
+		case 5: {
+			uint8_t pat[5];
+			int s = k == 4 ? 3 : 5;
+			for (i = 0; i < s; ++i)
+				pat[i] = rand_r(seed);
+			n = s * (8 + rand_r(seed) % 24);
+			if (p + n > e) n = e - p;
+			for (i = 0; i < n; ++i)
+				p[i] = pat[i % s];
+			break;
+		}
+		case 6: /* long run of one byte */
+			n = 32 + rand_r(seed) % 96;
+			if (p + n > e) n = e - p;
+			memset(p, rand_r(seed), n);
+			break;
+		default: /* noise */
+			n = 1 + rand_r(seed) % 16;
+			if (p + n > e) n = e - p;
+			for (i = 0; i < n; ++i)
+				p[i] = rand_r(seed);
+			break;
+		}
+		p += n;
+	}
+}
+
+struct result {
+	double csec, dsec;
+};
+
+static int run(uint8_t *rows, int nrows, uint8_t *comp, size_t *compsz,
+               uint8_t *chk, struct result *res)
+{
+	int i;
+	double start = now();
+	for (i = 0; i < nrows; ++i) {
+		Comdb2RLE c = {.in = rows + i * ROWSZ, .insz = ROWSZ,
+		               .out = comp + i * ROWSZ, .outsz = ROWSZ};
+		if (compressComdb2RLE(&c) != 0)
+			c.outsz = 0; /* didn't compress; stored raw */
+		compsz[i] = c.outsz;
+	}
+	res->csec = now() - start;
+
+	start = now();
+	for (i = 0; i < nrows; ++i) {
+		if (compsz[i] == 0) {
+			memcpy(chk + i * ROWSZ, rows + i * ROWSZ, ROWSZ);
+			continue;
+		}
+		Comdb2RLE d = {.in = comp + i * ROWSZ, .insz = compsz[i],
+		               .out = chk + i * ROWSZ, .outsz = ROWSZ};
+		if (decompressComdb2RLE(&d) != 0 || d.outsz != ROWSZ) {
+			fprintf(stderr, "row %d: decompress failed\n", i);
+			return 1;
+		}
+	}
+	res->dsec = now() - start;
+
+	if (memcmp(rows, chk, (size_t)nrows * ROWSZ) != 0) {
+		fprintf(stderr, "decompressed rows differ from input\n");
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int c, i, nrows = 200000;
+	unsigned seed = 1;
+	uint8_t *rows, *comp, *comp2, *chk;
+	size_t *compsz, *compsz2, total = 0;
+	struct result scalar, simd;
+	double mb;
+
+	while ((c = getopt(argc, argv, "n:")) != -1) {
+		switch (c) {
+		case 'n': nrows = atoi(optarg); break;
+		default:
+			fprintf(stderr, "usage: %s [-n <rows>]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (nrows <= 0) {
+		fprintf(stderr, "usage: %s [-n <rows>]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	rows = malloc((size_t)nrows * ROWSZ);
+	comp = malloc((size_t)nrows * ROWSZ);
+	comp2 = malloc((size_t)nrows * ROWSZ);
+	chk = malloc((size_t)nrows * ROWSZ);
+	compsz = malloc(nrows * sizeof(size_t));
+	compsz2 = malloc(nrows * sizeof(size_t));
+	if (!rows || !comp || !comp2 || !chk || !compsz || !compsz2) {
+		perror("malloc");
+		return EXIT_FAILURE;
+	}
+	for (i = 0; i < nrows; ++i)
+		mkrow(rows + i * ROWSZ, &seed);
+	mb = (double)nrows * ROWSZ / (1024 * 1024);
+
+	if (run(rows, nrows, comp, compsz, chk, &scalar) != 0)
+		return EXIT_FAILURE;
+	comdb2rle_init(1);
+	if (run(rows, nrows, comp2, compsz2, chk, &simd) != 0)
+		return EXIT_FAILURE;
+
+	for (i = 0; i < nrows; ++i) {
+		if (compsz[i] != compsz2[i] ||
+		    memcmp(comp + i * ROWSZ, comp2 + i * ROWSZ, compsz[i])) {
+			fprintf(stderr, "row %d: compressed differently\n", i);
+			return EXIT_FAILURE;
+		}
+		total += compsz[i] ? compsz[i] : ROWSZ;
+	}
+
+	printf("%d rows of %d bytes (%g MB), compressed to %.1f%%\n", nrows,
+	       ROWSZ, mb, total * 100.0 / ((double)nrows * ROWSZ));
+	printf("compress:   scalar %8.1f MB/s  vector %8.1f MB/s  (%.2fx)\n",
+	       mb / scalar.csec, mb / simd.csec, scalar.csec / simd.csec);
+	printf("decompress: scalar %8.1f MB/s  vector %8.1f MB/s  (%.2fx)\n",
+	       mb / scalar.dsec, mb / simd.dsec, scalar.dsec / simd.dsec);
+	return EXIT_SUCCESS;
+}
@@ -802,6 +802,7 @@ int insert_del_op(block_state_t *blkstate, struct db *srcdb, struct db *dstdb,
 
 int delayed_key_adds(struct ireq *iq, block_state_t *blkstate, void *trans,
                      int *blkpos, int *ixout, int *errout);
+int delayed_key_adds_parallel(void);
 void *create_constraint_table(long long *ctid);
 void *create_constraint_index_table(long long *ctid);
 int delete_constraint_table(void *table);
@@ -109,6 +109,7 @@ void berk_memp_sync_alarm_ms(int);
 #include <cdb2_constants.h>
 
 #include <crc32c.h>
+#include <comdb2rle.h>
 
 #include "fdb_fend.h"
 #include "fdb_bend.h"
@@ -161,6 +162,8 @@ int gbl_llmeta_open = 0;
 int gbl_sqlite_sortermult = 1;
 
 int gbl_sqlite_sorter_mem = 300 * 1024 * 1024; /* 300 meg */
+int gbl_sqlite_sorter_threads = 4;   /* helper threads per in-memory sort */
+int gbl_sqlite_sorter_minrecs = 20000; /* smallest piece worth a helper */
 
 int gbl_rep_node_pri = 0;
 int gbl_handoff_node = 0;
@@ -258,6 +261,9 @@ int gbl_net_poll = 100;
 int gbl_net_throttle_percent = 50;
 int gbl_osql_net_poll = 100;
 int gbl_osql_max_queue = 10000;
+int gbl_osql_batch_bytes = 0; /* off: one net message per row op */
+int gbl_osql_batch_ms = 10;
+int gbl_osql_batch_compress = 1;
 int gbl_osql_net_portmux_register_interval = 600;
 int gbl_signal_net_portmux_register_interval = 600;
 int gbl_net_portmux_register_interval = 600;
@@ -482,6 +488,8 @@ int gbl_osql_verify_retries_max =
     499; /* how many times we retry osql for verify */
 int gbl_osql_verify_ext_chk =
     1; /* extended verify-checking after this many failures */
+int gbl_osql_apply_ix_threads = 0; /* off: add delayed keys serially */
+int gbl_osql_apply_ix_min_rows = 10000;
 int gbl_test_badwrite_intvl = 0;
 int gbl_test_blob_race = 0;
 int gbl_skip_ratio_trace = 0;
@@ -782,6 +790,8 @@ int gbl_fingerprint_queries = 0;
 char *gbl_dbdir = NULL;
 
 extern int gbl_verbose_net;
+extern int gbl_net_io_threads;
+extern int gbl_net_coalesce_max_usec;
 
 static int create_service_file(char *lrlname);
 
@@ -820,6 +830,9 @@ extern int gbl_uses_password;
 
 extern int gbl_direct_count;
 extern int gbl_parallel_count;
+extern int gbl_parallel_agg;
+extern int gbl_fdb_pushdown;
+extern int gbl_column_projection;
 
 int gbl_bbenv;
 
@@ -2446,6 +2459,34 @@ static int read_lrl_option(struct dbenv *dbenv, char *line, void *p, int len)
         gbl_net_poll = ii;
     }
 
+    else if (tokcmp(tok, ltok, "net_io_threads") == 0) {
+        tok = segtok(line, len, &st, &ltok);
+        ii = toknum(tok, ltok);
+        if (ii >= 0) {
+            logmsg(LOGMSG_INFO, "setting net_io_threads to %d\n", ii);
+            gbl_net_io_threads = ii;
+        } else {
+            logmsg(LOGMSG_ERROR, "invalid net_io_threads, %d\n", ii);
+        }
+    }
+
+    else if (tokcmp(tok, ltok, "net_coalesce_max_usec") == 0) {
+        tok = segtok(line, len, &st, &ltok);
+        ii = toknum(tok, ltok);
+        if (ii >= 1000000) {
+            /* the writer's wait adds it to a timespec's tv_nsec */
+            logmsg(LOGMSG_WARN, "net_coalesce_max_usec %d too big, using "
+                                "999999\n", ii);
+            ii = 999999;
+        }
+        if (ii >= 0) {
+            logmsg(LOGMSG_INFO, "setting net_coalesce_max_usec to %d\n", ii);
+            gbl_net_coalesce_max_usec = ii;
+        } else {
+            logmsg(LOGMSG_ERROR, "invalid net_coalesce_max_usec, %d\n", ii);
+        }
+    }
+
     else if (tokcmp(tok, ltok, "osql_net_poll") == 0) {
         tok = segtok(line, len, &st, &ltok);
         ii = toknum(tok, ltok);
@@ -2482,6 +2523,27 @@ static int read_lrl_option(struct dbenv *dbenv, char *line, void *p, int len)
         gbl_osql_max_queue = ii;
     }
 
+    else if (tokcmp(tok, ltok, "osql_batch_bytes") == 0) {
+        tok = segtok(line, len, &st, &ltok);
+        ii = toknum(tok, ltok);
+        logmsg(LOGMSG_INFO, "setting osql_batch_bytes to %d\n", ii);
+        gbl_osql_batch_bytes = ii;
+    }
+
+    else if (tokcmp(tok, ltok, "osql_batch_ms") == 0) {
+        tok = segtok(line, len, &st, &ltok);
+        ii = toknum(tok, ltok);
+        logmsg(LOGMSG_INFO, "setting osql_batch_ms to %d\n", ii);
+        gbl_osql_batch_ms = ii;
+    }
+
+    else if (tokcmp(tok, ltok, "osql_batch_compress") == 0) {
+        tok = segtok(line, len, &st, &ltok);
+        ii = toknum(tok, ltok);
+        logmsg(LOGMSG_INFO, "setting osql_batch_compress to %d\n", ii);
+        gbl_osql_batch_compress = ii;
+    }
+
     else if (tokcmp(tok, ltok, "osql_bkoff_netsend") == 0) {
         tok = segtok(line, len, &st, &ltok);
         ii = toknum(tok, ltok);
@@ -2651,6 +2713,28 @@ static int read_lrl_option(struct dbenv *dbenv, char *line, void *p, int len)
         gbl_sqlite_sorter_mem = ii;
     }
 
+    else if (tokcmp(tok, ltok, "sqlsorterthreads") == 0) {
+        tok = segtok(line, len, &st, &ltok);
+        ii = toknum(tok, ltok);
+        if (ii < 0) {
+            logmsg(LOGMSG_ERROR, "Invalid sqlsorterthreads value\n");
+            return -1;
+        }
+        logmsg(LOGMSG_INFO, "setting sqlsorterthreads to %d\n", ii);
+        gbl_sqlite_sorter_threads = ii;
+    }
+
+    else if (tokcmp(tok, ltok, "sqlsorterminrecs") == 0) {
+        tok = segtok(line, len, &st, &ltok);
+        ii = toknum(tok, ltok);
+        if (ii <= 0) {
+            logmsg(LOGMSG_ERROR, "Invalid sqlsorterminrecs value\n");
+            return -1;
+        }
+        logmsg(LOGMSG_INFO, "setting sqlsorterminrecs to %d\n", ii);
+        gbl_sqlite_sorter_minrecs = ii;
+    }
+
     else if (tokcmp(tok, ltok, "sqlsortermult") == 0) {
         tok = segtok(line, len, &st, &ltok);
         ii = toknum(tok, ltok);
@@ -2844,6 +2928,30 @@ static int read_lrl_option(struct dbenv *dbenv, char *line, void *p, int len)
         gbl_fdb_track_hints = toknum(tok, ltok);
         logmsg(LOGMSG_INFO, "%s fdb hint tracking\n",
                (gbl_fdb_track_hints) ? "Enabling" : "Disabling");
+    } else if (tokcmp(tok, ltok, "fdb_stream_batch_max") == 0) {
+        extern int gbl_fdb_stream_batch_max;
+        tok = segtok(line, len, &st, &ltok);
+        gbl_fdb_stream_batch_max = toknum(tok, ltok);
+        logmsg(LOGMSG_INFO, "Remote sql rows flushed at most every %d rows\n",
+               gbl_fdb_stream_batch_max);
+    } else if (tokcmp(tok, ltok, "fdb_sbuf_size") == 0) {
+        extern int gbl_fdb_sbuf_size;
+        tok = segtok(line, len, &st, &ltok);
+        gbl_fdb_sbuf_size = toknum(tok, ltok);
+        logmsg(LOGMSG_INFO, "Remote sql socket buffer set to %d bytes\n",
+               gbl_fdb_sbuf_size);
+    } else if (tokcmp(tok, ltok, "fdb_server_version") == 0) {
+        extern int gbl_fdb_server_version;
+        tok = segtok(line, len, &st, &ltok);
+        ii = toknum(tok, ltok);
+        if (ii < FDB_VER_LEGACY || ii > FDB_VER) {
+            logmsg(LOGMSG_ERROR, "fdb_server_version must be %d to %d\n",
+                   FDB_VER_LEGACY, FDB_VER);
+            return -1;
+        }
+        gbl_fdb_server_version = ii;
+        logmsg(LOGMSG_INFO, "Serving remote sql with protocol version %d\n",
+               gbl_fdb_server_version);
     }
 
     else if (tokcmp(tok, ltok, "maxthrottletime") == 0) {
@@ -3694,6 +3802,10 @@ static int read_lrl_option(struct dbenv *dbenv, char *line, void *p, int len)
     } else if (tokcmp(tok, ltok, "use_parallel_schema_change") == 0) {
         gbl_default_sc_scanmode = SCAN_PARALLEL;
         logmsg(LOGMSG_INFO, "using parallel scan mode for schema changes by default\n");
+    } else if (tokcmp(tok, ltok, "use_sorted_schema_change") == 0) {
+        gbl_default_sc_scanmode = SCAN_SORTED;
+        logmsg(LOGMSG_INFO, "building new indexes from sorted keys in "
+                            "readonly schema changes by default\n");
     } else if (tokcmp(tok, ltok, "use_llmeta") == 0) {
         bdb_attr_set(dbenv->bdb_attr, BDB_ATTR_LLMETA, 1);
         gbl_use_llmeta = 1;
@@ -3870,6 +3982,12 @@ static int read_lrl_option(struct dbenv *dbenv, char *line, void *p, int len)
     } else if (tokcmp(tok, ltok, "sqlenginepool") == 0) {
         thdpool_process_message(gbl_sqlengine_thdpool, line, len,
                                 st);
+    } else if (tokcmp(tok, ltok, "sqlsorterpool") == 0) {
+        thdpool_process_message(gbl_sqlsorter_thdpool, line, len,
+                                st);
+    } else if (tokcmp(tok, ltok, "dirscanpool") == 0) {
+        thdpool_process_message(gbl_dirscan_thdpool, line, len,
+                                st);
     } else if (tokcmp(tok, ltok, "osqlpfaultpool") == 0) {
         thdpool_process_message(gbl_osqlpfault_thdpool, line, len,
                                 st);
@@ -4573,6 +4691,34 @@ static int read_lrl_option(struct dbenv *dbenv, char *line, void *p, int len)
                    tmp, gbl_osql_verify_ext_chk);
             gbl_osql_verify_ext_chk = tmp;
         }
+    } else if (tokcmp(tok, ltok, "osql_apply_ix_threads") == 0) {
+        int tmp;
+        tok = segtok(line, len, &st, &ltok);
+        if (ltok <= 0) {
+            logmsg(LOGMSG_ERROR, "Expected value for osql_apply_ix_threads\n");
+            return 0;
+        }
+        tmp = toknum(tok, ltok);
+        if (tmp >= 0) {
+            logmsg(LOGMSG_INFO, "Will add delayed index keys with %d threads "
+                   "(was %d)\n",
+                   tmp, gbl_osql_apply_ix_threads);
+            gbl_osql_apply_ix_threads = tmp;
+        }
+    } else if (tokcmp(tok, ltok, "osql_apply_ix_min_rows") == 0) {
+        int tmp;
+        tok = segtok(line, len, &st, &ltok);
+        if (ltok <= 0) {
+            logmsg(LOGMSG_ERROR, "Expected value for osql_apply_ix_min_rows\n");
+            return 0;
+        }
+        tmp = toknum(tok, ltok);
+        if (tmp >= 0) {
+            logmsg(LOGMSG_INFO, "Will add index keys in parallel for "
+                   "transactions of %d rows or more (was %d)\n",
+                   tmp, gbl_osql_apply_ix_min_rows);
+            gbl_osql_apply_ix_min_rows = tmp;
+        }
     } else if (tokcmp(tok, ltok, "badwrite_intvl") == 0) {
         int tmp;
         tok = segtok(line, len, &st, &ltok);
@@ -6578,6 +6724,10 @@ static int init(int argc, char **argv)
         logmsg(LOGMSG_FATAL, "failed to initialise sql module\n");
         return -1;
     }
+    if (sqlsorterpool_init()) {
+        logmsg(LOGMSG_FATAL, "failed to initialise sql sorter module\n");
+        return -1;
+    }
     if (udppfault_thdpool_init()) {
         logmsg(LOGMSG_FATAL, "failed to initialise udp prefault module\n");
         return -1;
@@ -6586,6 +6736,10 @@ static int init(int argc, char **argv)
         logmsg(LOGMSG_FATAL, "failed to initialise page compact module\n");
         return -1;
     }
+    if (dirscan_thdpool_init()) {
+        logmsg(LOGMSG_FATAL, "failed to initialise direct scan module\n");
+        return -1;
+    }
     toblock_init();
 
 
@@ -8547,6 +8701,18 @@ static void register_all_int_switches()
     register_int_switch("parallel_count",
                         "When 'direct_count' is on, enable thread-per-stripe",
                         &gbl_parallel_count);
+    register_int_switch("parallel_agg",
+                        "Compute simple count/sum/total/avg/min/max queries "
+                        "with a thread per stripe",
+                        &gbl_parallel_agg);
+    register_int_switch("fdb_pushdown",
+                        "Push LIMIT and simple aggregates of queries on "
+                        "remote tables to the remote database",
+                        &gbl_fdb_pushdown);
+    register_int_switch("column_projection",
+                        "Only decompress the leading part of a row that a "
+                        "read only statement references",
+                        &gbl_column_projection);
 }
 
 static void getmyid(void)
@@ -8619,6 +8785,7 @@ int main(int argc, char **argv)
     setvbuf(stdout, 0, _IOLBF, 0);
 
     crc32c_init(0);
+    comdb2rle_init(0);
 
     adjust_ulimits();
     sqlite3_tunables_init();
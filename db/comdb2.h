@@ -1506,7 +1506,8 @@ enum convert_scan_mode {
     SCAN_STRIPES = 1, /* requires dtastripe, required for live schema change */
     SCAN_DUMP = 2,
     SCAN_OLDCODE = 3,
-    SCAN_PARALLEL = 4 /* creates one thread for each stripe */
+    SCAN_PARALLEL = 4, /* creates one thread for each stripe */
+    SCAN_SORTED = 5    /* parallel scan, new indexes built from sorted keys */
 };
 
 struct dbq_cursor {
@@ -1560,6 +1561,9 @@ extern int gbl_osql_heartbeat_alert;
 extern int gbl_osql_bkoff_netsend_lmt;
 extern int gbl_osql_bkoff_netsend;
 extern int gbl_osql_max_queue;
+extern int gbl_osql_batch_bytes;
+extern int gbl_osql_batch_ms;
+extern int gbl_osql_batch_compress;
 extern int gbl_net_poll;
 extern int gbl_osql_net_poll;
 extern int gbl_osql_net_portmux_register_interval;
@@ -1742,6 +1746,7 @@ extern int gbl_prefault_toblock_local;
 extern int gbl_appsock_pooling;
 extern struct thdpool *gbl_appsock_thdpool;
 extern struct thdpool *gbl_sqlengine_thdpool;
+extern struct thdpool *gbl_sqlsorter_thdpool;
 extern struct thdpool *gbl_osqlpfault_thdpool;
 extern struct thdpool *gbl_udppfault_thdpool;
 
@@ -1796,6 +1801,8 @@ extern int gbl_enable_osql_logging;
 extern int gbl_enable_osql_longreq_logging;
 
 extern int gbl_osql_verify_ext_chk;
+extern int gbl_osql_apply_ix_threads;
+extern int gbl_osql_apply_ix_min_rows;
 
 extern int gbl_genid_cache;
 
@@ -1831,6 +1838,7 @@ int thd_init(void);
 void sqlinit(void);
 void sqlnet_init(void);
 int sqlpool_init(void);
+int sqlsorterpool_init(void);
 int schema_init(void);
 int osqlpfthdpool_init(void);
 void toblock_init(void);
@@ -2341,6 +2349,7 @@ int bt_hash_table(char *table, int szkb);
 int del_bt_hash_table(char *table);
 int stat_bt_hash_table(char *table);
 int stat_bt_hash_table_reset(char *table);
+int train_compr_dict(char *table, int nsamples);
 int fastinit_table(struct dbenv *dbenvin, char *table);
 int add_cmacc_stmt(struct db *db, int alt);
 int add_cmacc_stmt_no_side_effects(struct db *db, int alt);
@@ -916,6 +916,339 @@ int verify_del_constraints(struct javasp_trans_state *javasp_trans_handle,
 }
 
 
+/* Report a failed delayed key add the way the block processor expects. */
+static int delayed_key_add_error(struct ireq *iq, struct db *usedb, int ixnum,
+                                 int opblkpos, int rc, int *blkpos, int *ixout,
+                                 int *errout)
+{
+    if (rc == IX_DUP) {
+        reqerrstr(iq, COMDB2_CSTRT_RC_DUP, "add key constraint "
+                                           "duplicate key '%s' on "
+                                           "table '%s' index %d",
+                  get_keynm_from_db_idx(usedb, ixnum), usedb->dbname, ixnum);
+
+        logmsg(LOGMSG_ERROR, "%s line %d add key constraints\n", __func__, __LINE__);
+        *blkpos = opblkpos;
+        *errout = OP_FAILED_UNIQ;
+        *ixout = ixnum;
+        return rc;
+    }
+
+    reqerrstr(iq, COMDB2_CSTRT_RC_INTL_ERR,
+              "add key berkley error for key '%s' on index %d",
+              get_keynm_from_db_idx(usedb, ixnum), ixnum);
+
+    *blkpos = opblkpos;
+    *errout = OP_FAILED_INTERNAL;
+    *ixout = ixnum;
+
+    if (ERR_INTERNAL == rc) {
+        /* DRQS 39717216:
+         * Exit & have the cluster elect another master */
+        if (gbl_exit_on_internal_error) {
+            exit(1);
+        }
+
+        rc = ERR_NOMASTER;
+    }
+    return rc;
+}
+
+/*
+ * Parallel delayed key adds.
+ *
+ * For big transactions the writer thread still reads every record and forms
+ * every key, but instead of adding the keys itself it queues them, and every
+ * DELAYED_IX_BATCH keys hands each index file to one of up to
+ * gbl_osql_apply_ix_threads workers.  A worker adds the keys of its indexes,
+ * in the order they were queued, under a child transaction of the block
+ * transaction.  Berkeley requires children to be begun and committed by one
+ * thread and forbids the parent to write while it has live children, so the
+ * writer thread does both, and writes nothing itself while the workers run.
+ * No two workers touch the same btree, so the children never wait on each
+ * other; they may take page locks the block transaction already holds.
+ *
+ * A worker stops at its first failure.  Of those, the earliest queued one is
+ * the one the serial loop would have hit, and is what gets reported; all the
+ * children are then aborted.
+ */
+#define DELAYED_IX_BATCH 65536
+
+struct delayed_ix_item {
+    struct db *usedb;
+    int ixnum;
+    int rrn;
+    unsigned long long genid;
+    int blkpos;
+    int keylen;
+    int taillen; /* -1 if the key has no data tail */
+    int rc;
+    char *key;   /* key followed by the data tail */
+};
+
+struct delayed_ix_batch {
+    struct delayed_ix_item *items;
+    int nitems;
+};
+
+struct delayed_ix_worker {
+    struct ireq iq;
+    void *trans;
+    struct delayed_ix_item *items;
+    int *todo; /* indexes into items, in queued order */
+    int ntodo;
+    int failed; /* first item that failed, or -1 */
+    int started;
+    pthread_t tid;
+};
+
+int delayed_key_adds_parallel(void)
+{
+    return gbl_osql_apply_ix_threads > 1 && !gbl_rowlocks &&
+           !bdb_attr_get(thedb->bdb_attr, BDB_ATTR_SNAPISOL);
+}
+
+static void delayed_ix_clear(struct delayed_ix_batch *b)
+{
+    int i;
+    for (i = 0; i < b->nitems; i++)
+        free(b->items[i].key);
+    b->nitems = 0;
+}
+
+static int delayed_ix_queue(struct delayed_ix_batch *b, struct db *usedb,
+                            int ixnum, int rrn, unsigned long long genid,
+                            int blkpos, const char *key, int keylen,
+                            const char *tail, int taillen)
+{
+    struct delayed_ix_item *it;
+
+    if (b->items == NULL) {
+        b->items = malloc(DELAYED_IX_BATCH * sizeof(struct delayed_ix_item));
+        if (b->items == NULL)
+            return -1;
+    }
+    it = &b->items[b->nitems];
+    it->key = malloc(keylen + (tail ? taillen : 0));
+    if (it->key == NULL)
+        return -1;
+    memcpy(it->key, key, keylen);
+    if (tail)
+        memcpy(it->key + keylen, tail, taillen);
+    it->usedb = usedb;
+    it->ixnum = ixnum;
+    it->rrn = rrn;
+    it->genid = genid;
+    it->blkpos = blkpos;
+    it->keylen = keylen;
+    it->taillen = tail ? taillen : -1;
+    it->rc = 0;
+    b->nitems++;
+    return 0;
+}
+
+static int delayed_ix_add(struct ireq *iq, void *trans,
+                          struct delayed_ix_item *it)
+{
+    iq->usedb = it->usedb;
+    it->rc = ix_addk(iq, trans, it->key, it->ixnum, it->genid, it->rrn,
+                     it->taillen >= 0 ? it->key + it->keylen : NULL,
+                     it->taillen >= 0 ? it->taillen : 0);
+    return it->rc;
+}
+
+static void *delayed_ix_worker_thd(void *arg)
+{
+    struct delayed_ix_worker *w = arg;
+    int i;
+
+    thread_started("delayed ix add");
+    backend_thread_event(thedb, COMDB2_THR_EVENT_START_RDWR);
+
+    for (i = 0; i < w->ntodo; i++) {
+        if (delayed_ix_add(&w->iq, w->trans, &w->items[w->todo[i]]) != 0) {
+            w->failed = w->todo[i];
+            break;
+        }
+    }
+
+    backend_thread_event(thedb, COMDB2_THR_EVENT_DONE_RDWR);
+    return NULL;
+}
+
+/* Hand out index files to workers round robin, in the order they first show
+ * up.  Returns the number of workers that got any work. */
+static int delayed_ix_assign(struct delayed_ix_batch *b,
+                             struct delayed_ix_worker *w, int nworkers)
+{
+    struct {
+        struct db *usedb;
+        int ixnum;
+    } *files;
+    int nfiles = 0, last = -1, i, j;
+
+    files = malloc(b->nitems * sizeof(*files));
+    if (files == NULL)
+        return 0;
+
+    for (i = 0; i < b->nitems; i++) {
+        struct delayed_ix_item *it = &b->items[i];
+        if (last < 0 || files[last].usedb != it->usedb ||
+            files[last].ixnum != it->ixnum) {
+            for (j = 0; j < nfiles; j++)
+                if (files[j].usedb == it->usedb && files[j].ixnum == it->ixnum)
+                    break;
+            if (j == nfiles) {
+                files[j].usedb = it->usedb;
+                files[j].ixnum = it->ixnum;
+                nfiles++;
+            }
+            last = j;
+        }
+        if (w) {
+            struct delayed_ix_worker *wk = &w[last % nworkers];
+            wk->todo[wk->ntodo++] = i;
+        }
+    }
+
+    free(files);
+    return nfiles < nworkers ? nfiles : nworkers;
+}
+
+/* Add every queued key.  Returns 0, or the error of the earliest key that
+ * failed (already reported), or an error setting up the children. */
+static int delayed_ix_flush(struct ireq *iq, void *trans,
+                            struct delayed_ix_batch *b, int *blkpos,
+                            int *ixout, int *errout)
+{
+    struct delayed_ix_worker *w = NULL;
+    struct db *saved_usedb = iq->usedb;
+    int nworkers = 0, failed = -1, rc = 0, i;
+
+    if (b->nitems == 0)
+        return 0;
+
+    if (b->nitems >= gbl_osql_apply_ix_min_rows)
+        nworkers = delayed_ix_assign(b, NULL, gbl_osql_apply_ix_threads);
+
+    if (nworkers > 1) {
+        w = calloc(nworkers, sizeof(struct delayed_ix_worker));
+        for (i = 0; w && i < nworkers; i++) {
+            w[i].iq = *iq;
+            w[i].iq.debug = 0;
+            w[i].items = b->items;
+            w[i].failed = -1;
+            w[i].todo = malloc(b->nitems * sizeof(int));
+            if (w[i].todo == NULL)
+                break;
+        }
+        if (w == NULL || i < nworkers) {
+            logmsg(LOGMSG_ERROR, "%s: out of memory, adding keys serially\n",
+                   __func__);
+            for (i = 0; w && i < nworkers; i++)
+                free(w[i].todo);
+            free(w);
+            w = NULL;
+            nworkers = 0;
+        }
+    }
+
+    if (nworkers > 1) {
+        delayed_ix_assign(b, w, nworkers);
+
+        for (i = 0; i < nworkers; i++) {
+            rc = trans_start(iq, trans, &w[i].trans);
+            if (rc)
+                break;
+        }
+        if (rc) {
+            logmsg(LOGMSG_ERROR, "%s: failed to start child transaction rc %d\n",
+                   __func__, rc);
+            while (--i >= 0)
+                trans_abort(iq, w[i].trans);
+            reqerrstr(iq, COMDB2_CSTRT_RC_INTL_ERR,
+                      "add key constraint cannot start transaction");
+            *blkpos = b->items[0].blkpos;
+            *errout = OP_FAILED_INTERNAL;
+            goto out;
+        }
+
+        for (i = 0; i < nworkers; i++) {
+            /* if we can't get a thread, do that share ourselves */
+            w[i].started = pthread_create(&w[i].tid, NULL,
+                                          delayed_ix_worker_thd, &w[i]) == 0;
+        }
+        for (i = 0; i < nworkers; i++) {
+            if (w[i].started)
+                pthread_join(w[i].tid, NULL);
+            else {
+                struct ireq *wiq = &w[i].iq;
+                int j;
+                for (j = 0; j < w[i].ntodo; j++) {
+                    if (delayed_ix_add(wiq, w[i].trans,
+                                       &b->items[w[i].todo[j]]) != 0) {
+                        w[i].failed = w[i].todo[j];
+                        break;
+                    }
+                }
+            }
+            if (w[i].failed >= 0 && (failed < 0 || w[i].failed < failed))
+                failed = w[i].failed;
+        }
+
+        for (i = 0; i < nworkers; i++) {
+            if (failed >= 0 || rc) {
+                trans_abort(iq, w[i].trans);
+            } else {
+                db_seqnum_type seqnum;
+                rc = trans_commit_seqnum(iq, w[i].trans, &seqnum);
+                if (rc) {
+                    logmsg(LOGMSG_ERROR, "%s: child commit failed rc %d\n",
+                           __func__, rc);
+                    reqerrstr(iq, COMDB2_CSTRT_RC_INTL_ERR,
+                              "add key constraint cannot commit transaction");
+                    *blkpos = b->items[0].blkpos;
+                    *errout = OP_FAILED_INTERNAL;
+                }
+            }
+        }
+    } else {
+        for (i = 0; i < b->nitems; i++) {
+            if (delayed_ix_add(iq, trans, &b->items[i]) != 0) {
+                failed = i;
+                break;
+            }
+        }
+    }
+
+    if (iq->debug) {
+        int n = failed >= 0 ? failed + 1 : b->nitems;
+        for (i = 0; i < n; i++) {
+            struct delayed_ix_item *it = &b->items[i];
+            reqprintf(iq, "%p:ADDKYCNSTRT  TBL %s IX %d RRN %d KEY ", trans,
+                      it->usedb->dbname, it->ixnum, it->rrn);
+            reqdumphex(iq, it->key, it->keylen);
+            reqmoref(iq, " RC %d", it->rc);
+        }
+    }
+
+    if (failed >= 0) {
+        struct delayed_ix_item *it = &b->items[failed];
+        rc = delayed_key_add_error(iq, it->usedb, it->ixnum, it->blkpos,
+                                   it->rc, blkpos, ixout, errout);
+    }
+
+out:
+    if (w) {
+        for (i = 0; i < nworkers; i++)
+            free(w[i].todo);
+        free(w);
+    }
+    iq->usedb = saved_usedb;
+    delayed_ix_clear(b);
+    return rc;
+}
+
 /* this is called twice so putting here to avoid mess */
 #define LIVE_SC_DELAYED_KEY_ADDS(LAST) do {                                  \
         /* its ok to fail adding to newbtree indices -- SC will abort */     \
@@ -937,8 +1270,9 @@ int verify_del_constraints(struct javasp_trans_state *javasp_trans_handle,
 
 
 
-int delayed_key_adds(struct ireq *iq, block_state_t *blkstate, void *trans,
-                     int *blkpos, int *ixout, int *errout)
+static int delayed_key_adds_int(struct ireq *iq, block_state_t *blkstate,
+                                void *trans, int *blkpos, int *ixout,
+                                int *errout, struct delayed_ix_batch *batch)
 {
     int i = 0, rc = 0, fndlen = 0, fndrrn = 0, err = 0, limit = 0;
     int idx = 0, ixkeylen = -1;
@@ -1165,7 +1499,29 @@ int delayed_key_adds(struct ireq *iq, block_state_t *blkstate, void *trans,
             /* light the prefault kill bit for this subop - newkeys */
             prefault_kill_bits(iq, doidx, PFRQ_NEWKEY);
 
-            /* add the key */
+            /* add the key, or queue it to be added in parallel */
+            if (batch) {
+                if (delayed_ix_queue(batch, iq->usedb, doidx, addrrn, genid,
+                                     curop->blkpos, key, ixkeylen, od_dta_tail,
+                                     od_tail_len) != 0) {
+                    reqerrstr(iq, COMDB2_CSTRT_RC_ALLOC,
+                              "add key constraint failed malloc");
+                    *blkpos = curop->blkpos;
+                    *errout = OP_FAILED_INTERNAL;
+                    close_constraint_table_cursor(cur);
+                    free_cached_delayed_indexes(iq);
+                    return ERR_INTERNAL;
+                }
+                if (batch->nitems == DELAYED_IX_BATCH &&
+                    (rc = delayed_ix_flush(iq, trans, batch, blkpos, ixout,
+                                           errout)) != 0) {
+                    close_constraint_table_cursor(cur);
+                    free_cached_delayed_indexes(iq);
+                    return rc;
+                }
+                continue;
+            }
+
             rc = ix_addk(iq, trans, key, doidx, genid, addrrn, od_dta_tail,
                          od_tail_len);
 
@@ -1176,43 +1532,12 @@ int delayed_key_adds(struct ireq *iq, block_state_t *blkstate, void *trans,
                 reqmoref(iq, " RC %d", rc);
             }
 
-            if (rc == IX_DUP) {
-                reqerrstr(iq, COMDB2_CSTRT_RC_DUP, "add key constraint "
-                                                   "duplicate key '%s' on "
-                                                   "table '%s' index %d",
-                          get_keynm_from_db_idx(iq->usedb, doidx),
-                          iq->usedb->dbname, doidx);
-
-                logmsg(LOGMSG_ERROR, "%s line %d add key constraints\n", __func__, __LINE__);
-                *blkpos = curop->blkpos;
-                *errout = OP_FAILED_UNIQ;
-                *ixout = doidx;
-                close_constraint_table_cursor(cur);
-                free_cached_delayed_indexes(iq);
-
-                return rc;
-            } else if (rc != 0) {
-                reqerrstr(iq, COMDB2_CSTRT_RC_INTL_ERR,
-                          "add key berkley error for key '%s' on index %d",
-                          get_keynm_from_db_idx(iq->usedb, doidx), doidx);
-
-                *blkpos = curop->blkpos;
-
-                *errout = OP_FAILED_INTERNAL;
-                *ixout = doidx;
+            if (rc != 0) {
                 close_constraint_table_cursor(cur);
                 free_cached_delayed_indexes(iq);
-
-                if (ERR_INTERNAL == rc) {
-                    /* DRQS 39717216:
-                     * Exit & have the cluster elect another master */
-                    if (gbl_exit_on_internal_error) {
-                        exit(1);
-                    }
-
-                    rc = ERR_NOMASTER;
-                }
-                return rc;
+                return delayed_key_add_error(iq, iq->usedb, doidx,
+                                             curop->blkpos, rc, blkpos, ixout,
+                                             errout);
             }
         } /* for each index */
 
@@ -1223,6 +1548,11 @@ int delayed_key_adds(struct ireq *iq, block_state_t *blkstate, void *trans,
     close_constraint_table_cursor(cur);
     
     if (rc == IX_EMPTY || rc == IX_PASTEOF) {
+        if (batch && (rc = delayed_ix_flush(iq, trans, batch, blkpos, ixout,
+                                            errout)) != 0) {
+            free_cached_delayed_indexes(iq);
+            return rc;
+        }
         if (cached_index_genid != genid) {
             if (cache_delayed_indexes(iq, genid)) {
                 logmsg(LOGMSG_ERROR, "%s failed to cache delayed indexes\n",
@@ -1246,6 +1576,23 @@ int delayed_key_adds(struct ireq *iq, block_state_t *blkstate, void *trans,
     return ERR_INTERNAL;
 }
 
+int delayed_key_adds(struct ireq *iq, block_state_t *blkstate, void *trans,
+                     int *blkpos, int *ixout, int *errout)
+{
+    struct delayed_ix_batch batch = {0};
+    int rc;
+
+    if (!delayed_key_adds_parallel())
+        return delayed_key_adds_int(iq, blkstate, trans, blkpos, ixout, errout,
+                                    NULL);
+
+    rc = delayed_key_adds_int(iq, blkstate, trans, blkpos, ixout, errout,
+                              &batch);
+    delayed_ix_clear(&batch);
+    free(batch.items);
+    return rc;
+}
+
 int verify_add_constraints(struct javasp_trans_state *javasp_trans_handle,
                            struct ireq *iq, block_state_t *blkstate,
                            void *trans, int *errout)
@@ -45,6 +45,9 @@ extern int blockproc2sql_error(int rc, const char *func, int line);
 
 static void init_sqlclntstate(struct sqlclntstate *clnt, char *cid, int isuuid);
 
+/* most rows a streamed remote sql result buffers before flushing them */
+int gbl_fdb_stream_batch_max = 256;
+
 int fdb_appsock_work(const char *cid, struct sqlclntstate *clnt, int version,
                      enum run_sql_flags flags, char *sql, int sqllen,
                      char *trim_key, int trim_keylen, SBUF2 *sb)
@@ -112,25 +115,72 @@ int fdb_svc_cursor_open_sql(char *tid, char *cid, int code_release, int version,
  * Send back a streamed row with return code (marks also eos)
  *
  */
-int fdb_svc_sql_row(SBUF2 *sb, char *cid, char *row, int rowlen, int ret,
-                    int isuuid)
+static int _svc_sql_row(SBUF2 *sb, char *cid, char *row, int rowlen, int ret,
+                        int isuuid, int flush)
 {
     /* NOTE: we assume everything required is embedded in the sqlite row
        including genid and datacopy fields - as generated by select
        use datarow just as support */
-    int rc;
     unsigned long long genid = 0;
 
-    /* we know that genid is the last column ! */
-    if (ret == IX_FND || ret == IX_FNDMORE) {
+    /* we know that genid is the last column ! (pushed down aggregates
+       have none, and can be shorter than one) */
+    if ((ret == IX_FND || ret == IX_FNDMORE) && rowlen >= (int)sizeof(genid)) {
         genid = *(unsigned long long *)(row + rowlen - sizeof(genid));
         genid = flibc_htonll(genid);
     }
 
-    rc = fdb_remcur_send_row(sb, NULL, cid, genid, row, rowlen, NULL, 0, ret,
-                             isuuid);
+    return fdb_remcur_send_row(sb, NULL, cid, genid, row, rowlen, NULL, 0, ret,
+                               isuuid, flush);
+}
 
-    return rc;
+int fdb_svc_sql_row(SBUF2 *sb, char *cid, char *row, int rowlen, int ret,
+                    int isuuid)
+{
+    return _svc_sql_row(sb, cid, row, rowlen, ret, isuuid, 1);
+}
+
+void fdb_svc_sql_stream_init(fdb_sql_stream_t *st)
+{
+    st->batch = 1;
+    st->pending = 0;
+    st->first_ms = 0;
+}
+
+int fdb_svc_sql_stream_check(SBUF2 *sb, fdb_sql_stream_t *st)
+{
+    /* rows are coming slowly and the requester has been waiting on the
+       ones we are holding; send them and start over with small batches */
+    if (st->pending == 0 ||
+        time_epochms() - st->first_ms < FDB_STREAM_STALL_MS)
+        return 0;
+
+    st->pending = 0;
+    st->batch = 1;
+    return (sbuf2flush(sb) < 0) ? -1 : 0;
+}
+
+int fdb_svc_sql_row_stream(SBUF2 *sb, char *cid, char *row, int rowlen,
+                           int isuuid, fdb_sql_stream_t *st)
+{
+    int rc;
+
+    rc = _svc_sql_row(sb, cid, row, rowlen, IX_FNDMORE, isuuid, 0);
+    if (rc)
+        return rc;
+
+    if (st->pending++ == 0)
+        st->first_ms = time_epochms();
+    if (st->pending < st->batch)
+        return 0;
+
+    st->pending = 0;
+    if (st->batch < gbl_fdb_stream_batch_max)
+        st->batch = (st->batch * 2 < gbl_fdb_stream_batch_max)
+                        ? st->batch * 2
+                        : gbl_fdb_stream_batch_max;
+
+    return (sbuf2flush(sb) < 0) ? -1 : 0;
 }
 
 /**
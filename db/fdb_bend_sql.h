@@ -34,6 +34,38 @@ int fdb_appsock_work(const char *cid, struct sqlclntstate *clnt, int version,
 int fdb_svc_sql_row(SBUF2 *sb, char *cid, char *row, int rowlen, int rc,
                     int isuuid);
 
+/* flow control for the rows of a streamed remote sql result */
+typedef struct fdb_sql_stream {
+    int batch;    /* rows to buffer before the next flush */
+    int pending;  /* rows buffered since the last flush */
+    int first_ms; /* when the oldest of those was buffered */
+} fdb_sql_stream_t;
+
+/* rows buffered this long are flushed before the next row is produced, and
+   the batch starts over at one row */
+#define FDB_STREAM_STALL_MS 10
+
+void fdb_svc_sql_stream_init(fdb_sql_stream_t *st);
+
+/**
+ * Called before producing the next row: flushes the buffered rows if they
+ * have waited FDB_STREAM_STALL_MS.  A row can still be held for that long
+ * plus the time it takes to produce the next one
+ *
+ */
+int fdb_svc_sql_stream_check(SBUF2 *sb, fdb_sql_stream_t *st);
+
+/**
+ * Send back a streamed row that is not the last one (IX_FNDMORE). Rows are
+ * flushed in batches that start at one row and double up to
+ * gbl_fdb_stream_batch_max, so the requester sees the first row right away
+ * and long results go out in large writes; the last row, sent with
+ * fdb_svc_sql_row, flushes whatever is left
+ *
+ */
+int fdb_svc_sql_row_stream(SBUF2 *sb, char *cid, char *row, int rowlen,
+                           int isuuid, fdb_sql_stream_t *st);
+
 /**
  * For requests where we want to avoid a dedicated genid lookup socket, this
  * masks every index as covered index
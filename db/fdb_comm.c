@@ -31,6 +31,10 @@ extern int gbl_time_fdb;
 extern int gbl_notimeouts;
 
 extern int gbl_expressions_indexes;
+
+/* newest fdb protocol served; lowered to act like an older release */
+int gbl_fdb_server_version = FDB_VER;
+
 void free_cached_idx(uint8_t **cached_idx);
 
 /* matches fdb_svc_callback_t callbacks */
@@ -577,10 +581,10 @@ static int _check_code_release(SBUF2 *sb, char *cid, int code_release,
     code_release = fdb_ver_decoded(code_release);
 
     /* lets make sure we ask for sender to downgrade if its code is too new */
-    if (unlikely(code_release > FDB_VER)) {
+    if (unlikely(code_release > gbl_fdb_server_version)) {
 
-        snprintf(errstr, sizeof(errstr), "%d protocol %d too high", FDB_VER,
-                 code_release);
+        snprintf(errstr, sizeof(errstr), "%d protocol %d too high",
+                 gbl_fdb_server_version, code_release);
         errval = FDB_ERR_FDB_VERSION;
 
         /* we need to send back a rc code */
@@ -629,7 +633,7 @@ static int handle_remsql_session(SBUF2 *sb, struct dbenv *dbenv)
     if (_check_code_release(sb, open_msg.cid, open_msg.rootpage,
                             flags & FD_MSG_FLAGS_ISUUID)) {
         logmsg(LOGMSG_ERROR, "PROTOCOL TOO NEW %d, asking to downgrade to %d\n",
-                fdb_ver_decoded(open_msg.rootpage), FDB_VER);
+                fdb_ver_decoded(open_msg.rootpage), gbl_fdb_server_version);
         return 0;
     }
 
@@ -2869,7 +2873,8 @@ static enum svc_move_types move_type(int type)
 
 int fdb_remcur_send_row(SBUF2 *sb, fdb_msg_t *msg, char *cid,
                         unsigned long long genid, char *data, int datalen,
-                        char *datacopy, int datacopylen, int ret, int isuuid)
+                        char *datacopy, int datacopylen, int ret, int isuuid,
+                        int flush)
 {
     int rc;
     fdb_msg_t lcl_msg;
@@ -2894,7 +2899,7 @@ int fdb_remcur_send_row(SBUF2 *sb, fdb_msg_t *msg, char *cid,
     msg->dr.datacopylen = datacopylen;
     msg->dr.datacopy = datacopy;
 
-    rc = fdb_msg_write_message(sb, msg, 1);
+    rc = fdb_msg_write_message(sb, msg, flush);
 
     if (gbl_fdb_track) {
         fdb_msg_print_message(sb, msg, "sending msg");
@@ -2930,7 +2935,7 @@ int fdb_remcur_cursor_move(SBUF2 *sb, fdb_msg_t *msg, svc_callback_arg_t *arg)
     }
 
     rc = fdb_remcur_send_row(sb, msg, NULL, genid, data, datalen, datacopy,
-                             datacopylen, rc, arg->isuuid);
+                             datacopylen, rc, arg->isuuid, 1);
 
     return rc;
 }
@@ -2989,7 +2994,7 @@ int fdb_remcur_cursor_find(SBUF2 *sb, fdb_msg_t *msg, svc_callback_arg_t *arg)
     }
 
     rc = fdb_remcur_send_row(sb, msg, NULL, genid, data, datalen, datacopy,
-                             datacopylen, rc, arg->isuuid);
+                             datacopylen, rc, arg->isuuid, 1);
 
     return rc;
 }
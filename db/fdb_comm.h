@@ -69,7 +69,8 @@ char *fdb_msg_data(fdb_msg_t *msg);
 
 int fdb_remcur_send_row(SBUF2 *sb, fdb_msg_t *msg, char *cid,
                         unsigned long long genid, char *data, int datalen,
-                        char *datacopy, int datacopylen, int ret, int isuuid);
+                        char *datacopy, int datacopylen, int ret, int isuuid,
+                        int flush);
 
 int fdb_send_begin(fdb_msg_t *msg, fdb_tran_t *trans,
                    enum transaction_level lvl, int flags, int isuuid,
@@ -25,6 +25,7 @@
 #include <assert.h>
 #include <alloca.h>
 #include <poll.h>
+#include <unistd.h>
 
 #include <rtcpu.h>
 #include <list.h>
@@ -58,6 +59,8 @@ extern int gbl_new_indexes;
 
 int gbl_fdb_track = 0;
 int gbl_fdb_track_times = 0;
+int gbl_fdb_sbuf_size = 65536; /* socket buffer for remote sql streams */
+int gbl_fdb_pushdown = 1; /* push LIMIT and aggregates to the remote db */
 
 struct fdb_tbl;
 struct fdb;
@@ -179,6 +182,7 @@ struct fdb_cursor {
 
     Expr *hint;     /* expression passed down by sqlite */
     char *sql_hint; /* precreated sql query including hint */
+    long long limit; /* rows the query can consume, if > 0 */
     int is_schema;  /* special processing for accessing remote sqlite_master */
     int isuuid;     /* use extended 128bit UUID instead of 64bit fastseed*/
 
@@ -217,6 +221,7 @@ static int fdb_cursor_find_last(BtCursor *pCur, Mem *key, int nfields,
                                 int bias);
 static int fdb_cursor_set_hint(BtCursor *pCur, void *hint);
 static void *fdb_cursor_get_hint(BtCursor *pCur);
+static int fdb_cursor_set_limit(BtCursor *pCur, long long limit);
 static int fdb_cursor_set_sql(BtCursor *pCur, const char *sql);
 static char *fdb_cursor_name(BtCursor *pCur);
 static char *fdb_cursor_tblname(BtCursor *pCur);
@@ -1970,6 +1975,20 @@ static int _fdb_remote_reconnect(fdb_t *fdb, SBUF2 **psb, char *host)
         return FDB_ERR_CONNECT;
     }
 
+    /* rows are streamed back in batches; read them in large chunks instead
+       of the default 1KB the sbuf2 layer uses */
+    if (gbl_fdb_sbuf_size > 0) {
+        int fd = sbuf2fileno(sb);
+        if (sbuf2setbufsize(sb, gbl_fdb_sbuf_size)) {
+            /* sbuf2setbufsize frees sb on failure */
+            logmsg(LOGMSG_ERROR, "%s unable to size buffer for %s %s\n",
+                   __func__, fdb->dbname, host);
+            close(fd);
+            *psb = NULL;
+            return FDB_ERR_MALLOC;
+        }
+    }
+
     /* we don't want timeouts so we can cache sockets on the source side...  */
     sbuf2settimeout(sb, 0, 0);
 
@@ -2201,6 +2220,7 @@ static fdb_cursor_if_t *_fdb_cursor_open_remote(struct sqlclntstate *clnt,
     fdbc_if->get_found_data = fdb_cursor_get_found_data;
     fdbc_if->set_hint = fdb_cursor_set_hint;
     fdbc_if->get_hint = fdb_cursor_get_hint;
+    fdbc_if->set_limit = fdb_cursor_set_limit;
     fdbc_if->set_sql = fdb_cursor_set_sql;
     fdbc_if->name = fdb_cursor_name;
     fdbc_if->tblname = fdb_cursor_tblname;
@@ -2436,6 +2456,7 @@ static char *_build_run_sql_from_hint(BtCursor *pCur, Mem *m, int ncols,
     char *columnsDesc = NULL;
     int columnsDescLen = 0;
     int using_col_filter = 0;
+    char limitDesc[32] = "";
 
     if (!fdbc->ent) {
         tableName = "sqlite_master";
@@ -2477,6 +2498,14 @@ static char *_build_run_sql_from_hint(BtCursor *pCur, Mem *m, int ncols,
         }
     }
 
+    /* the limit only holds if the whole filter runs remotely, and a backward
+       table scan has no ORDER BY to limit from the right end */
+    if (fdbc->limit > 0 && fdbc->ent && (whereDesc || !fdbc->hint) &&
+        (fdbc->ent->ixnum >= 0 ||
+         (bias != OP_Prev && bias != OP_SeekLE && bias != OP_SeekLT))) {
+        snprintf(limitDesc, sizeof(limitDesc), " LIMIT %lld", fdbc->limit);
+    }
+
     if (whereDesc || hasCondition) {
         whereDescLen = strlen(" WHERE ") + (whereDesc ? strlen(whereDesc) : 0) +
                        1 /*terminating 0*/;
@@ -2499,6 +2528,7 @@ static char *_build_run_sql_from_hint(BtCursor *pCur, Mem *m, int ncols,
                  1 /*space*/ + whereDescLen + 5 /* possible " AND " */ +
                  orderLen;
     }
+    sqllen += strlen(limitDesc);
     sql = (char *)malloc(sqllen);
     if (!sql) {
         logmsg(LOGMSG_ERROR, "%s: malloc error %d bytes\n", __func__, sqllen);
@@ -2506,17 +2536,17 @@ static char *_build_run_sql_from_hint(BtCursor *pCur, Mem *m, int ncols,
     }
 
     if (whereDesc || hasCondition) {
-        snprintf(sql, sqllen, "SELECT %s%srowid FROM %s WHERE %s%s%s",
+        snprintf(sql, sqllen, "SELECT %s%srowid FROM %s WHERE %s%s%s%s",
                  (columnsDesc) ? columnsDesc : ((using_col_filter) ? "" : "*"),
                  (columnsDesc) ? ", " : ((using_col_filter) ? "" : ", "),
                  tableName, whereDesc ? whereDesc : "",
                  (whereDesc != NULL && hasCondition) ? " AND " : "",
-                 orderDesc ? orderDesc : "");
+                 orderDesc ? orderDesc : "", limitDesc);
     } else {
-        snprintf(sql, sqllen, "SELECT %s%srowid FROM %s%s",
+        snprintf(sql, sqllen, "SELECT %s%srowid FROM %s%s%s",
                  (columnsDesc) ? columnsDesc : ((using_col_filter) ? "" : "*"),
                  (columnsDesc) ? ", " : ((using_col_filter) ? "" : ", "),
-                 tableName, orderDesc ? orderDesc : "");
+                 tableName, orderDesc ? orderDesc : "", limitDesc);
     }
 
     /* lets get the actual size here
@@ -2748,6 +2778,14 @@ static void *fdb_cursor_get_hint(BtCursor *pCur)
     return pCur->fdbc->impl->hint;
 }
 
+static int fdb_cursor_set_limit(BtCursor *pCur, long long limit)
+{
+    assert(pCur->fdbc);
+    pCur->fdbc->impl->limit = limit;
+
+    return 0;
+}
+
 static int fdb_cursor_reopen(BtCursor *pCur)
 {
     struct sql_thread *thd;
@@ -3303,6 +3341,7 @@ const char *fdb_parse_comdb2_remote_dbname(const char *zDatabase,
  *
  */
 const char *fdb_dbname_name(fdb_t *fdb) { return fdb->dbname; }
+int fdb_server_version(fdb_t *fdb) { return fdb->server_version; }
 const char *fdb_table_entry_tblname(fdb_tbl_ent_t *ent)
 {
     return ent->tbl->name;
@@ -4674,6 +4713,7 @@ void _fdb_clear_clnt_node_affinities(struct sqlclntstate *clnt)
 static int _get_protocol_flags(int version, void *trans)
 {
     switch (version) {
+    case FDB_VER_AGG_PUSHDOWN:
     case FDB_VER_SOURCE_ID:
         return FDB_MSG_CURSOR_OPEN_SQL_SID;
 
@@ -66,8 +66,9 @@
 #define FDB_VER_LEGACY 0
 #define FDB_VER_CODE_VERSION 1
 #define FDB_VER_SOURCE_ID 2
+#define FDB_VER_AGG_PUSHDOWN 3 /* sends short aggregate rows back */
 
-#define FDB_VER FDB_VER_SOURCE_ID
+#define FDB_VER FDB_VER_AGG_PUSHDOWN
 
 /* cc2 ftw */
 #define fdb_ver_encoded(ver) (-(ver + 1))
@@ -169,6 +170,7 @@ typedef struct fdb_cursor_if {
 
     int (*set_hint)(BtCursor *pCur, void *hint);
     void *(*get_hint)(BtCursor *pCur);
+    int (*set_limit)(BtCursor *pCur, long long limit);
 
     int (*set_sql)(BtCursor *pCur, const char *sql);
     char *(*name)(BtCursor *pCur);
@@ -263,6 +265,7 @@ void fdb_sqlstats_put(fdb_t *fdb);
  *
  */
 const char *fdb_dbname_name(fdb_t *fdb);
+int fdb_server_version(fdb_t *fdb);
 const char *fdb_table_entry_tblname(fdb_tbl_ent_t *ent);
 const char *fdb_table_entry_dbname(fdb_tbl_ent_t *ent);
 
@@ -72,6 +72,7 @@ static int fdb_sqlstat_cursor_find_last(BtCursor *pCur, Mem *key, int nfields,
                                         int bias);
 static int fdb_sqlstat_cursor_set_hint(BtCursor *pCur, void *hint);
 static void *fdb_sqlstat_cursor_get_hint(BtCursor *pCur);
+static int fdb_sqlstat_cursor_set_limit(BtCursor *pCur, long long limit);
 static int fdb_sqlstat_cursor_set_sql(BtCursor *pCur, const char *sql);
 static char *fdb_sqlstat_cursor_name(BtCursor *pCur);
 static int fdb_sqlstat_cursor_has_partidx(BtCursor *pCur);
@@ -418,6 +419,7 @@ fdb_cursor_if_t *fdb_sqlstat_cache_cursor_open(struct sqlclntstate *clnt,
     fdbc_if->get_found_data = fdb_sqlstat_cursor_get_found_data;
     fdbc_if->set_hint = fdb_sqlstat_cursor_set_hint;
     fdbc_if->get_hint = fdb_sqlstat_cursor_get_hint;
+    fdbc_if->set_limit = fdb_sqlstat_cursor_set_limit;
     fdbc_if->set_sql = fdb_sqlstat_cursor_set_sql;
     fdbc_if->name = fdb_sqlstat_cursor_name;
     fdbc_if->tblname = fdb_sqlstat_cursor_name;
@@ -569,6 +571,11 @@ static int fdb_sqlstat_cursor_set_hint(BtCursor *pCur, void *hint)
 
 static void *fdb_sqlstat_cursor_get_hint(BtCursor *pCur) { return NULL; }
 
+static int fdb_sqlstat_cursor_set_limit(BtCursor *pCur, long long limit)
+{
+    return -1;
+}
+
 static int fdb_sqlstat_cursor_set_sql(BtCursor *pCur, const char *sql)
 {
     abort();
@@ -1551,6 +1551,18 @@ int osql_get_delayed(struct ireq *iq)
     return 1;
 }
 
+/* Big transactions delay their key adds, so that delayed_key_adds can add
+ * them to different indexes in parallel. */
+int osql_defer_ix_adds(struct ireq *iq)
+{
+    blocksql_tran_t *t;
+
+    if (!iq || !delayed_key_adds_parallel())
+        return 0;
+    t = (blocksql_tran_t *)iq->blocksql_tran;
+    return t && t->rows >= gbl_osql_apply_ix_min_rows;
+}
+
 void osql_bplog_clearonerror(struct ireq *iq, int rc)
 {
     blocksql_tran_t *tran = (blocksql_tran_t *)iq->blocksql_tran;
@@ -159,6 +159,7 @@ int osql_bplog_reqlog_queries(struct ireq *iq);
 void osql_bplog_time_done(struct ireq *iq);
 
 int osql_get_delayed(struct ireq *);
+int osql_defer_ix_adds(struct ireq *);
 
 int osql_throttle_session(struct ireq *);
 void osql_set_delayed(struct ireq *iq);
@@ -46,6 +46,12 @@
 #include <bpfunc.h>
 #include <strbuf.h>
 #include <logmsg.h>
+#include <lz4.h>
+#include "comdb2_atomic.h"
+
+#if LZ4_VERSION_NUMBER < 10701
+#define LZ4_compress_default LZ4_compress_limitedOutput
+#endif
 
 #define BLKOUT_DEFAULT_DELTA 5
 #define MAX_CLUSTER 16
@@ -2559,6 +2565,87 @@ typedef struct osql_stats {
     long int rcv_rdndt;
 } osql_stats_t;
 
+/* Row ops batched on the replicant, see osql_opbatch_add().  A batch is
+   sent as one NET_OSQL_OPBATCH message: this header, then "rawlen" bytes
+   of ops (lz4-compressed if OSQL_OPBATCH_LZ4 is set), each one a 4 byte
+   length followed by the op exactly as it would have been sent alone,
+   header and tails included. */
+typedef struct osql_opbatch_hdr {
+    int rpltype; /* NET_OSQL_*_RPL type of every op in the batch */
+    int nops;
+    int flags;
+    int rawlen;
+} osql_opbatch_hdr_t;
+
+enum { OSQLCOMM_OPBATCH_HDR_TYPE_LEN = 4 + 4 + 4 + 4 };
+
+BB_COMPILE_TIME_ASSERT(osqlcomm_opbatch_hdr_type_len,
+                       sizeof(osql_opbatch_hdr_t) ==
+                           OSQLCOMM_OPBATCH_HDR_TYPE_LEN);
+
+enum { OSQL_OPBATCH_LZ4 = 1 };
+
+static uint8_t *osqlcomm_opbatch_hdr_type_put(const osql_opbatch_hdr_t *p_hdr,
+                                              uint8_t *p_buf,
+                                              const uint8_t *p_buf_end)
+{
+    if (p_buf_end < p_buf ||
+        OSQLCOMM_OPBATCH_HDR_TYPE_LEN > (p_buf_end - p_buf))
+        return NULL;
+
+    p_buf = buf_put(&(p_hdr->rpltype), sizeof(p_hdr->rpltype), p_buf,
+                    p_buf_end);
+    p_buf = buf_put(&(p_hdr->nops), sizeof(p_hdr->nops), p_buf, p_buf_end);
+    p_buf = buf_put(&(p_hdr->flags), sizeof(p_hdr->flags), p_buf, p_buf_end);
+    p_buf = buf_put(&(p_hdr->rawlen), sizeof(p_hdr->rawlen), p_buf, p_buf_end);
+
+    return p_buf;
+}
+
+static const uint8_t *osqlcomm_opbatch_hdr_type_get(osql_opbatch_hdr_t *p_hdr,
+                                                    const uint8_t *p_buf,
+                                                    const uint8_t *p_buf_end)
+{
+    if (p_buf_end < p_buf ||
+        OSQLCOMM_OPBATCH_HDR_TYPE_LEN > (p_buf_end - p_buf))
+        return NULL;
+
+    p_buf = buf_get(&(p_hdr->rpltype), sizeof(p_hdr->rpltype), p_buf,
+                    p_buf_end);
+    p_buf = buf_get(&(p_hdr->nops), sizeof(p_hdr->nops), p_buf, p_buf_end);
+    p_buf = buf_get(&(p_hdr->flags), sizeof(p_hdr->flags), p_buf, p_buf_end);
+    p_buf = buf_get(&(p_hdr->rawlen), sizeof(p_hdr->rawlen), p_buf, p_buf_end);
+
+    return p_buf;
+}
+
+/* ops of one session a replicant has packed but not sent yet.  The
+   statements of a transaction may run on different sql threads, so batches
+   are found by session, not by thread. */
+typedef struct osql_opbatch {
+    uint8_t sess[sizeof(uuid_t)]; /* rqid or uuid from the ops' header, the
+                                     hash key; an rqid is zero padded */
+    pthread_mutex_t mtx;
+    char *host;
+    int rpltype;
+    int opened; /* time_epochms() of the first op */
+    int nops;
+    int len;
+    int cap;
+    uint8_t *buf;
+} osql_opbatch_t;
+
+static pthread_mutex_t osql_opbatch_mtx = PTHREAD_MUTEX_INITIALIZER;
+static hash_t *osql_opbatch_hash;
+static int osql_opbatch_count;
+
+static struct {
+    long int batches;
+    long int ops;
+    long int rawbytes;
+    long int sentbytes;
+} opbatch_stats;
+
 typedef struct osql_dbglog {
     int opcode;
     int padding;
@@ -2755,6 +2842,9 @@ static void net_osql_rpl(void *hndl, void *uptr, char *fromnode, int usertype,
 static int net_osql_rpl_tail(void *hndl, void *uptr, char *fromnode,
                              int usertype, void *dtap, int dtalen, void *tail,
                              int tailen);
+static void net_osql_opbatch(void *hndl, void *uptr, char *fromnode,
+                             int usertype, void *dtap, int dtalen,
+                             uint8_t is_tcp);
 
 static void net_sosql_req(void *hndl, void *uptr, char *fromnode, int usertype,
                           void *dtap, int dtalen, uint8_t is_tcp);
@@ -2801,6 +2891,8 @@ static int osql_check_version(int type);
 static int offload_net_send_tails(char *host, int usertype, void *data,
                                   int datalen, int nodelay, int ntails,
                                   void **tails, int *tailens);
+static int osql_opbatch_add(char *host, int usertype, void *data, int datalen,
+                            int ntails, void **tails, int *tailens);
 static int get_blkout(time_t now, char *nodes[REPMAX], int *nds);
 
 static int sorese_rcvreq(char *fromhost, void *dtap, int dtalen, int type,
@@ -2891,6 +2983,8 @@ int osql_comm_init(struct dbenv *dbenv)
 
     net_register_handler(tmp->handle_sibling, NET_OSQL_SOCK_REQ, net_sosql_req);
     net_register_handler(tmp->handle_sibling, NET_OSQL_SOCK_RPL, net_osql_rpl);
+    net_register_handler(tmp->handle_sibling, NET_OSQL_OPBATCH,
+                         net_osql_opbatch);
     net_register_handler(tmp->handle_sibling, NET_OSQL_SIGNAL,
                          net_sorese_signal);
 
@@ -2983,6 +3077,15 @@ int osql_comm_init(struct dbenv *dbenv)
     net_register_handler(tmp->handle_sibling, NET_OSQL_SNAP_UID_RPL,
                          net_snap_uid_rpl);
 
+    /* row op batches of the replicant's sessions */
+    osql_opbatch_hash = hash_init_o(offsetof(osql_opbatch_t, sess),
+                                    sizeof(uuid_t));
+    if (osql_opbatch_hash == NULL) {
+        logmsg(LOGMSG_ERROR, "%s: unable to create opbatch hash\n", __func__);
+        free(tmp);
+        return -1;
+    }
+
     /* kick the guy */
     rc = net_init(tmp->handle_sibling);
     if (rc) {
@@ -5168,6 +5271,10 @@ int osql_comm_quick_stat(void)
                reqtypes[i], stats[i].snd, stats[i].snd_failed, stats[i].rcv,
                stats[i].rcv_failed, stats[i].rcv_rdndt);
     }
+    if (opbatch_stats.batches)
+        logmsg(LOGMSG_USER, "op batches %ld ops %ld bytes %ld sent %ld\n",
+               opbatch_stats.batches, opbatch_stats.ops,
+               opbatch_stats.rawbytes, opbatch_stats.sentbytes);
     return 0;
 }
 
@@ -5736,6 +5843,265 @@ int osql_comm_check_bdb_lock(void)
     return 0;
 }
 
+/* whether a message is a session's reply to the master, with the header
+   that carries its rqid or uuid */
+static int osql_opbatch_rpl(int usertype, int datalen)
+{
+    switch (usertype) {
+    case NET_OSQL_BLOCK_RPL:
+    case NET_OSQL_SOCK_RPL:
+    case NET_OSQL_RECOM_RPL:
+    case NET_OSQL_SNAPISOL_RPL:
+    case NET_OSQL_SERIAL_RPL:
+        return datalen >= OSQLCOMM_RPL_TYPE_LEN;
+    case NET_OSQL_BLOCK_RPL_UUID:
+    case NET_OSQL_SOCK_RPL_UUID:
+    case NET_OSQL_RECOM_RPL_UUID:
+    case NET_OSQL_SNAPISOL_RPL_UUID:
+    case NET_OSQL_SERIAL_RPL_UUID:
+        return datalen >= OSQLCOMM_UUID_RPL_TYPE_LEN;
+    }
+    return 0;
+}
+
+/* whether an op can wait in a batch: only the row ops of a write
+   transaction, which the master just saves until the commit */
+static int osql_opbatch_op(int usertype, const uint8_t *data, int datalen)
+{
+    int type = 0;
+
+    if (!osql_opbatch_rpl(usertype, datalen))
+        return 0;
+
+    buf_get(&type, sizeof(type), data, data + datalen);
+    switch (type) {
+    case OSQL_USEDB:
+    case OSQL_DELREC:
+    case OSQL_INSREC:
+    case OSQL_QBLOB:
+    case OSQL_UPDREC:
+    case OSQL_UPDCOLS:
+    case OSQL_RECGENID:
+    case OSQL_DELETE:
+    case OSQL_INSERT:
+    case OSQL_UPDATE:
+    case OSQL_DELIDX:
+    case OSQL_INSIDX:
+        return 1;
+    }
+    return 0;
+}
+
+static int osql_opbatch_flush(osql_opbatch_t *b)
+{
+    osql_opbatch_hdr_t hdr = {0};
+    uint8_t *msg;
+    int len, n, rc;
+
+    if (b->nops == 0)
+        return 0;
+
+    len = OSQLCOMM_OPBATCH_HDR_TYPE_LEN + b->len;
+    if ((msg = malloc(len)) == NULL) {
+        logmsg(LOGMSG_ERROR, "%s: unable to allocate %d bytes\n", __func__,
+               len);
+        b->nops = b->len = 0;
+        return -1;
+    }
+
+    hdr.rpltype = b->rpltype;
+    hdr.nops = b->nops;
+    hdr.rawlen = b->len;
+
+    /* only worth it if it comes out smaller */
+    n = 0;
+    if (gbl_osql_batch_compress)
+        n = LZ4_compress_default((const char *)b->buf,
+                                 (char *)msg + OSQLCOMM_OPBATCH_HDR_TYPE_LEN,
+                                 b->len, b->len - 1);
+    if (n > 0) {
+        hdr.flags |= OSQL_OPBATCH_LZ4;
+        len = OSQLCOMM_OPBATCH_HDR_TYPE_LEN + n;
+    } else {
+        memcpy(msg + OSQLCOMM_OPBATCH_HDR_TYPE_LEN, b->buf, b->len);
+    }
+    osqlcomm_opbatch_hdr_type_put(&hdr, msg,
+                                  msg + OSQLCOMM_OPBATCH_HDR_TYPE_LEN);
+
+    ATOMIC_ADD(opbatch_stats.batches, 1);
+    ATOMIC_ADD(opbatch_stats.ops, b->nops);
+    ATOMIC_ADD(opbatch_stats.rawbytes, b->len);
+    ATOMIC_ADD(opbatch_stats.sentbytes, len);
+
+    /* emptied first, so offload_net_send doesn't come back here */
+    b->nops = b->len = 0;
+    rc = offload_net_send(b->host, NET_OSQL_OPBATCH, msg, len, 0);
+
+    free(msg);
+    return rc;
+}
+
+static void osql_opbatch_free(osql_opbatch_t *b)
+{
+    pthread_mutex_destroy(&b->mtx);
+    free(b->buf);
+    free(b);
+}
+
+/* the session key of an op: the rqid or uuid after the op type and
+   padding, padded to the size of a uuid */
+static void osql_opbatch_sess(int usertype, const void *data,
+                              uint8_t sess[sizeof(uuid_t)])
+{
+    const uint8_t *p = (const uint8_t *)data + 2 * sizeof(int);
+
+    memset(sess, 0, sizeof(uuid_t));
+    memcpy(sess, p, osql_nettype_is_uuid(usertype) ? sizeof(uuid_t)
+                                                   : sizeof(unsigned long long));
+}
+
+/* Send and drop the batch of a session, if it has one. */
+static int osql_opbatch_end(const uint8_t sess[sizeof(uuid_t)])
+{
+    osql_opbatch_t *b;
+    int rc;
+
+    if (ATOMIC_LOAD(osql_opbatch_count) == 0)
+        return 0;
+
+    pthread_mutex_lock(&osql_opbatch_mtx);
+    if ((b = hash_find(osql_opbatch_hash, sess)) != NULL) {
+        hash_del(osql_opbatch_hash, b);
+        osql_opbatch_count--;
+    }
+    pthread_mutex_unlock(&osql_opbatch_mtx);
+    if (b == NULL)
+        return 0;
+
+    /* a thread still appending to it holds the mutex until it's done */
+    pthread_mutex_lock(&b->mtx);
+    rc = osql_opbatch_flush(b);
+    pthread_mutex_unlock(&b->mtx);
+    osql_opbatch_free(b);
+    return rc;
+}
+
+/* Called at the end of every statement a replicant runs for clnt, so that
+   none of its row ops wait on a thread that may not run this session's
+   next statement. */
+int osql_opbatch_flush_clnt(struct sqlclntstate *clnt)
+{
+    uint8_t sess[sizeof(uuid_t)];
+
+    if (clnt->osql.rqid == 0)
+        return 0;
+    if (clnt->osql.rqid == OSQL_RQID_USE_UUID) {
+        memcpy(sess, clnt->osql.uuid, sizeof(uuid_t));
+    } else {
+        memset(sess, 0, sizeof(sess));
+        buf_put(&clnt->osql.rqid, sizeof(clnt->osql.rqid), sess,
+                sess + sizeof(sess));
+    }
+    return osql_opbatch_end(sess);
+}
+
+/* Called for every offload send.  With osql_batch_bytes set, the row ops a
+   replicant sends to a remote master are appended to their session's batch
+   instead.  The batch goes out once it holds osql_batch_bytes, when the
+   next op finds it has been open for osql_batch_ms, when the session sends
+   anything else (a done, a schema change, ...), and at the end of every
+   statement (osql_opbatch_flush_clnt), so the master still gets the ops of
+   a session in order and before the done that commits them.
+   Returns 1 if the op was batched, 0 if the caller should send it as
+   usual, or the error sending the pending batch. */
+static int osql_opbatch_add(char *host, int usertype, void *data, int datalen,
+                            int ntails, void **tails, int *tailens)
+{
+    osql_opbatch_t *b;
+    uint8_t sess[sizeof(uuid_t)], *p_buf;
+    int i, rc, oplen, cap;
+
+    if (host == gbl_mynode)
+        host = NULL;
+
+    if (!host || gbl_osql_batch_bytes <= 0 ||
+        !osql_opbatch_op(usertype, data, datalen)) {
+        /* whatever else a session sends goes after its row ops */
+        if (osql_opbatch_rpl(usertype, datalen)) {
+            osql_opbatch_sess(usertype, data, sess);
+            return osql_opbatch_end(sess);
+        }
+        return 0;
+    }
+
+    osql_opbatch_sess(usertype, data, sess);
+
+    oplen = datalen;
+    for (i = 0; i < ntails; i++)
+        oplen += tailens[i];
+
+    /* large blobs go on their own */
+    if (sizeof(oplen) + oplen > gbl_osql_batch_bytes)
+        return osql_opbatch_end(sess);
+
+    pthread_mutex_lock(&osql_opbatch_mtx);
+    if ((b = hash_find(osql_opbatch_hash, sess)) == NULL) {
+        if ((b = calloc(1, sizeof(osql_opbatch_t))) == NULL) {
+            pthread_mutex_unlock(&osql_opbatch_mtx);
+            return 0;
+        }
+        memcpy(b->sess, sess, sizeof(sess));
+        pthread_mutex_init(&b->mtx, NULL);
+        hash_add(osql_opbatch_hash, b);
+        osql_opbatch_count++;
+    }
+    pthread_mutex_lock(&b->mtx);
+    pthread_mutex_unlock(&osql_opbatch_mtx);
+
+    if (b->nops && (b->host != host || b->rpltype != usertype) &&
+        (rc = osql_opbatch_flush(b)) != 0)
+        goto out;
+
+    rc = 0;
+    if (b->len + sizeof(oplen) + oplen > b->cap) {
+        cap = 2 * gbl_osql_batch_bytes;
+        if (cap < b->len + sizeof(oplen) + oplen)
+            cap = b->len + sizeof(oplen) + oplen;
+        if ((p_buf = realloc(b->buf, cap)) == NULL) {
+            rc = osql_opbatch_flush(b);
+            goto out;
+        }
+        b->buf = p_buf;
+        b->cap = cap;
+    }
+
+    if (b->nops == 0) {
+        b->host = host;
+        b->rpltype = usertype;
+        b->opened = time_epochms();
+    }
+
+    p_buf = buf_put(&oplen, sizeof(oplen), b->buf + b->len, b->buf + b->cap);
+    memcpy(p_buf, data, datalen);
+    p_buf += datalen;
+    for (i = 0; i < ntails; i++) {
+        memcpy(p_buf, tails[i], tailens[i]);
+        p_buf += tailens[i];
+    }
+    b->len = p_buf - b->buf;
+    b->nops++;
+    rc = 1;
+
+    if ((b->len >= gbl_osql_batch_bytes ||
+         time_epochms() - b->opened >= gbl_osql_batch_ms) &&
+        (rc = osql_opbatch_flush(b)) == 0)
+        rc = 1;
+
+out:
+    pthread_mutex_unlock(&b->mtx);
+    return rc;
+}
+
 /* this wrapper tries to provide a reliable net_send that will prevent loosing
    packets
    due to queue being full */
@@ -5756,6 +6122,11 @@ static int offload_net_send(char *host, int usertype, void *data, int datalen,
         }
     }
 
+    if ((rc = osql_opbatch_add(host, usertype, data, datalen, 0, NULL,
+                               NULL)) != 0)
+        return rc < 0 ? rc : 0;
+    rc = -1;
+
     if (host == gbl_mynode)
         host = NULL;
 
@@ -5838,6 +6209,11 @@ static int offload_net_send_tails(char *host, int usertype, void *data,
     int unknownerror_retry = 0;
     int rc = -1;
 
+    if ((rc = osql_opbatch_add(host, usertype, data, datalen, ntails, tails,
+                               tailens)) != 0)
+        return rc < 0 ? rc : 0;
+    rc = -1;
+
     while (rc) {
         if (host == gbl_mynode)
             host = NULL;
@@ -6083,6 +6459,67 @@ static int net_osql_rpl_tail(void *hndl, void *uptr, char *fromhost,
     return rc;
 }
 
+/* Master callback for a batch of row ops: unpack it and save each op as if
+   it had arrived on its own. */
+static void net_osql_opbatch(void *hndl, void *uptr, char *fromhost,
+                             int usertype, void *dtap, int dtalen,
+                             uint8_t is_tcp)
+{
+    osql_opbatch_hdr_t hdr;
+    const uint8_t *p_buf, *p_buf_end;
+    uint8_t *raw = NULL;
+    int i, oplen;
+
+    p_buf = (const uint8_t *)dtap;
+    p_buf_end = p_buf + dtalen;
+
+    if (!(p_buf = osqlcomm_opbatch_hdr_type_get(&hdr, p_buf, p_buf_end)) ||
+        hdr.rawlen < 0) {
+        logmsg(LOGMSG_ERROR, "%s: malformed batch from %s\n", __func__,
+               fromhost);
+        return;
+    }
+
+    if (hdr.flags & OSQL_OPBATCH_LZ4) {
+        if ((raw = malloc(hdr.rawlen)) == NULL) {
+            logmsg(LOGMSG_FATAL,
+                   "%s: master running out of memory! unable to alloc %d "
+                   "bytes\n",
+                   __func__, hdr.rawlen);
+            abort();
+        }
+        if (LZ4_decompress_safe((const char *)p_buf, (char *)raw,
+                                p_buf_end - p_buf,
+                                hdr.rawlen) != hdr.rawlen) {
+            logmsg(LOGMSG_ERROR, "%s: corrupt batch from %s\n", __func__,
+                   fromhost);
+            free(raw);
+            return;
+        }
+        p_buf = raw;
+        p_buf_end = raw + hdr.rawlen;
+    } else if (p_buf_end - p_buf != hdr.rawlen) {
+        logmsg(LOGMSG_ERROR, "%s: malformed batch from %s\n", __func__,
+               fromhost);
+        return;
+    }
+
+    for (i = 0; i < hdr.nops; i++) {
+        if (!(p_buf = buf_get(&oplen, sizeof(oplen), p_buf, p_buf_end)) ||
+            oplen <= 0 || oplen > p_buf_end - p_buf ||
+            !osql_opbatch_op(hdr.rpltype, p_buf, oplen)) {
+            logmsg(LOGMSG_ERROR, "%s: bad op %d of %d in batch from %s\n",
+                   __func__, i, hdr.nops, fromhost);
+            break;
+        }
+        net_osql_rpl(hndl, uptr, fromhost, hdr.rpltype, (void *)p_buf, oplen,
+                     is_tcp);
+        p_buf += oplen;
+    }
+
+    free(raw);
+}
+
 static void net_sosql_req(void *hndl, void *uptr, char *fromhost, int usertype,
                           void *dtap, int dtalen, uint8_t is_tcp)
 {
@@ -6567,7 +7004,7 @@ int osql_process_packet(struct ireq *iq, unsigned long long rqid, uuid_t uuid,
 
         addflags = RECFLAGS_DYNSCHEMA_NULLS_ONLY;
         if (osql_get_delayed(iq) == 0 && iq->usedb->n_constraints == 0 &&
-            gbl_goslow == 0) {
+            gbl_goslow == 0 && !osql_defer_ix_adds(iq)) {
             addflags |= RECFLAGS_NO_CONSTRAINTS;
         } else {
             osql_set_delayed(iq);
@@ -42,6 +42,14 @@ int osql_comm_init(struct dbenv *dbenv);
  */
 void osql_comm_destroy(void);
 
+/**
+ * Send the row ops batched for clnt's session.
+ * Called at the end of every statement on a replicant.
+ *
+ */
+struct sqlclntstate;
+int osql_opbatch_flush_clnt(struct sqlclntstate *clnt);
+
 /**
  * Disable temporarily replicant "node"
  * "node" will receive no more offloading requests
@@ -144,9 +144,10 @@ void bdb_berktest_commit_delay(uint32_t);
 void rowlocks_clear_stats(void);
 void rowlocks_print_stats(FILE *f);
 void rowlocks_bench(void *, int, int);
-void rowlocks_lock1_bench(void *, int, int);
-void rowlocks_lock2_bench(void *, int, int);
+void rowlocks_lock1_bench(void *, int, int, int);
+void rowlocks_lock2_bench(void *, int, int, int);
 void commit_bench(void *, int, int);
+void apply_bench(const char *, int, int);
 void set_cursor_rowlocks(int cr);
 void bdb_detect(void *);
 void enable_ack_trace(void);
@@ -830,6 +831,22 @@ int process_command(struct dbenv *dbenv, char *line, int lline, int st)
         }
         dbgflag = toknum(tok, ltok);
         gbl_fdb_track_hints = dbgflag;
+    } else if (tokcmp(tok, ltok, "fdb_server_version") == 0) {
+        extern int gbl_fdb_server_version;
+
+        int version;
+        tok = segtok(line, lline, &st, &ltok);
+        if (ltok == 0) {
+            logmsg(LOGMSG_ERROR, "Expected version for fdb_server_version\n");
+            return -1;
+        }
+        version = toknum(tok, ltok);
+        if (version < FDB_VER_LEGACY || version > FDB_VER) {
+            logmsg(LOGMSG_ERROR, "fdb_server_version must be %d to %d\n",
+                   FDB_VER_LEGACY, FDB_VER);
+            return -1;
+        }
+        gbl_fdb_server_version = version;
     } else if (tokcmp(tok, ltok, "fdb") == 0) {
         fdb_process_message(line + st, lline - st);
     }
@@ -2099,9 +2116,11 @@ int process_command(struct dbenv *dbenv, char *line, int lline, int st)
         } else if (tokcmp(tok, ltok, "sqlpool") == 0) {
             thdpool_print_stats(stdout, gbl_appsock_thdpool);
             thdpool_print_stats(stdout, gbl_sqlengine_thdpool);
+            thdpool_print_stats(stdout, gbl_sqlsorter_thdpool);
             thdpool_print_stats(stdout, gbl_osqlpfault_thdpool);
             thdpool_print_stats(stdout, gbl_udppfault_thdpool);
             thdpool_print_stats(stdout, gbl_pgcompact_thdpool);
+            thdpool_print_stats(stdout, gbl_dirscan_thdpool);
         } else if (tokcmp(tok, ltok, "dumpsql") == 0) {
             sql_dump_running_statements();
         } else if (tokcmp(tok, ltok, "rep") == 0) {
@@ -2701,6 +2720,34 @@ int process_command(struct dbenv *dbenv, char *line, int lline, int st)
 
         if (bt_hash_table(table, szkb) != 0)
             return -1;
+    } else if (tokcmp(tok, ltok, "traindict") == 0) {
+        char table[MAXTABLELEN];
+        int nsamples = 0;
+        if (thedb->master != gbl_mynode) {
+            logmsg(LOGMSG_ERROR, "I am not master\n");
+            return -1;
+        }
+
+        tok = segtok(line, lline, &st, &ltok);
+        if (ltok == 0) {
+            logmsg(LOGMSG_ERROR, "Expected table name\n");
+            return -1;
+        }
+        if (ltok >= MAXTABLELEN) {
+            logmsg(LOGMSG_ERROR, "Invalid table name: too long (max %d)\n", MAXTABLELEN);
+            return -1;
+        }
+
+        tokcpy(tok, ltok, table);
+
+        tok = segtok(line, lline, &st, &ltok);
+        if (ltok != 0 && (nsamples = toknum(tok, ltok)) <= 0) {
+            logmsg(LOGMSG_ERROR, "Invalid sample count. Please give a positive number of records\n");
+            return -1;
+        }
+
+        if (train_compr_dict(table, nsamples) != 0)
+            return -1;
     } else if (tokcmp(tok, ltok, "bthashall") == 0) {
         int szkb;
         int idb;
@@ -3894,12 +3941,16 @@ int process_command(struct dbenv *dbenv, char *line, int lline, int st)
         thdpool_process_message(gbl_appsock_thdpool, line, lline, st);
     } else if (tokcmp(tok, ltok, "sqlenginepool") == 0) {
         thdpool_process_message(gbl_sqlengine_thdpool, line, lline, st);
+    } else if (tokcmp(tok, ltok, "sqlsorterpool") == 0) {
+        thdpool_process_message(gbl_sqlsorter_thdpool, line, lline, st);
     } else if (tokcmp(tok, ltok, "osqlpfaultpool") == 0) {
         thdpool_process_message(gbl_osqlpfault_thdpool, line, lline, st);
     } else if (tokcmp(tok, ltok, "udppfaultpool") == 0) {
         thdpool_process_message(gbl_udppfault_thdpool, line, lline, st);
     } else if (tokcmp(tok, ltok, "pgcompactpool") == 0) {
         thdpool_process_message(gbl_pgcompact_thdpool, line, lline, st);
+    } else if (tokcmp(tok, ltok, "dirscanpool") == 0) {
+        thdpool_process_message(gbl_dirscan_thdpool, line, lline, st);
     } else if (tokcmp(tok, ltok, "oldestgenids") == 0) {
         int i, stripe;
         void *buf = malloc(64 * 1024);
@@ -5194,6 +5245,33 @@ int process_command(struct dbenv *dbenv, char *line, int lline, int st)
             commit_bench(thedb->bdb_env, tcnt, cnt);
             pthread_mutex_unlock(&testguard);
         }
+    } else if (tokcmp(tok, ltok, "apply_bench") == 0) {
+        char table[MAXTABLELEN] = {0};
+        int rcnt = 0;
+        int tcnt = 4;
+        tok = segtok(line, lline, &st, &ltok);
+        if (ltok > 0 && ltok < sizeof(table)) {
+            tokcpy(tok, ltok, table);
+            tok = segtok(line, lline, &st, &ltok);
+            if (ltok > 0) {
+                rcnt = toknum(tok, ltok);
+                tok = segtok(line, lline, &st, &ltok);
+                if (ltok > 0)
+                    tcnt = toknum(tok, ltok);
+            }
+        }
+        if (thedb->master != gbl_mynode) {
+            logmsg(LOGMSG_ERROR, "I am not the master node\n");
+        } else if (gbl_rowlocks) {
+            logmsg(LOGMSG_ERROR, "apply_bench doesn't run in rowlocks mode\n");
+        } else if (table[0] == 0 || rcnt <= 0 || tcnt <= 0) {
+            logmsg(LOGMSG_ERROR, "apply_bench requires table & rows-per-txn "
+                   "[& thread-count]\n");
+        } else {
+            pthread_mutex_lock(&testguard);
+            apply_bench(table, rcnt, tcnt);
+            pthread_mutex_unlock(&testguard);
+        }
     } else if (tokcmp(tok, ltok, "rowlocks_bench") == 0) {
         int lcnt = 0;
         int pcnt = 0;
@@ -5218,6 +5296,7 @@ int process_command(struct dbenv *dbenv, char *line, int lline, int st)
     } else if (tokcmp(tok, ltok, "rowlocks_lock1_bench") == 0) {
         int lcnt = 0;
         int pcnt = 0;
+        int tcnt = 1;
         tok = segtok(line, lline, &st, &ltok);
         if (ltok > 0) {
             lcnt = toknum(tok, ltok);
@@ -5225,17 +5304,22 @@ int process_command(struct dbenv *dbenv, char *line, int lline, int st)
             tok = segtok(line, lline, &st, &ltok);
             if (ltok > 0) {
                 pcnt = toknum(tok, ltok);
+
+                tok = segtok(line, lline, &st, &ltok);
+                if (ltok > 0)
+                    tcnt = toknum(tok, ltok);
             }
         }
         if (thedb->master != gbl_mynode) {
             logmsg(LOGMSG_ERROR, "I am not the master node\n");
         } else if (!gbl_rowlocks) {
             logmsg(LOGMSG_ERROR, "I am not in rowlocks mode\n");
-        } else if (lcnt <= 0 || pcnt <= 0) {
-            logmsg(LOGMSG_ERROR, "rowlocks_lock1_bench requires ltxn-count & ptxn-count\n");
+        } else if (lcnt <= 0 || pcnt <= 0 || tcnt <= 0) {
+            logmsg(LOGMSG_ERROR, "rowlocks_lock1_bench requires ltxn-count & ptxn-count "
+                   "[& thread-count]\n");
         } else {
             pthread_mutex_lock(&testguard);
-            rowlocks_lock1_bench(thedb->bdb_env, lcnt, pcnt);
+            rowlocks_lock1_bench(thedb->bdb_env, lcnt, pcnt, tcnt);
             pthread_mutex_unlock(&testguard);
         }
     }
@@ -5243,6 +5327,7 @@ int process_command(struct dbenv *dbenv, char *line, int lline, int st)
     else if (tokcmp(tok, ltok, "rowlocks_lock2_bench") == 0) {
         int lcnt = 0;
         int pcnt = 0;
+        int tcnt = 1;
         tok = segtok(line, lline, &st, &ltok);
         if (ltok > 0) {
             lcnt = toknum(tok, ltok);
@@ -5250,18 +5335,23 @@ int process_command(struct dbenv *dbenv, char *line, int lline, int st)
             tok = segtok(line, lline, &st, &ltok);
             if (ltok > 0) {
                 pcnt = toknum(tok, ltok);
+
+                tok = segtok(line, lline, &st, &ltok);
+                if (ltok > 0)
+                    tcnt = toknum(tok, ltok);
             }
         }
         if (thedb->master != gbl_mynode) {
             logmsg(LOGMSG_ERROR, "I am not the master node\n");
         } else if (!gbl_rowlocks) {
             logmsg(LOGMSG_ERROR, "I am not in rowlocks mode\n");
-        } else if (lcnt <= 0 || pcnt <= 0) {
+        } else if (lcnt <= 0 || pcnt <= 0 || tcnt <= 0) {
             logmsg(LOGMSG_ERROR, 
-                   "rowlocks_lock2_bench requires ltxn-count & ptxn-count\n");
+                   "rowlocks_lock2_bench requires ltxn-count & ptxn-count "
+                   "[& thread-count]\n");
         } else {
             pthread_mutex_lock(&testguard);
-            rowlocks_lock2_bench(thedb->bdb_env, lcnt, pcnt);
+            rowlocks_lock2_bench(thedb->bdb_env, lcnt, pcnt, tcnt);
             pthread_mutex_unlock(&testguard);
         }
     } else if (tokcmp(tok, ltok, "deadlock_policy_override") == 0) {
@@ -17,6 +17,9 @@
 #include "limit_fortify.h"
 #include <comdb2.h>
 #include <epochlib.h>
+#include <flibc.h>
+#include "block_internal.h"
+#include "types.h"
 
 /* Commit bench opcodes */
 enum {
@@ -147,42 +150,44 @@ void rowlocks_print_stats(FILE *f)
     fprintf(f, "%llu interval-flushes\n", interval_flushes);
 }
 
-static void rowlocks_bench_int(bdb_state_type *bdb_state, int op, int count,
-                               int phys_txns_per_logical)
+struct rowlocks_bench_thd_arg {
+    int op;
+    int count;
+    int phys_txns_per_logical;
+    int first;
+    int rc;
+};
+
+/* Run count logical txns, locking rows first..first+count-1 */
+static void *rowlocks_bench_thd(void *varg)
 {
-    int i, j, rc, start, end = 0, now, elapsed, physcnt;
-    unsigned long long repcalls, repbytes, flushes, explicit_flushes,
-        interval_flushes;
+    struct rowlocks_bench_thd_arg *arg = varg;
+    int i, j, rc;
     void *trans = NULL;
     struct ireq iq;
 
-    assert(op > 0);
-    assert(count >= 1 && phys_txns_per_logical >= 1);
+    thread_started("rowlocks_bench");
+    backend_thread_event(thedb, COMDB2_THR_EVENT_START_RDWR);
 
     init_fake_ireq(thedb, &iq);
     iq.use_handle = thedb->bdb_env;
+    arg->rc = 0;
 
-    rep_reset_send_callcount();
-    rep_reset_send_bytecount();
-    net_reset_num_flushes();
-    net_reset_explicit_flushes();
-    net_reset_send_interval_flushes();
-
-    start = time_epoch();
-
-    for (i = 0; i < count; i++) {
+    for (i = arg->first; i < arg->first + arg->count; i++) {
         if ((rc = trans_start_logical(&iq, &trans)) != 0) {
             fprintf(stderr, "%s: error creating trans, rc=%d\n", __func__, rc);
-            return;
+            arg->rc = rc;
+            break;
         }
 
-        for (j = 0; j < phys_txns_per_logical; j++) {
-            if ((rc = ll_rowlocks_bench(thedb->bdb_env, trans, op, i, j, NULL,
-                                        0)) != 0) {
+        for (j = 0; j < arg->phys_txns_per_logical; j++) {
+            if ((rc = ll_rowlocks_bench(thedb->bdb_env, trans, arg->op, i, j,
+                                        NULL, 0)) != 0) {
                 fprintf(stderr, "%s: ll_rowlocks_bench returns %d\n", __func__,
                         rc);
                 trans_abort_logical(&iq, trans, NULL, 0, NULL, 0);
-                return;
+                arg->rc = rc;
+                goto out;
             }
 
             if ((rc = rowlocks_check_commit_physical(thedb->bdb_env, trans,
@@ -199,14 +204,66 @@ static void rowlocks_bench_int(bdb_state_type *bdb_state, int op, int count,
                                        iq.seq, iq.seqlen)) != 0) {
             fprintf(stderr, "%s: trans_commit_logical returns %d\n", 
                     __func__, rc);
-            return;
+            arg->rc = rc;
+            break;
         }
 
         trans = NULL;
     }
 
-    end = time_epoch();
-    elapsed = (end - start);
+out:
+    backend_thread_event(thedb, COMDB2_THR_EVENT_DONE_RDWR);
+    return NULL;
+}
+
+/* Each of nthreads threads runs count logical txns on rows of its own, so
+ * the row locks never conflict and only the lock manager is shared. */
+static void rowlocks_bench_int(bdb_state_type *bdb_state, int op, int count,
+                               int phys_txns_per_logical, int nthreads)
+{
+    int i, rc, start, elapsed;
+    long long physcnt;
+    unsigned long long repcalls, repbytes, flushes, explicit_flushes,
+        interval_flushes;
+    struct rowlocks_bench_thd_arg *args;
+    pthread_t *tids;
+
+    assert(op > 0);
+    assert(count >= 1 && phys_txns_per_logical >= 1 && nthreads >= 1);
+
+    args = calloc(nthreads, sizeof(*args));
+    tids = calloc(nthreads, sizeof(*tids));
+    if (!args || !tids) {
+        fprintf(stderr, "%s: out of memory\n", __func__);
+        free(args);
+        free(tids);
+        return;
+    }
+
+    rep_reset_send_callcount();
+    rep_reset_send_bytecount();
+    net_reset_num_flushes();
+    net_reset_explicit_flushes();
+    net_reset_send_interval_flushes();
+
+    start = time_epochms();
+
+    for (i = 0; i < nthreads; i++) {
+        args[i].op = op;
+        args[i].count = count;
+        args[i].phys_txns_per_logical = phys_txns_per_logical;
+        args[i].first = i * count;
+        if ((rc = pthread_create(&tids[i], NULL, rowlocks_bench_thd,
+                                 &args[i])) != 0) {
+            fprintf(stderr, "%s: pthread_create rc=%d\n", __func__, rc);
+            nthreads = i;
+            break;
+        }
+    }
+    for (i = 0; i < nthreads; i++)
+        pthread_join(tids[i], NULL);
+
+    elapsed = time_epochms() - start;
 
     repcalls = rep_get_send_callcount();
     repbytes = rep_get_send_bytecount();
@@ -214,17 +271,27 @@ static void rowlocks_bench_int(bdb_state_type *bdb_state, int op, int count,
     explicit_flushes = net_get_explicit_flushes();
     interval_flushes = net_get_send_interval_flushes();
 
-    fprintf(stderr, "op=%d count=%d phys-txns/logical-txn=%d\n", op, count,
-            phys_txns_per_logical);
+    for (i = 0; i < nthreads; i++) {
+        if (args[i].rc) {
+            fprintf(stderr, "%s: thread %d failed rc=%d\n", __func__, i,
+                    args[i].rc);
+        }
+    }
+    free(args);
+    free(tids);
 
-    physcnt = (phys_txns_per_logical * count);
+    fprintf(stderr, "op=%d count=%d phys-txns/logical-txn=%d threads=%d\n", op,
+            count, phys_txns_per_logical, nthreads);
+
+    physcnt = (long long)phys_txns_per_logical * count * nthreads;
+    if (physcnt == 0)
+        return;
 
     if (elapsed) {
-        printf("Committed %d physical records in %d seconds, ", physcnt,
-               elapsed);
-        printf("(%d records per second)\n", (physcnt / elapsed));
+        printf("Committed %lld physical records in %d ms, ", physcnt, elapsed);
+        printf("(%lld records per second)\n", physcnt * 1000 / elapsed);
     } else {
-        printf("Committed %d records (0 seconds elapsed)\n", physcnt);
+        printf("Committed %lld records (0 ms elapsed)\n", physcnt);
     }
 
     printf("%llu rep-calls (%d per record), %llu rep-bytes (%d per record)\n",
@@ -240,22 +307,212 @@ static void rowlocks_bench_int(bdb_state_type *bdb_state, int op, int count,
     return;
 }
 
+struct apply_bench_arg {
+    struct db *db;
+    int rows;
+    int rc;
+    int addms; /* adding the records */
+    int keyms; /* adding the delayed keys */
+};
+
+/* Give every field of the record the value val in whatever form it takes,
+ * so each row has unique keys.  Fields that can't hold it are null. */
+static void apply_bench_row(struct db *db, long long val, uint8_t *row)
+{
+    struct schema *s = db->schema;
+    const struct field_conv_opts outopts = {0};
+    char str[32];
+    long long ival = flibc_htonll(val);
+    int i, outsz, rc;
+
+    memset(row, 0, db->lrl);
+    snprintf(str, sizeof(str), "%lld", val);
+    for (i = 0; i < s->nmembers; i++) {
+        struct field *f = &s->member[i];
+        rc = CLIENT_to_SERVER(&ival, sizeof(ival), CLIENT_INT, 0, NULL, NULL,
+                              row + f->offset, f->len, f->type, 0, &outsz,
+                              &outopts, NULL);
+        if (rc)
+            rc = CLIENT_to_SERVER(str, strlen(str) + 1, CLIENT_CSTR, 0, NULL,
+                                  NULL, row + f->offset, f->len, f->type, 0,
+                                  &outsz, &outopts, NULL);
+        if (rc)
+            set_null(row + f->offset, f->len);
+    }
+}
+
+/* Insert rows records into one transaction the way the master applies an
+ * osql insert with delayed keys, add the keys, then abort. */
+static void *apply_bench_thd(void *varg)
+{
+    struct apply_bench_arg *arg = varg;
+    static const uint8_t ondisk_tag[] = ".ONDISK";
+    struct thread_info *thdinfo;
+    block_state_t blkstate = {0};
+    blob_buffer_t blobs[MAXBLOBS] = {{0}};
+    struct ireq iq;
+    void *trans = NULL;
+    uint8_t *row = NULL;
+    unsigned long long genid;
+    long long base;
+    int i, rc, start, opfailcode, ixfailnum, rrn, blkpos, ixout, errout;
+
+    thread_started("apply_bench");
+    backend_thread_event(thedb, COMDB2_THR_EVENT_START_RDWR);
+
+    /* delayed keys are queued in the thread's constraint tables */
+    thdinfo = calloc(1, sizeof(struct thread_info));
+    if (thdinfo == NULL) {
+        arg->rc = ERR_INTERNAL;
+        goto done;
+    }
+    thdinfo->ct_add_table = create_constraint_table(&thdinfo->ct_id_key);
+    thdinfo->ct_del_table = create_constraint_table(&thdinfo->ct_id_key);
+    thdinfo->ct_add_index = create_constraint_index_table(&thdinfo->ct_id_key);
+    pthread_setspecific(unique_tag_key, thdinfo);
+    row = malloc(arg->db->lrl);
+    if (!thdinfo->ct_add_table || !thdinfo->ct_del_table ||
+        !thdinfo->ct_add_index || !row) {
+        fprintf(stderr, "%s: can't allocate constraint tables\n", __func__);
+        arg->rc = ERR_INTERNAL;
+        goto out;
+    }
+
+    init_fake_ireq(thedb, &iq);
+    iq.use_handle = thedb->bdb_env;
+    iq.usedb = arg->db;
+    iq.blkstate = &blkstate;
+    base = (long long)time_epochms() * 1000;
+
+    if ((rc = trans_start(&iq, NULL, &trans)) != 0) {
+        fprintf(stderr, "%s: error creating trans rc=%d\n", __func__, rc);
+        arg->rc = rc;
+        goto out;
+    }
+
+    start = time_epochms();
+    for (i = 0, rc = 0; i < arg->rows && rc == 0; i++) {
+        apply_bench_row(arg->db, base + i, row);
+        rc = add_record(&iq, trans, ondisk_tag,
+                        ondisk_tag + sizeof(ondisk_tag) - 1, row,
+                        row + arg->db->lrl, NULL, blobs, MAXBLOBS, &opfailcode,
+                        &ixfailnum, &rrn, &genid, -1ULL, BLOCK2_ADDKL, i,
+                        RECFLAGS_DYNSCHEMA_NULLS_ONLY);
+        if (rc)
+            fprintf(stderr, "%s: add_record row %d rc=%d opfailcode=%d\n",
+                    __func__, i, rc, opfailcode);
+    }
+    arg->addms = time_epochms() - start;
+
+    if (rc == 0) {
+        start = time_epochms();
+        rc = delayed_key_adds(&iq, &blkstate, trans, &blkpos, &ixout, &errout);
+        arg->keyms = time_epochms() - start;
+        if (rc)
+            fprintf(stderr, "%s: delayed_key_adds rc=%d ix %d errout %d\n",
+                    __func__, rc, ixout, errout);
+    }
+    arg->rc = rc;
+
+    trans_abort(&iq, trans);
+    clear_constraints_tables();
+
+out:
+    free(row);
+    if (thdinfo->ct_add_table)
+        delete_constraint_table(thdinfo->ct_add_table);
+    if (thdinfo->ct_del_table)
+        delete_constraint_table(thdinfo->ct_del_table);
+    if (thdinfo->ct_add_index)
+        delete_constraint_table(thdinfo->ct_add_index);
+    pthread_setspecific(unique_tag_key, NULL);
+    free(thdinfo);
+done:
+    backend_thread_event(thedb, COMDB2_THR_EVENT_DONE_RDWR);
+    return NULL;
+}
+
+/* Apply the same big insert transaction with the index keys added serially
+ * and with nthreads threads, and report rows per second for each.  Nothing
+ * is committed. */
+static void apply_bench_int(struct db *db, int rows, int nthreads)
+{
+    struct apply_bench_arg arg[2];
+    int saved_threads = gbl_osql_apply_ix_threads;
+    int saved_min_rows = gbl_osql_apply_ix_min_rows;
+    pthread_t tid;
+    int i, rc;
+
+    assert(rows >= 1 && nthreads >= 1);
+
+    if (db->numblobs) {
+        fprintf(stderr, "%s: table %s has blobs\n", __func__, db->dbname);
+        return;
+    }
+
+    for (i = 0; i < 2; i++) {
+        memset(&arg[i], 0, sizeof(arg[i]));
+        arg[i].db = db;
+        arg[i].rows = rows;
+        gbl_osql_apply_ix_threads = i ? nthreads : 0;
+        gbl_osql_apply_ix_min_rows = 0;
+        if ((rc = pthread_create(&tid, NULL, apply_bench_thd, &arg[i])) != 0) {
+            fprintf(stderr, "%s: pthread_create rc=%d\n", __func__, rc);
+            arg[i].rc = rc;
+        } else {
+            pthread_join(tid, NULL);
+        }
+        gbl_osql_apply_ix_threads = saved_threads;
+        gbl_osql_apply_ix_min_rows = saved_min_rows;
+        if (arg[i].rc) {
+            fprintf(stderr, "%s: run %d failed rc=%d\n", __func__, i,
+                    arg[i].rc);
+            return;
+        }
+    }
+
+    printf("table %s, %d rows in one transaction, %d indexes\n", db->dbname,
+           rows, db->nix);
+    for (i = 0; i < 2; i++) {
+        int ms = arg[i].addms + arg[i].keyms;
+        printf("%-8s threads=%-3d records %d ms, keys %d ms, ", 
+               i ? "parallel" : "serial", i ? nthreads : 1, arg[i].addms,
+               arg[i].keyms);
+        if (ms)
+            printf("(%lld rows per second)\n", (long long)rows * 1000 / ms);
+        else
+            printf("(0 ms elapsed)\n");
+    }
+}
+
+void apply_bench(const char *table, int rows, int nthreads)
+{
+    struct db *db = getdbbyname(table);
+    if (db == NULL) {
+        fprintf(stderr, "%s: no such table %s\n", __func__, table);
+        return;
+    }
+    apply_bench_int(db, rows, nthreads);
+}
+
 void rowlocks_bench(void *state, int lcount, int count)
 {
     bdb_state_type *bdb_state = state;
-    rowlocks_bench_int(bdb_state, ROWLOCKS_BENCH, lcount, count);
+    rowlocks_bench_int(bdb_state, ROWLOCKS_BENCH, lcount, count, 1);
 }
 
-void rowlocks_lock1_bench(void *state, int lcount, int count)
+void rowlocks_lock1_bench(void *state, int lcount, int count, int nthreads)
 {
     bdb_state_type *bdb_state = state;
-    rowlocks_bench_int(bdb_state, ROWLOCKS_LOCK1_BENCH, lcount, count);
+    rowlocks_bench_int(bdb_state, ROWLOCKS_LOCK1_BENCH, lcount, count,
+                       nthreads);
 }
 
-void rowlocks_lock2_bench(void *state, int lcount, int count)
+void rowlocks_lock2_bench(void *state, int lcount, int count, int nthreads)
 {
     bdb_state_type *bdb_state = state;
-    rowlocks_bench_int(bdb_state, ROWLOCKS_LOCK2_BENCH, lcount, count);
+    rowlocks_bench_int(bdb_state, ROWLOCKS_LOCK2_BENCH, lcount, count,
+                       nthreads);
 }
 
 void commit_bench(void *state, int tcount, int count)
@@ -502,6 +502,8 @@ struct sqlclntstate {
     uint32_t init_gen;
     int8_t gen_changed;
     uint8_t skip_peer_chk;
+    uint8_t is_pipelined; /* client may queue requests behind this one */
+    uint8_t want_bindrows; /* client asks whether bindrows is supported */
 };
 
 /* Query stats. */
@@ -685,6 +687,7 @@ struct BtCursor {
 
     unsigned long long col_mask; /* tracking first 63 columns, if bit is set,
                                     column is needed */
+    int projlen; /* if set, rows past this many ondisk bytes may be zeroed */
 
     unsigned long long keyDdl; /* rowid for side DDL row */
     char *dataDdl;             /* DDL row, cached during CREATE operations */
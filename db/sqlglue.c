@@ -131,6 +131,7 @@ extern int gbl_notimeouts;
 extern int gbl_move_deadlk_max_attempt;
 extern int gbl_fdb_track;
 extern int gbl_selectv_rangechk;
+extern __thread int memp_scan_thread;
 extern volatile int gbl_schema_change_in_progress;
 
 unsigned long long gbl_sql_deadlock_reconstructions = 0;
@@ -482,6 +483,14 @@ int peer_dropped_connection(struct sqlclntstate *clnt)
     }
     if ((fd.revents & POLLIN) && clnt->want_query_effects)
         return 0;
+    if ((fd.revents & POLLIN) && clnt->is_pipelined) {
+        /* The next request may be waiting: only EOF means the peer left */
+        char c;
+        rc = recv(fd.fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+        if (rc > 0 || (rc < 0 && (errno == EAGAIN || errno == EINTR)))
+            return 0;
+        return 1;
+    }
     // shouldn't have any events
     return 1;
 }
@@ -649,6 +658,72 @@ void done_sql_thread(void)
 static int get_data_int(BtCursor *, struct schema *, uint8_t *in, int fnum,
                         Mem *, uint8_t flip_orig, const char *tzname);
 
+/* Fixed width ondisk fields are decoded in place here rather than through
+ * the generic SERVER_* to CLIENT_* conversions, which write network order
+ * output only for us to flip it back.  in points past the header byte. */
+static inline i64 ondisk_bint_value(const uint8_t *in, int len)
+{
+    uint16_t v2;
+    uint32_t v4;
+    uint64_t v8;
+
+    switch (len) {
+    case 3:
+        memcpy(&v2, in, sizeof(v2));
+        return (int16_t)(ntohs(v2) ^ 0x8000U);
+    case 5:
+        memcpy(&v4, in, sizeof(v4));
+        return (int32_t)(ntohl(v4) ^ 0x80000000U);
+    default:
+        memcpy(&v8, in, sizeof(v8));
+        return (i64)(flibc_ntohll(v8) ^ 0x8000000000000000ULL);
+    }
+}
+
+static inline i64 ondisk_uint_value(const uint8_t *in, int len)
+{
+    uint16_t v2;
+    uint32_t v4;
+    uint64_t v8;
+
+    switch (len) {
+    case 3:
+        memcpy(&v2, in, sizeof(v2));
+        return ntohs(v2);
+    case 5:
+        memcpy(&v4, in, sizeof(v4));
+        return ntohl(v4);
+    default:
+        memcpy(&v8, in, sizeof(v8));
+        return flibc_ntohll(v8);
+    }
+}
+
+static inline double ondisk_breal_value(const uint8_t *in, int len)
+{
+    uint32_t v4;
+    uint64_t v8;
+    float r4;
+    double r8;
+
+    /* positive values had their sign bit set, negative ones every bit */
+    if (len == 5) {
+        memcpy(&v4, in, sizeof(v4));
+        v4 = ntohl(v4);
+        v4 ^= ((v4 >> 31) - 1) | 0x80000000U;
+        memcpy(&r4, &v4, sizeof(r4));
+        return r4;
+    }
+    memcpy(&v8, in, sizeof(v8));
+    v8 = flibc_ntohll(v8);
+    v8 ^= ((v8 >> 63) - 1) | 0x8000000000000000ULL;
+    memcpy(&r8, &v8, sizeof(r8));
+    return r8;
+}
+
+/* Rows with up to this many columns are converted without a malloc. */
+#define ONDISK_TO_SQLITE_STACK_COLS 64
+
 static int ondisk_to_sqlite_tz(struct db *db, struct schema *s, void *inp,
                                int rrn, unsigned long long genid, void *outp,
                                int maxout, int nblobs, void **blob,
@@ -661,7 +736,10 @@ static int ondisk_to_sqlite_tz(struct db *db, struct schema *s, void *inp,
     int i;
     int rc = 0;
     int null;
+    Mem mstack[ONDISK_TO_SQLITE_STACK_COLS + 1];
+    u32 tstack[ONDISK_TO_SQLITE_STACK_COLS + 1];
     Mem *m = NULL;
+    u32 *types;
     u32 type;
     int datasz = 0;
     int hdrsz = 0;
@@ -676,18 +754,25 @@ static int ondisk_to_sqlite_tz(struct db *db, struct schema *s, void *inp,
     int rec_srt_off = gbl_sort_nulls_correctly ? 0 : 1;
     u32 len;
 
-    m = (Mem *)malloc(sizeof(Mem) * MAXCOLUMNS);
-    if (m == NULL) {
-        logmsg(LOGMSG_ERROR, "%s: failed to malloc Mem\n", __func__);
-        return -1;
-    }
-
     /* Raw index optimization */
     if (pCur && pCur->nCookFields >= 0)
         nField = pCur->nCookFields;
     else
         nField = s->nmembers;
 
+    /* one more for the genid */
+    if (nField <= ONDISK_TO_SQLITE_STACK_COLS) {
+        m = mstack;
+        types = tstack;
+    } else {
+        m = (Mem *)malloc((sizeof(Mem) + sizeof(u32)) * (nField + 1));
+        if (m == NULL) {
+            logmsg(LOGMSG_ERROR, "%s: failed to malloc Mem\n", __func__);
+            return -1;
+        }
+        types = (u32 *)&m[nField + 1];
+    }
+
 #ifdef debug_raw
     printf("convert => %s %s %d / %d\n", db->dbname, s->tag, nField,
            s->nmembers);
@@ -700,7 +785,7 @@ static int ondisk_to_sqlite_tz(struct db *db, struct schema *s, void *inp,
         rc = get_data_int(pCur, s, in, fnum, &m[fnum], 1, tzname);
         if (rc)
             goto done;
-        type =
+        type = types[fnum] =
             sqlite3VdbeSerialType(&m[fnum], SQLITE_DEFAULT_FILE_FORMAT, &len);
         sz = sqlite3VdbeSerialTypeLen(type);
         datasz += sz;
@@ -715,7 +800,7 @@ static int ondisk_to_sqlite_tz(struct db *db, struct schema *s, void *inp,
         m[fnum].u.i = genid;
         m[fnum].flags = MEM_Int;
 
-        type =
+        type = types[fnum] =
             sqlite3VdbeSerialType(&m[fnum], SQLITE_DEFAULT_FILE_FORMAT, &len);
         sz = sqlite3VdbeSerialTypeLen(type);
         datasz += sz;
@@ -753,15 +838,10 @@ static int ondisk_to_sqlite_tz(struct db *db, struct schema *s, void *inp,
     remainingsz = datasz;
 
     for (fnum = 0; fnum < ncols; fnum++) {
-        // TODO: verify that this works as before
-        u32 serial_type =
-            sqlite3VdbeSerialType(&m[fnum], SQLITE_DEFAULT_FILE_FORMAT, &len);
-        sz = sqlite3VdbeSerialPut(dtabuf, &m[fnum], serial_type);
+        sz = sqlite3VdbeSerialPut(dtabuf, &m[fnum], types[fnum]);
         dtabuf += sz;
         remainingsz -= sz;
-        sz = sqlite3PutVarint(
-            hdrbuf,
-            sqlite3VdbeSerialType(&m[fnum], SQLITE_DEFAULT_FILE_FORMAT, &len));
+        sz = sqlite3PutVarint(hdrbuf, types[fnum]);
         hdrbuf += sz;
         assert(hdrbuf <= (out + hdrsz));
     }
@@ -777,7 +857,7 @@ done:
             xorbuf(in + f->offset + rec_srt_off, f->len - rec_srt_off);
         }
     }
-    if (m)
+    if (m != mstack)
         free(m);
     return rc;
 }
@@ -2648,7 +2728,10 @@ static int cursor_move_table(BtCursor *pCur, int *pRes, int how)
         thd->nmove++;
 
     bdberr = 0;
+    /* Table scans read data pages once, don't let them flush the cache */
+    ++memp_scan_thread;
     rc = ddguard_bdb_cursor_move(thd, pCur, 0, &bdberr, how, NULL, 0);
+    --memp_scan_thread;
     if (bdberr == BDBERR_TRANTOOCOMPLEX) {
         return SQLITE_TRANTOOCOMPLEX;
     }
@@ -3174,9 +3257,11 @@ static int cursor_move_remote(BtCursor *pCur, int *pRes, int how)
 
         return SQLITE_SCHEMA_REMOTE;
     } else if (rc == FDB_ERR_FDB_VERSION) {
-        /* corner case, the db was backout to a lower protocol */
-        /* TODO: */
-        abort();
+        /* corner case, the db was backout to a lower protocol; the cursor
+           already downgraded, so only this statement fails */
+        logmsg(LOGMSG_ERROR, "%s remote db \"%s\" lowered its protocol\n",
+               __func__, pCur->fdbc->dbname(pCur));
+        return SQLITE_INTERNAL;
     } else {
         assert(rc != 0);
         logmsg(LOGMSG_ERROR, "%s dir %d rc %d\n", __func__, how, rc);
@@ -5640,9 +5725,12 @@ cursor_find_remote(BtCursor *pCur,            /* The cursor to be moved */
 
         return SQLITE_SCHEMA_REMOTE;
     } else if (rc == FDB_ERR_FDB_VERSION) {
-        /* corner case, the db was backout to a lower protocol */
-        /* TODO: */
-        abort();
+        /* corner case, the db was backout to a lower protocol; the cursor
+           already downgraded, so only this statement fails */
+        *pRes = -1;
+        logmsg(LOGMSG_ERROR, "%s remote db \"%s\" lowered its protocol\n",
+               __func__, pCur->fdbc->dbname(pCur));
+        return SQLITE_INTERNAL;
     } else {
         *pRes = -1;
         assert(rc != 0);
@@ -6824,6 +6912,12 @@ static int get_data_int(BtCursor *pCur, struct schema *sc, uint8_t *in,
 
     switch (f->type) {
     case SERVER_UINT:
+        /* 8 byte values past LLONG_MAX go through the range check below */
+        if (f->len == 3 || f->len == 5 || (f->len == 9 && !(in[1] & 0x80))) {
+            m->u.i = ondisk_uint_value(&in[1], f->len);
+            m->flags = MEM_Int;
+            break;
+        }
         rc = SERVER_UINT_to_CLIENT_INT(
             in, f->len, NULL /*convopts */, NULL /*blob */, &ival, sizeof(ival),
             &null, &outdtsz, NULL /*convopts */, NULL /*blob */);
@@ -6838,6 +6932,11 @@ static int get_data_int(BtCursor *pCur, struct schema *sc, uint8_t *in,
         break;
 
     case SERVER_BINT:
+        if (f->len == 3 || f->len == 5 || f->len == 9) {
+            m->u.i = ondisk_bint_value(&in[1], f->len);
+            m->flags = MEM_Int;
+            break;
+        }
         rc = SERVER_BINT_to_CLIENT_INT(
             in, f->len, NULL /*convopts */, NULL /*blob */, &ival, sizeof(ival),
             &null, &outdtsz, NULL /*convopts */, NULL /*blob */);
@@ -6853,6 +6952,11 @@ static int get_data_int(BtCursor *pCur, struct schema *sc, uint8_t *in,
         break;
 
     case SERVER_BREAL:
+        if (f->len == 5 || f->len == 9) {
+            m->u.r = ondisk_breal_value(&in[1], f->len);
+            m->flags = MEM_Real;
+            break;
+        }
         rc = SERVER_BREAL_to_CLIENT_REAL(
             in, f->len, NULL /*convopts */, NULL /*blob */, &dval, sizeof(dval),
             &null, &outdtsz, NULL /*convopts */, NULL /*blob */);
@@ -6905,16 +7009,9 @@ static int get_data_int(BtCursor *pCur, struct schema *sc, uint8_t *in,
                 m->flags = MEM_Datetime;
                 m->tz = (char *)tzname;
             } else {
-                rc = SERVER_BINT_to_CLIENT_INT(
-                    in, sizeof(db_time_t) + 1, NULL /*convopts */,
-                    NULL /*blob */, &(m->du.dt.dttz_sec),
-                    sizeof(m->du.dt.dttz_sec), &null, &outdtsz,
-                    NULL /*convopts */, NULL /*blob */);
-                if (rc == -1)
-                    goto done;
-
+                m->du.dt.dttz_sec =
+                    ondisk_bint_value(&in[1], sizeof(db_time_t) + 1);
                 memcpy(&msec, &in[1] + sizeof(db_time_t), sizeof(msec));
-                m->du.dt.dttz_sec = flibc_ntohll(m->du.dt.dttz_sec);
                 msec = ntohs(msec);
                 m->du.dt.dttz_frac = msec;
                 m->du.dt.dttz_prec = DTTZ_PREC_MSEC;
@@ -6959,16 +7056,9 @@ static int get_data_int(BtCursor *pCur, struct schema *sc, uint8_t *in,
                     m->flags = MEM_Datetime;
                     m->tz = (char *)tzname;
                 } else {
-                    rc = SERVER_BINT_to_CLIENT_INT(
-                        in, sizeof(db_time_t) + 1, NULL /*convopts */,
-                        NULL /*blob */, &(m->du.dt.dttz_sec),
-                        sizeof(m->du.dt.dttz_sec), &null, &outdtsz,
-                        NULL /*convopts */, NULL /*blob */);
-                    if (rc == -1)
-                        goto done;
-
+                    m->du.dt.dttz_sec =
+                        ondisk_bint_value(&in[1], sizeof(db_time_t) + 1);
                     memcpy(&usec, &in[1] + sizeof(db_time_t), sizeof(usec));
-                    m->du.dt.dttz_sec = flibc_ntohll(m->du.dt.dttz_sec);
                     usec = ntohl(usec);
                     m->du.dt.dttz_frac = usec;
                     m->du.dt.dttz_prec = DTTZ_PREC_USEC;
@@ -7208,12 +7298,52 @@ done:
     return rc;
 }
 
+/* A read reached past the bytes sqlite promised to use when it set the
+ * projection: turn it off for this cursor and fetch the current row again
+ * in full, rather than hand back the zeroes that stand for the rest. */
+static int projection_miss(BtCursor *pCur)
+{
+    unsigned long long genid = pCur->genid;
+    int bdberr = 0, fndlen, rc;
+    void *buf;
+    uint8_t ver;
+
+    pCur->projlen = 0;
+    pCur->bdbcur->set_projection(pCur->bdbcur, 0);
+    if (is_genid_synthetic(genid))
+        return SQLITE_OK; /* shadow rows are never cut short */
+
+    rc = ddguard_bdb_cursor_find(pCur->thd, pCur, pCur->bdbcur, &genid,
+                                 sizeof(genid), 0, OP_NotExists, &bdberr);
+    if (rc != IX_FND) {
+        if (rc == BDBERR_DEADLOCK || bdberr == BDBERR_DEADLOCK)
+            return SQLITE_DEADLOCK;
+        logmsg(LOGMSG_ERROR, "%s: refetch of genid %llx rc %d bdberr %d\n",
+               __func__, genid, rc, bdberr);
+        return SQLITE_INTERNAL;
+    }
+    pCur->bdbcur->get_found_data(pCur->bdbcur, &pCur->rrn, &pCur->genid,
+                                 &fndlen, &buf, &ver);
+    vtag_to_ondisk(pCur->db, buf, &fndlen, ver, pCur->genid);
+    pCur->ondisk_buf = buf;
+    pCur->dtabuf = buf;
+    return SQLITE_OK;
+}
+
 int get_data(BtCursor *pCur, void *invoid, int fnum, Mem *m)
 {
     if (unlikely(pCur->cursor_class == CURSORCLASS_REMOTE)) {
         /* convert the remote buffer to M array */
         abort(); /* this is suppsed to be a cooked access */
     } else {
+        if (unlikely(pCur->projlen) && invoid == pCur->dtabuf &&
+            pCur->sc->member[fnum].offset + pCur->sc->member[fnum].len >
+                pCur->projlen) {
+            int rc = projection_miss(pCur);
+            if (rc)
+                return rc;
+            invoid = pCur->dtabuf;
+        }
         return get_data_int(pCur, pCur->sc, invoid, fnum, m, 0,
                             pCur->clnt->tzname);
     }
@@ -8868,6 +8998,9 @@ int sqlite3BtreeData(BtCursor *pCur, u32 offset, u32 amt, void *pBuf)
         }
         memcpy(pBuf, dta + offset, amt);
     } else if (pCur->ixnum == -1) {
+        /* the whole row is wanted, not just the projected columns */
+        if (pCur->projlen && (rc = projection_miss(pCur)) != SQLITE_OK)
+            return rc;
         memcpy(pBuf, ((char *)pCur->dtabuf) + offset, amt);
     } else if (pCur->bt->is_remote) {
 
@@ -10659,6 +10792,369 @@ int sqlite3BtreeCount(BtCursor *pCur, i64 *pnEntry)
     return rc;
 }
 
+int gbl_parallel_agg = 0;
+
+/* One aggregate over one stripe, or over the whole table once merged. */
+struct parallel_agg {
+    i64 cnt;      /* rows for count(*), otherwise non-null values */
+    i64 isum;     /* integer sum, valid unless approx or overflow */
+    double rsum;  /* floating point sum */
+    int approx;   /* saw a real value */
+    int overflow; /* isum overflowed */
+    int have;     /* min/max below are set */
+    int isreal;
+    i64 ival;
+    double rval;
+};
+
+struct parallel_agg_scan {
+    struct db *db;
+    int nagg;
+    const int *spec;
+    struct parallel_agg *part; /* nagg per stripe */
+    i64 *nrows;                /* rows per stripe */
+    uint8_t **buf;             /* per stripe, for older schema versions */
+    int datsize;
+};
+
+static int parallel_agg_row(void *arg, int stripe, void *dta, int dtalen,
+                            uint8_t ver)
+{
+    struct parallel_agg_scan *scan = arg;
+    struct parallel_agg *part = &scan->part[stripe * scan->nagg];
+    uint8_t *rec = dta;
+    int i;
+
+    if (ver && ver != scan->db->version) {
+        int len = dtalen;
+        if (dtalen > scan->datsize)
+            return -1;
+        rec = scan->buf[stripe];
+        memcpy(rec, dta, dtalen);
+        vtag_to_ondisk_vermap(scan->db, rec, &len, ver);
+    }
+    scan->nrows[stripe]++;
+
+    for (i = 0; i < scan->nagg; i++) {
+        int kind = scan->spec[3 * i];
+        struct parallel_agg *a = &part[i];
+        Mem m;
+
+        if (kind == BTREE_AGG_COUNTSTAR) {
+            a->cnt++;
+            continue;
+        }
+        memset(&m, 0, sizeof(m));
+        if (get_data_int(NULL, scan->db->schema, rec, scan->spec[3 * i + 1],
+                         &m, 0, NULL))
+            return -1;
+        if (m.flags & MEM_Null)
+            continue;
+        a->cnt++;
+
+        switch (kind) {
+        case BTREE_AGG_SUM:
+        case BTREE_AGG_TOTAL:
+        case BTREE_AGG_AVG:
+            if (m.flags & MEM_Int) {
+                a->rsum += m.u.i;
+                if (!a->approx && !a->overflow &&
+                    sqlite3AddInt64(&a->isum, m.u.i))
+                    a->overflow = 1;
+            } else {
+                a->rsum += m.u.r;
+                a->approx = 1;
+            }
+            break;
+        case BTREE_AGG_MIN:
+        case BTREE_AGG_MAX:
+            if (m.flags & MEM_Int) {
+                if (!a->have || (kind == BTREE_AGG_MIN ? m.u.i < a->ival
+                                                       : m.u.i > a->ival))
+                    a->ival = m.u.i;
+            } else {
+                if (!a->have || (kind == BTREE_AGG_MIN ? m.u.r < a->rval
+                                                       : m.u.r > a->rval))
+                    a->rval = m.u.r;
+                a->isreal = 1;
+            }
+            a->have = 1;
+            break;
+        }
+    }
+    return 0;
+}
+
+/* Fold stripe partial b into a, in stripe order. */
+static void parallel_agg_merge(int kind, struct parallel_agg *a,
+                               const struct parallel_agg *b)
+{
+    a->cnt += b->cnt;
+    a->rsum += b->rsum;
+    a->approx |= b->approx;
+    a->overflow |= b->overflow;
+    if (!a->approx && !a->overflow && sqlite3AddInt64(&a->isum, b->isum))
+        a->overflow = 1;
+    if (!b->have)
+        return;
+    if (!a->have ||
+        (b->isreal ? (kind == BTREE_AGG_MIN ? b->rval < a->rval
+                                            : b->rval > a->rval)
+                   : (kind == BTREE_AGG_MIN ? b->ival < a->ival
+                                            : b->ival > a->ival))) {
+        a->ival = b->ival;
+        a->rval = b->rval;
+        a->isreal = b->isreal;
+    }
+    a->have = 1;
+}
+
+extern int gbl_fdb_pushdown;
+extern int gbl_fdb_track_hints;
+
+/*
+ ** Have the database owning the remote table of pCur compute the aggregates
+ ** in a single "SELECT agg, ... FROM table [WHERE hint]" and put the one row
+ ** it sends back into aMem.  Anything that can't be sent, or a remote error,
+ ** leaves *pDone at 0 so the regular loop runs (and reports the error).
+ */
+static int remote_agg(BtCursor *pCur, int nAgg, const int *aSpec,
+                      int bFiltered, Mem *aMem, int *pDone)
+{
+    fdb_cursor_if_t *fdbc = pCur->fdbc;
+    Table *pTab;
+    Expr *hint;
+    Mem m[MAXCOLUMNS];
+    char *where = NULL;
+    char *cols = NULL;
+    char *sql = NULL;
+    char *row;
+    unsigned int hdrsz, type;
+    int hdroffset, dataoffset;
+    int rowlen;
+    int i, rc;
+
+    /* older remotes read a genid off the end of every row they send back,
+       past the end of a short aggregate row; their protocol version was
+       learned when their schema was fetched */
+    if (!gbl_fdb_pushdown || fdbc == NULL || nAgg > MAXCOLUMNS ||
+        fdb_server_version(pCur->bt->fdb) < FDB_VER_AGG_PUSHDOWN ||
+        fdbc->table_entry(pCur) == NULL || is_sqlite_stat(fdbc->name(pCur)))
+        return SQLITE_OK;
+    if (authenticate_cursor(pCur, AUTHENTICATE_READ) != 0)
+        return SQLITE_OK; /* let the regular loop report it */
+
+    pTab = sqlite3FindTable(pCur->sqlite, fdbc->tblname(pCur),
+                            fdbc->dbname(pCur));
+    if (pTab == NULL)
+        return SQLITE_OK;
+
+    if (bFiltered) {
+        hint = fdbc->get_hint(pCur);
+        if (hint == NULL ||
+            (where = sqlite3ExprDescribeAtRuntime(pCur->vdbe, hint)) == NULL)
+            return SQLITE_OK;
+    }
+
+    for (i = 0; i < nAgg; i++) {
+        static const char *fn[] = {NULL,  "count", "count", "sum",
+                                   "total", "avg", "min",   "max"};
+        int kind = aSpec[3 * i];
+        int col = aSpec[3 * i + 1];
+        char *c;
+
+        if (kind == BTREE_AGG_COUNTSTAR)
+            c = sqlite3_mprintf("%z%scount(*)", cols, i ? ", " : "");
+        else if (col >= 0 && col < pTab->nCol)
+            c = sqlite3_mprintf("%z%s%s(\"%w\")", cols, i ? ", " : "", fn[kind],
+                                pTab->aCol[col].zName);
+        else
+            c = NULL;
+        if (c == NULL)
+            goto done;
+        cols = c;
+    }
+    sql = sqlite3_mprintf("SELECT %s FROM \"%w\"%s%s", cols, pTab->zName,
+                          where ? " WHERE " : "", where ? where : "");
+    if (sql == NULL)
+        goto done;
+
+    if (gbl_fdb_track_hints)
+        logmsg(LOGMSG_USER, "Remote aggregate \"%s\"\n", sql);
+
+    fdbc->set_sql(pCur, sql);
+    rc = fdbc->move(pCur, CFIRST);
+    fdbc->set_sql(pCur, NULL);
+    if (rc != IX_FND)
+        goto done;
+
+    /* the one row is a packed sqlite record with nAgg fields */
+    row = fdbc->data(pCur);
+    rowlen = fdbc->datalen(pCur);
+    hdroffset = sqlite3GetVarint32((unsigned char *)row, &hdrsz);
+    dataoffset = hdrsz;
+    for (i = 0; i < nAgg; i++) {
+        if (hdroffset >= hdrsz || hdrsz > rowlen)
+            goto done;
+        hdroffset +=
+            sqlite3GetVarint32((unsigned char *)row + hdroffset, &type);
+        if (dataoffset + sqlite3VdbeSerialTypeLen(type) > rowlen)
+            goto done;
+        memset(&m[i], 0, sizeof(Mem));
+        m[i].db = pCur->sqlite;
+        m[i].enc = SQLITE_UTF8;
+        dataoffset += sqlite3VdbeSerialGet((unsigned char *)row + dataoffset,
+                                           type, &m[i]);
+    }
+    for (i = 0; i < nAgg; i++) {
+        if (sqlite3VdbeMemCopy(&aMem[aSpec[3 * i + 2]], &m[i]))
+            goto done;
+    }
+
+    pCur->nfind++;
+    *pDone = 1;
+
+done:
+    sqlite3_free(sql);
+    sqlite3_free(cols);
+    if (where)
+        sqlite3DbFree(pCur->sqlite, where);
+    return SQLITE_OK;
+}
+
+/*
+ ** Compute the aggregates described by aSpec (nAgg triples of kind, column
+ ** and result register) over the whole table of pCur, one thread per data
+ ** stripe, and store the final values in aMem.  *pDone is left at 0, and
+ ** aMem untouched, if this table or these aggregates have to go through the
+ ** regular aggregate loop instead.  A remote table gets them from its own
+ ** database, with the cursor's range hint applied if bFiltered is set.
+ */
+int sqlite3BtreeParallelAgg(BtCursor *pCur, int nAgg, const int *aSpec,
+                            int bFiltered, Mem *aMem, int *pDone)
+{
+    struct sql_thread *thd = pCur->thd;
+    struct parallel_agg_scan scan;
+    struct parallel_agg *total;
+    int nstripes = gbl_dtastripe;
+    i64 nrows = 0;
+    int i, j, rc;
+
+    *pDone = 0;
+    if (pCur->bt && pCur->bt->is_remote)
+        return remote_agg(pCur, nAgg, aSpec, bFiltered, aMem, pDone);
+    if (bFiltered)
+        return SQLITE_OK;
+    if (!gbl_parallel_agg || pCur->cursor_class != CURSORCLASS_TABLE ||
+        pCur->clnt->intrans || pCur->is_recording || pCur->is_sampled_idx ||
+        pCur->bdbcur == NULL || !pCur->db->dtastripe || nstripes < 1)
+        return SQLITE_OK;
+    /* the direct scan reads the latest committed rows, not the snapshot
+     * these levels promise even to a single statement */
+    if (pCur->clnt->dbtran.mode == TRANLEVEL_SNAPISOL ||
+        pCur->clnt->dbtran.mode == TRANLEVEL_SERIAL)
+        return SQLITE_OK;
+    if (!thd->sqlclntstate->limits.tablescans_ok ||
+        access_control_check_sql_read(pCur, thd))
+        return SQLITE_OK; /* let the regular loop report it */
+
+    for (i = 0; i < nAgg; i++) {
+        struct field *f;
+        if (aSpec[3 * i] == BTREE_AGG_COUNTSTAR)
+            continue;
+        if (aSpec[3 * i + 1] >= pCur->db->schema->nmembers)
+            return SQLITE_OK;
+        f = &pCur->db->schema->member[aSpec[3 * i + 1]];
+        if (f->type != SERVER_BINT && f->type != SERVER_UINT &&
+            f->type != SERVER_BREAL)
+            return SQLITE_OK;
+    }
+
+    memset(&scan, 0, sizeof(scan));
+    scan.db = pCur->db;
+    scan.nagg = nAgg;
+    scan.spec = aSpec;
+    scan.datsize = getdatsize(pCur->db);
+    scan.part = calloc(nstripes * nAgg + nAgg, sizeof(struct parallel_agg));
+    scan.nrows = calloc(nstripes, sizeof(i64));
+    scan.buf = calloc(nstripes, sizeof(uint8_t *));
+    rc = (scan.part && scan.nrows && scan.buf) ? 0 : -1;
+    for (i = 0; rc == 0 && i < nstripes; i++) {
+        if ((scan.buf[i] = malloc(scan.datsize + 2)) == NULL)
+            rc = -1;
+    }
+    if (rc == 0)
+        rc = bdb_direct_scan(pCur->bdbcur, nstripes, parallel_agg_row, &scan);
+
+    if (rc == 0) {
+        total = &scan.part[nstripes * nAgg];
+        for (j = 0; j < nstripes; j++) {
+            nrows += scan.nrows[j];
+            for (i = 0; i < nAgg; i++)
+                parallel_agg_merge(aSpec[3 * i], &total[i],
+                                   &scan.part[j * nAgg + i]);
+        }
+        /* sum() has to raise "integer overflow"; leave that to the loop */
+        for (i = 0; i < nAgg; i++) {
+            if (aSpec[3 * i] == BTREE_AGG_SUM && total[i].overflow)
+                rc = -1;
+        }
+    }
+
+    if (rc == 0) {
+        for (i = 0; i < nAgg; i++) {
+            struct parallel_agg *a = &total[i];
+            Mem *pOut = &aMem[aSpec[3 * i + 2]];
+            switch (aSpec[3 * i]) {
+            case BTREE_AGG_COUNTSTAR:
+            case BTREE_AGG_COUNT:
+                sqlite3VdbeMemSetInt64(pOut, a->cnt);
+                break;
+            case BTREE_AGG_SUM:
+                if (a->cnt == 0)
+                    sqlite3VdbeMemSetNull(pOut);
+                else if (a->approx)
+                    sqlite3VdbeMemSetDouble(pOut, a->rsum);
+                else
+                    sqlite3VdbeMemSetInt64(pOut, a->isum);
+                break;
+            case BTREE_AGG_TOTAL:
+                sqlite3VdbeMemSetDouble(pOut, a->rsum);
+                break;
+            case BTREE_AGG_AVG:
+                if (a->cnt == 0)
+                    sqlite3VdbeMemSetNull(pOut);
+                else
+                    sqlite3VdbeMemSetDouble(pOut, a->rsum / (double)a->cnt);
+                break;
+            case BTREE_AGG_MIN:
+            case BTREE_AGG_MAX:
+                if (!a->have)
+                    sqlite3VdbeMemSetNull(pOut);
+                else if (a->isreal)
+                    sqlite3VdbeMemSetDouble(pOut, a->rval);
+                else
+                    sqlite3VdbeMemSetInt64(pOut, a->ival);
+                break;
+            }
+        }
+        pCur->nfind++;
+        pCur->nmove += nrows;
+        thd->had_tablescans = 1;
+        thd->cost += pCur->find_cost + (pCur->move_cost * nrows);
+        *pDone = 1;
+    }
+
+    if (scan.buf) {
+        for (i = 0; i < nstripes; i++)
+            free(scan.buf[i]);
+        free(scan.buf);
+    }
+    free(scan.nrows);
+    free(scan.part);
+    return SQLITE_OK;
+}
+
 /*
  ** Return the size of a BtCursor object in bytes.
  **
@@ -11153,8 +11649,12 @@ static void sqlite3BtreeCursorHint_Range(BtCursor *pCur, const Expr *pExpr)
 
     if (pCur && pCur->bt && pCur->bt->is_remote) {
         expr = sqlite3ExprDescribeAtRuntime(pCur->vdbe, pExpr);
-        if (!expr) /* failed hinting, calling sqlite engine will catch it */
+        if (!expr) {
+            /* failed hinting, calling sqlite engine will catch it */
+            if (pCur->fdbc)
+                pCur->fdbc->set_hint(pCur, NULL);
             return;
+        }
 
         if (pCur->fdbc) {
             if (!pCur->bt->is_remote)
@@ -11170,6 +11670,23 @@ static void sqlite3BtreeCursorHint_Range(BtCursor *pCur, const Expr *pExpr)
     }
 }
 
+static void sqlite3BtreeCursorHint_Limit(BtCursor *pCur, i64 nRow,
+                                         int bRange)
+{
+    if (!pCur || !pCur->bt || !pCur->bt->is_remote || !pCur->fdbc)
+        return;
+
+    /* rows the remote side would drop are counted against its LIMIT, so it
+       only gets one if it got the whole range hint */
+    if (nRow < 0 || (bRange && !pCur->fdbc->get_hint(pCur)))
+        nRow = 0;
+
+    pCur->fdbc->set_limit(pCur, nRow);
+
+    if (gbl_fdb_track_hints && nRow > 0)
+        logmsg(LOGMSG_USER, "Hint LIMIT %lld\n", nRow);
+}
+
 /*
 ** Provide hints to the cursor.  The particular hint given (and the type
 ** and number of the varargs parameters) is determined by the eHintType
@@ -11202,6 +11719,15 @@ void sqlite3BtreeCursorHint(BtCursor *pCur, int eHintType, ...)
 
         break;
     }
+
+    case BTREE_HINT_LIMIT: {
+        i64 nRow = va_arg(ap, i64);
+        int bRange = va_arg(ap, int);
+
+        sqlite3BtreeCursorHint_Limit(pCur, nRow, bRange);
+
+        break;
+    }
     }
     va_end(ap);
 }
@@ -11701,6 +12227,49 @@ int stat_bt_hash_table_reset(char *table)
 
     return 0;
 }
+
+/* Train a zstd dictionary for table from nsamples of its records.  Records
+ * written after this use it if the table is zstd compressed. */
+int train_compr_dict(char *table, int nsamples)
+{
+    struct db *db;
+    bdb_state_type *bdb_state;
+    unsigned dictid;
+    int rc, bdberr = 0;
+
+    db = getdbbyname(table);
+    if (db == NULL) {
+        logmsg(LOGMSG_ERROR, "%s: invalid table %s\n", __func__, table);
+        return -1;
+    }
+    if (!db->odh) {
+        logmsg(LOGMSG_ERROR, "%s: table %s isn't ODH\n", __func__, table);
+        return -1;
+    }
+
+    bdb_state = (bdb_state_type *)db->handle;
+    if (nsamples <= 0)
+        nsamples = bdb_attr_get(thedb->bdb_attr, BDB_ATTR_ZSTD_DICT_SAMPLES);
+    rc = bdb_train_compr_dict(
+        bdb_state, nsamples,
+        bdb_attr_get(thedb->bdb_attr, BDB_ATTR_ZSTD_DICT_SIZE), &dictid);
+    if (rc) {
+        logmsg(LOGMSG_ERROR, "Failed to train dictionary for table %s\n",
+               table);
+        return -1;
+    }
+
+    // scdone log, so replicants load the new dictionary
+    rc = bdb_llog_scdone(bdb_state, setcompr, 1, &bdberr);
+    if (rc || bdberr != BDBERR_NOERROR) {
+        logmsg(LOGMSG_ERROR,
+               "Failed to send logical log scdone setcompr rc=%d bdberr=%d\n",
+               rc, bdberr);
+        return -1;
+    }
+    return 0;
+}
+
 /**
  * Retrieve the schema version for table
  *
@@ -11721,13 +12290,42 @@ unsigned long long comdb2_table_version(const char *tablename)
 
 void sqlite3RegisterDateTimeFunctions(void) {}
 
+int gbl_column_projection = 1;
+
 /**
  * Save what columns are accessed using this cursor
  *
  */
 void sqlite3BtreeCursorSetFieldUsed(BtCursor *pCur, unsigned long long mask)
 {
+    struct schema *sc;
+    int i, projlen;
+
     pCur->col_mask = mask;
+
+    /* Tell a read only table cursor how much of each row the statement can
+     * reach, so bdb can stop decompressing there.  The top bit stands for
+     * every column past the 63rd.  Reads past projlen go through
+     * projection_miss(). */
+    if (!gbl_column_projection || pCur->cursor_class != CURSORCLASS_TABLE ||
+        pCur->ixnum != -1 || pCur->writeTransaction || pCur->is_recording ||
+        pCur->bdbcur == NULL || (mask & (1ULL << 63)))
+        return;
+
+    sc = pCur->sc;
+    projlen = 0;
+    for (i = 0; i < sc->nmembers && i < 63; i++) {
+        if ((mask & (1ULL << i)) &&
+            sc->member[i].offset + sc->member[i].len > projlen)
+            projlen = sc->member[i].offset + sc->member[i].len;
+    }
+    /* a row with nothing referenced still needs one byte to be a row */
+    if (projlen == 0)
+        projlen = 1;
+    if (projlen < getdatsize(pCur->db)) {
+        pCur->projlen = projlen;
+        pCur->bdbcur->set_projection(pCur->bdbcur, projlen);
+    }
 }
 
 void clearClientSideRow(struct sqlclntstate *clnt)
@@ -163,6 +163,7 @@ int gbl_check_access_controls;
 extern int gbl_extended_tm_from_sql;
 
 struct thdpool *gbl_sqlengine_thdpool = NULL;
+struct thdpool *gbl_sqlsorter_thdpool = NULL;
 
 static void sql_reset_sqlthread(sqlite3 *db, struct sql_thread *thd);
 int blockproc2sql_error(int rc, const char *func, int line);
@@ -1050,6 +1051,10 @@ static int fill_snapinfo(struct sqlclntstate *clnt, int *file, int *offset)
     if (clnt->skip_feature) {                                                  \
         features[n_features] = CDB2_SERVER_FEATURES__SKIP_ROWS;                \
         n_features++;                                                          \
+    }                                                                          \
+    if (clnt->want_bindrows) {                                                 \
+        features[n_features] = CDB2_SERVER_FEATURES__BINDROWS;                 \
+        n_features++;                                                          \
     }                                                                          \
                                                                                \
     if (n_features) {                                                          \
@@ -4015,6 +4020,28 @@ static int check_client_specified_conversions(struct sqlthdstate *thd,
     return 0;
 }
 
+/* Bind one row of newsql parameters; a request with array bindings carries
+   bindrows rows of parameters back to back in bindvars */
+static int bind_newsql_row(struct sqlclntstate *clnt, struct sql_state *rec,
+                           int row, char **errstr)
+{
+    CDB2SQLQUERY query = *clnt->sql_query;
+
+    if (query.bindrows > 1) {
+        if (query.n_bindvars % query.bindrows) {
+            *errstr = sqlite3_mprintf(
+                "%d values provided, not a multiple of %d rows",
+                (int)query.n_bindvars, query.bindrows);
+            return -1;
+        }
+        query.n_bindvars /= query.bindrows;
+        query.bindvars += row * query.n_bindvars;
+    }
+
+    return bind_parameters(rec->stmt, NULL, &query, NULL, NULL, 0, NULL, NULL,
+                           clnt->tzname, gbl_dump_sql_dispatched, errstr);
+}
+
 static int bind_params(struct sqlthdstate *thd, struct sqlclntstate *clnt,
                        struct sql_state *rec, struct errstat *err)
 {
@@ -4024,9 +4051,7 @@ static int bind_params(struct sqlthdstate *thd, struct sqlclntstate *clnt,
     if (rec->parameters_to_bind ||
         (clnt->is_newsql && clnt->sql_query && clnt->sql_query->n_bindvars)) {
         if (clnt->is_newsql) {
-            rc = bind_parameters(rec->stmt, NULL, clnt->sql_query, NULL, NULL,
-                                 0, NULL, NULL, clnt->tzname,
-                                 gbl_dump_sql_dispatched, &errstr);
+            rc = bind_newsql_row(clnt, rec, 0, &errstr);
         } else {
             rc = bind_parameters(rec->stmt, rec->parameters_to_bind, NULL,
                                  clnt->tagbuf, clnt->nullbits, clnt->numblobs,
@@ -5111,6 +5136,73 @@ static int post_sqlite_processing(struct sqlthdstate *thd,
     return 0;
 }
 
+/* Run an array bound newsql request for every row of parameters but the last
+   one, and bind the last row; run_stmt() then steps that one like any other
+   statement, so the client gets its result, or the first error.  Outside of a
+   client transaction all the rows are folded into one: the first write opens
+   the transaction as if we had seen a begin, and the last row commits it.
+   Only the last row's result reaches the client, so statements that return
+   columns are refused rather than silently losing the other result sets. */
+static int run_stmt_bound_rows(struct sqlthdstate *thd,
+                               struct sqlclntstate *clnt,
+                               struct sql_state *rec, int *steprc,
+                               struct errstat *err)
+{
+    sqlite3_stmt *stmt = rec->stmt;
+    int nrows = clnt->sql_query->bindrows;
+    int autocommit = (clnt->ctrl_sqlengine == SQLENG_NORMAL_PROCESS);
+    char *errstr = NULL;
+    int row;
+    int rc;
+
+    if (sqlite3_column_count(stmt) > 0) {
+        errstat_set_rcstrf(err, ERR_PREPARE, "can't bind %d rows to a "
+                                             "statement that returns rows",
+                           nrows);
+        return -1;
+    }
+
+    if (autocommit)
+        sql_set_sqlengine_state(clnt, __FILE__, __LINE__, SQLENG_STRT_STATE);
+
+    for (row = 0; row < nrows - 1; row++) {
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+            ;
+        if (rc != SQLITE_DONE) {
+            *steprc = rc;
+            rc = 0;
+            goto abort;
+        }
+        sqlite3_reset(stmt);
+        if (bind_newsql_row(clnt, rec, row + 1, &errstr)) {
+            errstat_set_rcstrf(err, ERR_PREPARE, "row %d: %s", row + 1,
+                               errstr);
+            sqlite3_free(errstr);
+            rc = -1;
+            goto abort;
+        }
+    }
+
+    if (autocommit)
+        sql_set_sqlengine_state(clnt, __FILE__, __LINE__,
+                                clnt->intrans ? SQLENG_FNSH_STATE
+                                              : SQLENG_NORMAL_PROCESS);
+    *steprc = sqlite3_step(stmt);
+    return 0;
+
+abort:
+    if (autocommit) {
+        if (clnt->intrans) {
+            sql_set_sqlengine_state(clnt, __FILE__, __LINE__,
+                                    SQLENG_FNSH_RBK_STATE);
+            sqlite3RollbackAll(thd->sqldb, SQLITE_OK);
+        }
+        sql_set_sqlengine_state(clnt, __FILE__, __LINE__,
+                                SQLENG_NORMAL_PROCESS);
+    }
+    return rc;
+}
+
 /* The design choice here for communication is to send row data inside this function,
    and delegate the error sending to the caller (since we send multiple rows, but we 
    send error only once and stop processing at that time)
@@ -5137,7 +5229,14 @@ static int run_stmt(struct sqlthdstate *thd, struct sqlclntstate *clnt,
     ncols = sqlite3_column_count(rec->stmt);
 
     /* Get first row to figure out column structure */
-    steprc = sqlite3_step(stmt);
+    if (clnt->is_newsql && clnt->sql_query && clnt->sql_query->bindrows > 1) {
+        if (run_stmt_bound_rows(thd, clnt, rec, &steprc, err)) {
+            *fast_error = 1;
+            return -1;
+        }
+    } else {
+        steprc = sqlite3_step(stmt);
+    }
     if (steprc == SQLITE_SCHEMA_REMOTE) {
         /* remote schema changed;
            Only safe to recover here
@@ -5408,6 +5507,11 @@ static int handle_sqlite_requests(struct sqlthdstate *thd,
                         comm->send_run_error(clnt, errstat_get_str(&err), 
                                              DB_ERR_CONV_FAIL);
                     break;
+                case ERR_PREPARE:
+                    if(comm->send_prepare_error)
+                        comm->send_prepare_error(clnt, errstat_get_str(&err),
+                                                 0);
+                    break;
             }
             if (fast_error)
                 goto errors;
@@ -5761,6 +5865,9 @@ static void sqlengine_work_appsock(struct thdpool *pool, void *work,
     else
         clnt->query_rc = execute_sql_query(thd, clnt);
 
+    /* the next statement of this session may run on another thread */
+    osql_opbatch_flush_clnt(clnt);
+
     /* execute sql query might have generated an overriding fdb error;
        reset it here before returning */
     bzero(&clnt->fdb_state.xerr, sizeof(clnt->fdb_state.xerr));
@@ -7745,6 +7852,15 @@ int handle_newsql_requests(struct thr_handle *thr_self, SBUF2 *sb,
         clnt.osql.sent_column_data = 0;
         clnt.sql_query = sql_query;
 
+        clnt.is_pipelined = 0;
+        clnt.want_bindrows = 0;
+        for (int ii = 0; ii < sql_query->n_features; ii++) {
+            if (CDB2_CLIENT_FEATURES__PIPELINE == sql_query->features[ii])
+                clnt.is_pipelined = 1;
+            else if (CDB2_CLIENT_FEATURES__BINDROWS == sql_query->features[ii])
+                clnt.want_bindrows = 1;
+        }
+
         if ((clnt.tzname[0] == '\0') && sql_query->tzname)
             strncpy(clnt.tzname, sql_query->tzname, sizeof(clnt.tzname));
 
@@ -8259,6 +8375,7 @@ static int execute_sql_query_offload_inner_loop(struct sqlclntstate *clnt,
     int rc = 0;
     int tmp;
     int sent;
+    fdb_sql_stream_t stream;
 
     if (!clnt->fdb_state.remote_sql_sb) {
         while ((ret = sqlite3_step(stmt)) == SQLITE_ROW)
@@ -8272,6 +8389,7 @@ static int execute_sql_query_offload_inner_loop(struct sqlclntstate *clnt,
             cid = (char *)&clnt->osql.rqid;
 
         sent = 0;
+        fdb_svc_sql_stream_init(&stream);
         while (1) {
             /* NOTE: in the recom and serial mode, the cursors look at the
             shared shadow_tran
@@ -8279,6 +8397,12 @@ static int execute_sql_query_offload_inner_loop(struct sqlclntstate *clnt,
             computing!
             Get the LOCK!
             */
+            /* don't sit on buffered rows while producing a slow one */
+            rc = fdb_svc_sql_stream_check(clnt->fdb_state.remote_sql_sb,
+                                          &stream);
+            if (rc)
+                break;
+
             if (clnt->dbtran.mode == TRANLEVEL_RECOM ||
                 clnt->dbtran.mode == TRANLEVEL_SERIAL) {
                 pthread_mutex_lock(&clnt->dtran_mtx);
@@ -8297,9 +8421,9 @@ static int execute_sql_query_offload_inner_loop(struct sqlclntstate *clnt,
 
             if (res.z) {
                 /* now we have the packed sqlite row in Mem->z */
-                rc = fdb_svc_sql_row(clnt->fdb_state.remote_sql_sb, cid, res.z,
-                                     res.n, IX_FNDMORE,
-                                     clnt->osql.rqid == OSQL_RQID_USE_UUID);
+                rc = fdb_svc_sql_row_stream(
+                    clnt->fdb_state.remote_sql_sb, cid, res.z, res.n,
+                    clnt->osql.rqid == OSQL_RQID_USE_UUID, &stream);
                 if (rc) {
                     /*
                     fprintf(stderr, "%s: failed to send back sql row\n",
@@ -8838,6 +8962,125 @@ int sqlpool_init(void)
     return 0;
 }
 
+/* Helper threads for the sqlite sorter.  Each one gets its own sql mspace
+ * so the compare functions it runs can allocate without borrowing memory
+ * from the sql thread that owns the sorter. */
+static void sqlsorter_thd_start(struct thdpool *pool, void *thddata)
+{
+    sql_mem_init(NULL);
+}
+
+static void sqlsorter_thd_end(struct thdpool *pool, void *thddata)
+{
+    sql_mem_shutdown(NULL);
+}
+
+int sqlsorterpool_init(void)
+{
+    gbl_sqlsorter_thdpool = thdpool_create("SQL sorter pool", 0);
+
+    if (gbl_exit_on_pthread_create_fail)
+        thdpool_set_exit(gbl_sqlsorter_thdpool);
+
+    thdpool_set_init_fn(gbl_sqlsorter_thdpool, sqlsorter_thd_start);
+    thdpool_set_delt_fn(gbl_sqlsorter_thdpool, sqlsorter_thd_end);
+    thdpool_set_minthds(gbl_sqlsorter_thdpool, 0);
+    thdpool_set_maxthds(gbl_sqlsorter_thdpool, 16);
+    thdpool_set_linger(gbl_sqlsorter_thdpool, 30);
+    /* never queue: if every helper is busy the sql thread sorts the piece
+     * itself rather than wait behind another query's sort */
+    thdpool_set_maxqueue(gbl_sqlsorter_thdpool, 0);
+
+    return 0;
+}
+
+struct sqlsorter_batch {
+    pthread_mutex_t lk;
+    pthread_cond_t cd;
+    int pending;
+};
+
+struct sqlsorter_work {
+    struct sqlsorter_batch *batch;
+    void (*func)(void *);
+    void *arg;
+    int queued;
+    int done;
+};
+
+static void sqlsorter_work_pp(struct thdpool *pool, void *work, void *thddata,
+                              int op)
+{
+    struct sqlsorter_work *w = work;
+    struct sqlsorter_batch *b = w->batch;
+
+    /* on THD_FREE the piece is left for the caller to sort */
+    if (op == THD_RUN) {
+        w->func(w->arg);
+        w->done = 1;
+    }
+
+    pthread_mutex_lock(&b->lk);
+    if (--b->pending == 0)
+        pthread_cond_signal(&b->cd);
+    pthread_mutex_unlock(&b->lk);
+}
+
+/* Run func on every element of args, handing all but the last to the sorter
+ * pool and doing the rest on this thread.  Returns once every call has
+ * finished. */
+void comdb2_sorter_run_parallel(void (*func)(void *), void **args, int nargs)
+{
+    struct sqlsorter_batch b;
+    struct sqlsorter_work *w;
+    int i;
+
+    w = alloca(nargs * sizeof(struct sqlsorter_work));
+    pthread_mutex_init(&b.lk, NULL);
+    pthread_cond_init(&b.cd, NULL);
+    b.pending = 0;
+
+    for (i = 0; i < nargs; i++) {
+        w[i].batch = &b;
+        w[i].func = func;
+        w[i].arg = args[i];
+        w[i].queued = 0;
+        w[i].done = 0;
+        if (i == nargs - 1 || gbl_sqlsorter_thdpool == NULL)
+            continue;
+        pthread_mutex_lock(&b.lk);
+        b.pending++;
+        pthread_mutex_unlock(&b.lk);
+        if (thdpool_enqueue(gbl_sqlsorter_thdpool, sqlsorter_work_pp, &w[i], 0,
+                            NULL) == 0) {
+            w[i].queued = 1;
+        } else {
+            pthread_mutex_lock(&b.lk);
+            b.pending--;
+            pthread_mutex_unlock(&b.lk);
+        }
+    }
+
+    /* whatever the pool couldn't take is done here while the helpers run */
+    for (i = nargs - 1; i >= 0; i--) {
+        if (!w[i].queued)
+            func(args[i]);
+    }
+
+    pthread_mutex_lock(&b.lk);
+    while (b.pending > 0)
+        pthread_cond_wait(&b.cd, &b.lk);
+    pthread_mutex_unlock(&b.lk);
+
+    for (i = 0; i < nargs - 1; i++) {
+        if (w[i].queued && !w[i].done)
+            func(args[i]);
+    }
+
+    pthread_cond_destroy(&b.cd);
+    pthread_mutex_destroy(&b.lk);
+}
+
 /* we have to clear
       - sqlclntstate (key, pointers in Bt, thd)
       - thd->tran and mode (this is actually done in Commit/Rollback)
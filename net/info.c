@@ -60,7 +60,7 @@ static void basic_node_data(struct host_node_tag *ptr, FILE *out)
     if (ptr->have_reader_thread)
         fprintf(out, " rd_thd");
     if (ptr->have_writer_thread)
-        fprintf(out, " wr_thd");
+        fprintf(out, ptr->ev_state != NET_EV_DETACHED ? " io_thd" : " wr_thd");
     if (ptr->decom_flag)
         fprintf(out, " decom");
     if (ptr->got_hello)
@@ -134,6 +134,8 @@ void net_cmd(netinfo_type *netinfo_ptr, char *line, int lline, int st, int op1)
 
     static const char *help_msg[] = {"stat    - basic stats",
                                      "dump #  - detailed dump of node #",
+                                     "evloop  - shared io thread stats",
+                                     "flush   - flush and coalescing histograms",
                                      "help    - help menu", NULL};
 
     tok = segtok(line, lline, &st, &ltok);
@@ -146,6 +148,10 @@ void net_cmd(netinfo_type *netinfo_ptr, char *line, int lline, int st, int op1)
             dump_node(netinfo_ptr, out, host);
             free(host);
         }
+    } else if (tokcmp(tok, ltok, "evloop") == 0) {
+        net_evloop_stat(out);
+    } else if (tokcmp(tok, ltok, "flush") == 0) {
+        net_flush_stat(netinfo_ptr, out);
     } else if (tokcmp(tok, ltok, "help") == 0) {
         int ii;
         for (ii = 0; help_msg[ii]; ii++)
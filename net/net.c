@@ -71,6 +71,11 @@
 #include <utime.h>
 #include <sys/time.h>
 #include <poll.h>
+#ifdef _LINUX_SOURCE
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#define NET_EVLOOP
+#endif
 
 #include <bb_oscompat.h>
 
@@ -124,6 +129,18 @@ extern int gbl_pmux_route_enabled;
 
 int gbl_verbose_net = 0;
 
+/* Number of shared I/O threads serving host sockets; 0 gives each host its
+ * own writer thread. */
+int gbl_net_io_threads = 0;
+
+static unsigned long long num_flushes = 0;
+static unsigned long long send_interval_flushes = 0;
+static unsigned long long explicit_flushes = 0;
+
+/* Longest a writer thread will hold back a flush (usecs) hoping the next
+ * commit joins it; 0 turns the coalescer off. */
+int gbl_net_coalesce_max_usec = 0;
+
 static unsigned long long gettmms(void)
 {
     struct timeval tm;
@@ -226,6 +243,10 @@ static void *heartbeat_check_thread(void *arg);
 static void *writer_thread(void *args);
 static void *reader_thread(void *arg);
 static void *connect_thread(void *arg);
+static void evloop_kick(host_node_type *host_node_ptr);
+#ifdef NET_EVLOOP
+static int evloop_attach(host_node_type *host_node_ptr);
+#endif
 
 static int net_writes(SBUF2 *sb, const char *buf, int nbytes);
 static int net_reads(SBUF2 *sb, char *buf, int nbytes);
@@ -536,6 +557,7 @@ static void close_hostnode_ll(host_node_type *host_node_ptr)
 
         /* wake up the writer thread if it's asleep */
         pthread_cond_signal(&(host_node_ptr->write_wakeup));
+        evloop_kick(host_node_ptr);
 
         /* call the hostdown routine if provided */
         if (host_node_ptr->netinfo_ptr->hostdown_rtn) {
@@ -603,18 +625,182 @@ static void check_list_sizes(host_node_type *host_node_ptr)
 }
 #endif
 
+static uint64_t net_time_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static int flush_hist_bucket(unsigned long long val)
+{
+    int b = 0;
+    while (val && b < NET_FLUSH_HIST_BUCKETS - 1) {
+        val >>= 1;
+        b++;
+    }
+    return b;
+}
+
+/* Called under enquelk for every nodelay user message. */
+static void coalesce_note_commit(host_node_type *host_node_ptr)
+{
+    uint64_t now = net_time_us();
+    uint64_t gap = now - host_node_ptr->last_commit_us;
+
+    if (host_node_ptr->last_commit_us == 0 || gap > MILLION)
+        gap = MILLION;
+    host_node_ptr->commit_gap_us =
+        (7 * (uint64_t)host_node_ptr->commit_gap_us + gap) / 8;
+    host_node_ptr->last_commit_us = now;
+}
+
+/* True if a commit boundary is expected soon enough that a flush forced by
+ * enque_flush_interval would only split it. */
+static int coalesce_expect_commit(host_node_type *host_node_ptr)
+{
+    int gap = host_node_ptr->commit_gap_us;
+
+    if (gbl_net_coalesce_max_usec <= 0 || gap == 0 ||
+        gap > gbl_net_coalesce_max_usec)
+        return 0;
+    return net_time_us() - host_node_ptr->last_commit_us < 2 * gap;
+}
+
+static void coalesce_sample_rtt(host_node_type *host_node_ptr)
+{
+#ifdef _LINUX_SOURCE
+    struct tcp_info ti;
+    socklen_t len = sizeof(ti);
+    int now = time_epoch();
+
+    if (host_node_ptr->rtt_time == now || host_node_ptr->fd < 0)
+        return;
+    host_node_ptr->rtt_time = now;
+    if (getsockopt(host_node_ptr->fd, IPPROTO_TCP, TCP_INFO, &ti, &len) == 0)
+        host_node_ptr->rtt_us = ti.tcpi_rtt;
+#endif
+}
+
+/* Decide how long (usecs) the writer should hold a flush that is due now so
+ * that the next commit can go out in the same segment.  Holding only pays
+ * off if commits arrive faster than a fraction of the round trip; otherwise,
+ * or if the batch is already large, flush right away. */
+static int coalesce_hold(host_node_type *host_node_ptr)
+{
+    int budget, gap;
+
+    if (gbl_net_coalesce_max_usec <= 0 || host_node_ptr->flush_msgs >= 64)
+        return 0;
+
+    coalesce_sample_rtt(host_node_ptr);
+    budget = host_node_ptr->rtt_us;
+    if (host_node_ptr->ack_us > budget)
+        budget = host_node_ptr->ack_us;
+    budget /= 4;
+    if (budget > gbl_net_coalesce_max_usec)
+        budget = gbl_net_coalesce_max_usec;
+
+    gap = host_node_ptr->commit_gap_us;
+    if (gap == 0 || gap > budget)
+        return 0;
+    return (2 * gap < budget) ? 2 * gap : budget;
+}
+
+static void flush_hist_add(netinfo_type *netinfo_ptr,
+                           host_node_type *host_node_ptr, int held_us)
+{
+    flush_hist_type *h = &netinfo_ptr->flush_hist;
+
+    __atomic_add_fetch(&h->msgs[flush_hist_bucket(host_node_ptr->flush_msgs)],
+                       1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&h->hold[flush_hist_bucket(held_us)], 1,
+                       __ATOMIC_RELAXED);
+    host_node_ptr->flush_msgs = 0;
+}
+
+static void print_flush_hist_row(FILE *out, const char *name,
+                                 const unsigned long long *hist)
+{
+    int b;
+
+    logmsgf(LOGMSG_USER, out, "  %-8s", name);
+    for (b = 0; b < NET_FLUSH_HIST_BUCKETS; b++) {
+        if (hist[b] == 0)
+            continue;
+        if (b == 0)
+            logmsgf(LOGMSG_USER, out, " [0]=%llu", hist[b]);
+        else
+            logmsgf(LOGMSG_USER, out, " [%u-%u]=%llu", 1U << (b - 1),
+                    (1U << b) - 1, hist[b]);
+    }
+    logmsgf(LOGMSG_USER, out, "\n");
+}
+
+/* The flush totals are process-wide, summed over every netinfo; the
+ * coalescer counters and histograms belong to netinfo_ptr. */
+void net_flush_stat(netinfo_type *netinfo_ptr, FILE *out)
+{
+    flush_hist_type *h = &netinfo_ptr->flush_hist;
+
+    logmsgf(LOGMSG_USER, out, "process flushes: %llu explicit %llu "
+                              "interval %llu\n",
+            num_flushes, explicit_flushes, send_interval_flushes);
+    logmsgf(LOGMSG_USER, out, "%s coalescer: max hold %dus, held %llu "
+                              "joined %llu, interval deferred to commit %llu\n",
+            netinfo_ptr->service, gbl_net_coalesce_max_usec, h->held,
+            h->joined, h->suppressed);
+    print_flush_hist_row(out, "msgs", h->msgs);
+    print_flush_hist_row(out, "hold us", h->hold);
+}
+
+struct net_iov_buf {
+    int refcnt;
+    size_t len;
+    char data[1];
+};
+
+net_iov_buf *net_iov_buf_alloc(size_t len)
+{
+    net_iov_buf *buf;
+
+    buf = malloc(offsetof(net_iov_buf, data) + len);
+    if (buf == NULL)
+        return NULL;
+    buf->refcnt = 1;
+    buf->len = len;
+    return buf;
+}
+
+void *net_iov_buf_data(net_iov_buf *buf) { return buf->data; }
+
+static void net_iov_buf_ref(net_iov_buf *buf)
+{
+    __atomic_add_fetch(&buf->refcnt, 1, __ATOMIC_RELAXED);
+}
+
+void net_iov_buf_release(net_iov_buf *buf)
+{
+    if (buf && __atomic_sub_fetch(&buf->refcnt, 1, __ATOMIC_ACQ_REL) == 0)
+        free(buf);
+}
+
 /* Enque a net message consisting of a header and some optional data.
  * The caller should hold the enque lock.
  * Note that dataptr1==NULL => datasz1==0 and dataptr2==NULL => datasz2==0
+ *
+ * If refs is given, iov[ii] with a non-NULL refs[ii] is queued by reference
+ * rather than copied.  Everything else is copied into the list item.
  */
 static int write_list(netinfo_type *netinfo_ptr, host_node_type *host_node_ptr,
                       const wire_header_type *headptr, const struct iovec *iov,
-                      int iovcount, int flags)
+                      net_iov_buf *const *refs, int iovcount, int flags)
 {
     write_data *insert;
-    int ii;
-    size_t datasz;
-    char *ptr;
+    write_seg *seg = NULL;
+    int ii, nseg;
+    size_t datasz, refsz, segsz;
+    char *ptr, *segstart = NULL;
     int rc;
 
     Pthread_mutex_lock(&(host_node_ptr->enquelk));
@@ -647,10 +833,25 @@ static int write_list(netinfo_type *netinfo_ptr, host_node_type *host_node_ptr,
 
     Pthread_mutex_unlock(&(host_node_ptr->enquelk));
 
-    for (datasz = 0, ii = 0; ii < iovcount; ii++) {
-        if (iov[ii].iov_base)
+    /* The netcmp routine parses the payload, so inorder messages have to be
+     * contiguous. */
+    if ((flags & WRITE_MSG_INORDER) && netinfo_ptr->netcmp_rtn != NULL)
+        refs = NULL;
+
+    for (datasz = 0, refsz = 0, nseg = 0, ii = 0; ii < iovcount; ii++) {
+        if (iov[ii].iov_base == NULL)
+            continue;
+        if (refs && refs[ii]) {
+            refsz += iov[ii].iov_len;
+            /* one for the reference, one for whatever is copied after it */
+            nseg += 2;
+        } else {
             datasz += iov[ii].iov_len;
+        }
     }
+    if (nseg)
+        nseg++; /* the header and anything copied before the first ref */
+    segsz = nseg * sizeof(write_seg);
     if (netinfo_ptr->myhostname_len >= HOSTNAME_LEN)
         datasz += netinfo_ptr->myhostname_len;
     if (host_node_ptr->hostname_len >= HOSTNAME_LEN)
@@ -664,7 +865,11 @@ static int write_list(netinfo_type *netinfo_ptr, host_node_type *host_node_ptr,
        sizeof(write_data) + datasz);
     */
 
-    if (sizeof(write_data) + datasz < netinfo_ptr->pool_size) {
+    /* The segment array goes after the payload; keep it aligned. */
+    if (segsz)
+        datasz = (datasz + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+    if (sizeof(write_data) + datasz + segsz < netinfo_ptr->pool_size) {
         Pthread_mutex_lock(&(host_node_ptr->pool_lock));
 
         /*
@@ -688,9 +893,10 @@ fprintf(stderr, "[%s] using malloc for %d bytes\n",
 */
 
 #ifdef PER_THREAD_MALLOC
-        insert = malloc(sizeof(write_data) + datasz);
+        insert = malloc(sizeof(write_data) + datasz + segsz);
 #else
-        insert = comdb2_malloc(host_node_ptr->msp, sizeof(write_data) + datasz);
+        insert = comdb2_malloc(host_node_ptr->msp,
+                               sizeof(write_data) + datasz + segsz);
 #endif
         if (insert == NULL) {
             logmsg(LOGMSG_ERROR, "%s: mspace out of memory datasz=%u\n", __func__,
@@ -704,7 +910,9 @@ fprintf(stderr, "[%s] using malloc for %d bytes\n",
     insert->enque_time = time_epoch();
     insert->next = NULL;
     insert->prev = NULL;
-    insert->len = sizeof(wire_header_type) + datasz;
+    insert->len = sizeof(wire_header_type) + refsz;
+    insert->nseg = 0;
+    insert->seg = NULL;
 
     memcpy(&insert->payload.header, headptr, sizeof(wire_header_type));
     ptr = insert->payload.raw + sizeof(wire_header_type);
@@ -719,12 +927,44 @@ fprintf(stderr, "[%s] using malloc for %d bytes\n",
         memcpy(ptr, host_node_ptr->host, host_node_ptr->hostname_len);
         ptr += host_node_ptr->hostname_len;
     }
+    if (segsz) {
+        insert->seg = seg =
+            (write_seg *)(insert->payload.raw + sizeof(wire_header_type) +
+                          datasz);
+        segstart = insert->payload.raw;
+    }
     for (ii = 0; ii < iovcount; ii++) {
-        if (iov[ii].iov_base) {
+        if (iov[ii].iov_base == NULL)
+            continue;
+        if (refs && refs[ii]) {
+            /* close off what we've copied so far, then point at the ref */
+            if (ptr > segstart) {
+                seg->base = segstart;
+                seg->len = ptr - segstart;
+                seg->ref = NULL;
+                seg++;
+            }
+            net_iov_buf_ref(refs[ii]);
+            seg->base = iov[ii].iov_base;
+            seg->len = iov[ii].iov_len;
+            seg->ref = refs[ii];
+            seg++;
+            segstart = ptr;
+        } else {
             memcpy(ptr, iov[ii].iov_base, iov[ii].iov_len);
             ptr += iov[ii].iov_len;
         }
     }
+    insert->len += ptr - (insert->payload.raw + sizeof(wire_header_type));
+    if (segsz) {
+        if (ptr > segstart) {
+            seg->base = segstart;
+            seg->len = ptr - segstart;
+            seg->ref = NULL;
+            seg++;
+        }
+        insert->nseg = seg - insert->seg;
+    }
 
     Pthread_mutex_lock(&(host_node_ptr->enquelk));
 
@@ -741,7 +981,8 @@ fprintf(stderr, "[%s] using malloc for %d bytes\n",
         int cnt = 0, cmp, reordered = 0;
         write_data *ptr = host_node_ptr->write_tail;
 
-        while (ptr != NULL &&
+        /* Don't reorder past a message we can't look inside */
+        while (ptr != NULL && ptr->nseg == 0 &&
                (cmp = (netinfo_ptr->netcmp_rtn)(
                     netinfo_ptr, insert->payload.raw, insert->len,
                     ptr->payload.raw, ptr->len)) < 0 &&
@@ -792,6 +1033,8 @@ fprintf(stderr, "[%s] using malloc for %d bytes\n",
         host_node_ptr->peak_enque_count_time = time_epoch();
     }
     host_node_ptr->enque_bytes += insert->len;
+    if ((flags & WRITE_MSG_NODELAY) && headptr->type == WIRE_HEADER_USER_MSG)
+        coalesce_note_commit(host_node_ptr);
     if (host_node_ptr->enque_bytes > host_node_ptr->peak_enque_bytes) {
         host_node_ptr->peak_enque_bytes = host_node_ptr->enque_bytes;
         host_node_ptr->peak_enque_bytes_time = time_epoch();
@@ -1104,6 +1347,27 @@ static int read_connect_message(SBUF2 *sb, char hostname[], int hostnamel,
     return 0;
 }
 
+/* Release a write list item back to the pool or heap it came from. */
+static void free_write_data(host_node_type *host_node_ptr, write_data *ptr)
+{
+    int ii;
+
+    for (ii = 0; ii < ptr->nseg; ii++)
+        net_iov_buf_release(ptr->seg[ii].ref);
+
+    if (ptr->pooled) {
+        Pthread_mutex_lock(&(host_node_ptr->pool_lock));
+        pool_relablk(host_node_ptr->write_pool, ptr);
+        Pthread_mutex_unlock(&(host_node_ptr->pool_lock));
+    } else {
+#ifdef PER_THREAD_MALLOC
+        free(ptr);
+#else
+        comdb2_free(ptr);
+#endif
+    }
+}
+
 static int empty_write_list(host_node_type *host_node_ptr)
 {
     write_data *ptr, *nxt;
@@ -1113,19 +1377,7 @@ static int empty_write_list(host_node_type *host_node_ptr)
     nxt = ptr = host_node_ptr->write_head;
     while (nxt != NULL) {
         ptr = ptr->next;
-
-        if (nxt->pooled) {
-            Pthread_mutex_lock(&(host_node_ptr->pool_lock));
-            pool_relablk(host_node_ptr->write_pool, nxt);
-            Pthread_mutex_unlock(&(host_node_ptr->pool_lock));
-        } else {
-#ifdef PER_THREAD_MALLOC
-            free(nxt);
-#else
-            comdb2_free(nxt);
-#endif
-        }
-
+        free_write_data(host_node_ptr, nxt);
         nxt = ptr;
     }
     host_node_ptr->write_head = host_node_ptr->write_tail = NULL;
@@ -1233,9 +1485,11 @@ static int write_connect_message(netinfo_type *netinfo_ptr,
 
 /* To reduce double buffering and other daftness this has evolved a sort of
  * writev style interface with data1 and data2. */
-static int write_message_int(netinfo_type *netinfo_ptr,
-                             host_node_type *host_node_ptr, int type,
-                             const struct iovec *iov, int iovcount, int flags)
+static int write_message_refs(netinfo_type *netinfo_ptr,
+                              host_node_type *host_node_ptr, int type,
+                              const struct iovec *iov,
+                              net_iov_buf *const *refs, int iovcount,
+                              int flags)
 {
     wire_header_type wire_header;
     int rc;
@@ -1266,8 +1520,8 @@ static int write_message_int(netinfo_type *netinfo_ptr,
     wire_header.type = type;
 
     /* Add this message to our linked list to send. */
-    rc = write_list(netinfo_ptr, host_node_ptr, &wire_header, iov, iovcount,
-                    flags);
+    rc = write_list(netinfo_ptr, host_node_ptr, &wire_header, iov, refs,
+                    iovcount, flags);
     if (rc < 0) {
         if (rc == -1) {
             logmsg(LOGMSG_ERROR, "%s: got reallybad failure?\n", __func__);
@@ -1278,12 +1532,25 @@ static int write_message_int(netinfo_type *netinfo_ptr,
     }
 
     /* wake up the writer thread */
-    if (flags & WRITE_MSG_NODELAY)
+    if (flags & WRITE_MSG_NODELAY) {
+        /* evloop stays set after a host detaches from its io thread and
+           reconnects on a writer thread, so wake up both, like
+           close_hostnode; evloop_kick skips detached hosts */
         pthread_cond_signal(&(host_node_ptr->write_wakeup));
+        evloop_kick(host_node_ptr);
+    }
 
     return 0;
 }
 
+static int write_message_int(netinfo_type *netinfo_ptr,
+                             host_node_type *host_node_ptr, int type,
+                             const struct iovec *iov, int iovcount, int flags)
+{
+    return write_message_refs(netinfo_ptr, host_node_ptr, type, iov, NULL,
+                              iovcount, flags);
+}
+
 static int write_message_checkhello(netinfo_type *netinfo_ptr,
                                     host_node_type *host_node_ptr, int type,
                                     const struct iovec *iov, int iovcount,
@@ -1761,6 +2028,7 @@ int net_send_message_payload_ack(netinfo_type *netinfo_ptr, const char *to_host,
     struct timeval tv;
 #endif
     struct iovec iov[2];
+    uint64_t send_us;
 
     rc = 0;
 
@@ -1816,6 +2084,7 @@ int net_send_message_payload_ack(netinfo_type *netinfo_ptr, const char *to_host,
     if (waitforack) {
         seq_ptr = add_seqnum_to_waitlist(host_node_ptr, netinfo_ptr->seqnum);
         seq_ptr->ack = 0;
+        send_us = net_time_us();
     } else
         seq_ptr = NULL;
 
@@ -1870,6 +2139,11 @@ int net_send_message_payload_ack(netinfo_type *netinfo_ptr, const char *to_host,
     rc = 0;
     while (1) {
         if (seq_ptr->ack == 1) {
+            /* feeds the flush coalescer */
+            host_node_ptr->ack_us =
+                (7 * (uint64_t)host_node_ptr->ack_us + net_time_us() -
+                 send_us) /
+                8;
             rc = remove_seqnum_from_waitlist(host_node_ptr, (void**) payloadptr,
                                              payloadlen, seq_ptr->seqnum);
             /* user is only allowed to return >=0 */
@@ -1935,9 +2209,6 @@ int net_send_message(netinfo_type *netinfo_ptr, const char *to_host,
 }
 
 
-static unsigned long long num_flushes = 0;
-static unsigned long long send_interval_flushes = 0;
-static unsigned long long explicit_flushes = 0;
 
 unsigned long long net_get_send_interval_flushes(void)
 {
@@ -2008,15 +2279,16 @@ int net_get_stack_flush_threshold(void) { return stack_flush_min; }
 
 void net_set_stack_flush_threshold(int thresh) { stack_flush_min = thresh; }
 
+static int net_send_iov_int(netinfo_type *netinfo_ptr, const char *host,
+                            int usertype, struct iovec *iov,
+                            net_iov_buf **refs, int iovcount, int datalen,
+                            int nodelay, int nodrop, int inorder);
+
 static int net_send_int(netinfo_type *netinfo_ptr, const char *host,
                         int usertype, void *data, int datalen, int nodelay,
                         int numtails, void **tails, int *taillens, int nodrop,
                         int inorder)
 {
-    host_node_type *host_node_ptr;
-    net_send_message_header tmphd, msghd;
-    uint8_t *p_buf, *p_buf_end;
-    int rc;
     struct iovec iov[35];
     int iovcount;
     int total_tails_len = 0;
@@ -2035,7 +2307,6 @@ static int net_send_int(netinfo_type *netinfo_ptr, const char *host,
     }
 #endif
 
-    rc = 0;
     if (numtails > 32) {
         logmsg(LOGMSG_ERROR, "too many tails %d passed to net_send_tails, max 32\n",
                numtails);
@@ -2052,6 +2323,68 @@ static int net_send_int(netinfo_type *netinfo_ptr, const char *host,
     tailen =
         (numtails > 0 && tails && total_tails_len > 0) ? total_tails_len : 0;
 
+    /* iov[0] is reserved for the message header */
+    iovcount = 1;
+    if (data && datalen) {
+        iov[iovcount].iov_base = data;
+        iov[iovcount].iov_len = datalen;
+        iovcount++;
+    }
+    if (numtails > 0) {
+        for (i = 0; i < numtails; i++) {
+            iov[iovcount].iov_base = tails[i];
+            iov[iovcount].iov_len = taillens[i];
+            iovcount++;
+        }
+    }
+
+    return net_send_iov_int(netinfo_ptr, host, usertype, iov, NULL, iovcount,
+                            datalen + tailen, nodelay, nodrop, inorder);
+}
+
+int net_send_message_iov(netinfo_type *netinfo_ptr, const char *host,
+                         int usertype, const net_iov *iov, int iovcnt,
+                         int nodelay, int nodrop, int inorder)
+{
+    struct iovec sendiov[NET_SEND_MAXIOV + 1];
+    net_iov_buf *refs[NET_SEND_MAXIOV + 1];
+    int datalen = 0;
+    int i;
+
+    if (iovcnt > NET_SEND_MAXIOV) {
+        logmsg(LOGMSG_ERROR, "%s: too many iovs %d, max %d\n", __func__,
+               iovcnt, NET_SEND_MAXIOV);
+        return -1;
+    }
+
+    if (netinfo_ptr->fake)
+        return 0;
+
+    /* sendiov[0] is reserved for the message header */
+    refs[0] = NULL;
+    for (i = 0; i < iovcnt; i++) {
+        sendiov[i + 1].iov_base = iov[i].base;
+        sendiov[i + 1].iov_len = iov[i].len;
+        refs[i + 1] = iov[i].ref;
+        datalen += iov[i].len;
+    }
+
+    return net_send_iov_int(netinfo_ptr, host, usertype, sendiov, refs,
+                            iovcnt + 1, datalen, nodelay, nodrop, inorder);
+}
+
+/* Send a user message.  iov[0] is filled in here with the message header;
+ * the payload is iov[1..iovcount). */
+static int net_send_iov_int(netinfo_type *netinfo_ptr, const char *host,
+                            int usertype, struct iovec *iov,
+                            net_iov_buf **refs, int iovcount, int datalen,
+                            int nodelay, int nodrop, int inorder)
+{
+    host_node_type *host_node_ptr;
+    net_send_message_header tmphd, msghd;
+    uint8_t *p_buf, *p_buf_end;
+    int rc = 0;
+
     Pthread_rwlock_rdlock(&(netinfo_ptr->lock));
     host_node_ptr = get_host_node_by_name_ll(netinfo_ptr, host);
     if (host_node_ptr == NULL) {
@@ -2075,8 +2408,13 @@ static int net_send_int(netinfo_type *netinfo_ptr, const char *host,
         explicit_flushes++;
         net_trace_explicit_flush();
     } else if (host_node_ptr->num_sends > netinfo_ptr->enque_flush_interval) {
-        send_interval_flushes++;
-        nodelay = 1;
+        if (coalesce_expect_commit(host_node_ptr)) {
+            __atomic_add_fetch(&netinfo_ptr->flush_hist.suppressed, 1,
+                               __ATOMIC_RELAXED);
+        } else {
+            send_interval_flushes++;
+            nodelay = 1;
+        }
     }
 
     if (nodelay)
@@ -2089,7 +2427,7 @@ static int net_send_int(netinfo_type *netinfo_ptr, const char *host,
     msghd.seqnum = ++netinfo_ptr->seqnum;
     Pthread_mutex_unlock(&(netinfo_ptr->seqlock));
     msghd.waitforack = 0;
-    msghd.datalen = datalen + tailen;
+    msghd.datalen = datalen;
 
     p_buf = (uint8_t *)&tmphd;
     p_buf_end = ((uint8_t *)&tmphd + sizeof(net_send_message_header));
@@ -2098,28 +2436,18 @@ static int net_send_int(netinfo_type *netinfo_ptr, const char *host,
 
     iov[0].iov_base = (int8_t *)&tmphd;
     iov[0].iov_len = sizeof(tmphd);
-    iovcount = 1;
-    if (data && datalen) {
-        iov[iovcount].iov_base = data;
-        iov[iovcount].iov_len = datalen;
-        iovcount++;
-    }
-    if (numtails > 0) {
-        for (i = 0; i < numtails; i++) {
-            iov[iovcount].iov_base = tails[i];
-            iov[iovcount].iov_len = taillens[i];
-            iovcount++;
-        }
-    }
 
     if (nodelay) {
         host_node_ptr->num_flushes++;
         num_flushes++;
     }
 
-    rc = write_message_checkhello(netinfo_ptr, host_node_ptr,
-                                  WIRE_HEADER_USER_MSG, iov, iovcount, nodelay,
-                                  nodrop, inorder);
+    rc = write_message_refs(netinfo_ptr, host_node_ptr, WIRE_HEADER_USER_MSG,
+                            iov, refs, iovcount,
+                            (nodelay ? WRITE_MSG_NODELAY : 0) |
+                                WRITE_MSG_NOHELLOCHECK |
+                                (nodrop ? WRITE_MSG_NOLIMIT : 0) |
+                                (inorder ? WRITE_MSG_INORDER : 0));
 
     /* queue is full */
     if (-2 == rc) {
@@ -3071,7 +3399,9 @@ void print_net_memstat(int human_readable)
             logmsg(LOGMSG_USER, "%12s | ", to_human_readable(total_numsp, hrn, sizeof(hrn)));
             logmsg(LOGMSG_USER, "%12s\n", to_human_readable(total_nfmsp, hrn, sizeof(hrn)));
         }
-        logmsg(LOGMSG_USER, "%.*s\n\n", tbl_width, tbl_breakline);
+        logmsg(LOGMSG_USER, "%.*s\n", tbl_width, tbl_breakline);
+        net_flush_stat(netinfo_ptr, stdout);
+        logmsg(LOGMSG_USER, "\n");
     }
 
     Pthread_mutex_unlock(&nets_list_lk);
@@ -3862,26 +4192,29 @@ static int write_decom(netinfo_type *netinfo_ptr, host_node_type *host_node_ptr,
 {
     int tmp;
     uint8_t *p_buf, *p_buf_end;
+    struct iovec iov[2];
 
     p_buf = (uint8_t *)&tmp;
     p_buf_end = (uint8_t *)&tmp + sizeof(int);
 
     buf_put(&decom_hostlen, sizeof(int), p_buf, p_buf_end);
 
-    int rc = write_message(netinfo_ptr, host_node_ptr, WIRE_HEADER_DECOM_NAME,
-                           &tmp, sizeof(int));
+    /* Queue the hostname along with its length rather than writing it to the
+     * socket behind the writer's back: the bytes on the wire are the same,
+     * but they can no longer be interleaved with other queued messages. */
+    iov[0].iov_base = &tmp;
+    iov[0].iov_len = sizeof(int);
+    iov[1].iov_base = (void *)decom_host;
+    iov[1].iov_len = decom_hostlen;
+
+    int rc = write_message_int(netinfo_ptr, host_node_ptr,
+                               WIRE_HEADER_DECOM_NAME, iov, 2,
+                               WRITE_MSG_NODELAY);
     if (rc) {
-        logmsg(LOGMSG_ERROR, "%s: rc=%d writing hostname len to %s\n", __func__,
+        logmsg(LOGMSG_ERROR, "%s: rc=%d writing hostname to %s\n", __func__,
                 rc, to_host);
         return -1;
     }
-    rc = write_stream(netinfo_ptr, host_node_ptr, host_node_ptr->sb,
-                      (void *)decom_host, decom_hostlen);
-    if (rc != decom_hostlen) {
-        logmsg(LOGMSG_ERROR, "%s: rc=%d writing hostname to %s\n", __func__, rc,
-                to_host);
-        return -1;
-    }
     return 0;
 }
 
@@ -4111,8 +4444,13 @@ static int create_reader_writer_threads(host_node_type *host_node_ptr,
         }
     }
 
-    /* make sure we have a writer thread */
+    /* make sure we have a writer thread, or an I/O thread doing its job */
     if (!(host_node_ptr->have_writer_thread)) {
+#ifdef NET_EVLOOP
+        if (gbl_net_io_threads > 0 && !sslio_has_ssl(host_node_ptr->sb) &&
+            evloop_attach(host_node_ptr) == 0)
+            return 0;
+#endif
         rc = pthread_create(&(host_node_ptr->writer_thread_id),
                             &(host_node_ptr->netinfo_ptr->pthread_attr_detach),
                             writer_thread, host_node_ptr);
@@ -4147,6 +4485,66 @@ static void shutdown_other_hostnodes(host_node_type *host_node_ptr)
     Pthread_mutex_unlock(&nets_list_lk);
 }
 
+/* write a queued message to the host's sbuf */
+static ssize_t write_data_stream(netinfo_type *netinfo_ptr,
+                                 host_node_type *host_node_ptr,
+                                 write_data *ptr)
+{
+    ssize_t rc = 0;
+    int ii;
+
+    if (ptr->nseg == 0)
+        return write_stream(netinfo_ptr, host_node_ptr, host_node_ptr->sb,
+                            ptr->payload.raw, ptr->len);
+
+    for (ii = 0; ii < ptr->nseg && rc >= 0; ii++)
+        rc = write_stream(netinfo_ptr, host_node_ptr, host_node_ptr->sb,
+                          (void *)ptr->seg[ii].base, ptr->seg[ii].len);
+    return rc;
+}
+
+/* Fill in the wire header of a queued message with the correct details for
+ * our current connection.  The header is endianized in place. */
+static void fill_wire_header(netinfo_type *netinfo_ptr,
+                             host_node_type *host_node_ptr,
+                             write_data *write_list_ptr)
+{
+    wire_header_type *wire_header, tmp_wire_hdr;
+    uint8_t *p_buf, *p_buf_end;
+
+    wire_header = &write_list_ptr->payload.header;
+    if (netinfo_ptr->myhostname_len >= HOSTNAME_LEN) {
+        snprintf(tmp_wire_hdr.fromhost, sizeof(tmp_wire_hdr.fromhost), ".%d",
+                 netinfo_ptr->myhostname_len);
+    } else {
+        strncpy(tmp_wire_hdr.fromhost, netinfo_ptr->myhostname,
+                sizeof(tmp_wire_hdr.fromhost));
+    }
+    tmp_wire_hdr.fromport = netinfo_ptr->myport;
+    tmp_wire_hdr.fromnode = 0;
+    if (host_node_ptr->hostname_len >= HOSTNAME_LEN) {
+        snprintf(tmp_wire_hdr.tohost, sizeof(tmp_wire_hdr.tohost), ".%d",
+                 host_node_ptr->hostname_len);
+    } else {
+        strncpy(tmp_wire_hdr.tohost, host_node_ptr->host,
+                sizeof(tmp_wire_hdr.tohost));
+    }
+    tmp_wire_hdr.toport = host_node_ptr->port;
+    tmp_wire_hdr.tonode = 0;
+    tmp_wire_hdr.type = wire_header->type;
+
+    /* This shouldn't happen.. but for a while it was happening
+     * due to various races. */
+    if (tmp_wire_hdr.toport == 0)
+        host_node_errf(LOGMSG_WARN, host_node_ptr, "PORT IS ZERO! type %d\n",
+                       tmp_wire_hdr.type);
+
+    p_buf = (uint8_t *)wire_header;
+    p_buf_end = ((uint8_t *)wire_header + sizeof(*wire_header));
+
+    /* endianize this */
+    net_wire_header_put(&tmp_wire_hdr, p_buf, p_buf_end);
+}
 
 static void *writer_thread(void *args)
 {
@@ -4154,6 +4552,8 @@ static void *writer_thread(void *args)
     host_node_type *host_node_ptr;
     write_data *write_list_ptr, *write_list_back;
     int rc, flags, maxage;
+    int hold = 0, pending = 0;
+    uint64_t hold_start = 0;
     int th_start_time = time_epoch();
     struct timespec waittime;
 #ifndef HAS_CLOCK_GETTIME
@@ -4196,8 +4596,12 @@ static void *writer_thread(void *args)
             pthread_cond_broadcast(&(host_node_ptr->throttle_wakeup));
 
             rc = 0;
-            flags = 0;
+            flags = pending;
             maxage = 0;
+            if (pending)
+                __atomic_add_fetch(&netinfo_ptr->flush_hist.joined, 1,
+                                   __ATOMIC_RELAXED);
+            host_node_ptr->flush_msgs += count;
 
             Pthread_mutex_lock(&(host_node_ptr->write_lock));
             start_time = time_epoch();
@@ -4206,8 +4610,6 @@ static void *writer_thread(void *args)
                  */
                 if (!host_node_ptr->closed && rc >= 0) {
                     int age;
-                    wire_header_type *wire_header, tmp_wire_hdr;
-                    uint8_t *p_buf, *p_buf_end;
 
                     if (flags & WRITE_MSG_NODELAY) {
                         age = time_epoch() - write_list_ptr->enque_time;
@@ -4215,47 +4617,11 @@ static void *writer_thread(void *args)
                             maxage = age;
                     }
 
-                    /* File in the wire header with correct details for our
-                     * current connection. */
-
-                    wire_header = &write_list_ptr->payload.header;
-                    if (netinfo_ptr->myhostname_len >= HOSTNAME_LEN) {
-                        snprintf(tmp_wire_hdr.fromhost,
-                                 sizeof(tmp_wire_hdr.fromhost), ".%d",
-                                 netinfo_ptr->myhostname_len);
-                    } else {
-                        strncpy(tmp_wire_hdr.fromhost, netinfo_ptr->myhostname,
-                                sizeof(tmp_wire_hdr.fromhost));
-                    }
-                    tmp_wire_hdr.fromport = netinfo_ptr->myport;
-                    tmp_wire_hdr.fromnode = 0;
-                    if (host_node_ptr->hostname_len >= HOSTNAME_LEN) {
-                        snprintf(tmp_wire_hdr.tohost,
-                                 sizeof(tmp_wire_hdr.tohost), ".%d",
-                                 host_node_ptr->hostname_len);
-                    } else {
-                        strncpy(tmp_wire_hdr.tohost, host_node_ptr->host,
-                                sizeof(tmp_wire_hdr.tohost));
-                    }
-                    tmp_wire_hdr.toport = host_node_ptr->port;
-                    tmp_wire_hdr.tonode = 0;
-                    tmp_wire_hdr.type = wire_header->type;
-
-                    /* This shouldn't happen.. but for a while it was happening
-                     * due to various races. */
-                    if (tmp_wire_hdr.toport == 0)
-                        host_node_errf(LOGMSG_WARN, host_node_ptr, "PORT IS ZERO! type %d\n",
-                                       tmp_wire_hdr.type);
-
-                    p_buf = (uint8_t *)wire_header;
-                    p_buf_end = ((uint8_t *)wire_header + sizeof(*wire_header));
+                    fill_wire_header(netinfo_ptr, host_node_ptr,
+                                     write_list_ptr);
 
-                    /* endianize this */
-                    net_wire_header_put(&tmp_wire_hdr, p_buf, p_buf_end);
-
-                    rc = write_stream(
-                        netinfo_ptr, host_node_ptr, host_node_ptr->sb,
-                        write_list_ptr->payload.raw, write_list_ptr->len);
+                    rc = write_data_stream(netinfo_ptr, host_node_ptr,
+                                           write_list_ptr);
                     flags |= write_list_ptr->flags;
                 } else
                     rc = -1;
@@ -4263,26 +4629,28 @@ static void *writer_thread(void *args)
                 write_list_back = write_list_ptr;
                 write_list_ptr = write_list_ptr->next;
 
-                if (write_list_back->pooled) {
-                    Pthread_mutex_lock(&(host_node_ptr->pool_lock));
-                    pool_relablk(host_node_ptr->write_pool, write_list_back);
-                    Pthread_mutex_unlock(&(host_node_ptr->pool_lock));
-                } else {
-#ifdef PER_THREAD_MALLOC
-                    free(write_list_back);
-#else
-                    comdb2_free(write_list_back);
-#endif
-                }
+                free_write_data(host_node_ptr, write_list_back);
             }
             /* we seem to set nodelay on virtually every message.  try to get
              * slightly better streaming performance by moving the flush out of
-             * the main loop. */
+             * the main loop.  If commits are arriving quickly, hold the flush
+             * (once) so the next one can share it. */
             if (flags & WRITE_MSG_NODELAY) {
-                net_delay(host_node_ptr->host);
-                if (netinfo_ptr->trace && debug_switch_net_verbose())
-                    logmsg(LOGMSG_USER, "Flushing %llu\n", gettmms());
-                sbuf2flush(host_node_ptr->sb);
+                if (!pending && rc >= 0 &&
+                    (hold = coalesce_hold(host_node_ptr)) > 0) {
+                    pending = WRITE_MSG_NODELAY;
+                    hold_start = net_time_us();
+                    __atomic_add_fetch(&netinfo_ptr->flush_hist.held, 1,
+                                       __ATOMIC_RELAXED);
+                } else {
+                    net_delay(host_node_ptr->host);
+                    if (netinfo_ptr->trace && debug_switch_net_verbose())
+                        logmsg(LOGMSG_USER, "Flushing %llu\n", gettmms());
+                    sbuf2flush(host_node_ptr->sb);
+                    flush_hist_add(netinfo_ptr, host_node_ptr,
+                                   pending ? net_time_us() - hold_start : 0);
+                    pending = 0;
+                }
             }
             end_time = time_epoch();
             Pthread_mutex_unlock(&(host_node_ptr->write_lock));
@@ -4310,11 +4678,30 @@ static void *writer_thread(void *args)
         rc = gettimeofday(&tv, NULL);
         timeval_to_timespec(&tv, &waittime);
 #endif
-        add_millisecs_to_timespec(&waittime, 5000);
+        if (pending) {
+            long long ns = waittime.tv_nsec + hold * 1000LL;
+            waittime.tv_sec += ns / BILLION;
+            waittime.tv_nsec = ns % BILLION;
+        } else {
+            add_millisecs_to_timespec(&waittime, 5000);
+        }
 
         pthread_cond_timedwait(&(host_node_ptr->write_wakeup),
                                &(host_node_ptr->enquelk), &waittime);
 
+        /* nothing joined a held flush; send what we have */
+        if (pending && host_node_ptr->write_head == NULL) {
+            Pthread_mutex_unlock(&(host_node_ptr->enquelk));
+            Pthread_mutex_lock(&(host_node_ptr->write_lock));
+            net_delay(host_node_ptr->host);
+            sbuf2flush(host_node_ptr->sb);
+            Pthread_mutex_unlock(&(host_node_ptr->write_lock));
+            flush_hist_add(netinfo_ptr, host_node_ptr,
+                           net_time_us() - hold_start);
+            pending = 0;
+            Pthread_mutex_lock(&(host_node_ptr->enquelk));
+        }
+
         /*
            pthread_cond_wait(&(host_node_ptr->write_wakeup),
            &(host_node_ptr->enquelk));
@@ -4346,6 +4733,545 @@ done:
 }
 
 
+#ifdef NET_EVLOOP
+/* Event loop transport.
+ *
+ * Instead of a dedicated writer thread per host, a small fixed set of I/O
+ * threads (gbl_net_io_threads) serve the write side of every host socket.
+ * Senders still enqueue onto the host's write list; a NODELAY message puts
+ * the host on its I/O thread's ready list and pokes the thread's eventfd.
+ * The I/O thread takes the whole write list and hands it to the kernel with
+ * non-blocking scatter/gather sends.  If the socket fills up we arm EPOLLOUT
+ * and carry on with other hosts.  Reads stay on the per host reader thread
+ * because user handlers run synchronously and may block.
+ *
+ * An attached host counts as having a writer thread (have_writer_thread) so
+ * the close/teardown logic is unchanged: the I/O thread detaches the host and
+ * clears the flag when the connection goes away. */
+
+enum {
+    NET_EVLOOP_MAXEVENTS = 64,
+    NET_EVLOOP_MAXIOV = 64,
+    NET_EVLOOP_MAXSENDS = 16, /* sends per host before yielding */
+    NET_EVLOOP_TICK_MS = 1000
+};
+
+struct net_evloop {
+    int idx;
+    int epfd;
+    int evfd;
+    pthread_t tid;
+    arch_tid archtid;
+    pthread_mutex_t lk;
+    host_node_type *ready_head;
+    host_node_type *ready_tail;
+    host_node_type *hosts;
+    int nhosts;
+    unsigned long long wakeups;
+    unsigned long long sends;
+    unsigned long long full;
+    unsigned long long bytes;
+};
+
+static struct net_evloop *evloops;
+static int num_evloops;
+static unsigned next_evloop;
+static pthread_mutex_t evloop_lk = PTHREAD_MUTEX_INITIALIZER;
+
+static void *net_evloop_thread(void *arg);
+
+static void evloop_wake(struct net_evloop *loop)
+{
+    uint64_t one = 1;
+    if (write(loop->evfd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+        logmsg(LOGMSG_ERROR, "%s: write eventfd errno %d %s\n", __func__,
+               errno, strerror(errno));
+}
+
+/* Caller holds loop->lk.  Returns 1 if the ready list was empty, ie. the I/O
+ * thread may be asleep and needs a wakeup. */
+static int evloop_ready_push_lk(struct net_evloop *loop,
+                                host_node_type *host_node_ptr)
+{
+    int wasempty = (loop->ready_head == NULL);
+    if (host_node_ptr->ev_queued)
+        return 0;
+    host_node_ptr->ev_queued = 1;
+    host_node_ptr->ev_next = NULL;
+    if (loop->ready_tail)
+        loop->ready_tail->ev_next = host_node_ptr;
+    else
+        loop->ready_head = host_node_ptr;
+    loop->ready_tail = host_node_ptr;
+    return wasempty;
+}
+
+static host_node_type *evloop_ready_pop(struct net_evloop *loop)
+{
+    host_node_type *host_node_ptr;
+    Pthread_mutex_lock(&loop->lk);
+    host_node_ptr = loop->ready_head;
+    if (host_node_ptr) {
+        loop->ready_head = host_node_ptr->ev_next;
+        if (loop->ready_head == NULL)
+            loop->ready_tail = NULL;
+        host_node_ptr->ev_next = NULL;
+        host_node_ptr->ev_queued = 0;
+    }
+    Pthread_mutex_unlock(&loop->lk);
+    return host_node_ptr;
+}
+
+/* Schedule a host for servicing by its I/O thread.  This is a no-op for
+ * hosts that are served by a writer thread. */
+static void evloop_kick(host_node_type *host_node_ptr)
+{
+    struct net_evloop *loop = host_node_ptr->evloop;
+    int wake = 0;
+
+    if (loop == NULL)
+        return;
+
+    Pthread_mutex_lock(&loop->lk);
+    if (host_node_ptr->ev_state != NET_EV_DETACHED)
+        wake = evloop_ready_push_lk(loop, host_node_ptr);
+    Pthread_mutex_unlock(&loop->lk);
+
+    if (wake)
+        evloop_wake(loop);
+}
+
+static int net_evloop_start(void)
+{
+    int rc = 0;
+    int i;
+
+    Pthread_mutex_lock(&evloop_lk);
+    if (evloops != NULL)
+        goto done;
+
+    evloops = calloc(gbl_net_io_threads, sizeof(struct net_evloop));
+    if (evloops == NULL) {
+        rc = -1;
+        goto done;
+    }
+
+    for (i = 0; i < gbl_net_io_threads; i++) {
+        struct net_evloop *loop = &evloops[i];
+        struct epoll_event ev = {0};
+
+        loop->idx = i;
+        loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+        if (loop->epfd < 0) {
+            logmsg(LOGMSG_ERROR, "%s: epoll_create1 errno %d %s\n", __func__,
+                   errno, strerror(errno));
+            rc = -1;
+            break;
+        }
+        loop->evfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (loop->evfd < 0) {
+            logmsg(LOGMSG_ERROR, "%s: eventfd errno %d %s\n", __func__, errno,
+                   strerror(errno));
+            close(loop->epfd);
+            rc = -1;
+            break;
+        }
+        ev.events = EPOLLIN;
+        ev.data.ptr = NULL; /* NULL marks the eventfd */
+        if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, loop->evfd, &ev) != 0) {
+            logmsg(LOGMSG_ERROR, "%s: epoll_ctl errno %d %s\n", __func__,
+                   errno, strerror(errno));
+            close(loop->evfd);
+            close(loop->epfd);
+            rc = -1;
+            break;
+        }
+        pthread_mutex_init(&loop->lk, NULL);
+
+        rc = pthread_create(&loop->tid, NULL, net_evloop_thread, loop);
+        if (rc != 0) {
+            logmsg(LOGMSG_ERROR, "%s: pthread_create rc %d %s\n", __func__, rc,
+                   strerror(rc));
+            rc = -1;
+            break;
+        }
+        pthread_detach(loop->tid);
+        num_evloops++;
+    }
+
+    /* Run with whatever we managed to start */
+    if (num_evloops > 0)
+        rc = 0;
+
+done:
+    Pthread_mutex_unlock(&evloop_lk);
+    return rc;
+}
+
+/* Hand the write side of a freshly connected host to an I/O thread.
+ * Caller holds host_node_ptr->lock. */
+static int evloop_attach(host_node_type *host_node_ptr)
+{
+    struct net_evloop *loop;
+    int wake;
+
+    if (net_evloop_start() != 0 || num_evloops == 0)
+        return -1;
+
+    /* a host keeps its I/O thread across reconnects */
+    if (host_node_ptr->evloop == NULL) {
+        Pthread_mutex_lock(&evloop_lk);
+        host_node_ptr->evloop = &evloops[next_evloop++ % num_evloops];
+        Pthread_mutex_unlock(&evloop_lk);
+    }
+    loop = host_node_ptr->evloop;
+
+    host_node_ptr->ev_error = 0;
+    host_node_ptr->ev_armed = 0;
+    host_node_ptr->ev_offset = 0;
+    host_node_ptr->ev_start_time = time_epoch();
+    host_node_ptr->have_writer_thread = 1;
+
+    Pthread_mutex_lock(&loop->lk);
+    host_node_ptr->ev_state = NET_EV_NEW;
+    host_node_ptr->ev_all_next = loop->hosts;
+    loop->hosts = host_node_ptr;
+    loop->nhosts++;
+    wake = evloop_ready_push_lk(loop, host_node_ptr);
+    Pthread_mutex_unlock(&loop->lk);
+
+    if (wake)
+        evloop_wake(loop);
+
+    if (gbl_verbose_net)
+        host_node_printf(LOGMSG_DEBUG, host_node_ptr,
+                         "%s: attached to io thread %d\n", __func__, loop->idx);
+    return 0;
+}
+
+/* Called on the I/O thread once a host's connection is finished with.
+ * Mirrors the exit path of writer_thread. */
+static void evloop_detach(struct net_evloop *loop,
+                          host_node_type *host_node_ptr)
+{
+    netinfo_type *netinfo_ptr = host_node_ptr->netinfo_ptr;
+    host_node_type **pp, *prev;
+    write_data *ptr;
+
+    Pthread_mutex_lock(&loop->lk);
+    if (host_node_ptr->ev_state == NET_EV_ACTIVE)
+        epoll_ctl(loop->epfd, EPOLL_CTL_DEL, host_node_ptr->fd, NULL);
+    host_node_ptr->ev_state = NET_EV_DETACHED;
+
+    if (host_node_ptr->ev_queued) {
+        for (prev = NULL, pp = &loop->ready_head; *pp != host_node_ptr;
+             prev = *pp, pp = &(*pp)->ev_next)
+            ;
+        *pp = host_node_ptr->ev_next;
+        if (loop->ready_tail == host_node_ptr)
+            loop->ready_tail = prev;
+        host_node_ptr->ev_queued = 0;
+    }
+    for (pp = &loop->hosts; *pp != host_node_ptr; pp = &(*pp)->ev_all_next)
+        ;
+    *pp = host_node_ptr->ev_all_next;
+    loop->nhosts--;
+    Pthread_mutex_unlock(&loop->lk);
+
+    while ((ptr = host_node_ptr->ev_outq) != NULL) {
+        host_node_ptr->ev_outq = ptr->next;
+        free_write_data(host_node_ptr, ptr);
+    }
+    host_node_ptr->ev_outq_tail = NULL;
+    host_node_ptr->ev_offset = 0;
+
+    Pthread_mutex_lock(&(host_node_ptr->lock));
+    host_node_ptr->have_writer_thread = 0;
+    if (gbl_verbose_net)
+        host_node_printf(LOGMSG_DEBUG, host_node_ptr,
+                         "%s: detached from io thread %d\n", __func__,
+                         loop->idx);
+    /* Check if failure is not during connection setup. */
+    if (((time_epoch() - host_node_ptr->ev_start_time) >
+         netinfo_ptr->heartbeat_check_time) &&
+        !host_node_ptr->closed) {
+        /* Close other sockets related to this hostname */
+        shutdown_other_hostnodes(host_node_ptr);
+    }
+    close_hostnode_ll(host_node_ptr);
+    Pthread_mutex_unlock(&(host_node_ptr->lock));
+}
+
+static int evloop_arm(struct net_evloop *loop, host_node_type *host_node_ptr,
+                      int want_out)
+{
+    struct epoll_event ev = {0};
+
+    if (host_node_ptr->ev_armed == want_out)
+        return 0;
+
+    ev.events = want_out ? EPOLLOUT : 0;
+    ev.data.ptr = host_node_ptr;
+    if (epoll_ctl(loop->epfd, EPOLL_CTL_MOD, host_node_ptr->fd, &ev) != 0) {
+        host_node_errf(LOGMSG_ERROR, host_node_ptr,
+                       "%s: epoll_ctl errno %d %s\n", __func__, errno,
+                       strerror(errno));
+        return -1;
+    }
+    host_node_ptr->ev_armed = want_out;
+    return 0;
+}
+
+/* Push queued messages for a host out to its socket.
+ *
+ * Returns 0 when everything has been handed to the kernel or the socket is
+ * full (EPOLLOUT is armed), 1 if we stopped early to give other hosts a turn,
+ * and -1 on error. */
+static int evloop_write(struct net_evloop *loop, host_node_type *host_node_ptr)
+{
+    netinfo_type *netinfo_ptr = host_node_ptr->netinfo_ptr;
+    struct iovec iov[NET_EVLOOP_MAXIOV];
+    struct msghdr msg;
+    write_data *ptr;
+    size_t done;
+    ssize_t n;
+    int ii, niov, nsends = 0, flags = 0;
+
+    /* Like writer_thread, only take the write list once the previous batch
+     * is gone.  Until then the enqueue counters keep growing, so the
+     * queue-full and throttle limits still apply to a slow socket. */
+    if (host_node_ptr->ev_outq == NULL) {
+        Pthread_mutex_lock(&(host_node_ptr->enquelk));
+        host_node_ptr->ev_outq = host_node_ptr->write_head;
+        host_node_ptr->ev_outq_tail = host_node_ptr->write_tail;
+        host_node_ptr->write_head = host_node_ptr->write_tail = NULL;
+        host_node_ptr->enque_count = 0;
+        host_node_ptr->enque_bytes = 0;
+        Pthread_mutex_unlock(&(host_node_ptr->enquelk));
+
+        if (host_node_ptr->ev_outq == NULL)
+            return evloop_arm(loop, host_node_ptr, 0);
+
+        pthread_cond_broadcast(&(host_node_ptr->throttle_wakeup));
+
+        for (ptr = host_node_ptr->ev_outq; ptr != NULL; ptr = ptr->next) {
+            fill_wire_header(netinfo_ptr, host_node_ptr, ptr);
+            flags |= ptr->flags;
+            host_node_ptr->flush_msgs++;
+        }
+        flush_hist_add(netinfo_ptr, host_node_ptr, 0);
+        host_node_ptr->ev_offset = 0;
+
+        if (flags & WRITE_MSG_NODELAY)
+            net_delay(host_node_ptr->host);
+        if (netinfo_ptr->trace && debug_switch_net_verbose())
+            logmsg(LOGMSG_USER, "Flushing %llu\n", gettmms());
+    }
+
+    while (host_node_ptr->ev_outq != NULL) {
+        if (nsends++ >= NET_EVLOOP_MAXSENDS)
+            return 1;
+
+        done = host_node_ptr->ev_offset;
+        for (niov = 0, ptr = host_node_ptr->ev_outq;
+             ptr != NULL && niov < NET_EVLOOP_MAXIOV; ptr = ptr->next) {
+            if (ptr->nseg == 0) {
+                iov[niov].iov_base = ptr->payload.raw + done;
+                iov[niov].iov_len = ptr->len - done;
+                niov++;
+            } else {
+                /* a message may go out partially; the byte count below
+                 * sorts out what was retired */
+                for (ii = 0; ii < ptr->nseg && niov < NET_EVLOOP_MAXIOV;
+                     ii++) {
+                    if (done >= ptr->seg[ii].len) {
+                        done -= ptr->seg[ii].len;
+                        continue;
+                    }
+                    iov[niov].iov_base = (char *)ptr->seg[ii].base + done;
+                    iov[niov].iov_len = ptr->seg[ii].len - done;
+                    niov++;
+                    done = 0;
+                }
+            }
+            done = 0;
+        }
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = niov;
+
+        n = sendmsg(host_node_ptr->fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                loop->full++;
+                return evloop_arm(loop, host_node_ptr, 1);
+            }
+            if (!host_node_ptr->distress)
+                host_node_errf(LOGMSG_ERROR, host_node_ptr,
+                               "%s: sendmsg errno %d %s\n", __func__, errno,
+                               strerror(errno));
+            return -1;
+        }
+
+        loop->sends++;
+        loop->bytes += n;
+        netinfo_ptr->stats.bytes_written += n;
+        host_node_ptr->stats.bytes_written += n;
+
+        /* retire whatever went out completely */
+        done = host_node_ptr->ev_offset + n;
+        while ((ptr = host_node_ptr->ev_outq) != NULL && done >= ptr->len) {
+            done -= ptr->len;
+            host_node_ptr->ev_outq = ptr->next;
+            free_write_data(host_node_ptr, ptr);
+        }
+        if (host_node_ptr->ev_outq == NULL)
+            host_node_ptr->ev_outq_tail = NULL;
+        host_node_ptr->ev_offset = done;
+    }
+
+    return evloop_arm(loop, host_node_ptr, 0);
+}
+
+static void evloop_service(struct net_evloop *loop,
+                           host_node_type *host_node_ptr)
+{
+    netinfo_type *netinfo_ptr = host_node_ptr->netinfo_ptr;
+    int rc;
+
+    if (host_node_ptr->ev_state == NET_EV_NEW) {
+        struct epoll_event ev = {0};
+        ev.events = 0; /* EPOLLERR and EPOLLHUP are always reported */
+        ev.data.ptr = host_node_ptr;
+        if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, host_node_ptr->fd, &ev) !=
+            0) {
+            host_node_errf(LOGMSG_ERROR, host_node_ptr,
+                           "%s: epoll_ctl add fd %d errno %d %s\n", __func__,
+                           host_node_ptr->fd, errno, strerror(errno));
+            evloop_detach(loop, host_node_ptr);
+            return;
+        }
+        Pthread_mutex_lock(&loop->lk);
+        host_node_ptr->ev_state = NET_EV_ACTIVE;
+        Pthread_mutex_unlock(&loop->lk);
+
+        write_hello(netinfo_ptr, host_node_ptr);
+    }
+
+    if (host_node_ptr->ev_error || host_node_ptr->decom_flag ||
+        host_node_ptr->closed || netinfo_ptr->exiting) {
+        evloop_detach(loop, host_node_ptr);
+        return;
+    }
+
+    rc = evloop_write(loop, host_node_ptr);
+    if (rc < 0) {
+        evloop_detach(loop, host_node_ptr);
+    } else if (rc > 0) {
+        /* more to send; go to the back of the line */
+        Pthread_mutex_lock(&loop->lk);
+        evloop_ready_push_lk(loop, host_node_ptr);
+        Pthread_mutex_unlock(&loop->lk);
+    }
+}
+
+static void *net_evloop_thread(void *arg)
+{
+    struct net_evloop *loop = arg;
+    struct epoll_event events[NET_EVLOOP_MAXEVENTS];
+    host_node_type *host_node_ptr;
+    int last_sweep = 0, now, n, i;
+    uint64_t cnt;
+
+    thread_started("net io");
+
+    loop->archtid = getarchtid();
+    if (gbl_verbose_net)
+        logmsg(LOGMSG_DEBUG, "%s: io thread %d starting tid=%d\n", __func__,
+               loop->idx, loop->archtid);
+
+    while (1) {
+        n = epoll_wait(loop->epfd, events, NET_EVLOOP_MAXEVENTS,
+                       NET_EVLOOP_TICK_MS);
+        if (n < 0) {
+            if (errno != EINTR) {
+                logmsg(LOGMSG_ERROR, "%s: epoll_wait errno %d %s\n", __func__,
+                       errno, strerror(errno));
+                poll(NULL, 0, 10);
+            }
+            n = 0;
+        }
+
+        for (i = 0; i < n; i++) {
+            host_node_ptr = events[i].data.ptr;
+            if (host_node_ptr == NULL) {
+                while (read(loop->evfd, &cnt, sizeof(cnt)) > 0)
+                    ;
+                loop->wakeups++;
+                continue;
+            }
+            if (events[i].events & (EPOLLERR | EPOLLHUP))
+                host_node_ptr->ev_error = 1;
+            Pthread_mutex_lock(&loop->lk);
+            evloop_ready_push_lk(loop, host_node_ptr);
+            Pthread_mutex_unlock(&loop->lk);
+        }
+
+        /* Once a tick, look at every host: this pushes out messages that
+         * were queued without NODELAY and notices closed or decommissioned
+         * hosts and exiting nets. */
+        now = time_epoch();
+        if (now != last_sweep) {
+            Pthread_mutex_lock(&loop->lk);
+            for (host_node_ptr = loop->hosts; host_node_ptr != NULL;
+                 host_node_ptr = host_node_ptr->ev_all_next)
+                evloop_ready_push_lk(loop, host_node_ptr);
+            Pthread_mutex_unlock(&loop->lk);
+            last_sweep = now;
+        }
+
+        while ((host_node_ptr = evloop_ready_pop(loop)) != NULL)
+            evloop_service(loop, host_node_ptr);
+    }
+
+    return NULL;
+}
+
+void net_evloop_stat(FILE *out)
+{
+    int i;
+
+    if (num_evloops == 0) {
+        fprintf(out, "net io threads not running (net_io_threads %d)\n",
+                gbl_net_io_threads);
+        return;
+    }
+
+    for (i = 0; i < num_evloops; i++) {
+        struct net_evloop *loop = &evloops[i];
+        fprintf(out,
+                "io thread %d tid %d hosts %d wakeups %llu sends %llu "
+                "bytes %llu socket-full %llu\n",
+                loop->idx, loop->archtid, loop->nhosts, loop->wakeups,
+                loop->sends, loop->bytes, loop->full);
+    }
+}
+
+#else
+
+static void evloop_kick(host_node_type *host_node_ptr) {}
+
+void net_evloop_stat(FILE *out)
+{
+    fprintf(out, "net io threads are not supported on this platform\n");
+}
+
+#endif /* NET_EVLOOP */
+
+
 static int process_hello(netinfo_type *netinfo_ptr,
                          host_node_type *host_node_ptr)
 {
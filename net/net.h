@@ -108,6 +108,31 @@ int net_send_inorder(netinfo_type *netinfo,
                      /*host_node_type *host_node, */
                      int usertype, void *dta, int dtalen, int nodelay);
 
+/* Refcounted send buffer.  Pieces of a message that live in one of these are
+   queued by reference instead of being copied, so a single buffer can be
+   fanned out to every host.  The allocating caller owns one reference and
+   drops it with net_iov_buf_release once it is done sending. */
+typedef struct net_iov_buf net_iov_buf;
+
+net_iov_buf *net_iov_buf_alloc(size_t len);
+void *net_iov_buf_data(net_iov_buf *buf);
+void net_iov_buf_release(net_iov_buf *buf);
+
+typedef struct net_iov {
+    void *base;
+    size_t len;
+    net_iov_buf *ref; /* NULL: copied when the message is queued */
+} net_iov;
+
+enum { NET_SEND_MAXIOV = 32 };
+
+/* Like net_send, but the payload is the concatenation of iov[0..iovcnt).
+   Pieces with a ref must lie inside that buffer.  Messages sent inorder are
+   always copied since the netcmp routine needs to see them contiguously. */
+int net_send_message_iov(netinfo_type *netinfo, const char *to_host,
+                         int usertype, const net_iov *iov, int iovcnt,
+                         int nodelay, int nodrop, int inorder);
+
 /* register your callback routine that will be called when
    user messages of type "usertype" are recieved */
 int net_register_handler(netinfo_type *netinfo_ptr, int usertype, NETFP func);
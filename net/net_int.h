@@ -59,6 +59,14 @@ enum { NET_WIRE_HEADER_TYPE_LEN = 16 + 4 + 4 + 16 + 4 + 4 + 4 };
 BB_COMPILE_TIME_ASSERT(net_write_header_type,
                        sizeof(wire_header_type) == NET_WIRE_HEADER_TYPE_LEN);
 
+/* A piece of a queued message.  Pieces either point into the message's own
+ * payload (ref == NULL) or into a caller's refcounted buffer. */
+typedef struct write_seg {
+    const char *base;
+    size_t len;
+    struct net_iov_buf *ref;
+} write_seg;
+
 typedef struct write_node_data {
     int flags;
     int enque_time;
@@ -66,6 +74,11 @@ typedef struct write_node_data {
     struct write_node_data *next;
     struct write_node_data *prev;
     size_t len;
+    /* If nseg is 0 the whole message is in payload; otherwise it is the
+     * concatenation of seg[0..nseg) and only the first piece is guaranteed
+     * to start at payload. */
+    int nseg;
+    write_seg *seg;
     /* Must be last thing in struct; payload immediately follows header */
     union {
         wire_header_type header;
@@ -86,6 +99,10 @@ typedef struct seq_node_data {
 struct host_node_tag;
 struct netinfo_struct;
 struct watchlist_node_tag;
+struct net_evloop;
+
+/* State of a host on the event loop transport */
+enum { NET_EV_DETACHED = 0, NET_EV_NEW = 1, NET_EV_ACTIVE = 2 };
 
 typedef struct watchlist_node_tag {
     char magic[4]; /* should be "WLST" */
@@ -121,6 +138,18 @@ typedef struct {
     unsigned long long reorders;
 } stats_type;
 
+/* Flush histograms, bumped with relaxed atomics.  Buckets are powers of two: bucket n
+ * counts values in [2^(n-1), 2^n), bucket 0 counts zeros. */
+enum { NET_FLUSH_HIST_BUCKETS = 16 };
+
+typedef struct {
+    unsigned long long msgs[NET_FLUSH_HIST_BUCKETS]; /* messages per flush */
+    unsigned long long hold[NET_FLUSH_HIST_BUCKETS]; /* usecs held per flush */
+    unsigned long long held;       /* flushes held back by the coalescer */
+    unsigned long long joined;     /* held flushes that picked up more work */
+    unsigned long long suppressed; /* interval flushes left to a commit */
+} flush_hist_type;
+
 #define HOSTNAME_LEN 16
 
 struct host_node_tag {
@@ -197,11 +226,37 @@ struct host_node_tag {
     HostInfo udp_info;
     int num_sends;
     unsigned long long num_flushes;
+
+    /* Adaptive flush coalescing (writer thread only).  commit_gap_us is a
+     * moving average of the time between nodelay user messages, which are
+     * the commit boundaries on the replication net. */
+    uint64_t last_commit_us;
+    int commit_gap_us;
+    int rtt_us;       /* smoothed rtt reported by the kernel */
+    int rtt_time;     /* when rtt_us was last sampled */
+    int ack_us;       /* moving average of send to ack latency */
+    unsigned flush_msgs; /* messages written since the last flush */
     pthread_mutex_t timestamp_lock; /* no more premature session killing */
 
     int throttle_waiters;
     pthread_mutex_t throttle_lock;
     pthread_cond_t throttle_wakeup;
+
+    /* Event loop transport: set if the write side of this host is served by
+     * a shared I/O thread instead of a writer thread.  The ev_ fields other
+     * than ev_state/ev_queued/ev_next/ev_all_next (protected by the loop's
+     * lock) are only touched by that I/O thread. */
+    struct net_evloop *evloop;
+    int ev_state;
+    int ev_queued;
+    int ev_armed;
+    int ev_error;
+    int ev_start_time;
+    struct host_node_tag *ev_next;     /* ready list */
+    struct host_node_tag *ev_all_next; /* all hosts on the loop */
+    write_data *ev_outq;               /* taken off the write list */
+    write_data *ev_outq_tail;
+    size_t ev_offset; /* bytes of ev_outq already sent */
 };
 
 /* Cut down data structure used for storing the sanc list. */
@@ -310,6 +365,7 @@ struct netinfo_struct {
     pthread_mutex_t connlk;
 
     int enque_flush_interval;
+    flush_hist_type flush_hist;
 
     int throttle_percent;
     NETCMPFP *netcmp_rtn;
@@ -327,6 +383,9 @@ typedef struct ack_state_struct {
     netinfo_type *netinfo;
 } ack_state_type;
 
+void net_evloop_stat(FILE *out);
+void net_flush_stat(netinfo_type *netinfo_ptr, FILE *out);
+
 /* Trace functions */
 void host_node_printf(loglvl lvl, host_node_type *host_node_ptr, const char *fmt, ...);
 void host_node_errf(loglvl lvl, host_node_type *host_node_ptr, const char *fmt, ...);
@@ -483,7 +483,9 @@ int do_alter_table_int(struct schema_change_type *s, struct ireq *iniq)
      * truncated prefix anyway */
     bdb_get_new_prefix(new_prefix, sizeof(new_prefix), &bdberr);
 
-    rc = open_temp_db_resume(newdb, new_prefix, s->resume, 0);
+    /* an interrupted sorted index build leaves nothing worth resuming */
+    rc = open_temp_db_resume(newdb, new_prefix,
+                             s->resume && !sc_sorted_ix_build(s, newdb), 0);
     if (rc) {
         /* todo: clean up db */
         sc_errf(s, "failed opening new db\n");
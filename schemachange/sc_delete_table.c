@@ -41,6 +41,7 @@ int delete_table(char *table)
     MEMORY_SYNC;
     delete_schema(table);
     bdb_del_table_csonparameters(NULL, table);
+    bdb_del_compr_dicts(NULL, table);
     return 0;
 }
 
@@ -138,6 +138,8 @@ int appsock_schema_change(SBUF2 *sb, int *keepsocket)
             sc.scanmode = SCAN_DUMP;
         else if (strcmp(tok, "indexscan") == 0)
             sc.scanmode = SCAN_INDEX;
+        else if (strcmp(tok, "sortedscan") == 0)
+            sc.scanmode = SCAN_SORTED;
         else if (strncmp(tok, "table:", 6) == 0)
             strncpy0(sc.table, tok + 6, sizeof(sc.table));
         else if (strcmp(tok, "fullrebuild") == 0)
@@ -172,6 +174,8 @@ int appsock_schema_change(SBUF2 *sb, int *keepsocket)
             sc.compress = BDB_COMPRESS_CRLE;
         else if (strcmp(tok, "rec_lz4") == 0)
             sc.compress = BDB_COMPRESS_LZ4;
+        else if (strcmp(tok, "rec_zstd") == 0)
+            sc.compress = BDB_COMPRESS_ZSTD;
         else if (strcmp(tok, "rec_nocompress") == 0)
             sc.compress = BDB_COMPRESS_NONE;
 
@@ -181,6 +185,8 @@ int appsock_schema_change(SBUF2 *sb, int *keepsocket)
             sc.compress_blobs = BDB_COMPRESS_RLE8;
         else if (strcmp(tok, "blob_lz4") == 0)
             sc.compress_blobs = BDB_COMPRESS_LZ4;
+        else if (strcmp(tok, "blob_zstd") == 0)
+            sc.compress_blobs = BDB_COMPRESS_ZSTD;
         else if (strcmp(tok, "blob_nocompress") == 0)
             sc.compress_blobs = BDB_COMPRESS_NONE;
 
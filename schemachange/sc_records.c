@@ -21,6 +21,7 @@
 #include "logmsg.h"
 
 extern int gbl_partial_indexes;
+extern __thread int memp_scan_thread;
 
 /* Hopefully this goes to a proper header at one point */
 extern unsigned long long get_genid(bdb_state_type *bdb_state, int dtastripe);
@@ -110,7 +111,7 @@ static inline int print_global_sc_stat(struct convert_record_data *data,
                   gbl_sc_adds + gbl_sc_updates);
 
     /* totals across all threads */
-    if (data->scanmode != SCAN_PARALLEL)
+    if (data->scanmode != SCAN_PARALLEL && data->scanmode != SCAN_SORTED)
         return 1;
 
     long long total_nrecs_diff = gbl_sc_nrecs - gbl_sc_prev_nrecs;
@@ -195,8 +196,9 @@ int init_sc_genids(struct db *db, struct schema_change_type *s)
 
     sc_genids = db->sc_genids;
 
-    /* if we aren't resuming simply zero the genids */
-    if (!s->resume) {
+    /* if we aren't resuming simply zero the genids; a sorted index build
+     * saves no progress, so it always starts over */
+    if (!s->resume || sc_sorted_ix_build(s, db)) {
         /* if we may have to resume this schema change, clear the progress in
          * llmeta */
         if (bdb_clear_high_genid(NULL /*input_trans*/, db->dbname,
@@ -409,6 +411,157 @@ static int report_sc_progress(struct convert_record_data *data, int now)
     return 0;
 }
 
+/* SCAN_SORTED builds the new indexes in two passes.  The stripe threads read
+ * the data as in SCAN_PARALLEL, but instead of adding each record's keys to
+ * the new btrees they put them in temp tables of their own, one per index,
+ * which keep them sorted.  Once every stripe is done the runs for each index
+ * are merged and added in key order (see sorted_ix_build_all()), so the new
+ * btree grows at its right edge: berkdb's append split leaves the pages full
+ * and the file is written front to back instead of at random.
+ *
+ * A temp table key is the index key followed by the genid.  The data is the
+ * datacopy or collattr tail for indexes that have one, and the genid again
+ * otherwise so that no row is empty.
+ *
+ * This only covers readonly schema changes whose plan keeps the data and
+ * blob files; returns why it can't be used for this one, or NULL. */
+static const char *sorted_ix_unusable(struct schema_change_type *s,
+                                      struct db *to)
+{
+    int ixnum, nbuild = 0;
+
+    if (s->live)
+        return "live schema change";
+    if (!gbl_use_plan || !to->plan || to->plan->dta_plan == -1)
+        return "data file is rebuilt";
+    for (ixnum = 0; ixnum < to->numblobs; ixnum++) {
+        if (to->plan->blob_plan[ixnum] == -1)
+            return "blob files are rebuilt";
+    }
+    if (to->ix_expr)
+        return "table has expression indexes";
+    if (schema_change == SC_CONSTRAINT_CHANGE)
+        return "constraint change";
+    for (ixnum = 0; ixnum < to->nix; ixnum++) {
+        if (to->plan->ix_plan[ixnum] == -1)
+            nbuild++;
+    }
+    if (nbuild == 0)
+        return "no indexes to build";
+    return NULL;
+}
+
+/* Nothing marks how far a sorted build got, and the merge pass may have
+ * filled the new btrees partway, so a resumed one starts over in a fresh
+ * new table (see open_temp_db_resume()) from genid 0. */
+int sc_sorted_ix_build(struct schema_change_type *s, struct db *to)
+{
+    return s->scanmode == SCAN_SORTED && sorted_ix_unusable(s, to) == NULL;
+}
+
+static void sorted_ix_close(struct convert_record_data *data)
+{
+    int ixnum, bdberr;
+
+    for (ixnum = 0; ixnum < MAXINDEX; ixnum++) {
+        if (data->ixtbl[ixnum])
+            bdb_temp_table_close(thedb->bdb_env, data->ixtbl[ixnum], &bdberr);
+        data->ixtbl[ixnum] = NULL;
+        data->ixcur[ixnum] = NULL;
+    }
+}
+
+static int sorted_ix_open(struct convert_record_data *data)
+{
+    int ixnum, bdberr;
+
+    data->ixsch = find_tag_schema(data->to->dbname, ".NEW..ONDISK");
+    if (data->ixsch == NULL) {
+        sc_errf(data->s, "sorted index build: no .NEW..ONDISK schema\n");
+        return -1;
+    }
+
+    for (ixnum = 0; ixnum < data->to->nix; ixnum++) {
+        if (data->to->plan->ix_plan[ixnum] != -1)
+            continue;
+        data->ixtbl[ixnum] = bdb_temp_table_create(thedb->bdb_env, &bdberr);
+        if (data->ixtbl[ixnum] == NULL) {
+            sc_errf(data->s, "failed to create sort table for index %d "
+                             "bdberr %d\n",
+                    ixnum, bdberr);
+            sorted_ix_close(data);
+            return -1;
+        }
+        data->ixcur[ixnum] = bdb_temp_table_cursor(
+            thedb->bdb_env, data->ixtbl[ixnum], NULL, &bdberr);
+        if (data->ixcur[ixnum] == NULL) {
+            sc_errf(data->s, "failed to open sort cursor for index %d "
+                             "bdberr %d\n",
+                    ixnum, bdberr);
+            sorted_ix_close(data);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* forms the keys of a record for every index being built and puts them in
+ * this stripe's sort tables */
+static int sorted_ix_add(struct convert_record_data *data, char *dta,
+                         int dtalen, unsigned long long genid,
+                         unsigned long long ins_keys, int *ixfailnum)
+{
+    char key[MAXKEYLEN + sizeof(genid)];
+    char mangled_key[MAXKEYLEN];
+    char ixtag[MAXTAGLEN];
+    int ixnum, ixkeylen, rc, bdberr;
+
+    for (ixnum = 0; ixnum < data->to->nix; ixnum++) {
+        char *tail = NULL;
+        int taillen = 0;
+
+        if (data->ixtbl[ixnum] == NULL)
+            continue;
+
+        /* only add keys when told */
+        if (gbl_partial_indexes && data->to->ix_partial &&
+            !(ins_keys & (1ULL << ixnum)))
+            continue;
+
+        *ixfailnum = ixnum;
+        ixkeylen = getkeysize(data->to, ixnum);
+        if (ixkeylen < 0)
+            return ERR_BADREQ;
+
+        snprintf(ixtag, sizeof(ixtag), ".NEW..ONDISK_IX_%d", ixnum);
+        rc = create_key_from_ondisk_sch_blobs(
+            data->to, data->ixsch, ixnum, &tail, &taillen, mangled_key,
+            ".NEW..ONDISK", dta, dtalen, ixtag, key, NULL, data->wrblb,
+            MAXBLOBS, data->iq.tzname);
+        if (rc) {
+            sc_errf(data->s, "cannot form index %d\n", ixnum);
+            return ERR_INTERNAL;
+        }
+
+        memcpy(key + ixkeylen, &genid, sizeof(genid));
+        if (tail == NULL || taillen == 0) {
+            tail = (char *)&genid;
+            taillen = sizeof(genid);
+        }
+
+        rc = bdb_temp_table_insert(thedb->bdb_env, data->ixcur[ixnum], key,
+                                   ixkeylen + sizeof(genid), tail, taillen,
+                                   &bdberr);
+        if (rc) {
+            sc_errf(data->s, "sort table insert for index %d failed rc %d "
+                             "bdberr %d\n",
+                    ixnum, rc, bdberr);
+            return ERR_INTERNAL;
+        }
+    }
+    return 0;
+}
+
 /* converts a single record and prepares for the next one
  * should be called from a while loop
  * param data: pointer to all the state information
@@ -467,6 +620,8 @@ static int convert_record(struct convert_record_data *data)
      *   live schema change.
      * - SCAN_PARALLEL - start one thread for each stripe, the thread
      *   reads all the records in its stripe in order
+     * - SCAN_SORTED - read like SCAN_PARALLEL, but only collect the keys
+     *   of the new indexes; they are built afterwards in key order.
      * - SCAN_DUMP - bulk dump the data file(s).  Fastest possible
      *   scan mode.
      * - SCAN_INDEX - use regular ix_ routines to scan the primary
@@ -479,10 +634,12 @@ static int convert_record(struct convert_record_data *data)
     data->iq.usedb = data->from;
     data->iq.timeoutms = gbl_sc_timeoutms;
 
-    if (data->scanmode == SCAN_PARALLEL) {
+    if (data->scanmode == SCAN_PARALLEL || data->scanmode == SCAN_SORTED) {
+        ++memp_scan_thread;
         rc = dtas_next(&data->iq, data->sc_genids, &genid, &data->stripe, 1,
                        data->dta_buf, data->trans, data->from->lrl, &dtalen,
                        NULL);
+        --memp_scan_thread;
         if (rc == 0) {
             dta = data->dta_buf;
             check_genid = bdb_normalise_genid(data->to->handle, genid);
@@ -797,7 +954,13 @@ static int convert_record(struct convert_record_data *data)
             goto err;
     }
 
-    if (schema_change != SC_CONSTRAINT_CHANGE) {
+    if (data->scanmode == SCAN_SORTED) {
+        rc = sorted_ix_add(data, (char *)p_buf_data,
+                           p_buf_data_end - p_buf_data, ngenid, dirty_keys,
+                           &ixfailnum);
+        if (rc)
+            goto err;
+    } else if (schema_change != SC_CONSTRAINT_CHANGE) {
         int nrrn = rrn;
         rc = add_record(
             &data->iq, data->trans, p_tagname_buf, p_tagname_buf_end,
@@ -813,8 +976,10 @@ static int convert_record(struct convert_record_data *data)
     }
 
     /* if we have been rebuilding the data files we're gonna
-       call bdb_get_high_genid to resume, not look at llmeta */
+       call bdb_get_high_genid to resume, not look at llmeta.
+       a sorted build has nothing in the new indexes to resume from */
     if (usellmeta && !is_dta_being_rebuilt(data->to->plan) &&
+        data->scanmode != SCAN_SORTED &&
         (data->nrecs %
          BDB_ATTR_GET(thedb->bdb_attr, INDEXREBUILD_SAVE_EVERY_N)) == 0) {
         int bdberr;
@@ -885,7 +1050,7 @@ err: /*if (is_schema_change_doomed())*/
 
     /* Advance our progress markers */
     data->nrecs++;
-    if (data->scanmode == SCAN_PARALLEL) {
+    if (data->scanmode == SCAN_PARALLEL || data->scanmode == SCAN_SORTED) {
         data->sc_genids[data->stripe] = genid;
     }
 
@@ -1063,6 +1228,278 @@ cleanup_no_msg:
     return NULL;
 }
 
+/* one key read back from the sort tables, kept until its transaction
+ * commits so that it can be added again if that transaction deadlocks */
+struct sorted_ix_key {
+    unsigned long long genid;
+    char *tail;
+    int taillen, tailsz;
+    char key[MAXKEYLEN];
+};
+
+struct sorted_ix_build {
+    struct convert_record_data *data;
+    struct convert_record_data *thds; /* stripe threads holding the runs */
+    int nthds;
+    int nextix; /* next index to pick up */
+    int outrc;
+};
+
+/* adds a batch of keys to index ixnum in one transaction */
+static int sorted_ix_flush(struct ireq *iq, struct schema_change_type *s,
+                           int ixnum, struct sorted_ix_key *keys, int nkeys)
+{
+    void *trans;
+    int ii, rc;
+
+    while (1) {
+        rc = trans_start_sc(iq, NULL, &trans);
+        if (rc) {
+            sc_errf(s, "error %d starting transaction\n", rc);
+            return -1;
+        }
+        set_tran_lowpri(iq, trans);
+
+        for (ii = 0; ii < nkeys; ii++) {
+            rc = ix_addk(iq, trans, keys[ii].key, ixnum, keys[ii].genid, 2,
+                         keys[ii].tail, keys[ii].taillen);
+            if (rc)
+                break;
+        }
+        if (rc == 0) {
+            rc = trans_commit(iq, trans, gbl_mynode);
+            if (rc) {
+                sc_errf(s, "sorted index build: trans_commit failed with "
+                           "rcode %d\n",
+                        rc);
+                return -1;
+            }
+            return 0;
+        }
+
+        trans_abort(iq, trans);
+        if (rc == RC_INTERNAL_RETRY && !gbl_sc_abort) {
+            poll(0, 0, (rand() % 500 + 10));
+            continue;
+        }
+        if (rc == IX_DUP)
+            sc_errf(s, "Could not add duplicate entry in index %d "
+                       "genid 0x%llx\n",
+                    ixnum, keys[ii].genid);
+        else
+            sc_errf(s, "Error adding key to index %d genid 0x%llx rcode %d\n",
+                    ixnum, keys[ii].genid, rc);
+        return -1;
+    }
+}
+
+/* merges every stripe's run for index ixnum and adds the keys in order */
+static int sorted_ix_merge(struct sorted_ix_build *b, struct ireq *iq,
+                           int ixnum)
+{
+    struct convert_record_data *data = b->data;
+    struct temp_cursor *cur[b->nthds];
+    int valid[b->nthds];
+    struct sorted_ix_key *keys;
+    int perbatch, nkeys = 0, ii, rc = 0, bdberr;
+    int keylen = getkeysize(data->to, ixnum);
+    int cmplen = keylen + sizeof(unsigned long long);
+    int lasttime = time_epoch();
+    long long nadded = 0;
+
+    perbatch = gbl_num_record_converts > 0 ? gbl_num_record_converts : 1;
+    keys = calloc(perbatch, sizeof(struct sorted_ix_key));
+    if (keys == NULL) {
+        sc_errf(data->s, "sorted index build: out of memory\n");
+        return -1;
+    }
+
+    for (ii = 0; ii < b->nthds; ii++) {
+        valid[ii] = 0;
+        cur[ii] = bdb_temp_table_cursor(thedb->bdb_env,
+                                        b->thds[ii].ixtbl[ixnum], NULL, &bdberr);
+        if (cur[ii] == NULL) {
+            sc_errf(data->s, "failed to open sort cursor for index %d "
+                             "bdberr %d\n",
+                    ixnum, bdberr);
+            rc = -1;
+            continue;
+        }
+        if (rc)
+            continue;
+        rc = bdb_temp_table_first(thedb->bdb_env, cur[ii], &bdberr);
+        if (rc == 0)
+            valid[ii] = 1;
+        else if (rc == IX_EMPTY || rc == IX_PASTEOF)
+            rc = 0;
+        else
+            sc_errf(data->s, "sort table read for index %d rc %d bdberr %d\n",
+                    ixnum, rc, bdberr);
+    }
+
+    while (rc == 0) {
+        int min = -1;
+
+        for (ii = 0; ii < b->nthds; ii++) {
+            if (valid[ii] &&
+                (min < 0 || memcmp(bdb_temp_table_key(cur[ii]),
+                                   bdb_temp_table_key(cur[min]), cmplen) < 0))
+                min = ii;
+        }
+
+        if (min >= 0) {
+            struct sorted_ix_key *k = &keys[nkeys++];
+            char *tkey = bdb_temp_table_key(cur[min]);
+            int taillen = bdb_temp_table_datasize(cur[min]);
+
+            memcpy(k->key, tkey, keylen);
+            memcpy(&k->genid, tkey + keylen, sizeof(k->genid));
+            k->taillen = 0;
+            if (data->to->ix_datacopy[ixnum] || data->to->ix_collattr[ixnum]) {
+                if (taillen > k->tailsz) {
+                    char *p = realloc(k->tail, taillen);
+                    if (p == NULL) {
+                        sc_errf(data->s, "sorted index build: out of memory\n");
+                        rc = -1;
+                        break;
+                    }
+                    k->tail = p;
+                    k->tailsz = taillen;
+                }
+                memcpy(k->tail, bdb_temp_table_data(cur[min]), taillen);
+                k->taillen = taillen;
+            }
+
+            rc = bdb_temp_table_next(thedb->bdb_env, cur[min], &bdberr);
+            if (rc == IX_PASTEOF || rc == IX_EMPTY) {
+                valid[min] = 0;
+                rc = 0;
+            } else if (rc) {
+                sc_errf(data->s, "sort table read for index %d rc %d "
+                                 "bdberr %d\n",
+                        ixnum, rc, bdberr);
+                break;
+            }
+        }
+
+        if (nkeys == perbatch || (min < 0 && nkeys > 0)) {
+            rc = sorted_ix_flush(iq, data->s, ixnum, keys, nkeys);
+            if (rc)
+                break;
+            nadded += nkeys;
+            nkeys = 0;
+
+            int now = time_epoch();
+            if (gbl_sc_report_freq > 0 &&
+                now >= lasttime + gbl_sc_report_freq) {
+                lasttime = now;
+                sc_printf(data->s, "progress index %d added %lld sorted keys\n",
+                          ixnum, nadded);
+            }
+        }
+
+        if (min < 0)
+            break;
+
+        if (gbl_sc_abort || gbl_sc_thd_failed) {
+            rc = -1;
+            break;
+        }
+    }
+
+    if (rc == 0)
+        sc_printf(data->s, "built index %d from %lld sorted keys\n", ixnum,
+                  nadded);
+
+    for (ii = 0; ii < b->nthds; ii++) {
+        if (cur[ii])
+            bdb_temp_table_close_cursor(thedb->bdb_env, cur[ii], &bdberr);
+    }
+    for (ii = 0; ii < perbatch; ii++)
+        free(keys[ii].tail);
+    free(keys);
+    return rc;
+}
+
+static void *sorted_ix_build_thd(void *arg)
+{
+    struct sorted_ix_build *b = arg;
+    struct ireq iq;
+    int ixnum;
+
+    thread_started("sorted index build");
+    thrman_register(THRTYPE_SCHEMACHANGE);
+    backend_thread_event(thedb, COMDB2_THR_EVENT_START_RDWR);
+
+    init_fake_ireq(thedb, &iq);
+    iq.usedb = b->data->to;
+    iq.opcode = OP_REBUILD;
+    iq.timeoutms = gbl_sc_timeoutms;
+
+    while ((ixnum = ATOMIC_ADD(b->nextix, 1) - 1) < b->data->to->nix) {
+        if (b->thds[0].ixtbl[ixnum] == NULL)
+            continue;
+        if (sorted_ix_merge(b, &iq, ixnum)) {
+            b->outrc = -1;
+            gbl_sc_thd_failed = 1;
+            break;
+        }
+    }
+
+    backend_thread_event(thedb, COMDB2_THR_EVENT_DONE_RDWR);
+    return NULL;
+}
+
+/* second pass of SCAN_SORTED: builds each new index from the stripe
+ * threads' sort tables, one index per thread */
+static int sorted_ix_build_all(struct convert_record_data *data,
+                               struct convert_record_data *thds, int nthds)
+{
+    struct sorted_ix_build b = {0};
+    pthread_attr_t attr;
+    int ii, nbuild = 0, nthreads;
+
+    b.data = data;
+    b.thds = thds;
+    b.nthds = nthds;
+
+    for (ii = 0; ii < data->to->nix; ii++) {
+        if (thds[0].ixtbl[ii])
+            nbuild++;
+    }
+    nthreads = data->cmembers->maxthreads;
+    if (nthreads > nbuild)
+        nthreads = nbuild;
+    if (nthreads < 1)
+        nthreads = 1;
+
+    sc_printf(data->s, "building %d indexes from sorted keys with %d "
+                       "threads\n",
+              nbuild, nthreads);
+
+    pthread_t tids[nthreads];
+    int started[nthreads];
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, DEFAULT_THD_STACKSZ);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+    for (ii = 0; ii < nthreads; ii++) {
+        started[ii] = pthread_create(&tids[ii], &attr, sorted_ix_build_thd,
+                                     &b) == 0;
+        if (!started[ii]) {
+            sc_errf(data->s, "starting sorted index build thread failed\n");
+            b.outrc = -1;
+        }
+    }
+    for (ii = 0; ii < nthreads; ii++) {
+        if (started[ii])
+            pthread_join(tids[ii], NULL);
+    }
+    pthread_attr_destroy(&attr);
+
+    return b.outrc;
+}
+
 int convert_all_records(struct db *from, struct db *to,
                         unsigned long long *sc_genids,
                         struct schema_change_type *s)
@@ -1080,6 +1517,16 @@ int convert_all_records(struct db *from, struct db *to,
     data.sc_genids = sc_genids;
     data.s = s;
 
+    if (data.scanmode == SCAN_SORTED) {
+        const char *why = sorted_ix_unusable(s, to);
+        if (why) {
+            sc_printf(data.s, "can't build indexes from sorted keys (%s), "
+                              "using parallel scan\n",
+                      why);
+            data.scanmode = SCAN_PARALLEL;
+        }
+    }
+
     if (data.live && data.scanmode != SCAN_PARALLEL) {
         sc_errf(data.s, "live schema change can only be done in parallel "
                         "scan mode\n");
@@ -1152,13 +1599,14 @@ int convert_all_records(struct db *from, struct db *to,
     int outrc = 0;
 
     /* if were not in parallel, dont start any threads */
-    if (data.scanmode != SCAN_PARALLEL) {
+    if (data.scanmode != SCAN_PARALLEL && data.scanmode != SCAN_SORTED) {
         convert_records_thd(&data);
         outrc = data.outrc;
     } else {
         struct convert_record_data threadData[gbl_dtastripe];
         pthread_attr_t attr;
         int rc = 0;
+        int nsorted = 0;
 
         data.isThread = 1;
 
@@ -1174,6 +1622,14 @@ int convert_all_records(struct db *from, struct db *to,
             threadData[ii] = data;
             threadData[ii].stripe = ii;
 
+            if (data.scanmode == SCAN_SORTED) {
+                if (sorted_ix_open(&threadData[ii])) {
+                    outrc = -1;
+                    break;
+                }
+                nsorted++;
+            }
+
             sc_printf(threadData[ii].s, "starting thread for stripe: %d\n",
                       threadData[ii].stripe);
 
@@ -1225,6 +1681,13 @@ int convert_all_records(struct db *from, struct db *to,
 
         /* destroy attr */
         pthread_attr_destroy(&attr);
+
+        /* every stripe has been read, now build the indexes */
+        if (data.scanmode == SCAN_SORTED && outrc == 0)
+            outrc = sorted_ix_build_all(&data, threadData, gbl_dtastripe);
+
+        for (ii = 0; ii < nsorted; ++ii)
+            sorted_ix_close(&threadData[ii]);
     }
 
     convert_record_data_cleanup(&data);
@@ -1302,9 +1765,11 @@ static int upgrade_records(struct convert_record_data *data)
          rc == RC_INTERNAL_RETRY && nretries++ != gbl_maxretries;) {
 
         if (data->nrecs > 0 || data->sc_genids[data->stripe] == 0) {
+            ++memp_scan_thread;
             rc = dtas_next(&data->iq, data->sc_genids, &genid, &data->stripe,
                            data->scanmode == SCAN_PARALLEL, data->dta_buf,
                            data->trans, data->from->lrl, &dtalen, &recver);
+            --memp_scan_thread;
         } else {
             genid = data->sc_genids[data->stripe];
             rc = ix_find_ver_by_rrn_and_genid_tran(
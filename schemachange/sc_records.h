@@ -55,6 +55,10 @@ struct convert_record_data {
     int *tagmap; // mapping of fields from -> to
     struct common_members *cmembers;
     unsigned int write_count; // saved write counter to this tbl
+    /* SCAN_SORTED: keys extracted for each index being built */
+    struct temp_table *ixtbl[MAXINDEX];
+    struct temp_cursor *ixcur[MAXINDEX];
+    struct schema *ixsch; // .NEW..ONDISK schema the keys are formed from
 };
 
 int convert_all_records(struct db *from, struct db *to,
@@ -70,5 +74,7 @@ void convert_record_data_cleanup(struct convert_record_data *data);
 
 int init_sc_genids(struct db *db, struct schema_change_type *s);
 
+int sc_sorted_ix_build(struct schema_change_type *s, struct db *to);
+
 void live_sc_enter_exclusive_all(bdb_state_type *bdb_state, void *trans);
 #endif
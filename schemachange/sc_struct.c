@@ -686,6 +686,9 @@ void print_schemachange_info(struct schema_change_type *s, struct db *db,
         sc_printf(s, "%s schema change running in parallel scan mode\n",
                   (s->live ? "Live" : "Readonly"));
         break;
+    case SCAN_SORTED:
+        sc_printf(s, "Schema change running in sorted index build mode\n");
+        break;
     }
 }
 
@@ -222,10 +222,13 @@ void fillTableOption(struct schema_change_type* sc, int opt)
         sc->compress_blobs = BDB_COMPRESS_ZLIB;
     if (OPT_ON(opt, BLOB_LZ4))
         sc->compress_blobs = BDB_COMPRESS_LZ4;
+    if (OPT_ON(opt, BLOB_ZSTD))
+        sc->compress_blobs = BDB_COMPRESS_ZSTD;
 
     if (sc->compress_blobs != BDB_COMPRESS_RLE8 &&
         sc->compress_blobs != BDB_COMPRESS_ZLIB && 
-        sc->compress_blobs != BDB_COMPRESS_LZ4)
+        sc->compress_blobs != BDB_COMPRESS_LZ4 &&
+        sc->compress_blobs != BDB_COMPRESS_ZSTD)
                 sc->compress_blobs = BDB_COMPRESS_NONE;
 
     if (OPT_ON(opt, REC_RLE))
@@ -236,10 +239,13 @@ void fillTableOption(struct schema_change_type* sc, int opt)
         sc->compress = BDB_COMPRESS_ZLIB;
     if (OPT_ON(opt, REC_LZ4))
         sc->compress = BDB_COMPRESS_LZ4;
+    if (OPT_ON(opt, REC_ZSTD))
+        sc->compress = BDB_COMPRESS_ZSTD;
 
     if (sc->compress != BDB_COMPRESS_RLE8 &&
         sc->compress != BDB_COMPRESS_ZLIB && 
-        sc->compress != BDB_COMPRESS_LZ4)
+        sc->compress != BDB_COMPRESS_LZ4 &&
+        sc->compress != BDB_COMPRESS_ZSTD)
                 sc->compress = BDB_COMPRESS_NONE;
 
     if (OPT_ON(opt, FORCE_REBUILD))
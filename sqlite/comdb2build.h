@@ -20,6 +20,9 @@
 
 #define FORCE_REBUILD 2048
 
+#define BLOB_ZSTD 4096
+#define REC_ZSTD  8192
+
 #define REBUILD_ALL     1
 #define REBUILD_DATA    2
 #define REBUILD_BLOB    4
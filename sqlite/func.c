@@ -2180,12 +2180,13 @@ void sqlite3RegisterBuiltinFunctions(void){
     LIKEFUNC(like, 3, &likeInfoNorm, SQLITE_FUNC_LIKE),
   #endif
 #ifdef SQLITE_BUILDING_FOR_COMDB2
-    FUNCTION(comdb2_version,    0, 0, 0, comdb2VersionFunc),
-    FUNCTION(table_version,     1, 0, 0, tableVersionFunc),
-    FUNCTION(partition_info,    2, 0, 0, partitionInfoFunc),
-    FUNCTION(comdb2_host,       0, 0, 0, comdb2HostFunc),
-    FUNCTION(comdb2_dbname,     0, 0, 0, comdb2DbnameFunc),
-    FUNCTION(comdb2_prevquerycost,0,0,0, comdb2PrevquerycostFunc),
+    /* these read the node or session they run on */
+    DFUNCTION(comdb2_version,   0, 0, 0, comdb2VersionFunc),
+    DFUNCTION(table_version,    1, 0, 0, tableVersionFunc),
+    DFUNCTION(partition_info,   2, 0, 0, partitionInfoFunc),
+    DFUNCTION(comdb2_host,      0, 0, 0, comdb2HostFunc),
+    DFUNCTION(comdb2_dbname,    0, 0, 0, comdb2DbnameFunc),
+    DFUNCTION(comdb2_prevquerycost,0,0,0,comdb2PrevquerycostFunc),
 #endif
 #ifdef SQLITE_ENABLE_UNKNOWN_SQL_FUNCTION
     FUNCTION(unknown,           -1, 0, 0, unknownFunc      ),
@@ -330,6 +330,7 @@ static Keyword aKeywordTable[] = {
   { "DDL",              "TK_DDL",           ALWAYS,                 0},
   { "USERSCHEMA",       "TK_USERSCHEMA",    ALWAYS,                 0},
   { "ZLIB",             "TK_ZLIB",          ALWAYS,                 0},
+  { "ZSTD",             "TK_ZSTD",          ALWAYS,                 0},
 };
 
 /* Number of keywords */
@@ -413,6 +413,7 @@ blob_compress_type(A) ::= RLE. {A = BLOB_RLE;}
 //blob_compress_type(A) ::= CRLE. {A = BLOB_CRLE;}
 blob_compress_type(A) ::= ZLIB. {A = BLOB_ZLIB;}
 blob_compress_type(A) ::= LZ4. {A = BLOB_LZ4;}
+blob_compress_type(A) ::= ZSTD. {A = BLOB_ZSTD;}
 
 %type compress_rec {int}
 compress_rec(A) ::= REC rle_compress_type(T). {A = T;}
@@ -422,6 +423,7 @@ rle_compress_type(A) ::= RLE. {A = REC_RLE;}
 rle_compress_type(A) ::= CRLE. {A = REC_CRLE;}
 rle_compress_type(A) ::= ZLIB. {A = REC_ZLIB;}
 rle_compress_type(A) ::= LZ4. {A = REC_LZ4;}
+rle_compress_type(A) ::= ZSTD. {A = REC_ZSTD;}
 
 /////////////////// COMDB2 ALTER TABLE STATEMENT  //////////////////////////////
 
@@ -528,7 +530,7 @@ columnname(A) ::= nm(A) typetoken(Y). {sqlite3AddColumn(pParse,&A,&Y);}
   ISC KW LUA LZ4 ODH OFF OP OPTIONS PARTITION PASSWORD PERIOD 
   PROCEDURE PUT REBUILD READ REC RESERVED RETENTION REVOKE RLE ROWLOCKS
   SCALAR SCHEMACHANGE START SUMMARIZE THREADS THRESHOLD TIME 
-  TRUNCATE VERSION WRITE DDL USERSCHEMA ZLIB .
+  TRUNCATE VERSION WRITE DDL USERSCHEMA ZLIB ZSTD .
 %wildcard ANY.
 
 
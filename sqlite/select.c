@@ -4011,6 +4011,133 @@ static Table *isSimpleCount(Select *p, AggInfo *pAggInfo){
   return pTab;
 }
 
+/* COMDB2 MODIFICATION */
+#ifdef SQLITE_ENABLE_CURSOR_HINTS
+/*
+** Walker callback for remoteAggWhere(): flag anything a remote database
+** could not evaluate for the table at cursor Walker.u.iCur, or could give
+** a different answer for.  Only built-in functions whose result depends on
+** their arguments alone qualify; application-defined ones (the datetime
+** functions among them) and ones reading the node or session do not.
+*/
+static int remoteAggWhereExpr(Walker *pWalker, Expr *pExpr){
+  if( pExpr->op==TK_COLUMN ){
+    if( pExpr->iTable!=pWalker->u.iCur || pExpr->u.zToken==0 ){
+      pWalker->eCode = 1;
+    }
+  }else if( pExpr->op==TK_FUNCTION && !ExprHasProperty(pExpr, EP_xIsSelect) ){
+    sqlite3 *db = pWalker->pParse->db;
+    int nArg = pExpr->x.pList ? pExpr->x.pList->nExpr : 0;
+    FuncDef *pDef;
+    if( sqlite3HashFind(&db->aFunc, pExpr->u.zToken)!=0
+     || (pDef = sqlite3FindFunction(db, pExpr->u.zToken, nArg, ENC(db), 0))==0
+     || (pDef->funcFlags & (SQLITE_FUNC_CONSTANT|SQLITE_FUNC_SLOCHNG))
+          !=SQLITE_FUNC_CONSTANT ){
+      pWalker->eCode = 1;
+    }
+  }else if( ExprHasProperty(pExpr, EP_xIsSelect)
+         || pExpr->op==TK_AGG_FUNCTION || pExpr->op==TK_AGG_COLUMN ){
+    pWalker->eCode = 1;
+  }
+  return pWalker->eCode ? WRC_Abort : WRC_Continue;
+}
+
+/*
+** Return true if the WHERE clause of an aggregate over the remote table at
+** cursor iCur can be sent to that table's database as a cursor hint.  It
+** may only refer to that table's own columns, by name.
+*/
+static int remoteAggWhere(Parse *pParse, Expr *pWhere, int iCur){
+  Walker w;
+  memset(&w, 0, sizeof(w));
+  w.pParse = pParse;
+  w.xExprCallback = remoteAggWhereExpr;
+  w.u.iCur = iCur;
+  sqlite3WalkExpr(&w, pWhere);
+  return w.eCode==0;
+}
+#endif
+
+/* COMDB2 MODIFICATION */
+/*
+** If the aggregate query p reads a single table with no WHERE clause and
+** every aggregate function in it is one sqlite3BtreeParallelAgg() knows how
+** to compute, return the P4_INTARRAY operand of OP_ParallelAgg describing
+** them.  Otherwise return 0.  A remote table may have a WHERE clause, which
+** goes to its database with the aggregates.
+*/
+static int *parallelAggSpec(Parse *pParse, Select *p, AggInfo *pAggInfo){
+  sqlite3 *db = pParse->db;
+  Table *pTab;
+  int *aSpec;
+  int i;
+  int isRemote;
+  extern int gbl_parallel_agg;
+  extern int gbl_fdb_pushdown;
+
+  assert( !p->pGroupBy );
+
+  if( p->pSrc->nSrc!=1 || p->pSrc->a[0].pSelect ) return 0;
+  /* hack as in codeCursorHint(), only remote tables have it */
+  isRemote = p->pSrc->a[0].zDatabase!=0;
+  if( !(isRemote ? gbl_fdb_pushdown : gbl_parallel_agg) ) return 0;
+  if( p->pWhere ){
+#ifdef SQLITE_ENABLE_CURSOR_HINTS
+    if( !isRemote
+     || !remoteAggWhere(pParse, p->pWhere, p->pSrc->a[0].iCursor) ){
+      return 0;
+    }
+#else
+    return 0;
+#endif
+  }
+  if( pAggInfo->nAccumulator || pAggInfo->nFunc==0 ) return 0;
+  pTab = p->pSrc->a[0].pTab;
+  if( pTab==0 || pTab->pSelect || IsVirtual(pTab) ) return 0;
+  if( sqlite3SchemaToIndex(db, pTab->pSchema)==1 ) return 0;
+
+  aSpec = sqlite3DbMallocRawNN(db, sizeof(int)*(1+3*pAggInfo->nFunc));
+  if( aSpec==0 ) return 0;
+  aSpec[0] = 1+3*pAggInfo->nFunc;
+  for(i=0; i<pAggInfo->nFunc; i++){
+    struct AggInfo_func *pF = &pAggInfo->aFunc[i];
+    ExprList *pList = pF->pExpr->x.pList;
+    const char *zName = pF->pFunc->zName;
+    Expr *pArg;
+    int kind;
+
+    if( pF->pExpr->flags&EP_Distinct ) goto not_parallel;
+    if( pList==0 || pList->nExpr==0 ){
+      if( (pF->pFunc->funcFlags&SQLITE_FUNC_COUNT)==0 ) goto not_parallel;
+      aSpec[1+3*i] = BTREE_AGG_COUNTSTAR;
+      aSpec[2+3*i] = -1;
+      aSpec[3+3*i] = pF->iMem;
+      continue;
+    }
+    if( pList->nExpr!=1 ) goto not_parallel;
+    pArg = pList->a[0].pExpr;
+    if( pArg->op!=TK_AGG_COLUMN && pArg->op!=TK_COLUMN ) goto not_parallel;
+    if( pArg->iTable!=p->pSrc->a[0].iCursor || pArg->iColumn<0 ){
+      goto not_parallel;
+    }
+    if( sqlite3StrICmp(zName, "count")==0 ) kind = BTREE_AGG_COUNT;
+    else if( sqlite3StrICmp(zName, "sum")==0 ) kind = BTREE_AGG_SUM;
+    else if( sqlite3StrICmp(zName, "total")==0 ) kind = BTREE_AGG_TOTAL;
+    else if( sqlite3StrICmp(zName, "avg")==0 ) kind = BTREE_AGG_AVG;
+    else if( sqlite3StrICmp(zName, "min")==0 ) kind = BTREE_AGG_MIN;
+    else if( sqlite3StrICmp(zName, "max")==0 ) kind = BTREE_AGG_MAX;
+    else goto not_parallel;
+    aSpec[1+3*i] = kind;
+    aSpec[2+3*i] = pArg->iColumn;
+    aSpec[3+3*i] = pF->iMem;
+  }
+  return aSpec;
+
+not_parallel:
+  sqlite3DbFree(db, aSpec);
+  return 0;
+}
+
 /*
 ** If the source-list item passed as an argument was augmented with an
 ** INDEXED BY clause, then try to locate the specified index. If there
@@ -5275,9 +5402,18 @@ int sqlite3Select(
     assert( WHERE_USE_LIMIT==SF_FixedLimit );
     wctrlFlags |= p->selFlags & SF_FixedLimit;
 
+    /* COMDB2 MODIFICATION */
+    /* A remote table read on its own can stop after LIMIT+OFFSET rows;
+    ** codeCursorHint() decides whether the whole WHERE clause and the
+    ** ORDER BY go with it, which the LIMIT needs */
+    if( p->iLimit && !sDistinct.isTnct && pTabList->nSrc==1 ){
+      pParse->iRemLimit = p->iOffset ? p->iOffset+1 : p->iLimit;
+    }
+
     /* Begin the database scan. */
     pWInfo = sqlite3WhereBegin(pParse, pTabList, pWhere, sSort.pOrderBy,
                                p->pEList, wctrlFlags, p->nSelectRow);
+    pParse->iRemLimit = 0;
     if( pWInfo==0 ) goto select_end;
     if( sqlite3WhereOutputRowCount(pWInfo) < p->nSelectRow ){
       p->nSelectRow = sqlite3WhereOutputRowCount(pWInfo);
@@ -5740,6 +5876,38 @@ int sqlite3Select(
           }
         }
   
+        /* COMDB2 MODIFICATION */
+        /* Try to compute the aggregates over all data stripes at once.
+        ** OP_ParallelAgg jumps past the loop below if it could, and falls
+        ** into it if it couldn't. */
+        int iParCsr = -1;
+        int addrParDone = 0;
+        int addrParSkip = 0;
+        int *aParSpec = 0;
+        if( flag==0 && p->op!=TK_SELECTV && !p->recording
+         && (aParSpec = parallelAggSpec(pParse, p, &sAggInfo))!=0 ){
+          Table *pParTab = p->pSrc->a[0].pTab;
+          int iParDb = sqlite3SchemaToIndex(db, pParTab->pSchema);
+          iParCsr = pParse->nTab++;
+          addrParDone = sqlite3VdbeMakeLabel(v);
+          addrParSkip = sqlite3VdbeMakeLabel(v);
+          sqlite3CodeVerifySchema(pParse, iParDb);
+          sqlite3VdbeAddTable(v, pParTab);
+          sqlite3TableLock(pParse, iParDb, pParTab->tnum, 0, pParTab->zName);
+          sqlite3VdbeAddOp4Int(v, OP_OpenRead, iParCsr, pParTab->tnum, iParDb,
+                               pParTab->nCol);
+#ifdef SQLITE_ENABLE_CURSOR_HINTS
+          if( p->pWhere ){
+            sqlite3VdbeAddOp4(v, OP_CursorHint, iParCsr, 0, 0,
+                              (char*)sqlite3ExprDup(db, p->pWhere, 0),
+                              P4_EXPR);
+          }
+#endif
+          sqlite3VdbeAddOp4(v, OP_ParallelAgg, iParCsr, addrParDone,
+                            p->pWhere!=0, (char*)aParSpec, P4_INTARRAY);
+          sqlite3VdbeAddOp1(v, OP_Close, iParCsr);
+        }
+
         /* This case runs if the aggregate has no GROUP BY clause.  The
         ** processing is much simpler since there is only a single row
         ** of output.
@@ -5759,6 +5927,14 @@ int sqlite3Select(
         }
         sqlite3WhereEnd(pWInfo);
         finalizeAggFunctions(pParse, &sAggInfo);
+
+        /* COMDB2 MODIFICATION */
+        if( iParCsr>=0 ){
+          sqlite3VdbeGoto(v, addrParSkip);
+          sqlite3VdbeResolveLabel(v, addrParDone);
+          sqlite3VdbeAddOp1(v, OP_Close, iParCsr);
+          sqlite3VdbeResolveLabel(v, addrParSkip);
+        }
       }
 
       sSort.pOrderBy = 0;
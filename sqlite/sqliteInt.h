@@ -3034,6 +3034,8 @@ struct Parse {
   With *pWith;              /* Current WITH clause, or NULL */
   /* COMDB2 MODIFICATION */
   int recording[MAX_CURSOR_IDS/sizeof(int)];  /* register which cursors are recording and which not */
+  int iRemLimit;            /* LIMIT register the next WHERE loop may pass
+                            ** to a remote cursor, see codeCursorHint() */
   With *pWithToFree;        /* Free this WITH object at the end of the parse */
 };
 
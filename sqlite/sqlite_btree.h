@@ -192,9 +192,20 @@ int sqlite3BtreeNewDb(Btree *p);
 **     to prefetch content from remote machines - to provide those
 **     implementations with limits on what needs to be prefetched and thereby
 **     reduce network bandwidth.
+**
+** BTREE_HINT_LIMIT  (arguments: i64, int)
+**
+**     COMDB2 MODIFICATION.  The first argument is the most rows that will be
+**     read from the cursor in a scan, or 0 or less if unknown.  It is only
+**     given when every row satisfying the _RANGE hint, if any, is one the
+**     query keeps; the second argument is true if a _RANGE hint was given
+**     just before, in which case the limit only holds if that hint could
+**     be applied.
 */
 #define BTREE_HINT_FLAGS 1       /* Set flags indicating cursor usage */
 #define BTREE_HINT_RANGE 2       /* Range constraints on queries */
+/* COMDB2 MODIFICATION */
+#define BTREE_HINT_LIMIT 3       /* Most rows the cursor will be read for */
 
 /*
 ** Values that may be OR'd together to form the second argument to the
@@ -347,6 +358,19 @@ int sqlite3BtreeCursorIsValid(BtCursor*);
 int sqlite3BtreeCount(BtCursor *, i64 *);
 #endif
 
+/* COMDB2 MODIFICATION */
+/* Aggregates sqlite3BtreeParallelAgg() can compute, as found in the P4 array
+** of OP_ParallelAgg: a (kind, column, register) triple per aggregate. */
+#define BTREE_AGG_COUNTSTAR 1     /* count(*) */
+#define BTREE_AGG_COUNT     2     /* count(col) */
+#define BTREE_AGG_SUM       3
+#define BTREE_AGG_TOTAL     4
+#define BTREE_AGG_AVG       5
+#define BTREE_AGG_MIN       6
+#define BTREE_AGG_MAX       7
+int sqlite3BtreeParallelAgg(BtCursor*, int nAgg, const int *aSpec,
+                            int bFiltered, sqlite3_value *aMem, int *pDone);
+
 #ifdef SQLITE_TEST
 int sqlite3BtreeCursorInfo(BtCursor*, int*, int);
 void sqlite3BtreeCursorList(Btree*);
@@ -3367,6 +3367,38 @@ case OP_Count: {         /* out2 */
 }
 #endif
 
+/* Opcode: ParallelAgg P1 P2 P3 P4 *
+** Synopsis: aggregates of cursor P1, all stripes at once
+**
+** COMDB2 MODIFICATION
+** P4 is an array of (kind, column, register) triples, one per aggregate
+** function of a query like "SELECT sum(a), max(b) FROM t".  Compute all of
+** them over the table opened by cursor P1 by scanning every data stripe on
+** its own thread, store the final values in their registers and jump to P2.
+** A remote table has them computed by its own database instead.
+**
+** If P3 is set, only the rows matching the range hint given to cursor P1
+** count; that can only be done for a remote table.
+**
+** If the table or the aggregates can't be done this way, fall through
+** without touching any register; the regular aggregate loop follows.
+*/
+case OP_ParallelAgg: {     /* jump */
+  BtCursor *pCrsr;
+  int done;
+
+  assert( p->apCsr[pOp->p1]->eCurType==CURTYPE_BTREE );
+  assert( pOp->p4type==P4_INTARRAY );
+  pCrsr = p->apCsr[pOp->p1]->uc.pCursor;
+  assert( pCrsr );
+  done = 0;
+  rc = sqlite3BtreeParallelAgg(pCrsr, (pOp->p4.ai[0]-1)/3, &pOp->p4.ai[1],
+                               pOp->p3, aMem, &done);
+  if( rc ) goto abort_due_to_error;
+  if( done ) goto jump_to_p2;
+  break;
+}
+
 /* Opcode: Savepoint P1 * * P4 *
 **
 ** Open, release or rollback the savepoint named by parameter P4, depending
@@ -7513,20 +7545,34 @@ case OP_Init: {          /* jump */
 }
 
 #ifdef SQLITE_ENABLE_CURSOR_HINTS
-/* Opcode: CursorHint P1 * * P4 *
+/* Opcode: CursorHint P1 P2 * P4 *
 **
 ** Provide a hint to cursor P1 that it only needs to return rows that
 ** satisfy the Expr in P4.  TK_REGISTER terms in the P4 expression refer
 ** to values currently held in registers.  TK_COLUMN terms in the P4
 ** expression refer to columns in the b-tree to which cursor P1 is pointing.
+**
+** COMDB2 MODIFICATION
+** If P2 is not zero, register P2 holds the most rows that will be read
+** from cursor P1 (LIMIT plus OFFSET).  P4 may be empty in that case.
 */
 case OP_CursorHint: {
   VdbeCursor *pC;
 
   assert( pOp->p1>=0 && pOp->p1<p->nCursor );
-  assert( pOp->p4type==P4_EXPR );
+  assert( pOp->p4type==P4_EXPR || (pOp->p2 && pOp->p4type==P4_NOTUSED) );
   pC = p->apCsr[pOp->p1];
-  if( pC )  sqlite3BtreeCursorHint(pC->uc.pCursor, BTREE_HINT_RANGE, pOp->p4.pExpr, aMem);
+  if( pC ){
+    if( pOp->p4type==P4_EXPR ){
+      sqlite3BtreeCursorHint(pC->uc.pCursor, BTREE_HINT_RANGE,
+                             pOp->p4.pExpr, aMem);
+    }
+    if( pOp->p2 ){
+      assert( aMem[pOp->p2].flags&MEM_Int );
+      sqlite3BtreeCursorHint(pC->uc.pCursor, BTREE_HINT_LIMIT,
+                             aMem[pOp->p2].u.i, pOp->p4type==P4_EXPR);
+    }
+  }
   break;
 }
 #endif /* SQLITE_ENABLE_CURSOR_HINTS */
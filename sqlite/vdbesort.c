@@ -1479,6 +1479,190 @@ static int vdbeSorterSort(SortSubtask *pTask, SorterList *pList){
   return pTask->pUnpacked->errCode;
 }
 
+/* COMDB2 MODIFICATION */
+/*
+** Large in-memory lists are cut into pieces that are sorted by helper
+** threads from the sql sorter pool and then merged here.  This is done
+** instead of turning on SQLITE_MAX_WORKER_THREADS because sqlite memory in
+** comdb2 comes from a per-thread allocator: the helpers only compare
+** records, and everything they touch is allocated and freed by the
+** calling thread.
+*/
+extern int gbl_sqlite_sorter_threads;
+extern int gbl_sqlite_sorter_minrecs;
+void comdb2_sorter_run_parallel(void (*)(void *), void **, int);
+
+#define SORTER_MAX_PIECES 8
+
+typedef struct SorterPiece SorterPiece;
+struct SorterPiece {
+  SortSubtask task;               /* Private compare context */
+  SorterRecord *pList;            /* Records in this piece */
+  SorterRecord **aSlot;           /* Merge slots, allocated by the caller */
+  int rc;                         /* Result of the sort */
+};
+
+static void vdbeSorterSortPiece(void *pArg){
+  SorterPiece *pPiece = (SorterPiece*)pArg;
+  SortSubtask *pTask = &pPiece->task;
+  SorterRecord **aSlot = pPiece->aSlot;
+  SorterRecord *p = pPiece->pList;
+  int i;
+
+  while( p ){
+    SorterRecord *pNext = p->u.pNext;
+    p->u.pNext = 0;
+    for(i=0; aSlot[i]; i++){
+      p = vdbeSorterMerge(pTask, p, aSlot[i]);
+      aSlot[i] = 0;
+    }
+    aSlot[i] = p;
+    p = pNext;
+  }
+
+  p = 0;
+  for(i=0; i<64; i++){
+    if( aSlot[i]==0 ) continue;
+    p = p ? vdbeSorterMerge(pTask, p, aSlot[i]) : aSlot[i];
+  }
+  pPiece->pList = p;
+  pPiece->rc = pTask->pUnpacked->errCode;
+}
+
+/*
+** Return the record that follows p in pList, whichever way the list is
+** linked.
+*/
+static SorterRecord *vdbeSorterListNext(SorterList *pList, SorterRecord *p){
+  if( pList->aMemory ){
+    if( (u8*)p==pList->aMemory ) return 0;
+    return (SorterRecord*)&pList->aMemory[p->u.iNext];
+  }
+  return p->u.pNext;
+}
+
+/*
+** True if every column of the sorter's key compares with BINARY in the
+** connection's own encoding.  Any other collation, or a conversion to
+** another encoding, goes through vdbeCompareMemString(), which allocates
+** on the connection: that can't happen on the sorter pool's threads.
+*/
+static int vdbeSorterParallelOk(VdbeSorter *pSorter){
+  KeyInfo *pKeyInfo = pSorter->pKeyInfo;
+  u8 enc = ENC(pSorter->db);
+  int i;
+
+  for(i=0; i<pKeyInfo->nField+pKeyInfo->nXField; i++){
+    CollSeq *pColl = pKeyInfo->aColl[i];
+    if( pColl && (pColl->enc!=enc
+               || sqlite3StrICmp(pColl->zName, sqlite3StrBINARY)) ){
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/*
+** Same as vdbeSorterSort(), but large lists are split across the sorter
+** pool.  Small lists, gbl_sqlite_sorter_threads==0, or keys that need a
+** collation, go straight to vdbeSorterSort().
+*/
+static int vdbeSorterSortParallel(SortSubtask *pTask, SorterList *pList){
+  sqlite3 *db = pTask->pSorter->db;
+  SorterPiece *aPiece;
+  void *apArg[SORTER_MAX_PIECES];
+  SorterRecord *p;
+  i64 nRec = 0;
+  i64 nPer;
+  int nPiece;
+  int nAlloc;
+  int i;
+  int rc;
+
+  if( gbl_sqlite_sorter_threads<=0 || gbl_sqlite_sorter_minrecs<=0
+   || !vdbeSorterParallelOk(pTask->pSorter) ){
+    return vdbeSorterSort(pTask, pList);
+  }
+  for(p=pList->pList; p; p=vdbeSorterListNext(pList, p)) nRec++;
+
+  nPiece = gbl_sqlite_sorter_threads + 1;
+  if( nPiece>SORTER_MAX_PIECES ) nPiece = SORTER_MAX_PIECES;
+  if( nRec/gbl_sqlite_sorter_minrecs < nPiece ){
+    nPiece = (int)(nRec/gbl_sqlite_sorter_minrecs);
+  }
+  if( nPiece<2 ){
+    return vdbeSorterSort(pTask, pList);
+  }
+
+  rc = vdbeSortAllocUnpacked(pTask);
+  if( rc!=SQLITE_OK ) return rc;
+  pTask->xCompare = vdbeSorterGetCompare(pTask->pSorter);
+
+  nAlloc = nPiece;
+  aPiece = (SorterPiece*)sqlite3MallocZero(nAlloc * sizeof(SorterPiece));
+  if( !aPiece ) return SQLITE_NOMEM_BKPT;
+  for(i=0; i<nAlloc && rc==SQLITE_OK; i++){
+    aPiece[i].task.pSorter = pTask->pSorter;
+    aPiece[i].task.xCompare = pTask->xCompare;
+    rc = vdbeSortAllocUnpacked(&aPiece[i].task);
+    if( rc==SQLITE_OK ){
+      aPiece[i].aSlot =
+          (SorterRecord**)sqlite3MallocZero(64 * sizeof(SorterRecord*));
+      if( !aPiece[i].aSlot ) rc = SQLITE_NOMEM_BKPT;
+    }
+    apArg[i] = &aPiece[i];
+  }
+
+  if( rc==SQLITE_OK ){
+    /* Relink as u.pNext while cutting, which is what vdbeSorterSort()
+    ** leaves behind as well. */
+    nPer = (nRec + nPiece - 1) / nPiece;
+    p = pList->pList;
+    for(i=0; i<nPiece; i++){
+      SorterRecord **pp = &aPiece[i].pList;
+      i64 n;
+      for(n=0; p && n<nPer; n++){
+        SorterRecord *pNext = vdbeSorterListNext(pList, p);
+        *pp = p;
+        pp = &p->u.pNext;
+        p = pNext;
+      }
+      *pp = 0;
+    }
+
+    comdb2_sorter_run_parallel(vdbeSorterSortPiece, apArg, nPiece);
+
+    for(i=0; i<nPiece; i++){
+      if( aPiece[i].rc!=SQLITE_OK ) rc = aPiece[i].rc;
+    }
+
+    /* Merge neighbouring pieces pairwise until one is left. */
+    while( nPiece>1 ){
+      int j = 0;
+      for(i=0; i<nPiece; i+=2){
+        SorterRecord *p1 = aPiece[i].pList;
+        if( i+1<nPiece ){
+          SorterRecord *p2 = aPiece[i+1].pList;
+          if( p1==0 ) p1 = p2;
+          else if( p2 ) p1 = vdbeSorterMerge(pTask, p1, p2);
+        }
+        aPiece[j++].pList = p1;
+      }
+      for(i=j; i<nPiece; i++) aPiece[i].pList = 0;
+      nPiece = j;
+    }
+    pList->pList = aPiece[0].pList;
+    if( rc==SQLITE_OK ) rc = pTask->pUnpacked->errCode;
+  }
+
+  for(i=0; i<nAlloc; i++){
+    sqlite3DbFree(db, aPiece[i].task.pUnpacked);
+    sqlite3_free(aPiece[i].aSlot);
+  }
+  sqlite3_free(aPiece);
+  return rc;
+}
+
 /*
 ** Initialize a PMA-writer object.
 */
@@ -1618,7 +1802,8 @@ static int vdbeSorterListToPMA(SortSubtask *pTask, SorterList *pList){
 
   /* Sort the list */
   if( rc==SQLITE_OK ){
-    rc = vdbeSorterSort(pTask, pList);
+    /* COMDB2 MODIFICATION */
+    rc = vdbeSorterSortParallel(pTask, pList);
   }
 
   if( rc==SQLITE_OK ){
@@ -2635,7 +2820,8 @@ int sqlite3VdbeSorterRewind(const VdbeCursor *pCsr, int *pbEof){
   if( pSorter->bUsePMA==0 ){
     if( pSorter->list.pList ){
       *pbEof = 0;
-      rc = vdbeSorterSort(&pSorter->aTask[0], &pSorter->list);
+      /* COMDB2 MODIFICATION */
+      rc = vdbeSorterSortParallel(&pSorter->aTask[0], &pSorter->list);
     }else{
       *pbEof = 1;
     }
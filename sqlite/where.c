@@ -4486,6 +4486,11 @@ WhereInfo *sqlite3WhereBegin(
   pWInfo->iBreak = pWInfo->iContinue = sqlite3VdbeMakeLabel(v);
   pWInfo->wctrlFlags = wctrlFlags;
   pWInfo->iLimit = iAuxArg;
+  /* COMDB2 MODIFICATION */
+  /* the LIMIT offered by the caller is for this loop only, not for the
+  ** loops of any subqueries coded while it is being built */
+  pWInfo->iRemLimit = pParse->iRemLimit;
+  pParse->iRemLimit = 0;
   pWInfo->savedNQueryLoop = pParse->nQueryLoop;
   memset(&pWInfo->nOBSat, 0, 
          offsetof(WhereInfo,sWC) - offsetof(WhereInfo,nOBSat));
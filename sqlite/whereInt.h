@@ -425,6 +425,7 @@ struct WhereInfo {
   int iContinue;            /* Jump here to continue with next record */
   int iBreak;               /* Jump here to break out of the loop */
   int savedNQueryLoop;      /* pParse->nQueryLoop outside the WHERE loop */
+  int iRemLimit;            /* COMDB2: LIMIT register for a remote cursor */
   u16 wctrlFlags;           /* Flags originally passed to sqlite3WhereBegin() */
   u8 nLevel;                /* Number of nested loop */
   i8 nOBSat;                /* Number of ORDER BY terms satisfied by indices */
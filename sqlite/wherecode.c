@@ -891,6 +891,10 @@ static void codeCursorHint(
   int i,j;
   struct CCurHint sHint;
   Walker sWalker;
+  /* COMDB2 MODIFICATION */
+  int bAllHinted = 1;   /* Every term on this cursor is in the hint */
+  int iRegLimit = 0;    /* LIMIT register to pass along, if any */
+  extern int gbl_fdb_pushdown;
 
   if( OptimizationDisabled(db, SQLITE_CursorHints) ) return;
 
@@ -926,7 +930,10 @@ static void codeCursorHint(
        TERM_CODED commented allows me still encode equality operations
        properly*/
     if( pTerm->wtFlags & (TERM_VIRTUAL/*|TERM_CODED*/) ) continue;
-    if( pTerm->prereqAll & pLevel->notReady ) continue;
+    if( pTerm->prereqAll & pLevel->notReady ){
+      bAllHinted = 0;
+      continue;
+    }
 
     /* Any terms specified as part of the ON(...) clause for any LEFT 
     ** JOIN for which the current table is not the rhs are omitted
@@ -958,10 +965,16 @@ static void codeCursorHint(
         sWalker.eCode = 0;
         sWalker.xExprCallback = codeCursorHintIsOrFunction;
         sqlite3WalkExpr(&sWalker, pTerm->pExpr);
-        if( sWalker.eCode ) continue;
+        if( sWalker.eCode ){
+          bAllHinted = 0;
+          continue;
+        }
       }
     }else{
-      if( ExprHasProperty(pTerm->pExpr, EP_FromJoin) ) continue;
+      if( ExprHasProperty(pTerm->pExpr, EP_FromJoin) ){
+        bAllHinted = 0;
+        continue;
+      }
     }
 
 
@@ -969,22 +982,47 @@ static void codeCursorHint(
     ** the cursor.  No need to hint initialization terms. */
     if( pTerm!=pEndRange ){
       for(j=0; j<pWLoop->nLTerm && pWLoop->aLTerm[j]!=pTerm; j++){}
-      if( j<pWLoop->nLTerm ) continue;
+      if( j<pWLoop->nLTerm ){
+        /* COMDB2 MODIFICATION */
+        /* index seeks go out as conditions on the key; rowid seeks don't */
+        if( sHint.pIdx==0 ) bAllHinted = 0;
+        continue;
+      }
     }
 
     /* No subqueries or non-deterministic functions allowed */
-    if( sqlite3ExprContainsSubquery(pTerm->pExpr) ) continue;
+    if( sqlite3ExprContainsSubquery(pTerm->pExpr) ){
+      bAllHinted = 0;
+      continue;
+    }
 
     /* If we survive all prior tests, that means this term is worth hinting */
     if( sHint.pIdx!=0 ){
       sWalker.eCode = 0;
       sWalker.xExprCallback = codeCursorHintCheckExpr;
       sqlite3WalkExpr(&sWalker, pTerm->pExpr);
-      if( sWalker.eCode ) continue;
+      if( sWalker.eCode ){
+        bAllHinted = 0;
+        continue;
+      }
     }
     pExpr = sqlite3ExprAnd(db, pExpr, sqlite3ExprDup(db, pTerm->pExpr, 0));
   } 
-  if( pExpr!=0 ){
+
+  /* COMDB2 MODIFICATION */
+  /* If the hint holds the whole WHERE clause of a query reading only this
+  ** table, and the rows come out of the scan already in ORDER BY order,
+  ** every row the remote side sends is one sqlite keeps: it can stop at
+  ** the LIMIT as well.  OP_CursorHint P2 is the register holding it. */
+  if( gbl_fdb_pushdown && bAllHinted && pWInfo->iRemLimit
+   && pWInfo->nLevel==1
+   && (pLoop->wsFlags & WHERE_MULTI_OR)==0 && pLoop->nSkip==0
+   && (pWInfo->pOrderBy==0 || pWInfo->nOBSat==pWInfo->pOrderBy->nExpr)
+  ){
+    iRegLimit = pWInfo->iRemLimit;
+  }
+
+  if( pExpr!=0 || iRegLimit ){
 #if 0
   Hipp refactoring and fixes to sqlite, overlapping mine
 
@@ -1011,8 +1049,8 @@ static void codeCursorHint(
     sWalker.xExprCallback = codeCursorHintFixExpr;
     sqlite3WalkExpr(&sWalker, pExpr);
     sqlite3VdbeAddOp4(v, OP_CursorHint, 
-                      (sHint.pIdx ? sHint.iIdxCur : sHint.iTabCur), 0, 0,
-                      (const char*)pExpr, P4_EXPR);
+                      (sHint.pIdx ? sHint.iIdxCur : sHint.iTabCur), iRegLimit,
+                      0, (const char*)pExpr, pExpr ? P4_EXPR : P4_NOTUSED);
 
   }
 }
@@ -0,0 +1,173 @@
+/*
+   Copyright 2017 Bloomberg Finance L.P.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+/*
+ * Compare the page I/O paths berkdb can use for checkpoint-style writes and
+ * random page reads:
+ *   buffered  plain pwrite/pread through the page cache
+ *   direct    O_DIRECT, one pwrite/pread per page (the directio path)
+ *   aio       O_DIRECT, each batch of pages submitted together through
+ *             __os_aio_rw (io_uring, or kernel aio as a fallback)
+ *
+ * Usage: aiobench [-f file] [-p pagesize] [-n filepages] [-b batch]
+ *                 [-r rounds]
+ */
+
+#include "db_config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "db_int.h"
+#include "mem_restore.h"
+
+enum { MODE_BUFFERED, MODE_DIRECT, MODE_AIO };
+static const char *modename[] = {"buffered", "direct", "aio"};
+
+static size_t pagesize = 4096;
+static int filepages = 65536;
+static int batch = 32;
+static int rounds = 2000;
+static const char *path = "aiobench.dat";
+
+static double now(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static int run_batch(int mode, int op, DB_AIO_REQ *reqs)
+{
+    int i;
+    ssize_t rc;
+
+    if (mode == MODE_AIO)
+        return __os_aio_rw(NULL, op, reqs, batch);
+
+    for (i = 0; i < batch; i++) {
+        if (op == DB_IO_WRITE)
+            rc = pwrite(reqs[i].fhp->fd, reqs[i].buf, reqs[i].len,
+                        reqs[i].off);
+        else
+            rc = pread(reqs[i].fhp->fd, reqs[i].buf, reqs[i].len, reqs[i].off);
+        if (rc != (ssize_t)reqs[i].len)
+            return rc < 0 ? errno : EIO;
+    }
+    return 0;
+}
+
+static int bench(int mode, int op, u_int8_t *bufs)
+{
+    DB_FH fh;
+    DB_AIO_REQ *reqs;
+    double start, elapsed;
+    int i, r, rc;
+
+    memset(&fh, 0, sizeof(fh));
+    fh.fd = open(path, O_RDWR | (mode == MODE_BUFFERED ? 0 : O_DIRECT));
+    if (fh.fd == -1) {
+        fprintf(stderr, "open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    if (mode != MODE_BUFFERED)
+        fh.flags = DB_FH_DIRECT;
+
+    reqs = calloc(batch, sizeof(DB_AIO_REQ));
+    srandom(1);
+    start = now();
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < batch; i++) {
+            reqs[i].fhp = &fh;
+            reqs[i].buf = bufs + i * pagesize;
+            reqs[i].len = pagesize;
+            reqs[i].off = (off_t)(random() % filepages) * pagesize;
+        }
+        if ((rc = run_batch(mode, op, reqs)) != 0) {
+            fprintf(stderr, "%s %s: %s\n", modename[mode],
+                    op == DB_IO_WRITE ? "write" : "read", strerror(rc));
+            break;
+        }
+        /* A checkpoint syncs what it wrote. */
+        if (op == DB_IO_WRITE && (r % 64) == 63)
+            fdatasync(fh.fd);
+    }
+    if (op == DB_IO_WRITE)
+        fdatasync(fh.fd);
+    elapsed = now() - start;
+
+    printf("%-8s %-5s %10.0f pages/s %8.1f MB/s\n", modename[mode],
+           op == DB_IO_WRITE ? "write" : "read",
+           (double)r * batch / elapsed,
+           (double)r * batch * pagesize / elapsed / (1024 * 1024));
+
+    free(reqs);
+    close(fh.fd);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    u_int8_t *bufs;
+    int c, fd, i, mode;
+
+    while ((c = getopt(argc, argv, "f:p:n:b:r:")) != -1) {
+        switch (c) {
+        case 'f': path = optarg; break;
+        case 'p': pagesize = atoi(optarg); break;
+        case 'n': filepages = atoi(optarg); break;
+        case 'b': batch = atoi(optarg); break;
+        case 'r': rounds = atoi(optarg); break;
+        default:
+            fprintf(stderr, "Usage: %s [-f file] [-p pagesize] "
+                            "[-n filepages] [-b batch] [-r rounds]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    if (posix_memalign((void **)&bufs, 4096, batch * pagesize) != 0) {
+        fprintf(stderr, "can't allocate %d pages\n", batch);
+        return 1;
+    }
+    memset(bufs, 0x5a, batch * pagesize);
+
+    if ((fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644)) == -1) {
+        fprintf(stderr, "open %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    for (i = 0; i < filepages; i++)
+        if (write(fd, bufs, pagesize) != pagesize) {
+            fprintf(stderr, "can't preallocate %s\n", path);
+            return 1;
+        }
+    fsync(fd);
+    close(fd);
+
+    for (mode = MODE_BUFFERED; mode <= MODE_AIO; mode++) {
+        if (bench(mode, DB_IO_WRITE, bufs) || bench(mode, DB_IO_READ, bufs))
+            break;
+    }
+
+    unlink(path);
+    free(bufs);
+    return 0;
+}
@@ -0,0 +1,201 @@
+/*
+   Copyright 2017 Bloomberg Finance L.P.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+/*
+ * Loads a table one row per statement and again with cdb2_bind_array,
+ * checks that both loads agree, that a failing row rolls back the whole
+ * array, and reports how long each load took.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <cdb2api.h>
+
+static cdb2_hndl_tp *db;
+
+static long long now_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+static void run(const char *sql)
+{
+    int rc = cdb2_run_statement(db, sql);
+    if (rc) {
+        fprintf(stderr, "run %s failed with rc %d errmsg %s\n", sql, rc,
+                cdb2_errstr(db));
+        exit(1);
+    }
+    while (cdb2_next_record(db) == CDB2_OK)
+        ;
+}
+
+static long long count(const char *sql)
+{
+    long long n;
+    if (cdb2_run_statement(db, sql) || cdb2_next_record(db) != CDB2_OK) {
+        fprintf(stderr, "run %s failed errmsg %s\n", sql, cdb2_errstr(db));
+        exit(1);
+    }
+    n = *(long long *)cdb2_column_value(db, 0);
+    while (cdb2_next_record(db) == CDB2_OK)
+        ;
+    return n;
+}
+
+static void usage(FILE *f, const char *argv0)
+{
+    fprintf(f, "usage: %s -d <dbname> [-t <tier>] [-n <rows>] [-b <batch>]\n",
+            argv0);
+}
+
+int main(int argc, char *argv[])
+{
+    char *dbname = NULL, *tier = "default";
+    int nrows = 1000, batch = 100;
+    long long *a, start, single_us, array_us;
+    char **b, *conf;
+    int c, i, rc;
+
+    while ((c = getopt(argc, argv, "d:t:n:b:h")) != -1) {
+        switch (c) {
+        case 'd': dbname = optarg; break;
+        case 't': tier = optarg; break;
+        case 'n': nrows = atoi(optarg); break;
+        case 'b': batch = atoi(optarg); break;
+        case 'h': usage(stdout, argv[0]); return 0;
+        default: usage(stderr, argv[0]); return 1;
+        }
+    }
+    if (dbname == NULL || nrows <= 0 || batch <= 0) {
+        usage(stderr, argv[0]);
+        return 1;
+    }
+
+    if ((conf = getenv("CDB2_CONFIG")) != NULL)
+        cdb2_set_comdb2db_config(conf);
+    if ((rc = cdb2_open(&db, dbname, tier, 0)) != 0) {
+        fprintf(stderr, "cdb2_open %s rc %d\n", dbname, rc);
+        return 1;
+    }
+
+    a = calloc(nrows, sizeof(long long));
+    b = calloc(nrows, sizeof(char *));
+    for (i = 0; i < nrows; i++) {
+        a[i] = i;
+        if (i % 10) {
+            b[i] = malloc(32);
+            snprintf(b[i], 32, "row %d", i);
+        }
+    }
+
+    run("drop table if exists bindarray1");
+    run("drop table if exists bindarray2");
+    run("create table bindarray1 {schema{int a cstring b[32] null=yes} "
+        "keys{\"a\" = a}}");
+    run("create table bindarray2 {schema{int a cstring b[32] null=yes} "
+        "keys{\"a\" = a}}");
+
+    start = now_us();
+    for (i = 0; i < nrows; i++) {
+        cdb2_bind_param(db, "a", CDB2_INTEGER, &a[i], sizeof(long long));
+        cdb2_bind_param(db, "b", CDB2_CSTRING, b[i], b[i] ? strlen(b[i]) : 0);
+        run("insert into bindarray1 values(@a, @b)");
+        cdb2_clearbindings(db);
+    }
+    single_us = now_us() - start;
+
+    start = now_us();
+    for (i = 0; i < nrows; i += batch) {
+        int n = (nrows - i < batch) ? nrows - i : batch;
+        cdb2_bind_array(db, "a", CDB2_INTEGER, &a[i], n, sizeof(long long));
+        cdb2_bind_array(db, "b", CDB2_CSTRING, &b[i], n, 0);
+        run("insert into bindarray2 values(@a, @b)");
+        cdb2_clearbindings(db);
+    }
+    array_us = now_us() - start;
+
+    if (count("select count(*) from bindarray2") != nrows ||
+        count("select count(*) from bindarray1 t1 join bindarray2 t2 on "
+              "t1.a = t2.a and t1.b is t2.b") != nrows) {
+        fprintf(stderr, "array load doesn't match single row load\n");
+        return 1;
+    }
+
+    /* The last row is a duplicate: nothing from the array is written. */
+    a[0] = nrows;
+    a[1] = nrows + 1;
+    a[2] = 0;
+    cdb2_bind_array(db, "a", CDB2_INTEGER, a, 3, sizeof(long long));
+    cdb2_bind_array(db, "b", CDB2_CSTRING, b, 3, 0);
+    rc = cdb2_run_statement(db, "insert into bindarray2 values(@a, @b)");
+    cdb2_clearbindings(db);
+    if (rc == 0) {
+        fprintf(stderr, "duplicate row in array was accepted\n");
+        return 1;
+    }
+    if (count("select count(*) from bindarray2") != nrows) {
+        fprintf(stderr, "failed array left rows behind\n");
+        return 1;
+    }
+
+    /* Inside a transaction the rows join it, and a scalar is repeated. */
+    long long minus = -1;
+    run("begin");
+    cdb2_bind_array(db, "a", CDB2_INTEGER, a, 2, sizeof(long long));
+    cdb2_bind_param(db, "b", CDB2_CSTRING, "intrans", 7);
+    run("insert into bindarray2 values(@a, @b)");
+    cdb2_clearbindings(db);
+    cdb2_bind_param(db, "a", CDB2_INTEGER, &minus, sizeof(long long));
+    run("insert into bindarray2 values(@a, 'x')");
+    cdb2_clearbindings(db);
+    run("commit");
+    if (count("select count(*) from bindarray2 where b = 'intrans'") != 2 ||
+        count("select count(*) from bindarray2") != nrows + 3) {
+        fprintf(stderr, "array in transaction was not applied\n");
+        return 1;
+    }
+
+    /* Only one result set would come back, so a select is refused. */
+    cdb2_bind_array(db, "a", CDB2_INTEGER, a, 3, sizeof(long long));
+    rc = cdb2_run_statement(db, "select b from bindarray2 where a = @a");
+    cdb2_clearbindings(db);
+    if (rc == 0) {
+        fprintf(stderr, "select with an array of rows was accepted\n");
+        return 1;
+    }
+    while (cdb2_next_record(db) == CDB2_OK)
+        ;
+    if (count("select count(*) from bindarray2") != nrows + 3) {
+        fprintf(stderr, "refused select disturbed the handle\n");
+        return 1;
+    }
+
+    printf("%d rows: one per statement %lld us, arrays of %d %lld us\n",
+           nrows, single_us, batch, array_us);
+
+    for (i = 0; i < nrows; i++)
+        free(b[i]);
+    free(b);
+    free(a);
+    cdb2_close(db);
+    return 0;
+}
@@ -0,0 +1,175 @@
+/*
+   Copyright 2017 Bloomberg Finance L.P.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+/*
+ * Concurrent DB_MPOOLFILE->get/put of resident pages, with and without the
+ * mpool_optimistic_get lock-free path.  The main thread keeps every page
+ * pinned, the way cursors keep root and internal pages pinned, so each get
+ * and put in the timed loop shares an already referenced buffer.  With -u
+ * nothing is held and every get is a first reference (the locked path).
+ *
+ * Usage: mpoolbench [-d dir] [-p pagesize] [-n pages] [-t maxthreads]
+ *                   [-o opsperthread] [-u]
+ */
+
+#include "db_config.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "db_int.h"
+#include "mem_restore.h"
+
+static const char *dir = "/tmp";
+static size_t pagesize = 4096;
+static int npages = 64;
+static int maxthreads = 16;
+static int nops = 1000000;
+static int unpinned;
+
+static DB_ENV *dbenv;
+static DB_MPOOLFILE *mpf;
+
+static double now(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void *worker(void *arg)
+{
+    unsigned int seed = (unsigned int)(uintptr_t)arg;
+    unsigned long sum = 0;
+    db_pgno_t pgno;
+    u_int8_t *p;
+    int i, rc;
+
+    for (i = 0; i < nops; i++) {
+        pgno = rand_r(&seed) % npages;
+        if ((rc = mpf->get(mpf, &pgno, 0, &p)) != 0) {
+            fprintf(stderr, "get %u rc %d\n", pgno, rc);
+            exit(1);
+        }
+        sum += p[pagesize - 1];
+        if ((rc = mpf->put(mpf, p, 0)) != 0) {
+            fprintf(stderr, "put %u rc %d\n", pgno, rc);
+            exit(1);
+        }
+    }
+    return (void *)sum;
+}
+
+static double run(int nthreads)
+{
+    pthread_t tids[nthreads];
+    double start;
+    int i;
+
+    start = now();
+    for (i = 0; i < nthreads; i++)
+        pthread_create(&tids[i], NULL, worker, (void *)(uintptr_t)(i + 1));
+    for (i = 0; i < nthreads; i++)
+        pthread_join(tids[i], NULL);
+    return (double)nops * nthreads / (now() - start);
+}
+
+int main(int argc, char *argv[])
+{
+    DB_MPOOL_STAT *sp;
+    u_int8_t **held;
+    db_pgno_t pgno;
+    int c, i, nthreads, opt, rc;
+    double rate[2];
+
+    while ((c = getopt(argc, argv, "d:p:n:t:o:u")) != -1) {
+        switch (c) {
+        case 'd': dir = optarg; break;
+        case 'p': pagesize = strtoul(optarg, NULL, 10); break;
+        case 'n': npages = atoi(optarg); break;
+        case 't': maxthreads = atoi(optarg); break;
+        case 'o': nops = atoi(optarg); break;
+        case 'u': unpinned = 1; break;
+        default:
+            fprintf(stderr, "Usage: %s [-d dir] [-p pagesize] [-n pages] "
+                            "[-t maxthreads] [-o opsperthread] [-u]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    if ((rc = db_env_create(&dbenv, 0)) != 0 ||
+        (rc = dbenv->set_cachesize(dbenv, 0, 64 * 1024 * 1024, 1)) != 0 ||
+        (rc = dbenv->open(dbenv, dir,
+                          DB_CREATE | DB_INIT_MPOOL | DB_PRIVATE | DB_THREAD,
+                          0)) != 0) {
+        fprintf(stderr, "env open: %s\n", db_strerror(rc));
+        return 1;
+    }
+
+    /* A temporary file: the pages never leave the cache. */
+    if ((rc = dbenv->memp_fcreate(dbenv, &mpf, 0)) != 0 ||
+        (rc = mpf->open(mpf, NULL, DB_CREATE, 0644, pagesize)) != 0) {
+        fprintf(stderr, "mpool file open: %s\n", db_strerror(rc));
+        return 1;
+    }
+
+    held = calloc(npages, sizeof(u_int8_t *));
+    for (i = 0; i < npages; i++) {
+        pgno = i;
+        if ((rc = mpf->get(mpf, &pgno, DB_MPOOL_CREATE, &held[i])) != 0) {
+            fprintf(stderr, "create page %d: %s\n", i, db_strerror(rc));
+            return 1;
+        }
+        memset(held[i], i, pagesize);
+        if (unpinned) {
+            mpf->put(mpf, held[i], DB_MPOOL_DIRTY);
+            held[i] = NULL;
+        } else
+            mpf->set(mpf, held[i], DB_MPOOL_DIRTY);
+    }
+
+    printf("%d %s pages of %zu bytes, %d gets per thread\n", npages,
+           unpinned ? "unpinned" : "pinned", pagesize, nops);
+    printf("%8s %14s %14s %8s\n", "threads", "locked/s", "optimistic/s",
+           "speedup");
+    for (nthreads = 1; nthreads <= maxthreads; nthreads *= 2) {
+        for (opt = 0; opt < 2; opt++) {
+            dbenv->attr.mpool_optimistic_get = opt;
+            rate[opt] = run(nthreads);
+        }
+        printf("%8d %14.0f %14.0f %7.2fx\n", nthreads, rate[0], rate[1],
+               rate[1] / rate[0]);
+    }
+
+    if (dbenv->memp_stat(dbenv, &sp, NULL, 0) == 0) {
+        printf("st_hash_optimistic %u st_hash_optimistic_miss %u\n",
+               sp->st_hash_optimistic, sp->st_hash_optimistic_miss);
+        free(sp);
+    }
+
+    for (i = 0; i < npages; i++)
+        if (held[i] != NULL)
+            mpf->put(mpf, held[i], 0);
+    free(held);
+    mpf->close(mpf, DB_MPOOL_DISCARD);
+    dbenv->close(dbenv, 0);
+    return 0;
+}
@@ -0,0 +1,240 @@
+/*
+   Copyright 2017 Bloomberg Finance L.P.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+/*
+ * Runs the same point queries one at a time and pipelined with
+ * cdb2_run_statement_async, checks that the answers agree and reports how
+ * long each took.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <cdb2api.h>
+
+static cdb2_hndl_tp *db;
+
+static long long now_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+static void run(const char *sql)
+{
+    int rc = cdb2_run_statement(db, sql);
+    if (rc) {
+        fprintf(stderr, "run %s failed with rc %d errmsg %s\n", sql, rc,
+                cdb2_errstr(db));
+        exit(1);
+    }
+    while (cdb2_next_record(db) == CDB2_OK)
+        ;
+}
+
+/* Stop reading from our tcp connections to the database, so the next poll
+ * sees the connection drop after its statements went out. */
+static void drop_reads(void)
+{
+    struct sockaddr_storage addr;
+    socklen_t len;
+    struct stat st;
+    int fd;
+
+    for (fd = 3; fd < 1024; fd++) {
+        len = sizeof(addr);
+        if (fstat(fd, &st) != 0 || !S_ISSOCK(st.st_mode) ||
+            getpeername(fd, (struct sockaddr *)&addr, &len) != 0)
+            continue;
+        if (addr.ss_family == AF_INET || addr.ss_family == AF_INET6)
+            shutdown(fd, SHUT_RD);
+    }
+}
+
+static long long count_dropped(void)
+{
+    long long n;
+    int rc = cdb2_run_statement(db, "select count(*) from pipeline_drop");
+    if (rc || cdb2_next_record(db) != CDB2_OK) {
+        fprintf(stderr, "count failed rc %d %s\n", rc, cdb2_errstr(db));
+        exit(1);
+    }
+    n = *(long long *)cdb2_column_value(db, 0);
+    while (cdb2_next_record(db) == CDB2_OK)
+        ;
+    return n;
+}
+
+static void usage(FILE *f, const char *argv0)
+{
+    fprintf(f, "usage: %s -d <dbname> [-t <tier>] [-n <rows>] [-b <batch>]\n",
+            argv0);
+}
+
+int main(int argc, char *argv[])
+{
+    char *dbname = NULL, *tier = "default";
+    int nrows = 1000, batch = 50;
+    long long *sync_vals, start, sync_us, async_us;
+    int c, i, j, rc, seq;
+    char *conf;
+
+    while ((c = getopt(argc, argv, "d:t:n:b:h")) != -1) {
+        switch (c) {
+        case 'd': dbname = optarg; break;
+        case 't': tier = optarg; break;
+        case 'n': nrows = atoi(optarg); break;
+        case 'b': batch = atoi(optarg); break;
+        case 'h': usage(stdout, argv[0]); return 0;
+        default: usage(stderr, argv[0]); return 1;
+        }
+    }
+    if (dbname == NULL || nrows <= 0 || batch <= 0) {
+        usage(stderr, argv[0]);
+        return 1;
+    }
+
+    if ((conf = getenv("CDB2_CONFIG")) != NULL)
+        cdb2_set_comdb2db_config(conf);
+    if ((rc = cdb2_open(&db, dbname, tier, 0)) != 0) {
+        fprintf(stderr, "cdb2_open %s rc %d\n", dbname, rc);
+        return 1;
+    }
+
+    run("drop table if exists pipeline");
+    run("create table pipeline {schema{int a int b} keys{\"a\" = a}}");
+    for (i = 0; i < nrows; i++) {
+        long long a = i, b = i * 7;
+        cdb2_bind_param(db, "a", CDB2_INTEGER, &a, sizeof(a));
+        cdb2_bind_param(db, "b", CDB2_INTEGER, &b, sizeof(b));
+        run("insert into pipeline values(@a, @b)");
+        cdb2_clearbindings(db);
+    }
+
+    sync_vals = calloc(nrows, sizeof(long long));
+    start = now_us();
+    for (i = 0; i < nrows; i++) {
+        long long a = i;
+        cdb2_bind_param(db, "a", CDB2_INTEGER, &a, sizeof(a));
+        rc = cdb2_run_statement(db, "select b from pipeline where a = @a");
+        cdb2_clearbindings(db);
+        if (rc || cdb2_next_record(db) != CDB2_OK) {
+            fprintf(stderr, "select %d failed rc %d %s\n", i, rc,
+                    cdb2_errstr(db));
+            return 1;
+        }
+        sync_vals[i] = *(long long *)cdb2_column_value(db, 0);
+        while (cdb2_next_record(db) == CDB2_OK)
+            ;
+    }
+    sync_us = now_us() - start;
+
+    start = now_us();
+    for (i = 0; i < nrows; i += batch) {
+        int n = (nrows - i < batch) ? nrows - i : batch;
+        for (j = 0; j < n; j++) {
+            long long a = i + j;
+            cdb2_bind_param(db, "a", CDB2_INTEGER, &a, sizeof(a));
+            rc = cdb2_run_statement_async(
+                db, "select b from pipeline where a = @a", &seq);
+            cdb2_clearbindings(db);
+            if (rc) {
+                fprintf(stderr, "queue %d failed rc %d %s\n", i + j, rc,
+                        cdb2_errstr(db));
+                return 1;
+            }
+        }
+        for (j = 0; j < n; j++) {
+            rc = cdb2_poll(db, &seq);
+            if (rc || cdb2_next_record(db) != CDB2_OK) {
+                fprintf(stderr, "poll %d failed rc %d %s\n", i + j, rc,
+                        cdb2_errstr(db));
+                return 1;
+            }
+            if (seq != i + j ||
+                *(long long *)cdb2_column_value(db, 0) != sync_vals[i + j]) {
+                fprintf(stderr, "seq %d row %d: got %lld want %lld\n", seq,
+                        i + j, *(long long *)cdb2_column_value(db, 0),
+                        sync_vals[i + j]);
+                return 1;
+            }
+        }
+    }
+    if ((rc = cdb2_poll(db, &seq)) != CDB2_OK_DONE || seq != -1) {
+        fprintf(stderr, "final poll rc %d seq %d\n", rc, seq);
+        return 1;
+    }
+    async_us = now_us() - start;
+
+    /* A bad statement in the middle doesn't disturb its neighbours. */
+    cdb2_run_statement_async(db, "select 1", NULL);
+    cdb2_run_statement_async(db, "select nosuchcolumn from pipeline", NULL);
+    cdb2_run_statement_async(db, "select 3", NULL);
+    if ((rc = cdb2_poll(db, NULL)) != 0 || cdb2_next_record(db) != CDB2_OK ||
+        *(long long *)cdb2_column_value(db, 0) != 1 ||
+        cdb2_poll(db, NULL) == 0 || (rc = cdb2_poll(db, NULL)) != 0 ||
+        cdb2_next_record(db) != CDB2_OK ||
+        *(long long *)cdb2_column_value(db, 0) != 3) {
+        fprintf(stderr, "error in pipeline rc %d %s\n", rc, cdb2_errstr(db));
+        return 1;
+    }
+    if (cdb2_run_statement(db, "select 4") != 0) {
+        fprintf(stderr, "sync after pipeline failed %s\n", cdb2_errstr(db));
+        return 1;
+    }
+    while (cdb2_next_record(db) == CDB2_OK)
+        ;
+
+    /* The connection drops after a write went out: it must be reported
+     * lost rather than run again, and the read behind it is resent. */
+    run("drop table if exists pipeline_drop");
+    run("create table pipeline_drop {schema{int a}}");
+    cdb2_run_statement_async(db, "insert into pipeline_drop values(1)", NULL);
+    cdb2_run_statement_async(db, "select 5", NULL);
+    drop_reads();
+    if ((rc = cdb2_poll(db, NULL)) != CDB2ERR_IO_ERROR) {
+        fprintf(stderr, "dropped write poll rc %d, want %d\n", rc,
+                CDB2ERR_IO_ERROR);
+        return 1;
+    }
+    if ((rc = cdb2_poll(db, NULL)) != 0 || cdb2_next_record(db) != CDB2_OK ||
+        *(long long *)cdb2_column_value(db, 0) != 5) {
+        fprintf(stderr, "read after dropped write rc %d %s\n", rc,
+                cdb2_errstr(db));
+        return 1;
+    }
+    if ((rc = cdb2_poll(db, NULL)) != CDB2_OK_DONE) {
+        fprintf(stderr, "final poll after drop rc %d\n", rc);
+        return 1;
+    }
+    if (count_dropped() > 1) {
+        fprintf(stderr, "dropped write ran more than once\n");
+        return 1;
+    }
+
+    printf("%d point queries: one at a time %lld us, pipelined by %d %lld us\n",
+           nrows, sync_us, batch, async_us);
+
+    free(sync_vals);
+    cdb2_close(db);
+    return 0;
+}
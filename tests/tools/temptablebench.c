@@ -0,0 +1,211 @@
+/*
+   Copyright 2017 Bloomberg Finance L.P.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+/*
+ * Fills, scans, probes and drains the same temp tables twice: once with
+ * temptable_mem_budget at 0, which puts every table in its own berkeley
+ * btree, and once with a budget, which keeps them in memory until they go
+ * over it.  Checks that both give the same answers and reports how long
+ * each took.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <bdb_int.h>
+
+/* normally provided by the server */
+char *gbl_crypto = NULL;
+int gbl_temptable_pool_capacity = 0;
+pthread_key_t query_info_key;
+
+static long long now_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+static void die(const char *what, int rc, int bdberr)
+{
+    fprintf(stderr, "%s failed rc %d bdberr %d\n", what, rc, bdberr);
+    exit(1);
+}
+
+struct row {
+    unsigned int key;
+    char pad[60];
+};
+
+/* big-endian so memcmp order is numeric order */
+static void mkkey(unsigned char *k, unsigned int v)
+{
+    k[0] = v >> 24;
+    k[1] = v >> 16;
+    k[2] = v >> 8;
+    k[3] = v;
+}
+
+static unsigned long long run(bdb_state_type *bdb_state, int ntables,
+                              int nrows)
+{
+    unsigned long long sum = 0;
+    unsigned int seed = 1;
+    int t, i, rc, bdberr = 0;
+
+    for (t = 0; t < ntables; t++) {
+        struct temp_table *tbl;
+        struct temp_cursor *cur;
+        unsigned char k[4], prev[4];
+        struct row r;
+        int n;
+
+        tbl = bdb_temp_table_create(bdb_state, &bdberr);
+        if (tbl == NULL)
+            die("create", -1, bdberr);
+        cur = bdb_temp_table_cursor(bdb_state, tbl, NULL, &bdberr);
+        if (cur == NULL)
+            die("cursor", -1, bdberr);
+
+        memset(&r, 'x', sizeof(r));
+        for (i = 0; i < nrows; i++) {
+            r.key = rand_r(&seed) % (nrows * 4);
+            mkkey(k, r.key);
+            rc = bdb_temp_table_insert(bdb_state, cur, k, sizeof(k), &r,
+                                       sizeof(r), &bdberr);
+            if (rc)
+                die("insert", rc, bdberr);
+        }
+
+        /* full scan: keys must come back strictly ascending */
+        n = 0;
+        rc = bdb_temp_table_first(bdb_state, cur, &bdberr);
+        while (rc == 0) {
+            memcpy(k, bdb_temp_table_key(cur), sizeof(k));
+            if (n && memcmp(prev, k, sizeof(k)) >= 0)
+                die("scan order", -1, 0);
+            memcpy(prev, k, sizeof(k));
+            sum += ((struct row *)bdb_temp_table_data(cur))->key;
+            n++;
+            rc = bdb_temp_table_next(bdb_state, cur, &bdberr);
+        }
+        if (rc != IX_PASTEOF && rc != IX_EMPTY)
+            die("next", rc, bdberr);
+        sum += n;
+
+        /* point lookups, then delete every other row found */
+        for (i = 0; i < nrows; i++) {
+            void *key = malloc(sizeof(k));
+            mkkey(key, i);
+            rc = bdb_temp_table_find_exact(bdb_state, cur, key, sizeof(k),
+                                           &bdberr);
+            if (rc == IX_FND) {
+                sum += i;
+                if ((i & 1) &&
+                    (rc = bdb_temp_table_delete(bdb_state, cur, &bdberr)) != 0)
+                    die("delete", rc, bdberr);
+            } else if (rc == IX_NOTFND) {
+                free(key);
+            } else {
+                die("find_exact", rc, bdberr);
+            }
+        }
+
+        /* reverse scan of what's left */
+        rc = bdb_temp_table_last(bdb_state, cur, &bdberr);
+        while (rc == 0) {
+            sum += ((struct row *)bdb_temp_table_data(cur))->key * 3ULL;
+            rc = bdb_temp_table_prev(bdb_state, cur, &bdberr);
+        }
+        if (rc != IX_PASTEOF && rc != IX_EMPTY)
+            die("prev", rc, bdberr);
+
+        bdb_temp_table_close_cursor(bdb_state, cur, &bdberr);
+        rc = bdb_temp_table_close(bdb_state, tbl, &bdberr);
+        if (rc)
+            die("close", rc, bdberr);
+    }
+    return sum;
+}
+
+static void usage(FILE *f, const char *argv0)
+{
+    fprintf(f, "usage: %s [-d <tmpdir>] [-t <tables>] [-n <rows>] "
+               "[-b <budget>]\n",
+            argv0);
+}
+
+int main(int argc, char *argv[])
+{
+    bdb_state_type *bdb_state;
+    char *tmpdir = "/tmp";
+    int ntables = 200, nrows = 2000, budget = 2097152, c;
+    unsigned long long btree_sum, mem_sum, spill_sum;
+    long long start, btree_us, mem_us, spill_us;
+
+    while ((c = getopt(argc, argv, "d:t:n:b:h")) != -1) {
+        switch (c) {
+        case 'd': tmpdir = optarg; break;
+        case 't': ntables = atoi(optarg); break;
+        case 'n': nrows = atoi(optarg); break;
+        case 'b': budget = atoi(optarg); break;
+        case 'h': usage(stdout, argv[0]); return 0;
+        default: usage(stderr, argv[0]); return 1;
+        }
+    }
+    if (ntables <= 0 || nrows <= 0 || budget <= 0) {
+        usage(stderr, argv[0]);
+        return 1;
+    }
+
+    bdb_state = calloc(1, sizeof(bdb_state_type));
+    bdb_state->attr = calloc(1, sizeof(bdb_attr_type));
+    bdb_state->attr->temptable_cachesz = 262144;
+    bdb_state->attr->temptable_mem_threshold = 512;
+    bdb_state->tmpdir = tmpdir;
+    bdb_state->temp_stats = calloc(1, sizeof(*bdb_state->temp_stats));
+    pthread_mutex_init(&bdb_state->temp_list_lock, NULL);
+    pthread_key_create(&query_info_key, NULL);
+
+    bdb_state->attr->temptable_mem_budget = 0;
+    start = now_us();
+    btree_sum = run(bdb_state, ntables, nrows);
+    btree_us = now_us() - start;
+
+    bdb_state->attr->temptable_mem_budget = budget;
+    start = now_us();
+    mem_sum = run(bdb_state, ntables, nrows);
+    mem_us = now_us() - start;
+
+    /* small enough that every table moves to a btree while being filled */
+    bdb_state->attr->temptable_mem_budget = nrows * sizeof(struct row) / 4;
+    start = now_us();
+    spill_sum = run(bdb_state, ntables, nrows);
+    spill_us = now_us() - start;
+
+    if (btree_sum != mem_sum || btree_sum != spill_sum) {
+        fprintf(stderr, "results differ: btree %llu memory %llu spill %llu\n",
+                btree_sum, mem_sum, spill_sum);
+        return 1;
+    }
+
+    printf("%d tables of %d rows: btree %lld us, in memory %lld us, "
+           "spilled %lld us\n",
+           ntables, nrows, btree_us, mem_us, spill_us);
+    return 0;
+}
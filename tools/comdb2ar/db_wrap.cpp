@@ -2,9 +2,11 @@
 #include "error.h"
 
 #include <iostream>
+#include <cstring>
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <arpa/inet.h>
 
 #include "chksum.h"
 
@@ -111,6 +113,22 @@ bool DB_Wrap::get_swapped() const
 	return m_swapped;
 }
 
+// A btree page written with the page_compress berkattr is a header and the
+// compressed page; the header carries a crc32c of the compressed bytes.
+// Layout from berkdb/mp/mp_pgcompress.c.
+static bool compressed_page(const uint8_t *page, size_t pagesize, bool *ok)
+{
+    uint32_t hdr[4];
+    memcpy(hdr, page, sizeof(hdr));
+    if (ntohl(hdr[0]) != 0xffffffffU ||
+        (ntohl(hdr[1]) & 0xffffff00U) != 0x50475a00U)
+        return false;
+    uint32_t len = ntohl(hdr[2]);
+    *ok = len <= pagesize - sizeof(hdr) &&
+          crc32c(page + sizeof(hdr), len) == ntohl(hdr[3]);
+    return true;
+}
+
 bool verify_checksum(uint8_t *page, size_t pagesize, bool crypto, bool swapped)
 // Verify the checksum on a regular Berkeley DB page.  Returns true if
 // the checksum is correct, false otherwise
@@ -118,6 +136,10 @@ bool verify_checksum(uint8_t *page, size_t pagesize, bool crypto, bool swapped)
     if (pagesize <= 4096)
         return true;
 
+    bool ok;
+    if (compressed_page(page, pagesize, &ok))
+        return ok;
+
     uint8_t *chksum_ptr = page;
     PAGE *pagep = (PAGE *)page;
 
@@ -111,10 +111,10 @@ static const char *usage_text[] =
 "Valid options include:-",
 "   -o      Enable ODH (on-disk headers) for table.",
 "   -O      Remove ODH for table.",
-"   -z <blob|rec>:<none|rle|zlib|crle|lz4>",
+"   -z <blob|rec>:<none|rle|zlib|crle|lz4|zstd>",
 "           Set compression option for blobs or records. Valid options are:",
-"           blob:type  where type is one of none, rle, zlib or lz4",
-"           rec:type   where type is one of none, rle, zlib, lz4 or crle (comdb2 rle).",
+"           blob:type  where type is one of none, rle, zlib, lz4 or zstd",
+"           rec:type   where type is one of none, rle, zlib, lz4, zstd or crle (comdb2 rle).",
 "           Enabling compression for either blobs or data records implies the -o option.",
 "   -i on|off",
 "           Set or remove in-place updates for table.  Enabling in-place ",
@@ -132,8 +132,9 @@ static const char *usage_text[] =
 "   -d      Live schema change only - delay the commit of the new schema until",
 "           the 'sccommit' message trap is received.  Allows you to have split",
 "           second precision over when the new schema will take effect.",
-"   -s index|stripe|parallel|dump",
+"   -s index|stripe|parallel|dump|sorted",
 "           Set table scan mode.  Usually you should just accept the default.",
+"           sorted builds new indexes from sorted keys; readonly only.",
 "   -r      Force a full rebuild of the table regardless of the extent of the",
 "           changes.",
 "   -f      Force the schema change to go ahead even if disk space is low.",
@@ -638,6 +639,7 @@ main(int argc, char *argv[])
                    strcmp(optarg, "dump") == 0 ||
                    strcmp(optarg, "stripe") == 0 ||
                    strcmp(optarg, "parallel") == 0 ||
+                   strcmp(optarg, "sorted") == 0 ||
                    strcmp(optarg, "old") == 0)
                 {
                     snprintf(scanmodebuf, sizeof(scanmodebuf),
@@ -770,6 +772,9 @@ main(int argc, char *argv[])
                     } else if (strcmp(colon, "lz4") == 0) {
                         *opt = "lz4";
                         odh_opt = "add_headers";
+                    } else if (strcmp(colon, "zstd") == 0) {
+                        *opt = "zstd";
+                        odh_opt = "add_headers";
                     } else {
                         usage();
                     }